@@ -24,7 +24,8 @@ func GetChatClient() *openai.Client {
 	return openai.NewClientWithConfig(conf)
 }
 
-func StreamChatContent(client *openai.Client, b []byte, dataSource chan string, content []openai.ChatCompletionMessage, contentChan chan *openai.ChatCompletionMessage) []openai.ChatCompletionMessage {
+// ctx 取消时请求随之中止，dataSource 收到 "NETWORK_ERROR"
+func StreamChatContent(ctx context.Context, client *openai.Client, b []byte, dataSource chan string, content []openai.ChatCompletionMessage, contentChan chan *openai.ChatCompletionMessage) []openai.ChatCompletionMessage {
 	completionMessage := new(openai.ChatCompletionMessage)
 	completionMessage = &openai.ChatCompletionMessage{Role: openai.ChatMessageRoleUser, Content: string(b)}
 	content = StitchContent(content, completionMessage)
@@ -35,15 +36,16 @@ func StreamChatContent(client *openai.Client, b []byte, dataSource chan string,
 		Messages:  requestContent,
 		Stream:    true,
 	}
-	go streamSendContent(client, req, dataSource, contentChan)
+	go streamSendContent(ctx, client, req, dataSource, contentChan)
 	return content
 }
 
-func streamSendContent(client *openai.Client, req openai.ChatCompletionRequest, dataSource chan string, contentChan chan *openai.ChatCompletionMessage) {
-	ctx := context.Background()
+func streamSendContent(ctx context.Context, client *openai.Client, req openai.ChatCompletionRequest, dataSource chan string, contentChan chan *openai.ChatCompletionMessage) {
 	stream, err := client.CreateChatCompletionStream(ctx, req)
 	if err != nil {
 		fmt.Printf("ChatCompletionStream error: %v\n", err)
+		dataSource <- "NETWORK_ERROR"
+		return
 	}
 	defer stream.Close()
 	responseContent := ""
@@ -61,6 +63,7 @@ func streamSendContent(client *openai.Client, req openai.ChatCompletionRequest,
 		if err != nil {
 			fmt.Printf("\nStream error: %v\n", err)
 			dataSource <- "NETWORK_ERROR"
+			return
 		}
 		responseContent = responseContent + response.Choices[0].Delta.Content
 
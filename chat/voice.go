@@ -0,0 +1,83 @@
+package chat
+
+import (
+	"context"
+	"errors"
+	"github.com/sashabaranov/go-openai"
+	"sync"
+)
+
+var ErrNetwork = errors.New("chat: network error")
+
+// 语音对话的回复生成，实现 voice.Responder
+// 每个用户一份对话历史，与 gws.Ws 一样保留 9 条。
+type VoiceResponder struct {
+	client *openai.Client
+
+	mu      sync.Mutex
+	history map[string][]openai.ChatCompletionMessage
+}
+
+func NewVoiceResponder(client *openai.Client) *VoiceResponder {
+	return &VoiceResponder{
+		client:  client,
+		history: make(map[string][]openai.ChatCompletionMessage),
+	}
+}
+
+// 在历史的副本上发起请求，提前开始的请求被取消时历史不受影响
+func (r *VoiceResponder) Respond(ctx context.Context, userID, text string, tokens chan<- string) (string, error) {
+	content := make([]openai.ChatCompletionMessage, 9)
+	r.mu.Lock()
+	copy(content, r.history[userID])
+	r.mu.Unlock()
+
+	dataSource := make(chan string, 64)
+	contentChan := make(chan *openai.ChatCompletionMessage, 1)
+	StreamChatContent(ctx, r.client, []byte(text), dataSource, content, contentChan)
+	for {
+		var token string
+		select {
+		case token = <-dataSource:
+		case <-ctx.Done():
+			go drainStream(dataSource)
+			return "", ctx.Err()
+		}
+		switch token {
+		case "EOF":
+			answer := <-contentChan
+			return answer.Content, nil
+		case "NETWORK_ERROR":
+			return "", ErrNetwork
+		case "":
+			continue
+		}
+		select {
+		case tokens <- token:
+		case <-ctx.Done():
+			go drainStream(dataSource)
+			return "", ctx.Err()
+		}
+	}
+}
+
+func (r *VoiceResponder) Commit(userID, text, answer string) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	content := r.history[userID]
+	if content == nil {
+		content = make([]openai.ChatCompletionMessage, 9)
+	}
+	content = StitchContent(content, &openai.ChatCompletionMessage{Role: openai.ChatMessageRoleUser, Content: text})
+	content = StitchContent(content, &openai.ChatCompletionMessage{Role: openai.ChatMessageRoleAssistant, Content: answer})
+	r.history[userID] = content
+}
+
+// 读完被放弃的流，ctx 取消后 streamSendContent 送出的剩余 token 与 NETWORK_ERROR 不会阻塞
+func drainStream(dataSource chan string) {
+	for token := range dataSource {
+		if token == "EOF" || token == "NETWORK_ERROR" {
+			return
+		}
+	}
+}
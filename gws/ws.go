@@ -41,7 +41,7 @@ func Ws(c *gin.Context, client *openai.Client) {
 			break
 		} else {
 			dataSource := make(chan string)
-			content = chat.StreamChatContent(client, message, dataSource, content, contentChannel)
+			content = chat.StreamChatContent(c.Request.Context(), client, message, dataSource, content, contentChannel)
 			for {
 				answer = <-dataSource
 				if answer == "EOF" {
@@ -49,6 +49,8 @@ func Ws(c *gin.Context, client *openai.Client) {
 					content = chat.StitchContent(content, rsp)
 					fmt.Println(content)
 					break
+				} else if answer == "NETWORK_ERROR" {
+					break
 				} else {
 					// 将消息返回给客户端
 					err = conn.WriteMessage(websocket.TextMessage, []byte(answer))
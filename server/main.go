@@ -7,6 +7,8 @@ import (
 	"gchatgpt/trtc/swing"
 	"github.com/gin-gonic/gin"
 	"net/http"
+	"os"
+	"strconv"
 )
 
 import "C"
@@ -34,6 +36,33 @@ func main() {
 		gws.Ws(c, client)
 	})
 
+	// 房间语音对话的统计
+	if pipeline := startVoice(client); pipeline != nil {
+		r.GET("/voice/stats", func(c *gin.Context) {
+			c.JSON(http.StatusOK, pipeline.Stats())
+		})
+	}
+
+	// 逐帧时延，SWING_TRACE_SAMPLE_SHIFT 为每 2^n 帧追踪一帧，未设置、无效或为负时关闭
+	// 显式设为 0 时追踪每一帧，满负载下每帧多出约 100ns 且追踪缓冲会溢出，只用于排查问题
+	sampleShift := -1
+	if value := os.Getenv("SWING_TRACE_SAMPLE_SHIFT"); value != "" {
+		shift, err := strconv.Atoi(value)
+		if err != nil {
+			fmt.Println("trace: invalid SWING_TRACE_SAMPLE_SHIFT:", value)
+		} else {
+			sampleShift = shift
+		}
+	}
+	swing.EnableTracing(sampleShift)
+	r.GET("/trace/latency", func(c *gin.Context) {
+		snapshot := swing.LatencySnapshot()
+		if c.Query("reset") == "1" {
+			swing.ResetLatency()
+		}
+		c.JSON(http.StatusOK, snapshot)
+	})
+
 	// 静态文件处理
 	r.Static("/static", "./static")
 
@@ -0,0 +1,80 @@
+package main
+
+import (
+	"fmt"
+	"gchatgpt/chat"
+	"gchatgpt/trtc/swing"
+	"gchatgpt/voice"
+	"github.com/sashabaranov/go-openai"
+	"os"
+	"strconv"
+)
+
+// 房间语音接入对话，设置 TRTC_SDKAPPID、TRTC_ROOM、TRTC_USERID、TRTC_USERSIG
+// 且有可用的 voice.Transcriber 时启用，见 newTranscriber()。
+func startVoice(client *openai.Client) *voice.Pipeline {
+	sdkAppID, err := strconv.ParseUint(os.Getenv("TRTC_SDKAPPID"), 10, 32)
+	roomID := os.Getenv("TRTC_ROOM")
+	if err != nil || roomID == "" {
+		return nil
+	}
+	transcriber := newTranscriber()
+	if transcriber == nil {
+		fmt.Println("voice: no speech recognizer configured, room voice disabled")
+		return nil
+	}
+	source := swing.NewVoiceSource(swing.VoiceSourceConfig{PrerollMs: -1})
+	result := source.EnterRoom(uint32(sdkAppID), roomID, os.Getenv("TRTC_USERID"), os.Getenv("TRTC_USERSIG"))
+	if result != 0 {
+		fmt.Println("voice: enter room failed:", result)
+		source.Close()
+		return nil
+	}
+
+	pipeline := voice.NewPipeline(transcriber, chat.NewVoiceResponder(client), voice.DefaultPipelineConfig())
+	go pumpVoice(source, pipeline)
+	go func() {
+		for reply := range pipeline.Replies() {
+			if reply.Done {
+				fmt.Printf("voice: %s %q -> %q %v\n", reply.UserID, reply.Text, reply.Answer, reply.Err)
+			}
+		}
+	}()
+	return pipeline
+}
+
+// 语音识别，目前还没有接入识别服务，返回 nil 时不启用房间语音
+// VOICE_FAKE_STT=1 时使用 voice.LocalTranscriber 替身：不识别真实音频，按脚本生成问题
+// 并发给对话服务，仅用于联调整条链路，会消耗对话服务的 token。
+func newTranscriber() voice.Transcriber {
+	if os.Getenv("VOICE_FAKE_STT") == "1" {
+		fmt.Println("voice: VOICE_FAKE_STT=1, using scripted transcripts instead of room audio")
+		return voice.NewLocalTranscriber()
+	}
+	return nil
+}
+
+// 把 VoiceSource 的事件按顺序交给流水线
+func pumpVoice(source *swing.VoiceSource, pipeline *voice.Pipeline) {
+	var events []swing.VoiceEvent
+	var err error
+	for {
+		events, err = source.Read(events[:0], -1)
+		if err != nil {
+			return
+		}
+		for _, event := range events {
+			switch event.Type {
+			case swing.VoiceSpeechStart:
+				pipeline.StartUtterance(event.UserID, event.SampleRate)
+			case swing.VoiceAudio:
+				pipeline.Audio(event.UserID, event.Samples)
+				swing.TraceStamp(event.TraceKey, swing.TraceProcess)
+			case swing.VoiceSpeechEnd:
+				pipeline.EndUtterance(event.UserID)
+			case swing.VoiceUserExit:
+				pipeline.RemoveUser(event.UserID)
+			}
+		}
+	}
+}
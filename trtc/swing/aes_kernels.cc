@@ -0,0 +1,584 @@
+#include "aes_kernels.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SWING_AES_X86 1
+#endif
+
+namespace swing {
+
+namespace {
+
+std::atomic<bool> g_force_scalar(false);
+
+const uint8_t kSbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+inline uint8_t XTime(uint8_t x) {
+  return static_cast<uint8_t>((x << 1) ^ ((x >> 7) * 0x1b));
+}
+
+inline uint32_t LoadBE32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void StoreBE32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+inline uint64_t LoadBE64(const uint8_t* p) {
+  return (static_cast<uint64_t>(LoadBE32(p)) << 32) | LoadBE32(p + 4);
+}
+
+inline void StoreBE64(uint8_t* p, uint64_t v) {
+  StoreBE32(p, static_cast<uint32_t>(v >> 32));
+  StoreBE32(p + 4, static_cast<uint32_t>(v));
+}
+
+void AesEncryptBlockC(const AesKey& key, const uint8_t in[16], uint8_t out[16]) {
+  uint8_t state[16];
+  for (int i = 0; i < 16; ++i) {
+    state[i] = in[i] ^ key.round_keys[i];
+  }
+  for (int round = 1; round <= key.rounds; ++round) {
+    // SubBytes + ShiftRows，state[r + 4c] 取自第 (c + r) % 4 列
+    uint8_t t[16];
+    for (int c = 0; c < 4; ++c) {
+      for (int r = 0; r < 4; ++r) {
+        t[r + 4 * c] = kSbox[state[r + 4 * ((c + r) & 3)]];
+      }
+    }
+    if (round != key.rounds) {
+      for (int c = 0; c < 4; ++c) {
+        uint8_t* col = t + 4 * c;
+        uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+        col[0] = a0 ^ all ^ XTime(a0 ^ a1);
+        col[1] = a1 ^ all ^ XTime(a1 ^ a2);
+        col[2] = a2 ^ all ^ XTime(a2 ^ a3);
+        col[3] = a3 ^ all ^ XTime(a3 ^ a0);
+      }
+    }
+    const uint8_t* round_key = key.round_keys + 16 * round;
+    for (int i = 0; i < 16; ++i) {
+      state[i] = t[i] ^ round_key[i];
+    }
+  }
+  memcpy(out, state, 16);
+}
+
+void AesCtrXorC(const AesKey& key,
+                const uint8_t counter[16],
+                const uint8_t* in,
+                uint8_t* out,
+                size_t length) {
+  uint8_t block[16];
+  uint8_t stream[16];
+  memcpy(block, counter, 16);
+  uint32_t ctr = LoadBE32(block + 12);
+  while (length > 0) {
+    StoreBE32(block + 12, ctr++);
+    AesEncryptBlockC(key, block, stream);
+    size_t n = length < 16 ? length : 16;
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = in[i] ^ stream[i];
+    }
+    in += n;
+    out += n;
+    length -= n;
+  }
+}
+
+// GF(2^128) 乘法，SP 800-38D 算法 1，|x| / |y| / |z| 为大端的高低 64 位
+void GfMulC(uint64_t x_hi, uint64_t x_lo, uint64_t y_hi, uint64_t y_lo, uint64_t* z_hi,
+            uint64_t* z_lo) {
+  uint64_t hi = 0, lo = 0;
+  uint64_t v_hi = y_hi, v_lo = y_lo;
+  for (int i = 0; i < 128; ++i) {
+    uint64_t bit = i < 64 ? (x_hi >> (63 - i)) & 1 : (x_lo >> (127 - i)) & 1;
+    uint64_t mask = 0 - bit;
+    hi ^= v_hi & mask;
+    lo ^= v_lo & mask;
+    uint64_t carry = v_lo & 1;
+    v_lo = (v_lo >> 1) | (v_hi << 63);
+    v_hi = (v_hi >> 1) ^ ((0 - carry) & 0xe100000000000000ull);
+  }
+  *z_hi = hi;
+  *z_lo = lo;
+}
+
+void GhashUpdateC(const GhashKey& key, uint8_t state[16], const uint8_t* data, size_t length) {
+  uint64_t h_hi = LoadBE64(key.powers);
+  uint64_t h_lo = LoadBE64(key.powers + 8);
+  uint64_t s_hi = LoadBE64(state);
+  uint64_t s_lo = LoadBE64(state + 8);
+  while (length > 0) {
+    uint8_t block[16] = {0};
+    size_t n = length < 16 ? length : 16;
+    memcpy(block, data, n);
+    s_hi ^= LoadBE64(block);
+    s_lo ^= LoadBE64(block + 8);
+    GfMulC(s_hi, s_lo, h_hi, h_lo, &s_hi, &s_lo);
+    data += n;
+    length -= n;
+  }
+  StoreBE64(state, s_hi);
+  StoreBE64(state + 8, s_lo);
+}
+
+#if defined(SWING_AES_X86)
+
+bool HasAesNi() {
+  static const bool has_aesni = __builtin_cpu_supports("aes") &&
+                                __builtin_cpu_supports("pclmul") &&
+                                __builtin_cpu_supports("sse4.1");
+  return has_aesni;
+}
+
+bool HasVaes() {
+  static const bool has_vaes = HasAesNi() && __builtin_cpu_supports("avx2") &&
+                               __builtin_cpu_supports("vaes") &&
+                               __builtin_cpu_supports("vpclmulqdq");
+  return has_vaes;
+}
+
+#define SWING_AESNI_TARGET __attribute__((target("aes,pclmul,sse4.1")))
+#define SWING_VAES_TARGET __attribute__((target("aes,pclmul,sse4.1,avx2,vaes,vpclmulqdq")))
+
+SWING_AESNI_TARGET inline __m128i CounterBlock(__m128i base, uint32_t ctr) {
+  return _mm_insert_epi32(base, static_cast<int>(__builtin_bswap32(ctr)), 3);
+}
+
+SWING_AESNI_TARGET inline __m128i ByteSwap(__m128i x) {
+  const __m128i mask = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm_shuffle_epi8(x, mask);
+}
+
+SWING_AESNI_TARGET inline __m128i EncryptAesNi(const __m128i* rk, int rounds, __m128i b) {
+  b = _mm_xor_si128(b, rk[0]);
+  for (int i = 1; i < rounds; ++i) {
+    b = _mm_aesenc_si128(b, rk[i]);
+  }
+  return _mm_aesenclast_si128(b, rk[rounds]);
+}
+
+SWING_AESNI_TARGET void AesEncryptBlockAesNi(const AesKey& key,
+                                             const uint8_t in[16],
+                                             uint8_t out[16]) {
+  // rk[0] 在循环外载入，编译器无从判断 |rounds| 非负时也不会报未初始化
+  __m128i rk[15];
+  rk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.round_keys));
+  for (int i = 1; i <= key.rounds; ++i) {
+    rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.round_keys + 16 * i));
+  }
+  __m128i b = EncryptAesNi(rk, key.rounds,
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), b);
+}
+
+// 末尾不足一个分组的部分
+SWING_AESNI_TARGET void CtrTail(const __m128i* rk,
+                                int rounds,
+                                __m128i block,
+                                const uint8_t* in,
+                                uint8_t* out,
+                                size_t length) {
+  uint8_t stream[16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(stream), EncryptAesNi(rk, rounds, block));
+  for (size_t i = 0; i < length; ++i) {
+    out[i] = in[i] ^ stream[i];
+  }
+}
+
+SWING_AESNI_TARGET void AesCtrXorAesNi(const AesKey& key,
+                                       const uint8_t counter[16],
+                                       const uint8_t* in,
+                                       uint8_t* out,
+                                       size_t length) {
+  const int rounds = key.rounds;
+  __m128i rk[15];
+  for (int i = 0; i <= rounds; ++i) {
+    rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.round_keys + 16 * i));
+  }
+  const __m128i base = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counter));
+  uint32_t ctr = LoadBE32(counter + 12);
+
+  // 8 个分组交错执行，掩盖 aesenc 的延迟
+  while (length >= 8 * kAesBlockSize) {
+    __m128i b[8];
+    for (int j = 0; j < 8; ++j) {
+      b[j] = _mm_xor_si128(CounterBlock(base, ctr + j), rk[0]);
+    }
+    ctr += 8;
+    for (int i = 1; i < rounds; ++i) {
+      for (int j = 0; j < 8; ++j) {
+        b[j] = _mm_aesenc_si128(b[j], rk[i]);
+      }
+    }
+    for (int j = 0; j < 8; ++j) {
+      b[j] = _mm_aesenclast_si128(b[j], rk[rounds]);
+      __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * j));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16 * j), _mm_xor_si128(x, b[j]));
+    }
+    in += 8 * kAesBlockSize;
+    out += 8 * kAesBlockSize;
+    length -= 8 * kAesBlockSize;
+  }
+  while (length >= kAesBlockSize) {
+    __m128i b = EncryptAesNi(rk, rounds, CounterBlock(base, ctr++));
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(x, b));
+    in += kAesBlockSize;
+    out += kAesBlockSize;
+    length -= kAesBlockSize;
+  }
+  if (length > 0) {
+    CtrTail(rk, rounds, CounterBlock(base, ctr), in, out, length);
+  }
+}
+
+// 无约减的 128 位无进位乘法，操作数为字节反转后的表示
+SWING_AESNI_TARGET inline void ClMul(__m128i a, __m128i b, __m128i* lo, __m128i* hi) {
+  __m128i t0 = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i t1 = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+  __m128i t2 = _mm_clmulepi64_si128(a, b, 0x11);
+  *lo = _mm_xor_si128(t0, _mm_slli_si128(t1, 8));
+  *hi = _mm_xor_si128(t2, _mm_srli_si128(t1, 8));
+}
+
+// 左移一位后按 x^128 + x^7 + x^2 + x + 1 约减，见 Intel《Carry-Less Multiplication
+// Instruction and its Usage for Computing the GCM Mode》算法 5
+SWING_AESNI_TARGET inline __m128i Reduce(__m128i lo, __m128i hi) {
+  __m128i t7 = _mm_srli_epi32(lo, 31);
+  __m128i t8 = _mm_srli_epi32(hi, 31);
+  lo = _mm_slli_epi32(lo, 1);
+  hi = _mm_slli_epi32(hi, 1);
+  __m128i t9 = _mm_srli_si128(t7, 12);
+  t8 = _mm_slli_si128(t8, 4);
+  t7 = _mm_slli_si128(t7, 4);
+  lo = _mm_or_si128(lo, t7);
+  hi = _mm_or_si128(_mm_or_si128(hi, t8), t9);
+
+  t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)),
+                     _mm_slli_epi32(lo, 25));
+  t8 = _mm_srli_si128(t7, 4);
+  lo = _mm_xor_si128(lo, _mm_slli_si128(t7, 12));
+  __m128i t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)),
+                             _mm_srli_epi32(lo, 7));
+  t2 = _mm_xor_si128(t2, t8);
+  lo = _mm_xor_si128(lo, t2);
+  return _mm_xor_si128(hi, lo);
+}
+
+SWING_AESNI_TARGET void GhashUpdateAesNi(const GhashKey& key,
+                                         uint8_t state[16],
+                                         const uint8_t* data,
+                                         size_t length) {
+  __m128i h[4];
+  for (int i = 0; i < 4; ++i) {
+    h[i] = ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(key.powers + 16 * i)));
+  }
+  __m128i s = ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)));
+
+  // 4 个分组一组：(S ^ X1)·H^4 ^ X2·H^3 ^ X3·H^2 ^ X4·H，只约减一次
+  while (length >= 4 * kAesBlockSize) {
+    __m128i lo, hi, l, h2;
+    __m128i x = _mm_xor_si128(s, ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data))));
+    ClMul(x, h[3], &lo, &hi);
+    for (int j = 1; j < 4; ++j) {
+      x = ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * j)));
+      ClMul(x, h[3 - j], &l, &h2);
+      lo = _mm_xor_si128(lo, l);
+      hi = _mm_xor_si128(hi, h2);
+    }
+    s = Reduce(lo, hi);
+    data += 4 * kAesBlockSize;
+    length -= 4 * kAesBlockSize;
+  }
+  while (length > 0) {
+    uint8_t block[16] = {0};
+    size_t n = length < 16 ? length : 16;
+    memcpy(block, data, n);
+    __m128i lo, hi;
+    __m128i x = ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)));
+    ClMul(_mm_xor_si128(s, x), h[0], &lo, &hi);
+    s = Reduce(lo, hi);
+    data += n;
+    length -= n;
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), ByteSwap(s));
+}
+
+SWING_VAES_TARGET inline __m256i CounterPair(__m128i base, uint32_t ctr) {
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(CounterBlock(base, ctr)),
+                                 CounterBlock(base, ctr + 1), 1);
+}
+
+SWING_VAES_TARGET void AesCtrXorVaes(const AesKey& key,
+                                     const uint8_t counter[16],
+                                     const uint8_t* in,
+                                     uint8_t* out,
+                                     size_t length) {
+  const int rounds = key.rounds;
+  __m256i rk[15];
+  for (int i = 0; i <= rounds; ++i) {
+    rk[i] = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.round_keys + 16 * i)));
+  }
+  const __m128i base = _mm_loadu_si128(reinterpret_cast<const __m128i*>(counter));
+  uint32_t ctr = LoadBE32(counter + 12);
+
+  // 每条指令处理两个分组，16 个分组交错执行
+  while (length >= 16 * kAesBlockSize) {
+    __m256i b[8];
+    for (int j = 0; j < 8; ++j) {
+      b[j] = _mm256_xor_si256(CounterPair(base, ctr + 2 * j), rk[0]);
+    }
+    ctr += 16;
+    for (int i = 1; i < rounds; ++i) {
+      for (int j = 0; j < 8; ++j) {
+        b[j] = _mm256_aesenc_epi128(b[j], rk[i]);
+      }
+    }
+    for (int j = 0; j < 8; ++j) {
+      b[j] = _mm256_aesenclast_epi128(b[j], rk[rounds]);
+      __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 32 * j));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 32 * j), _mm256_xor_si256(x, b[j]));
+    }
+    in += 16 * kAesBlockSize;
+    out += 16 * kAesBlockSize;
+    length -= 16 * kAesBlockSize;
+  }
+  while (length >= 2 * kAesBlockSize) {
+    __m256i b = _mm256_xor_si256(CounterPair(base, ctr), rk[0]);
+    ctr += 2;
+    for (int i = 1; i < rounds; ++i) {
+      b = _mm256_aesenc_epi128(b, rk[i]);
+    }
+    b = _mm256_aesenclast_epi128(b, rk[rounds]);
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_xor_si256(x, b));
+    in += 2 * kAesBlockSize;
+    out += 2 * kAesBlockSize;
+    length -= 2 * kAesBlockSize;
+  }
+  if (length > 0) {
+    // 剩余不足两个分组，交给 AES-NI 实现，计数器从当前位置继续
+    uint8_t next[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(next), CounterBlock(base, ctr));
+    AesCtrXorAesNi(key, next, in, out, length);
+  }
+}
+
+SWING_VAES_TARGET inline __m256i ByteSwap256(__m256i x) {
+  const __m256i mask = _mm256_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                       0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return _mm256_shuffle_epi8(x, mask);
+}
+
+SWING_VAES_TARGET inline void ClMul256(__m256i a, __m256i b, __m256i* lo, __m256i* hi) {
+  __m256i t0 = _mm256_clmulepi64_epi128(a, b, 0x00);
+  __m256i t1 = _mm256_xor_si256(_mm256_clmulepi64_epi128(a, b, 0x10),
+                                _mm256_clmulepi64_epi128(a, b, 0x01));
+  __m256i t2 = _mm256_clmulepi64_epi128(a, b, 0x11);
+  *lo = _mm256_xor_si256(*lo, _mm256_xor_si256(t0, _mm256_slli_si256(t1, 8)));
+  *hi = _mm256_xor_si256(*hi, _mm256_xor_si256(t2, _mm256_srli_si256(t1, 8)));
+}
+
+SWING_VAES_TARGET void GhashUpdateVaes(const GhashKey& key,
+                                       uint8_t state[16],
+                                       const uint8_t* data,
+                                       size_t length) {
+  if (length >= 8 * kAesBlockSize) {
+    // 两个 128 位通道分别对应相邻的两个分组，乘数依次为
+    // (H^8, H^7)、(H^6, H^5)、(H^4, H^3)、(H^2, H^1)
+    __m256i h[4];
+    for (int j = 0; j < 4; ++j) {
+      const uint8_t* high = key.powers + 16 * (7 - 2 * j);
+      __m128i even = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high));
+      __m128i odd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high - 16));
+      h[j] = ByteSwap256(_mm256_inserti128_si256(_mm256_castsi128_si256(even), odd, 1));
+    }
+    __m128i s = ByteSwap(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)));
+    while (length >= 8 * kAesBlockSize) {
+      __m256i lo = _mm256_setzero_si256();
+      __m256i hi = _mm256_setzero_si256();
+      for (int j = 0; j < 4; ++j) {
+        __m256i x =
+            ByteSwap256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32 * j)));
+        if (j == 0) {
+          x = _mm256_xor_si256(x, _mm256_inserti128_si256(_mm256_setzero_si256(), s, 0));
+        }
+        ClMul256(x, h[j], &lo, &hi);
+      }
+      __m128i lo128 = _mm_xor_si128(_mm256_castsi256_si128(lo), _mm256_extracti128_si256(lo, 1));
+      __m128i hi128 = _mm_xor_si128(_mm256_castsi256_si128(hi), _mm256_extracti128_si256(hi, 1));
+      s = Reduce(lo128, hi128);
+      data += 8 * kAesBlockSize;
+      length -= 8 * kAesBlockSize;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), ByteSwap(s));
+  }
+  if (length > 0) {
+    GhashUpdateAesNi(key, state, data, length);
+  }
+}
+
+#endif  // SWING_AES_X86
+
+enum AesImpl {
+  kAesImplC,
+  kAesImplAesNi,
+  kAesImplVaes,
+};
+
+AesImpl CurrentImpl() {
+  if (g_force_scalar.load(std::memory_order_relaxed)) {
+    return kAesImplC;
+  }
+#if defined(SWING_AES_X86)
+  if (HasVaes()) {
+    return kAesImplVaes;
+  }
+  if (HasAesNi()) {
+    return kAesImplAesNi;
+  }
+#endif
+  return kAesImplC;
+}
+
+}  // namespace
+
+const char* AesKernelName() {
+  switch (CurrentImpl()) {
+    case kAesImplVaes:
+      return "vaes";
+    case kAesImplAesNi:
+      return "aesni";
+    default:
+      return "c";
+  }
+}
+
+void ForceScalarAesKernels(bool force) {
+  g_force_scalar.store(force, std::memory_order_relaxed);
+}
+
+bool AesExpandKey(const uint8_t* key, size_t key_bytes, AesKey* out) {
+  if (key == nullptr || out == nullptr ||
+      (key_bytes != 16 && key_bytes != 24 && key_bytes != 32)) {
+    return false;
+  }
+  const int nk = static_cast<int>(key_bytes / 4);
+  out->rounds = nk + 6;
+  const int words = 4 * (out->rounds + 1);
+  uint8_t* w = out->round_keys;
+  memcpy(w, key, key_bytes);
+  uint8_t rcon = 1;
+  for (int i = nk; i < words; ++i) {
+    uint8_t t[4];
+    memcpy(t, w + 4 * (i - 1), 4);
+    if (i % nk == 0) {
+      uint8_t first = t[0];
+      t[0] = static_cast<uint8_t>(kSbox[t[1]] ^ rcon);
+      t[1] = kSbox[t[2]];
+      t[2] = kSbox[t[3]];
+      t[3] = kSbox[first];
+      rcon = XTime(rcon);
+    } else if (nk > 6 && i % nk == 4) {
+      for (int j = 0; j < 4; ++j) {
+        t[j] = kSbox[t[j]];
+      }
+    }
+    for (int j = 0; j < 4; ++j) {
+      w[4 * i + j] = w[4 * (i - nk) + j] ^ t[j];
+    }
+  }
+  return true;
+}
+
+void AesEncryptBlock(const AesKey& key, const uint8_t in[16], uint8_t out[16]) {
+#if defined(SWING_AES_X86)
+  if (CurrentImpl() != kAesImplC) {
+    AesEncryptBlockAesNi(key, in, out);
+    return;
+  }
+#endif
+  AesEncryptBlockC(key, in, out);
+}
+
+void AesCtrXor(const AesKey& key,
+               const uint8_t counter[16],
+               const uint8_t* in,
+               uint8_t* out,
+               size_t length) {
+  switch (CurrentImpl()) {
+#if defined(SWING_AES_X86)
+    case kAesImplVaes:
+      AesCtrXorVaes(key, counter, in, out, length);
+      return;
+    case kAesImplAesNi:
+      AesCtrXorAesNi(key, counter, in, out, length);
+      return;
+#endif
+    default:
+      AesCtrXorC(key, counter, in, out, length);
+  }
+}
+
+void GhashInit(const AesKey& key, GhashKey* out) {
+  uint8_t zero[16] = {0};
+  uint8_t h[16];
+  AesEncryptBlockC(key, zero, h);
+  // 幂次统一以大端字节序保存，各实现加载时自行转换
+  uint64_t h_hi = LoadBE64(h);
+  uint64_t h_lo = LoadBE64(h + 8);
+  uint64_t p_hi = h_hi;
+  uint64_t p_lo = h_lo;
+  for (int i = 0; i < 8; ++i) {
+    StoreBE64(out->powers + 16 * i, p_hi);
+    StoreBE64(out->powers + 16 * i + 8, p_lo);
+    GfMulC(p_hi, p_lo, h_hi, h_lo, &p_hi, &p_lo);
+  }
+}
+
+void GhashUpdate(const GhashKey& key, uint8_t state[16], const uint8_t* data, size_t length) {
+  switch (CurrentImpl()) {
+#if defined(SWING_AES_X86)
+    case kAesImplVaes:
+      GhashUpdateVaes(key, state, data, length);
+      return;
+    case kAesImplAesNi:
+      GhashUpdateAesNi(key, state, data, length);
+      return;
+#endif
+    default:
+      GhashUpdateC(key, state, data, length);
+  }
+}
+
+}  // namespace swing
@@ -0,0 +1,60 @@
+//
+// 功能说明：
+//   AES-CTR / GHASH 基础算子，供 MediaCipher 实现 AES-GCM / AES-CTR。
+//   x86 上运行时检测 VAES + VPCLMULQDQ（一条指令处理两个分组）或
+//   AES-NI + PCLMULQDQ，其余情况走标量实现，三种实现的输出逐字节一致。
+//   只需要加密方向：CTR 与 GCM 的解密同样使用分组加密。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AES_KERNELS_H_
+#define GCHATGPT_TRTC_SWING_AES_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace swing {
+
+const size_t kAesBlockSize = 16;
+
+// 扩展后的加密轮密钥，布局与 FIPS-197 一致，AES-NI 可直接加载
+struct AesKey {
+  uint8_t round_keys[15 * 16];
+  // 10 / 12 / 14
+  int rounds;
+};
+
+// GHASH 子密钥 H 及其幂，顺序为 H, H^2, ..., H^8，按 GCM 的大端字节序保存，
+// 与具体实现无关，切换实现后仍可使用
+struct GhashKey {
+  uint8_t powers[8 * 16];
+};
+
+// 当前使用的实现："vaes"、"aesni" 或 "c"
+const char* AesKernelName();
+
+// 强制使用标量实现，用于基准测试对比
+void ForceScalarAesKernels(bool force);
+
+// 扩展密钥，|key_bytes| 取 16、24 或 32，其他长度返回 false
+bool AesExpandKey(const uint8_t* key, size_t key_bytes, AesKey* out);
+
+// 加密单个分组
+void AesEncryptBlock(const AesKey& key, const uint8_t in[16], uint8_t out[16]);
+
+// CTR 模式，|counter| 为首个计数块，低 32 位按大端递增（GCM 的 inc32）
+// |in| 与 |out| 可以相同。
+void AesCtrXor(const AesKey& key,
+               const uint8_t counter[16],
+               const uint8_t* in,
+               uint8_t* out,
+               size_t length);
+
+// 由 AES 密钥计算 GHASH 子密钥 H = E(K, 0^128)
+void GhashInit(const AesKey& key, GhashKey* out);
+
+// |state| = GHASH(|state|, |data|)，末尾不足 16 字节时补零
+void GhashUpdate(const GhashKey& key, uint8_t state[16], const uint8_t* data, size_t length);
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AES_KERNELS_H_
@@ -0,0 +1,531 @@
+#include "audio_encoder_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+
+#ifdef SWING_HAVE_OPUS
+#include <opus.h>
+#endif
+
+#include "frame_pool.h"
+
+namespace swing {
+
+namespace {
+
+// libopus 建议的单包上限
+const size_t kMaxPacketBytes = 4000;
+
+// 每个工作线程保留的空闲 PCM 缓冲个数
+const size_t kMaxSpareBuffers = 256;
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 当前进程允许运行的 CPU
+std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+void UpdateMax(std::atomic<uint64_t>* target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value > current &&
+         !target->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+bool IsOpusParams(const AudioEncodeParams& params) {
+  switch (params.sample_rate) {
+    case 8000:
+    case 12000:
+    case 16000:
+    case 24000:
+    case 48000:
+      break;
+    default:
+      return false;
+  }
+  switch (params.frame_length_ms) {
+    case 10:
+    case 20:
+    case 40:
+    case 60:
+      break;
+    default:
+      return false;
+  }
+  return params.channels == 1 || params.channels == 2;
+}
+
+#ifdef SWING_HAVE_OPUS
+
+class OpusAudioEncoder : public AudioEncoder {
+ public:
+  OpusAudioEncoder(OpusEncoder* encoder, int frame_size)
+      : encoder_(encoder), frame_size_(frame_size) {}
+  ~OpusAudioEncoder() override { opus_encoder_destroy(encoder_); }
+
+  int Encode(const int16_t* pcm, uint8_t* out, size_t capacity) override {
+    opus_int32 size = opus_encode(encoder_, pcm, frame_size_, out,
+                                  static_cast<opus_int32>(std::min(capacity, kMaxPacketBytes)));
+    return size < 0 ? liteav::trtc::ERR_FAILED : static_cast<int>(size);
+  }
+
+  liteav::trtc::AudioCodecType codec() const override {
+    return liteav::trtc::AUDIO_CODEC_TYPE_OPUS;
+  }
+
+ private:
+  OpusAudioEncoder(const OpusAudioEncoder&);
+  OpusAudioEncoder& operator=(const OpusAudioEncoder&);
+
+  OpusEncoder* const encoder_;
+  const int frame_size_;
+};
+
+#endif  // SWING_HAVE_OPUS
+
+// 默认工厂
+class OpusEncoderFactory : public AudioEncoderFactory {
+ public:
+  int Create(const AudioEncodeParams& params, std::unique_ptr<AudioEncoder>* encoder) override {
+    return CreateOpusEncoder(params, encoder);
+  }
+};
+
+OpusEncoderFactory g_opus_factory;
+
+}  // namespace
+
+int CreateOpusEncoder(const AudioEncodeParams& params, std::unique_ptr<AudioEncoder>* encoder) {
+  if (encoder == nullptr || !IsOpusParams(params) || params.bitrate_bps <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+#ifdef SWING_HAVE_OPUS
+  int error = OPUS_OK;
+  OpusEncoder* opus =
+      opus_encoder_create(params.sample_rate, params.channels, OPUS_APPLICATION_VOIP, &error);
+  if (opus == nullptr || error != OPUS_OK) {
+    return liteav::trtc::ERR_FAILED;
+  }
+  opus_encoder_ctl(opus, OPUS_SET_BITRATE(params.bitrate_bps));
+  encoder->reset(
+      new OpusAudioEncoder(opus, params.sample_rate * params.frame_length_ms / 1000));
+  return liteav::trtc::ERR_OK;
+#else
+  return liteav::trtc::ERR_NOT_SUPPORTED;
+#endif
+}
+
+void CloudAudioSender::OnEncodedAudio(int, const AudioFrame& frame, int64_t) {
+  if (cloud_->SendAudioFrame(frame) != liteav::trtc::ERR_OK) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+struct AudioEncoderPool::Channel {
+  Channel()
+      : id(0),
+        sink(nullptr),
+        worker(nullptr),
+        frame_samples(0),
+        pending(0),
+        removed(false),
+        fifo_offset(0),
+        fifo_pts(0) {}
+
+  int id;
+  AudioEncodeParams params;
+  std::unique_ptr<AudioEncoder> encoder;
+  EncodedAudioSink* sink;
+  Worker* worker;
+  // 一个编码帧的交错样本数
+  size_t frame_samples;
+
+  std::atomic<size_t> pending;
+  std::atomic<bool> removed;
+
+  // 以下仅工作线程访问
+  // 未凑满一帧的 PCM，有效数据从 |fifo_offset| 开始，|fifo_pts| 为其首个样本的 pts
+  std::vector<int16_t> fifo;
+  size_t fifo_offset;
+  uint32_t fifo_pts;
+  AudioFrame output;
+};
+
+class AudioEncoderPool::Worker {
+ public:
+  explicit Worker(int cpu)
+      : cpu_(cpu),
+        channels_(0),
+        running_(true),
+        encoded_frames_(0),
+        errors_(0),
+        encode_ns_total_(0),
+        encode_ns_max_(0),
+        batches_(0),
+        max_batch_frames_(0) {
+    thread_ = std::thread(&Worker::Run, this);
+  }
+
+  ~Worker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+  }
+
+  void Push(const std::shared_ptr<Channel>& channel, const AudioFrame& frame) {
+    bool notify = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Job job;
+      if (!spare_.empty()) {
+        job.pcm = std::move(spare_.back());
+        spare_.pop_back();
+      }
+      job.pcm.Assign(frame.data(), frame.size());
+      job.channel = channel;
+      job.pts = frame.pts;
+      notify = pending_.empty();
+      pending_.push_back(std::move(job));
+    }
+    if (notify) {
+      cond_.notify_one();
+    }
+  }
+
+  // 等待进行中的批次结束，之后不会再访问已标记移除的通道
+  void Sync() { std::lock_guard<std::mutex> lock(batch_mutex_); }
+
+  std::atomic<size_t>& channels() { return channels_; }
+
+  void AddStats(AudioEncoderPoolStats* stats) const {
+    stats->encoded_frames += encoded_frames_.load(std::memory_order_relaxed);
+    stats->errors += errors_.load(std::memory_order_relaxed);
+    stats->encode_ns_total += encode_ns_total_.load(std::memory_order_relaxed);
+    stats->encode_ns_max =
+        std::max(stats->encode_ns_max, encode_ns_max_.load(std::memory_order_relaxed));
+    stats->batches += batches_.load(std::memory_order_relaxed);
+    stats->max_batch_frames =
+        std::max(stats->max_batch_frames, max_batch_frames_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  struct Job {
+    Job() : pts(0) {}
+    Job(Job&& other)
+        : channel(std::move(other.channel)), pcm(std::move(other.pcm)), pts(other.pts) {}
+    Job& operator=(Job&& other) {
+      channel = std::move(other.channel);
+      pcm = std::move(other.pcm);
+      pts = other.pts;
+      return *this;
+    }
+
+    std::shared_ptr<Channel> channel;
+    PooledBuffer pcm;
+    uint32_t pts;
+  };
+
+  // 一个编码帧，数据在 |packets_| 中
+  struct Output {
+    Channel* channel;
+    size_t offset;
+    size_t size;
+    uint32_t pts;
+    int64_t encode_ns;
+  };
+
+  Worker(const Worker&);
+  Worker& operator=(const Worker&);
+
+  void Pin() {
+    if (cpu_ < 0) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  void Run() {
+    Pin();
+    std::vector<Job> batch;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this] { return !pending_.empty() || !running_; });
+        if (pending_.empty()) {
+          return;
+        }
+        batch.swap(pending_);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        Process(&batch);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < batch.size() && spare_.size() < kMaxSpareBuffers; ++i) {
+        spare_.push_back(std::move(batch[i].pcm));
+      }
+      batch.clear();
+    }
+  }
+
+  void Process(std::vector<Job>* batch) {
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    UpdateMax(&max_batch_frames_, batch->size());
+
+    // 按通道分组，组内保持提交顺序
+    std::stable_sort(batch->begin(), batch->end(), [](const Job& a, const Job& b) {
+      return a.channel->id < b.channel->id;
+    });
+
+    outputs_.clear();
+    packets_.clear();
+    for (size_t i = 0; i < batch->size(); ++i) {
+      Job& job = (*batch)[i];
+      Channel* channel = job.channel.get();
+      channel->pending.fetch_sub(1, std::memory_order_relaxed);
+      if (channel->removed.load(std::memory_order_acquire)) {
+        continue;
+      }
+      Append(channel, job);
+      Encode(channel);
+    }
+
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      const Output& out = outputs_[i];
+      Channel* channel = out.channel;
+      if (channel->removed.load(std::memory_order_acquire)) {
+        continue;
+      }
+      channel->output.SetData(packets_.data() + out.offset, out.size);
+      channel->output.pts = out.pts;
+      channel->sink->OnEncodedAudio(channel->id, channel->output, out.encode_ns);
+    }
+    // 释放本批对通道的引用，已移除的通道在这里析构
+    for (size_t i = 0; i < batch->size(); ++i) {
+      (*batch)[i].channel.reset();
+    }
+  }
+
+  void Append(Channel* channel, const Job& job) {
+    const int16_t* samples = reinterpret_cast<const int16_t*>(job.pcm.data());
+    const size_t count = job.pcm.size() / sizeof(int16_t);
+    if (channel->fifo_offset == channel->fifo.size()) {
+      channel->fifo.clear();
+      channel->fifo_offset = 0;
+      channel->fifo_pts = job.pts;
+    } else if (channel->fifo_offset > 0) {
+      channel->fifo.erase(channel->fifo.begin(),
+                          channel->fifo.begin() + static_cast<ptrdiff_t>(channel->fifo_offset));
+      channel->fifo_offset = 0;
+    }
+    channel->fifo.insert(channel->fifo.end(), samples, samples + count);
+  }
+
+  void Encode(Channel* channel) {
+    const size_t frame_samples = channel->frame_samples;
+    while (channel->fifo.size() - channel->fifo_offset >= frame_samples) {
+      const size_t offset = packets_.size();
+      packets_.resize(offset + kMaxPacketBytes);
+      const int64_t start = MonotonicNs();
+      int size = channel->encoder->Encode(channel->fifo.data() + channel->fifo_offset,
+                                          packets_.data() + offset, kMaxPacketBytes);
+      const int64_t elapsed = MonotonicNs() - start;
+      channel->fifo_offset += frame_samples;
+      const uint32_t pts = channel->fifo_pts;
+      channel->fifo_pts += static_cast<uint32_t>(channel->params.frame_length_ms);
+      if (size < 0) {
+        packets_.resize(offset);
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      packets_.resize(offset + static_cast<size_t>(size));
+      Output out;
+      out.channel = channel;
+      out.offset = offset;
+      out.size = static_cast<size_t>(size);
+      out.pts = pts;
+      out.encode_ns = elapsed;
+      outputs_.push_back(out);
+      encoded_frames_.fetch_add(1, std::memory_order_relaxed);
+      encode_ns_total_.fetch_add(static_cast<uint64_t>(elapsed), std::memory_order_relaxed);
+      UpdateMax(&encode_ns_max_, static_cast<uint64_t>(elapsed));
+    }
+  }
+
+  const int cpu_;
+  std::atomic<size_t> channels_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::vector<Job> pending_;
+  std::vector<PooledBuffer> spare_;
+  bool running_;
+
+  // 工作线程处理一批时持有
+  std::mutex batch_mutex_;
+
+  // 以下仅工作线程访问
+  std::vector<Output> outputs_;
+  std::vector<uint8_t> packets_;
+
+  std::atomic<uint64_t> encoded_frames_;
+  std::atomic<uint64_t> errors_;
+  std::atomic<uint64_t> encode_ns_total_;
+  std::atomic<uint64_t> encode_ns_max_;
+  std::atomic<uint64_t> batches_;
+  std::atomic<uint64_t> max_batch_frames_;
+
+  std::thread thread_;
+};
+
+AudioEncoderPool::AudioEncoderPool(const AudioEncoderPoolConfig& config)
+    : config_(config), next_channel_id_(1), submitted_frames_(0), rejected_frames_(0) {
+  std::vector<int> cpus = AllowedCpus();
+  size_t count = config_.threads;
+  if (count == 0) {
+    count = cpus.empty() ? std::max(1u, std::thread::hardware_concurrency()) : cpus.size();
+  }
+  for (size_t i = 0; i < count; ++i) {
+    int cpu = config_.pin_threads && !cpus.empty() ? cpus[i % cpus.size()] : -1;
+    workers_.push_back(std::unique_ptr<Worker>(new Worker(cpu)));
+  }
+}
+
+AudioEncoderPool::~AudioEncoderPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.begin();
+         it != channels_.end(); ++it) {
+      it->second->removed.store(true, std::memory_order_release);
+    }
+    channels_.clear();
+  }
+  workers_.clear();
+}
+
+int AudioEncoderPool::AddChannel(const AudioEncodeParams& params, EncodedAudioSink* sink) {
+  if (sink == nullptr || params.sample_rate <= 0 || params.channels <= 0 ||
+      params.frame_length_ms <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::shared_ptr<Channel> channel(new Channel());
+  AudioEncoderFactory* factory = config_.factory != nullptr ? config_.factory : &g_opus_factory;
+  int result = factory->Create(params, &channel->encoder);
+  if (result != liteav::trtc::ERR_OK) {
+    return result;
+  }
+  if (channel->encoder == nullptr) {
+    return liteav::trtc::ERR_FAILED;
+  }
+  channel->params = params;
+  channel->sink = sink;
+  channel->frame_samples = static_cast<size_t>(params.sample_rate) * params.frame_length_ms /
+                           1000 * static_cast<size_t>(params.channels);
+  channel->output.sample_rate = params.sample_rate;
+  channel->output.channels = params.channels;
+  channel->output.bits_per_sample = 16;
+  channel->output.codec = channel->encoder->codec();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Worker* worker = workers_[0].get();
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    if (workers_[i]->channels().load(std::memory_order_relaxed) <
+        worker->channels().load(std::memory_order_relaxed)) {
+      worker = workers_[i].get();
+    }
+  }
+  worker->channels().fetch_add(1, std::memory_order_relaxed);
+  channel->worker = worker;
+  channel->id = next_channel_id_++;
+  channels_[channel->id] = channel;
+  return channel->id;
+}
+
+int AudioEncoderPool::RemoveChannel(int channel_id) {
+  std::shared_ptr<Channel> channel;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.find(channel_id);
+    if (it == channels_.end()) {
+      return liteav::trtc::ERR_INVALID_PARAMETER;
+    }
+    channel = it->second;
+    channels_.erase(it);
+  }
+  channel->removed.store(true, std::memory_order_release);
+  channel->worker->Sync();
+  channel->worker->channels().fetch_sub(1, std::memory_order_relaxed);
+  return liteav::trtc::ERR_OK;
+}
+
+int AudioEncoderPool::Submit(int channel_id, const AudioFrame& frame) {
+  std::shared_ptr<Channel> channel;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.find(channel_id);
+    if (it == channels_.end()) {
+      return liteav::trtc::ERR_INVALID_PARAMETER;
+    }
+    channel = it->second;
+  }
+  const AudioEncodeParams& params = channel->params;
+  if (frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM || frame.bits_per_sample != 16 ||
+      frame.sample_rate != params.sample_rate || frame.channels != params.channels ||
+      frame.size() % (sizeof(int16_t) * params.channels) != 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (channel->pending.fetch_add(1, std::memory_order_relaxed) >= config_.max_pending_frames) {
+    channel->pending.fetch_sub(1, std::memory_order_relaxed);
+    rejected_frames_.fetch_add(1, std::memory_order_relaxed);
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+  submitted_frames_.fetch_add(1, std::memory_order_relaxed);
+  channel->worker->Push(channel, frame);
+  return liteav::trtc::ERR_OK;
+}
+
+AudioEncoderPoolStats AudioEncoderPool::GetStats() const {
+  AudioEncoderPoolStats stats;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.channels = channels_.size();
+  }
+  stats.submitted_frames = submitted_frames_.load(std::memory_order_relaxed);
+  stats.rejected_frames = rejected_frames_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->AddStats(&stats);
+  }
+  return stats;
+}
+
+}  // namespace swing
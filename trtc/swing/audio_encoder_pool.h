@@ -0,0 +1,195 @@
+//
+// 功能说明：
+//   机器人发送音频的编码线程池。
+//   CreateLocalAudioChannel() 时 AudioEncodeParams::need_encode 为 true，
+//   SDK 在 SendAudioFrame() 的调用线程上做 Opus 编码，房间里机器人多时编码挤在
+//   各自的回调 / 定时器线程上，无法按核扩展。AudioEncoderPool 把编码集中到
+//   一组工作线程（默认每个可用 CPU 一个）：
+//   - 每个通道固定分配给通道数最少的工作线程，编码器状态只在该线程上访问，
+//     输出帧按提交顺序送给 EncodedAudioSink；
+//   - 工作线程被唤醒后一次取走分配给它的所有通道的待编码帧，按通道分组连续编码，
+//     再统一投递，同一通道的编码器状态与编码代码在一批内保持在缓存中；
+//   - 提交的 PCM 帧长度可以与编码帧长不同，按通道累积到整帧再编码，
+//     输出帧的 pts 由首个样本的 pts 推算；
+//   - 每帧的编码耗时随输出帧交给 EncodedAudioSink，汇总见 GetStats()。
+//
+//   发送端用 need_encode 为 false 创建本地音频通道，在 EncodedAudioSink 中
+//   调用 SendAudioFrame() 发送，CloudAudioSender 即为这样的实现。
+//
+//   Opus 编码需以 go build -tags opus 构建（链接 libopus 并定义 SWING_HAVE_OPUS），
+//   否则 CreateOpusEncoder() 返回 ERR_NOT_SUPPORTED；也可通过
+//   AudioEncoderPoolConfig::factory 换成其他编码器。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AUDIO_ENCODER_POOL_H_
+#define GCHATGPT_TRTC_SWING_AUDIO_ENCODER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::AudioEncodeParams;
+using liteav::trtc::AudioFrame;
+using liteav::trtc::TRTCCloud;
+
+// 单路编码器，只在一个线程上调用
+class AudioEncoder {
+ public:
+  virtual ~AudioEncoder() {}
+
+  // 编码一帧，|pcm| 为交错的 16 位 PCM，长度为 AudioEncodeParams 的一个帧长
+  // 返回写入 |out| 的字节数，失败时返回负的错误码。
+  virtual int Encode(const int16_t* pcm, uint8_t* out, size_t capacity) = 0;
+
+  // 输出的编码类型
+  virtual liteav::trtc::AudioCodecType codec() const = 0;
+};
+
+class AudioEncoderFactory {
+ public:
+  virtual ~AudioEncoderFactory() {}
+
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：编码器不支持 |params|
+  // - ERR_NOT_SUPPORTED：编码器不可用
+  virtual int Create(const AudioEncodeParams& params, std::unique_ptr<AudioEncoder>* encoder) = 0;
+};
+
+// Opus 编码器，采样率需为 8000 / 12000 / 16000 / 24000 / 48000，
+// 声道数为 1 或 2，帧长为 10 / 20 / 40 / 60 ms
+// 返回值同 AudioEncoderFactory::Create()。
+int CreateOpusEncoder(const AudioEncodeParams& params, std::unique_ptr<AudioEncoder>* encoder);
+
+// 编码结果
+// |frame| 的 codec 为编码器的输出类型，sample_rate / channels 同通道参数。
+// 同一通道的回调在同一线程上按顺序执行，回调内不可调用 AddChannel() / RemoveChannel()。
+class EncodedAudioSink {
+ public:
+  virtual ~EncodedAudioSink() {}
+  virtual void OnEncodedAudio(int channel_id, const AudioFrame& frame, int64_t encode_ns) = 0;
+};
+
+// 把编码结果交给 TRTCCloud::SendAudioFrame()
+class CloudAudioSender : public EncodedAudioSink {
+ public:
+  explicit CloudAudioSender(TRTCCloud* cloud) : cloud_(cloud), failures_(0) {}
+
+  void OnEncodedAudio(int channel_id, const AudioFrame& frame, int64_t encode_ns) override;
+
+  // SendAudioFrame() 返回错误的次数
+  uint64_t Failures() const { return failures_.load(std::memory_order_relaxed); }
+
+ private:
+  CloudAudioSender(const CloudAudioSender&);
+  CloudAudioSender& operator=(const CloudAudioSender&);
+
+  TRTCCloud* const cloud_;
+  std::atomic<uint64_t> failures_;
+};
+
+struct AudioEncoderPoolConfig {
+  AudioEncoderPoolConfig()
+      : threads(0), pin_threads(true), max_pending_frames(16), factory(nullptr) {}
+
+  // 工作线程数，0 表示取当前进程可用的 CPU 数
+  size_t threads;
+
+  // 是否把第 i 个工作线程绑定到第 i 个可用 CPU（超出时取模）
+  bool pin_threads;
+
+  // 每个通道最多积压的待编码帧数，超出时 Submit() 返回 ERR_READ_TRY_AGAIN
+  size_t max_pending_frames;
+
+  // 编码器工厂，nullptr 表示使用 CreateOpusEncoder()，需在线程池销毁前保持有效
+  AudioEncoderFactory* factory;
+};
+
+struct AudioEncoderPoolStats {
+  AudioEncoderPoolStats()
+      : channels(0),
+        submitted_frames(0),
+        rejected_frames(0),
+        encoded_frames(0),
+        errors(0),
+        encode_ns_total(0),
+        encode_ns_max(0),
+        batches(0),
+        max_batch_frames(0) {}
+
+  size_t channels;
+
+  // 提交成功与因积压被拒绝的 PCM 帧数
+  uint64_t submitted_frames;
+  uint64_t rejected_frames;
+
+  // 输出的编码帧数与编码失败次数
+  uint64_t encoded_frames;
+  uint64_t errors;
+
+  // 每个编码帧的耗时，单位纳秒
+  uint64_t encode_ns_total;
+  uint64_t encode_ns_max;
+
+  // 工作线程处理的批次数与单批最多的 PCM 帧数
+  uint64_t batches;
+  uint64_t max_batch_frames;
+};
+
+class AudioEncoderPool {
+ public:
+  explicit AudioEncoderPool(const AudioEncoderPoolConfig& config);
+  ~AudioEncoderPool();
+
+  // 添加一个编码通道，返回大于 0 的通道 ID
+  // |sink| 需保持有效直到 RemoveChannel() 返回。
+  // 失败时返回 AudioEncoderFactory::Create() 的错误码，|sink| 为空时返回 ERR_INVALID_PARAMETER。
+  int AddChannel(const AudioEncodeParams& params, EncodedAudioSink* sink);
+
+  // 移除通道，未编码的帧被丢弃，返回后不再回调该通道的 |sink|
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：通道不存在
+  int RemoveChannel(int channel_id);
+
+  // 提交一帧 16 位 PCM，采样率与声道数需与通道参数一致，复制后立即返回
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：通道不存在或帧格式不符
+  // - ERR_READ_TRY_AGAIN：通道积压达到 |max_pending_frames|
+  int Submit(int channel_id, const AudioFrame& frame);
+
+  size_t ThreadCount() const { return workers_.size(); }
+
+  AudioEncoderPoolStats GetStats() const;
+
+ private:
+  struct Channel;
+  class Worker;
+
+  AudioEncoderPool(const AudioEncoderPool&);
+  AudioEncoderPool& operator=(const AudioEncoderPool&);
+
+  const AudioEncoderPoolConfig config_;
+  std::vector<std::unique_ptr<Worker> > workers_;
+
+  mutable std::mutex mutex_;
+  std::map<int, std::shared_ptr<Channel> > channels_;
+  int next_channel_id_;
+
+  std::atomic<uint64_t> submitted_frames_;
+  std::atomic<uint64_t> rejected_frames_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AUDIO_ENCODER_POOL_H_
@@ -0,0 +1,424 @@
+#include "audio_kernels.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SWING_AUDIO_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SWING_AUDIO_NEON 1
+#endif
+
+namespace swing {
+
+namespace {
+
+std::atomic<bool> g_force_scalar(false);
+
+void MixAccumulateC(const int16_t* src, int32_t* acc, size_t count, int gain) {
+  if (gain == kUnityGain) {
+    for (size_t i = 0; i < count; ++i) {
+      acc[i] += src[i];
+    }
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    acc[i] += (src[i] * gain) >> 14;
+  }
+}
+
+void SaturateC(const int32_t* acc, int16_t* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    int32_t v = acc[i];
+    dst[i] = static_cast<int16_t>(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+  }
+}
+
+int32_t DotProductC(const int16_t* a, const int16_t* b, size_t count) {
+  int32_t sum = 0;
+  for (size_t i = 0; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+void DownmixStereoC(const int16_t* src, int16_t* dst, size_t frames) {
+  for (size_t i = 0; i < frames; ++i) {
+    dst[i] = static_cast<int16_t>((src[2 * i] + src[2 * i + 1]) >> 1);
+  }
+}
+
+void UpmixMonoC(const int16_t* src, int16_t* dst, size_t frames) {
+  for (size_t i = 0; i < frames; ++i) {
+    dst[2 * i] = src[i];
+    dst[2 * i + 1] = src[i];
+  }
+}
+
+void SignalEnergyC(const int16_t* src, size_t count, uint64_t* energy, uint64_t* diff_energy) {
+  uint64_t e = 0;
+  uint64_t d = 0;
+  for (size_t i = 0; i < count; ++i) {
+    e += static_cast<uint64_t>(src[i] * src[i]);
+    if (i > 0) {
+      int32_t diff = (src[i] >> 1) - (src[i - 1] >> 1);
+      d += static_cast<uint64_t>(diff * diff);
+    }
+  }
+  *energy = e;
+  *diff_energy = d;
+}
+
+#if defined(SWING_AUDIO_X86)
+
+bool HasAVX2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+__attribute__((target("avx2"))) void MixAccumulateAVX2(const int16_t* src,
+                                                       int32_t* acc,
+                                                       size_t count,
+                                                       int gain) {
+  size_t i = 0;
+  if (gain == kUnityGain) {
+    for (; i + 8 <= count; i += 8) {
+      __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi32(a, s));
+    }
+  } else {
+    const __m256i g = _mm256_set1_epi32(gain);
+    for (; i + 8 <= count; i += 8) {
+      __m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+      s = _mm256_srai_epi32(_mm256_mullo_epi32(s, g), 14);
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi32(a, s));
+    }
+  }
+  MixAccumulateC(src + i, acc + i, count - i, gain);
+}
+
+__attribute__((target("avx2"))) void SaturateAVX2(const int32_t* acc, int16_t* dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i + 8));
+    // packs 在 128 位通道内交错，permute 恢复顺序
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  SaturateC(acc + i, dst + i, count - i);
+}
+
+__attribute__((target("avx2"))) int32_t DotProductAVX2(const int16_t* a,
+                                                       const int16_t* b,
+                                                       size_t count) {
+  size_t i = 0;
+  __m256i sum = _mm256_setzero_si256();
+  for (; i + 16 <= count; i += 16) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, y));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+  return _mm_cvtsi128_si32(s) + DotProductC(a + i, b + i, count - i);
+}
+
+__attribute__((target("avx2"))) void DownmixStereoAVX2(const int16_t* src,
+                                                       int16_t* dst,
+                                                       size_t frames) {
+  size_t i = 0;
+  const __m256i ones = _mm256_set1_epi16(1);
+  for (; i + 16 <= frames; i += 16) {
+    // madd 把相邻的左右声道相加成 int32
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 16));
+    lo = _mm256_srai_epi32(_mm256_madd_epi16(lo, ones), 1);
+    hi = _mm256_srai_epi32(_mm256_madd_epi16(hi, ones), 1);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  DownmixStereoC(src + 2 * i, dst + i, frames - i);
+}
+
+__attribute__((target("avx2"))) void UpmixMonoAVX2(const int16_t* src,
+                                                   int16_t* dst,
+                                                   size_t frames) {
+  size_t i = 0;
+  for (; i + 16 <= frames; i += 16) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i lo = _mm256_unpacklo_epi16(x, x);
+    __m256i hi = _mm256_unpackhi_epi16(x, x);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 16),
+                        _mm256_permute2x128_si256(lo, hi, 0x31));
+  }
+  UpmixMonoC(src + i, dst + 2 * i, frames - i);
+}
+
+__attribute__((target("avx2"))) void SignalEnergyAVX2(const int16_t* src,
+                                                      size_t count,
+                                                      uint64_t* energy,
+                                                      uint64_t* diff_energy) {
+  if (count < 17) {
+    SignalEnergyC(src, count, energy, diff_energy);
+    return;
+  }
+  // madd 得到相邻两个平方之和，最大 2^31，按无符号扩展到 64 位累加
+  __m256i e = _mm256_setzero_si256();
+  __m256i d = _mm256_setzero_si256();
+  size_t i = 1;
+  for (; i + 16 <= count; i += 16) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i - 1));
+    __m256i diff = _mm256_sub_epi16(_mm256_srai_epi16(x, 1), _mm256_srai_epi16(p, 1));
+    __m256i xx = _mm256_madd_epi16(x, x);
+    __m256i dd = _mm256_madd_epi16(diff, diff);
+    e = _mm256_add_epi64(e, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(xx)));
+    e = _mm256_add_epi64(e, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(xx, 1)));
+    d = _mm256_add_epi64(d, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(dd)));
+    d = _mm256_add_epi64(d, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(dd, 1)));
+  }
+  uint64_t lanes[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), e);
+  uint64_t total_e = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), d);
+  uint64_t total_d = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+  // 第一个样本只计能量，尾部从 i - 1 开始补齐差分
+  uint64_t tail_e = 0;
+  uint64_t tail_d = 0;
+  SignalEnergyC(src + i - 1, count - i + 1, &tail_e, &tail_d);
+  *energy = total_e + static_cast<uint64_t>(src[0] * src[0]) + tail_e -
+            static_cast<uint64_t>(src[i - 1] * src[i - 1]);
+  *diff_energy = total_d + tail_d;
+}
+
+#endif  // defined(SWING_AUDIO_X86)
+
+#if defined(SWING_AUDIO_NEON)
+
+void MixAccumulateNEON(const int16_t* src, int32_t* acc, size_t count, int gain) {
+  size_t i = 0;
+  if (gain == kUnityGain) {
+    for (; i + 8 <= count; i += 8) {
+      int16x8_t s = vld1q_s16(src + i);
+      vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vget_low_s16(s)));
+      vst1q_s32(acc + i + 4, vaddw_s16(vld1q_s32(acc + i + 4), vget_high_s16(s)));
+    }
+  } else {
+    const int32x4_t g = vdupq_n_s32(gain);
+    for (; i + 8 <= count; i += 8) {
+      int16x8_t s = vld1q_s16(src + i);
+      int32x4_t lo = vshrq_n_s32(vmulq_s32(vmovl_s16(vget_low_s16(s)), g), 14);
+      int32x4_t hi = vshrq_n_s32(vmulq_s32(vmovl_s16(vget_high_s16(s)), g), 14);
+      vst1q_s32(acc + i, vaddq_s32(vld1q_s32(acc + i), lo));
+      vst1q_s32(acc + i + 4, vaddq_s32(vld1q_s32(acc + i + 4), hi));
+    }
+  }
+  MixAccumulateC(src + i, acc + i, count - i, gain);
+}
+
+void SaturateNEON(const int32_t* acc, int16_t* dst, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    int16x4_t lo = vqmovn_s32(vld1q_s32(acc + i));
+    int16x4_t hi = vqmovn_s32(vld1q_s32(acc + i + 4));
+    vst1q_s16(dst + i, vcombine_s16(lo, hi));
+  }
+  SaturateC(acc + i, dst + i, count - i);
+}
+
+int32_t DotProductNEON(const int16_t* a, const int16_t* b, size_t count) {
+  size_t i = 0;
+  int32x4_t sum = vdupq_n_s32(0);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t x = vld1q_s16(a + i);
+    int16x8_t y = vld1q_s16(b + i);
+    sum = vmlal_s16(sum, vget_low_s16(x), vget_low_s16(y));
+    sum = vmlal_s16(sum, vget_high_s16(x), vget_high_s16(y));
+  }
+  int32_t total = vgetq_lane_s32(sum, 0) + vgetq_lane_s32(sum, 1) + vgetq_lane_s32(sum, 2) +
+                  vgetq_lane_s32(sum, 3);
+  return total + DotProductC(a + i, b + i, count - i);
+}
+
+void DownmixStereoNEON(const int16_t* src, int16_t* dst, size_t frames) {
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    int16x8x2_t v = vld2q_s16(src + 2 * i);
+    vst1q_s16(dst + i, vhaddq_s16(v.val[0], v.val[1]));
+  }
+  DownmixStereoC(src + 2 * i, dst + i, frames - i);
+}
+
+void UpmixMonoNEON(const int16_t* src, int16_t* dst, size_t frames) {
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    int16x8x2_t v;
+    v.val[0] = vld1q_s16(src + i);
+    v.val[1] = v.val[0];
+    vst2q_s16(dst + 2 * i, v);
+  }
+  UpmixMonoC(src + i, dst + 2 * i, frames - i);
+}
+
+void SignalEnergyNEON(const int16_t* src,
+                      size_t count,
+                      uint64_t* energy,
+                      uint64_t* diff_energy) {
+  if (count < 9) {
+    SignalEnergyC(src, count, energy, diff_energy);
+    return;
+  }
+  // 单个平方不超过 2^30，vmull 结果按无符号两两累加到 64 位
+  uint64x2_t e = vdupq_n_u64(0);
+  uint64x2_t d = vdupq_n_u64(0);
+  size_t i = 1;
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t x = vld1q_s16(src + i);
+    int16x8_t p = vld1q_s16(src + i - 1);
+    int16x8_t diff = vsubq_s16(vshrq_n_s16(x, 1), vshrq_n_s16(p, 1));
+    e = vpadalq_u32(e, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(x), vget_low_s16(x))));
+    e = vpadalq_u32(e, vreinterpretq_u32_s32(vmull_s16(vget_high_s16(x), vget_high_s16(x))));
+    d = vpadalq_u32(d, vreinterpretq_u32_s32(vmull_s16(vget_low_s16(diff), vget_low_s16(diff))));
+    d = vpadalq_u32(d,
+                    vreinterpretq_u32_s32(vmull_s16(vget_high_s16(diff), vget_high_s16(diff))));
+  }
+  uint64_t tail_e = 0;
+  uint64_t tail_d = 0;
+  SignalEnergyC(src + i - 1, count - i + 1, &tail_e, &tail_d);
+  *energy = vgetq_lane_u64(e, 0) + vgetq_lane_u64(e, 1) + static_cast<uint64_t>(src[0] * src[0]) +
+            tail_e - static_cast<uint64_t>(src[i - 1] * src[i - 1]);
+  *diff_energy = vgetq_lane_u64(d, 0) + vgetq_lane_u64(d, 1) + tail_d;
+}
+
+#endif  // defined(SWING_AUDIO_NEON)
+
+bool UseSimd() {
+  return !g_force_scalar.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+const char* AudioKernelName() {
+  if (!UseSimd()) {
+    return "c";
+  }
+#if defined(SWING_AUDIO_X86)
+  return HasAVX2() ? "avx2" : "c";
+#elif defined(SWING_AUDIO_NEON)
+  return "neon";
+#else
+  return "c";
+#endif
+}
+
+void ForceScalarAudioKernels(bool force) {
+  g_force_scalar.store(force, std::memory_order_relaxed);
+}
+
+int GainToQ14(float gain) {
+  if (!(gain > 0.0f)) {
+    return 0;
+  }
+  if (gain >= 4.0f) {
+    return 4 * kUnityGain - 1;
+  }
+  return static_cast<int>(gain * kUnityGain + 0.5f);
+}
+
+void MixAccumulateS16(const int16_t* src, int32_t* acc, size_t count, int gain) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      MixAccumulateAVX2(src, acc, count, gain);
+      return;
+    }
+#elif defined(SWING_AUDIO_NEON)
+    MixAccumulateNEON(src, acc, count, gain);
+    return;
+#endif
+  }
+  MixAccumulateC(src, acc, count, gain);
+}
+
+void SaturateS32ToS16(const int32_t* acc, int16_t* dst, size_t count) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      SaturateAVX2(acc, dst, count);
+      return;
+    }
+#elif defined(SWING_AUDIO_NEON)
+    SaturateNEON(acc, dst, count);
+    return;
+#endif
+  }
+  SaturateC(acc, dst, count);
+}
+
+int32_t DotProductS16(const int16_t* a, const int16_t* b, size_t count) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      return DotProductAVX2(a, b, count);
+    }
+#elif defined(SWING_AUDIO_NEON)
+    return DotProductNEON(a, b, count);
+#endif
+  }
+  return DotProductC(a, b, count);
+}
+
+void DownmixStereoToMono(const int16_t* src, int16_t* dst, size_t frames) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      DownmixStereoAVX2(src, dst, frames);
+      return;
+    }
+#elif defined(SWING_AUDIO_NEON)
+    DownmixStereoNEON(src, dst, frames);
+    return;
+#endif
+  }
+  DownmixStereoC(src, dst, frames);
+}
+
+void UpmixMonoToStereo(const int16_t* src, int16_t* dst, size_t frames) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      UpmixMonoAVX2(src, dst, frames);
+      return;
+    }
+#elif defined(SWING_AUDIO_NEON)
+    UpmixMonoNEON(src, dst, frames);
+    return;
+#endif
+  }
+  UpmixMonoC(src, dst, frames);
+}
+
+void SignalEnergyS16(const int16_t* src, size_t count, uint64_t* energy, uint64_t* diff_energy) {
+  if (UseSimd()) {
+#if defined(SWING_AUDIO_X86)
+    if (HasAVX2()) {
+      SignalEnergyAVX2(src, count, energy, diff_energy);
+      return;
+    }
+#elif defined(SWING_AUDIO_NEON)
+    SignalEnergyNEON(src, count, energy, diff_energy);
+    return;
+#endif
+  }
+  SignalEnergyC(src, count, energy, diff_energy);
+}
+
+}  // namespace swing
@@ -0,0 +1,51 @@
+//
+// 功能说明：
+//   16 位 PCM 处理的基础算子。
+//   x86 上运行时检测 AVX2，ARM64 上使用 NEON，其余情况走标量实现，
+//   三种实现的输出逐样本一致。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AUDIO_KERNELS_H_
+#define GCHATGPT_TRTC_SWING_AUDIO_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace swing {
+
+// 增益的定点表示，1.0 对应 kUnityGain
+const int kUnityGain = 1 << 14;
+
+// 当前使用的实现："avx2"、"neon" 或 "c"
+const char* AudioKernelName();
+
+// 强制使用标量实现，用于基准测试对比
+void ForceScalarAudioKernels(bool force);
+
+// 浮点增益转定点，限制在 [0, 4.0)，保证乘积不溢出 int32
+int GainToQ14(float gain);
+
+// 累加：acc[i] += (src[i] * gain) >> 14，|gain| 为 kUnityGain 时直接相加
+void MixAccumulateS16(const int16_t* src, int32_t* acc, size_t count, int gain);
+
+// 饱和截断：dst[i] = clamp(acc[i], -32768, 32767)
+void SaturateS32ToS16(const int32_t* acc, int16_t* dst, size_t count);
+
+// 点积：sum(a[i] * b[i])，调用方保证结果不溢出 int32
+int32_t DotProductS16(const int16_t* a, const int16_t* b, size_t count);
+
+// 交织立体声转单声道：dst[i] = (src[2i] + src[2i+1]) >> 1
+void DownmixStereoToMono(const int16_t* src, int16_t* dst, size_t frames);
+
+// 单声道转交织立体声，左右声道相同
+void UpmixMonoToStereo(const int16_t* src, int16_t* dst, size_t frames);
+
+// 能量与一阶差分能量，用于语音检测
+// *energy = sum(src[i]^2)
+// *diff_energy = sum(((src[i] >> 1) - (src[i-1] >> 1))^2)，i 从 1 开始
+// 两者之比反映频谱重心：正弦信号满足 4 * diff / energy ≈ 2 - 2cos(2πf / fs)。
+void SignalEnergyS16(const int16_t* src, size_t count, uint64_t* energy, uint64_t* diff_energy);
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AUDIO_KERNELS_H_
@@ -0,0 +1,293 @@
+#include "audio_mixer.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "audio_kernels.h"
+
+namespace swing {
+
+struct AudioMixer::Source {
+  Source(const char* user_id, size_t capacity)
+      : user_id(user_id), gain(kUnityGain), samples(capacity), head(0), count(0), start(-1) {}
+
+  const std::string user_id;
+  int gain;
+
+  // 线性缓冲，|head| 之前的空间在写满时整体前移回收
+  std::vector<int16_t> samples;
+  size_t head;
+  size_t count;
+
+  // samples[head] 在时间轴上的位置，单位采样点，-1 表示尚无数据
+  int64_t start;
+};
+
+namespace {
+
+// 32 位毫秒 pts 的有符号差，回绕后仍然正确
+int32_t PtsDiff(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b);
+}
+
+int64_t PtsToPosition(int64_t pts_ms, int sample_rate) {
+  return pts_ms * sample_rate / 1000;
+}
+
+}  // namespace
+
+AudioMixer::AudioMixer(const AudioMixerConfig& config)
+    : config_(config),
+      frame_length_(static_cast<int64_t>(config.output_sample_rate) *
+                    config.output_frame_length_ms / 1000),
+      frame_samples_(static_cast<size_t>(frame_length_) * config.output_channels),
+      max_delay_(static_cast<int64_t>(config.output_sample_rate) * config.max_delay_ms / 1000),
+      next_position_(-1),
+      has_pts_anchor_(false),
+      pts_anchor_(0),
+      pts_anchor_ms_(0),
+      accumulator_(frame_samples_),
+      output_(frame_samples_) {}
+
+AudioMixer::~AudioMixer() {}
+
+AudioMixer::Source* AudioMixer::FindOrCreate(const char* user_id) {
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    if (sources_[i]->user_id == user_id) {
+      return sources_[i].get();
+    }
+  }
+  // 至少容纳 1 秒，或 4 倍的帧长加等待时间
+  int64_t frames = std::max<int64_t>(config_.output_sample_rate, 4 * (frame_length_ + max_delay_));
+  Source* source = new Source(user_id, static_cast<size_t>(frames) * config_.output_channels);
+  sources_.push_back(std::unique_ptr<Source>(source));
+  return source;
+}
+
+void AudioMixer::SetUserGain(const char* user_id, float gain) {
+  if (user_id == nullptr) {
+    return;
+  }
+  FindOrCreate(user_id)->gain = GainToQ14(gain);
+}
+
+void AudioMixer::ExcludeUser(const char* user_id) {
+  SetUserGain(user_id, 0.0f);
+}
+
+void AudioMixer::RemoveUser(const char* user_id) {
+  if (user_id == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    if (sources_[i]->user_id == user_id) {
+      sources_.erase(sources_.begin() + i);
+      return;
+    }
+  }
+}
+
+size_t AudioMixer::ActiveUsers() const {
+  size_t active = 0;
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    if (sources_[i]->gain > 0) {
+      ++active;
+    }
+  }
+  return active;
+}
+
+int AudioMixer::PushFrame(const char* user_id, const AudioFrame& frame) {
+  const int channels = config_.output_channels;
+  if (user_id == nullptr || frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM ||
+      frame.bits_per_sample != 16 || frame.sample_rate != config_.output_sample_rate ||
+      frame.channels != channels) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  size_t samples = frame.size() / sizeof(int16_t);
+  samples -= samples % channels;
+  if (samples == 0) {
+    return liteav::trtc::ERR_OK;
+  }
+
+  Source* source = FindOrCreate(user_id);
+  int64_t position = PtsToPosition(ExtendPts(frame.pts), config_.output_sample_rate);
+  int64_t end = source->start + static_cast<int64_t>(source->count / channels);
+
+  // 与上一帧的衔接误差在半帧以内视为连续，否则从 pts 重新对齐
+  int64_t drift = position - end;
+  if (source->start < 0 || drift > frame_length_ / 2 || drift < -frame_length_ / 2) {
+    source->head = 0;
+    source->count = 0;
+    source->start = position;
+  }
+  if (next_position_ < 0) {
+    next_position_ = source->start;
+  }
+
+  const size_t capacity = source->samples.size();
+  if (samples > capacity) {
+    // 单帧比缓冲还大，只保留末尾
+    size_t skip = samples - capacity;
+    skip -= skip % channels;
+    source->start += static_cast<int64_t>((source->count + skip) / channels);
+    source->head = 0;
+    source->count = 0;
+    samples -= skip;
+    memcpy(source->samples.data(), frame.data() + skip * sizeof(int16_t),
+           samples * sizeof(int16_t));
+    source->count = samples;
+    return liteav::trtc::ERR_OK;
+  }
+  if (source->head + source->count + samples > capacity) {
+    if (source->count + samples > capacity) {
+      // 缓冲溢出，丢弃最旧的数据
+      size_t drop = source->count + samples - capacity;
+      source->head += drop;
+      source->count -= drop;
+      source->start += static_cast<int64_t>(drop / channels);
+    }
+    memmove(source->samples.data(), source->samples.data() + source->head,
+            source->count * sizeof(int16_t));
+    source->head = 0;
+  }
+  memcpy(source->samples.data() + source->head + source->count, frame.data(),
+         samples * sizeof(int16_t));
+  source->count += samples;
+  return liteav::trtc::ERR_OK;
+}
+
+int64_t AudioMixer::ExtendPts(uint32_t pts) {
+  if (!has_pts_anchor_) {
+    // 起点加 2^32：回退的 pts 展开后仍为正数，低 32 位与 pts 相同
+    has_pts_anchor_ = true;
+    pts_anchor_ = pts;
+    pts_anchor_ms_ = static_cast<int64_t>(pts) + (static_cast<int64_t>(1) << 32);
+    return pts_anchor_ms_;
+  }
+  const int64_t pts_ms = pts_anchor_ms_ + PtsDiff(pts, pts_anchor_);
+  if (pts_ms > pts_anchor_ms_) {
+    pts_anchor_ = pts;
+    pts_anchor_ms_ = pts_ms;
+  }
+  return pts_ms;
+}
+
+void AudioMixer::RebaseIfLate() {
+  if (next_position_ < 0) {
+    return;
+  }
+  const int channels = config_.output_channels;
+  int64_t earliest = -1;
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    const Source* source = sources_[i].get();
+    if (source->gain <= 0 || source->start < 0 || source->count == 0) {
+      continue;
+    }
+    const int64_t end = source->start + static_cast<int64_t>(source->count / channels);
+    if (end + max_delay_ >= next_position_) {
+      return;
+    }
+    earliest = earliest < 0 ? source->start : std::min(earliest, source->start);
+  }
+  if (earliest >= 0) {
+    next_position_ = earliest;
+  }
+}
+
+bool AudioMixer::Ready() const {
+  if (next_position_ < 0) {
+    return false;
+  }
+  const int channels = config_.output_channels;
+  const int64_t frame_end = next_position_ + frame_length_;
+
+  int64_t max_end = -1;
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    const Source* source = sources_[i].get();
+    if (source->gain > 0 && source->start >= 0) {
+      max_end = std::max(max_end, source->start + static_cast<int64_t>(source->count / channels));
+    }
+  }
+  if (max_end < frame_end) {
+    return false;
+  }
+  if (max_end - next_position_ >= frame_length_ + max_delay_) {
+    return true;
+  }
+
+  // 落后超过 |max_delay_| 的用户视为已停止发送，不再等待
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    const Source* source = sources_[i].get();
+    if (source->gain <= 0 || source->start < 0) {
+      continue;
+    }
+    int64_t end = source->start + static_cast<int64_t>(source->count / channels);
+    if (end < frame_end && end + max_delay_ >= max_end) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int AudioMixer::Mix(AudioFrame* output) {
+  if (output == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  RebaseIfLate();
+  if (!Ready()) {
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+
+  const int channels = config_.output_channels;
+  const int64_t frame_end = next_position_ + frame_length_;
+  std::fill(accumulator_.begin(), accumulator_.end(), 0);
+
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    Source* source = sources_[i].get();
+    if (source->start < 0) {
+      continue;
+    }
+    // 丢弃输出位置之前的迟到数据
+    if (source->start < next_position_) {
+      size_t late = static_cast<size_t>(next_position_ - source->start) * channels;
+      late = std::min(late, source->count);
+      source->head += late;
+      source->count -= late;
+      source->start += static_cast<int64_t>(late / channels);
+    }
+    if (source->count == 0) {
+      continue;
+    }
+
+    int64_t offset = source->start - next_position_;
+    int64_t available = std::min<int64_t>(frame_end - source->start,
+                                          static_cast<int64_t>(source->count / channels));
+    if (available <= 0) {
+      continue;
+    }
+    if (source->gain > 0) {
+      MixAccumulateS16(source->samples.data() + source->head,
+                       accumulator_.data() + offset * channels,
+                       static_cast<size_t>(available) * channels, source->gain);
+    }
+    size_t consumed = static_cast<size_t>(available) * channels;
+    source->head += consumed;
+    source->count -= consumed;
+    source->start += available;
+  }
+
+  SaturateS32ToS16(accumulator_.data(), output_.data(), frame_samples_);
+  output->SetData(reinterpret_cast<const uint8_t*>(output_.data()),
+                  frame_samples_ * sizeof(int16_t));
+  output->sample_rate = config_.output_sample_rate;
+  output->channels = channels;
+  output->bits_per_sample = 16;
+  output->codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+  output->pts = static_cast<uint32_t>(next_position_ * 1000 / config_.output_sample_rate);
+  next_position_ = frame_end;
+  return liteav::trtc::ERR_OK;
+}
+
+}  // namespace swing
@@ -0,0 +1,124 @@
+//
+// 功能说明：
+//   本地多路 PCM 混音。
+//   效果对应 RecordConfig::enable_remote_audio_mix，但可以自行挑选参与混音的
+//   用户（例如排除机器人自己的声音），并为每个用户设置增益。
+//   各路按 AudioFrame::pts 对齐到同一时间轴，输出固定帧长的 AudioFrame。
+//   32 位毫秒 pts 按有符号差展开到 64 位时间轴，pts 回绕后仍然连续；
+//   所有参与混音的用户都回退到输出位置之前超过 |max_delay_ms|（例如发送端重启、
+//   pts 从更小的起点重新计数）时，输出位置随之回退到最早的数据，不会一直输出静音。
+//
+//   输入帧的采样率、声道数需与输出一致，不一致时先经过 AudioResampler。
+//   非线程安全，PushFrame() 与 Mix() 需在同一线程调用。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AUDIO_MIXER_H_
+#define GCHATGPT_TRTC_SWING_AUDIO_MIXER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+
+// 混音参数，默认值与 RecordConfig 一致
+struct AudioMixerConfig {
+  AudioMixerConfig()
+      : output_sample_rate(16000),
+        output_channels(1),
+        output_frame_length_ms(20),
+        max_delay_ms(60) {}
+
+  explicit AudioMixerConfig(const liteav::trtc::RecordConfig& config)
+      : output_sample_rate(config.output_sample_rate),
+        output_channels(config.output_channels),
+        output_frame_length_ms(config.output_frame_length_ms),
+        max_delay_ms(60) {}
+
+  int output_sample_rate;
+  int output_channels;
+  int output_frame_length_ms;
+
+  // 等待迟到用户的最长时间
+  // 已有用户的数据领先输出位置超过一帧加 |max_delay_ms| 时，不再等待其他用户，
+  // 缺失部分按静音处理。
+  int max_delay_ms;
+};
+
+class AudioMixer {
+ public:
+  explicit AudioMixer(const AudioMixerConfig& config);
+  ~AudioMixer();
+
+  // 设置用户增益，取值 [0, 4.0)，0 表示不参与混音，默认 1.0
+  void SetUserGain(const char* user_id, float gain);
+
+  // 等同 SetUserGain(user_id, 0)
+  void ExcludeUser(const char* user_id);
+
+  // 移除用户及其缓存的数据
+  void RemoveUser(const char* user_id);
+
+  // 写入一帧
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：非 PCM 或采样率、声道数与输出不一致
+  int PushFrame(const char* user_id, const AudioFrame& frame);
+
+  // 输出一帧混音
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_READ_TRY_AGAIN：数据不足，请在下次写入后重试
+  int Mix(AudioFrame* output);
+
+  // 每帧输出的样本数（含所有声道）
+  size_t frame_samples() const { return frame_samples_; }
+
+  // 参与混音的用户数
+  size_t ActiveUsers() const;
+
+ private:
+  struct Source;
+
+  AudioMixer(const AudioMixer&);
+  AudioMixer& operator=(const AudioMixer&);
+
+  Source* FindOrCreate(const char* user_id);
+  bool Ready() const;
+
+  // 把 |pts| 展开为 64 位毫秒时间
+  int64_t ExtendPts(uint32_t pts);
+
+  // 参与混音的用户的数据都落后输出位置超过 |max_delay_| 时，输出位置回退到最早的数据
+  void RebaseIfLate();
+
+  const AudioMixerConfig config_;
+  // 每帧的采样点数（单声道计）和样本数（含所有声道）
+  const int64_t frame_length_;
+  const size_t frame_samples_;
+  const int64_t max_delay_;
+
+  std::vector<std::unique_ptr<Source> > sources_;
+
+  // 下一帧输出在时间轴上的位置，单位采样点，-1 表示尚未开始
+  int64_t next_position_;
+
+  // 已见过的最大 pts 及其展开值，ExtendPts() 以此为锚点
+  bool has_pts_anchor_;
+  uint32_t pts_anchor_;
+  int64_t pts_anchor_ms_;
+
+  std::vector<int32_t> accumulator_;
+  std::vector<int16_t> output_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AUDIO_MIXER_H_
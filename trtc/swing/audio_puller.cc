@@ -0,0 +1,270 @@
+#include "audio_puller.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include <algorithm>
+
+namespace swing {
+
+namespace {
+
+// 落后超过该帧数时不再追赶，从当前时间重新计时
+const int64_t kMaxLagFrames = 5;
+
+// 每个用户每个节拍最多读取的帧数，SDK 缓存积压时分几个节拍追上
+const size_t kMaxFramesPerPull = 4;
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void SleepUntil(int64_t deadline_ns) {
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(deadline_ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(deadline_ns % 1000000000);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+}  // namespace
+
+struct AudioPuller::Source {
+  Source(TRTCCloud* cloud, const std::string& user_id, size_t capacity)
+      : cloud(cloud),
+        ring(user_id, liteav::trtc::STREAM_TYPE_AUDIO, capacity),
+        removed(false),
+        idle_ticks(0),
+        next_tick(0) {}
+
+  TRTCCloud* const cloud;
+  StreamRing ring;
+  std::atomic<bool> removed;
+
+  // 以下仅拉取线程访问
+  int64_t idle_ticks;
+  uint64_t next_tick;
+};
+
+AudioPuller::AudioPuller(const AudioPullerConfig& config)
+    : config_(config), generation_(0), removed_dropped_(0), running_(false), pulls_(0) {}
+
+AudioPuller::~AudioPuller() {
+  Stop();
+}
+
+int AudioPuller::Start() {
+  if (thread_.joinable() || config_.frame_length_ms <= 0) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread(&AudioPuller::Run, this);
+  return liteav::trtc::ERR_OK;
+}
+
+void AudioPuller::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  running_.store(false, std::memory_order_release);
+  thread_.join();
+}
+
+int AudioPuller::AddUser(TRTCCloud* cloud, const char* user_id) {
+  if (cloud == nullptr || user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<Source>& source = sources_[SourceKey(cloud, user_id)];
+  if (!source) {
+    source.reset(new Source(cloud, user_id, config_.max_buffered_frames));
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+int AudioPuller::RemoveUser(TRTCCloud* cloud, const char* user_id) {
+  if (cloud == nullptr || user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  // 等正在进行的拉取结束，返回后不会再对该用户调用 GetAudioFrame()
+  std::lock_guard<std::mutex> pull_lock(pull_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<SourceKey, std::shared_ptr<Source> >::iterator it =
+      sources_.find(SourceKey(cloud, user_id));
+  if (it == sources_.end()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  it->second->removed.store(true, std::memory_order_release);
+  removed_dropped_ += it->second->ring.Dropped();
+  sources_.erase(it);
+  generation_.fetch_add(1, std::memory_order_release);
+  return liteav::trtc::ERR_OK;
+}
+
+void AudioPuller::RemoveCloud(TRTCCloud* cloud) {
+  std::lock_guard<std::mutex> pull_lock(pull_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<SourceKey, std::shared_ptr<Source> >::iterator it =
+      sources_.lower_bound(SourceKey(cloud, std::string()));
+  while (it != sources_.end() && it->first.first == cloud) {
+    it->second->removed.store(true, std::memory_order_release);
+    removed_dropped_ += it->second->ring.Dropped();
+    sources_.erase(it++);
+  }
+  generation_.fetch_add(1, std::memory_order_release);
+}
+
+size_t AudioPuller::GetAudioFrames(TRTCCloud* cloud,
+                                   const char* const user_ids[],
+                                   size_t count,
+                                   AudioFrame frames[],
+                                   int results[]) {
+  size_t ready = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < count; ++i) {
+    std::map<SourceKey, std::shared_ptr<Source> >::iterator it =
+        user_ids[i] == nullptr ? sources_.end() : sources_.find(SourceKey(cloud, user_ids[i]));
+    if (it == sources_.end()) {
+      results[i] = liteav::trtc::ERR_INVALID_PARAMETER;
+      continue;
+    }
+    StreamRing* ring = &it->second->ring;
+    if (ring->Readable() == 0) {
+      results[i] = liteav::trtc::ERR_READ_TRY_AGAIN;
+      continue;
+    }
+    const RingFrame* frame = ring->Peek(0);
+    frames[i].SetData(frame->payload.data(), frame->payload.size());
+    frames[i].pts = frame->pts;
+    frames[i].codec = static_cast<liteav::trtc::AudioCodecType>(frame->codec);
+    frames[i].sample_rate = frame->sample_rate;
+    frames[i].channels = frame->channels;
+    frames[i].bits_per_sample = 16;
+    results[i] = static_cast<int>(frame->payload.size());
+    ring->Consume(1);
+    ++ready;
+  }
+  return ready;
+}
+
+size_t AudioPuller::Drain(AudioPullSink* sink, size_t max_per_user) {
+  size_t total = 0;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (std::map<SourceKey, std::shared_ptr<Source> >::iterator it = sources_.begin();
+       it != sources_.end(); ++it) {
+    StreamRing* ring = &it->second->ring;
+    size_t readable = ring->Readable();
+    if (readable == 0) {
+      continue;
+    }
+    if (max_per_user > 0 && readable > max_per_user) {
+      readable = max_per_user;
+    }
+    sink->OnAudioFrames(it->first.first, ring, readable);
+    ring->Consume(readable);
+    total += readable;
+  }
+  return total;
+}
+
+size_t AudioPuller::UserCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sources_.size();
+}
+
+uint64_t AudioPuller::TotalDropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t dropped = removed_dropped_;
+  for (std::map<SourceKey, std::shared_ptr<Source> >::const_iterator it = sources_.begin();
+       it != sources_.end(); ++it) {
+    dropped += it->second->ring.Dropped();
+  }
+  return dropped;
+}
+
+size_t AudioPuller::Pull(Source* source, AudioFrame* frame) {
+  size_t pulled = 0;
+  while (pulled < kMaxFramesPerPull) {
+    pulls_.fetch_add(1, std::memory_order_relaxed);
+    int ret = source->cloud->GetAudioFrame(source->ring.user_id(), frame);
+    if (ret <= 0) {
+      break;
+    }
+    ++pulled;
+    RingFrame* slot = source->ring.BeginPush();
+    if (slot == nullptr) {
+      // 消费者跟不上，本节拍剩余的数据留在 SDK 里
+      break;
+    }
+    slot->kind = kFrameKindAudio;
+    slot->pts = frame->pts;
+    slot->dts = frame->pts;
+    slot->codec = frame->codec;
+    slot->sample_rate = frame->sample_rate;
+    slot->channels = frame->channels;
+    slot->payload.Assign(frame->data(), frame->size());
+    source->ring.CommitPush();
+  }
+  return pulled;
+}
+
+void AudioPuller::Run() {
+  const int64_t frame_ns = static_cast<int64_t>(config_.frame_length_ms) * 1000000;
+  const int64_t max_idle_ticks =
+      std::max<int64_t>(1, config_.idle_poll_interval_ms / config_.frame_length_ms);
+
+  // 复用同一个 AudioFrame，SDK 内部缓冲容量足够时不再分配
+  AudioFrame frame;
+  std::vector<std::shared_ptr<Source> > snapshot;
+  uint64_t snapshot_generation = ~static_cast<uint64_t>(0);
+  uint64_t tick = 0;
+  int64_t deadline = MonotonicNs();
+
+  while (running_.load(std::memory_order_acquire)) {
+    uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (generation != snapshot_generation) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      snapshot.clear();
+      for (std::map<SourceKey, std::shared_ptr<Source> >::iterator it = sources_.begin();
+           it != sources_.end(); ++it) {
+        snapshot.push_back(it->second);
+      }
+      snapshot_generation = generation_.load(std::memory_order_acquire);
+    }
+
+    size_t pulled = 0;
+    std::unique_lock<std::mutex> pull_lock(pull_mutex_);
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+      Source* source = snapshot[i].get();
+      if (source->removed.load(std::memory_order_acquire) || source->next_tick > tick) {
+        continue;
+      }
+      size_t count = Pull(source, &frame);
+      if (count > 0) {
+        source->idle_ticks = 0;
+      } else if (source->idle_ticks < max_idle_ticks) {
+        ++source->idle_ticks;
+      }
+      // 静默越久拉取间隔越长，最长 |max_idle_ticks| 个节拍
+      source->next_tick = tick + static_cast<uint64_t>(std::max<int64_t>(1, source->idle_ticks));
+      pulled += count;
+    }
+    pull_lock.unlock();
+    if (pulled > 0) {
+      event_.Notify();
+    }
+
+    ++tick;
+    deadline += frame_ns;
+    int64_t now = MonotonicNs();
+    if (now - deadline > kMaxLagFrames * frame_ns) {
+      deadline = now;
+    }
+    SleepUntil(deadline);
+  }
+}
+
+}  // namespace swing
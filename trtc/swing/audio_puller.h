@@ -0,0 +1,147 @@
+//
+// 功能说明：
+//   非录制模式下远端音频的事件驱动批量读取。
+//   TRTCCloud::GetAudioFrame() 没有数据时返回 ERR_READ_TRY_AGAIN，业务只能按定时器
+//   逐个用户轮询。AudioPuller 用一个线程按帧长节拍统一拉取所有注册用户的音频，
+//   读到的帧放进每个用户的 SPSC 队列，有新帧时通知 DataEvent；
+//   业务线程在 DataEvent 上等待（或把 fd 放进 epoll），醒来后一次调用
+//   GetAudioFrames() / Drain() 取走所有就绪帧。
+//
+//   - 连续读不到数据的用户逐步降低拉取频率，最长间隔 |idle_poll_interval_ms|，
+//     有数据后立即恢复每帧拉取，房间里大量静默用户时开销接近于零；
+//   - 多个 TRTCCloud 可以共用一个 AudioPuller，几百个房间只需一个拉取线程；
+//   - 录制模式（TRTC_SCENE_RECORD）下音频经 OnRemoteAudioReceived 回调，
+//     用 FrameDispatcher::SetDataEvent() 达到同样的效果。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AUDIO_PULLER_H_
+#define GCHATGPT_TRTC_SWING_AUDIO_PULLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "data_event.h"
+#include "frame_dispatcher.h"
+
+namespace swing {
+
+using liteav::trtc::TRTCCloud;
+
+struct AudioPullerConfig {
+  AudioPullerConfig()
+      : frame_length_ms(20), max_buffered_frames(16), idle_poll_interval_ms(100) {}
+
+  // 拉取节拍，与 GetAudioFrame() 每次读取的时长一致
+  int frame_length_ms;
+
+  // 每个用户最多缓存的帧数，向上取整为 2 的幂，队列满时丢弃新帧并计数
+  size_t max_buffered_frames;
+
+  // 静默用户的最长拉取间隔
+  int idle_poll_interval_ms;
+};
+
+// 批量消费回调
+// |ring| 中前 |count| 帧可通过 ring->Peek(i) 读取，回调返回后自动 Consume。
+// 回调内不可调用 AddUser() / RemoveUser()。
+class AudioPullSink {
+ public:
+  virtual ~AudioPullSink() {}
+  virtual void OnAudioFrames(TRTCCloud* cloud, StreamRing* ring, size_t count) = 0;
+};
+
+class AudioPuller {
+ public:
+  explicit AudioPuller(const AudioPullerConfig& config);
+  ~AudioPuller();
+
+  // 启动拉取线程
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_OPERATION：已经启动
+  int Start();
+
+  // 停止拉取线程，已缓存的帧仍可读取
+  void Stop();
+
+  // 注册 / 注销需要拉取的远端用户，通常在 OnRemoteAudioAvailable 中调用
+  // |cloud| 需保持有效直到对应用户全部注销或 Stop() 返回；
+  // 注销返回后拉取线程不会再访问该用户。
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：参数为空，或注销时用户未注册
+  int AddUser(TRTCCloud* cloud, const char* user_id);
+  int RemoveUser(TRTCCloud* cloud, const char* user_id);
+
+  // 注销 |cloud| 下的所有用户，ExitRoom() 前调用
+  void RemoveCloud(TRTCCloud* cloud);
+
+  // 有新帧时触发
+  DataEvent* event() { return &event_; }
+
+  // 批量版的 GetAudioFrame()
+  // 每个用户最多取一帧写入 |frames[i]|，|results[i]| 为读取的字节数，
+  // 没有数据时为 ERR_READ_TRY_AGAIN，用户未注册时为 ERR_INVALID_PARAMETER。
+  // 返回读到数据的用户数。
+  size_t GetAudioFrames(TRTCCloud* cloud,
+                        const char* const user_ids[],
+                        size_t count,
+                        AudioFrame frames[],
+                        int results[]);
+
+  // 取出所有用户的就绪帧，每个用户最多 |max_per_user| 帧，0 表示不限
+  // 返回总帧数。同一时刻只允许一个线程调用 GetAudioFrames() / Drain()。
+  size_t Drain(AudioPullSink* sink, size_t max_per_user);
+
+  // 已注册的用户数
+  size_t UserCount() const;
+
+  // 各队列满时丢弃的帧数之和，含已注销的用户
+  uint64_t TotalDropped() const;
+
+  // 调用 GetAudioFrame() 的次数，用于观察静默用户降频的效果
+  uint64_t PullCount() const { return pulls_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Source;
+  typedef std::pair<TRTCCloud*, std::string> SourceKey;
+
+  AudioPuller(const AudioPuller&);
+  AudioPuller& operator=(const AudioPuller&);
+
+  void Run();
+
+  // 拉取 |source| 的可读帧，返回帧数
+  size_t Pull(Source* source, AudioFrame* frame);
+
+  const AudioPullerConfig config_;
+  DataEvent event_;
+
+  // 拉取线程每个节拍持有，注销时据此等待进行中的 GetAudioFrame() 结束
+  // 加锁顺序：先 |pull_mutex_| 后 |mutex_|
+  std::mutex pull_mutex_;
+
+  mutable std::mutex mutex_;
+  std::map<SourceKey, std::shared_ptr<Source> > sources_;
+  // |sources_| 每次变化加一，拉取线程据此刷新快照
+  std::atomic<uint64_t> generation_;
+  uint64_t removed_dropped_;
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+  std::atomic<uint64_t> pulls_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AUDIO_PULLER_H_
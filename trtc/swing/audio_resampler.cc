@@ -0,0 +1,334 @@
+#include "audio_resampler.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "audio_kernels.h"
+
+namespace swing {
+
+namespace {
+
+const int kMinSampleRate = 8000;
+const int kMaxSampleRate = 192000;
+const int kMaxChannels = 8;
+
+const double kPi = 3.14159265358979323846;
+
+// 通带占输出奈奎斯特频率的比例
+const double kRolloff = 0.92;
+// Kaiser 窗参数，阻带约 -80dB
+const double kKaiserBeta = 8.0;
+// 上采样时每相位的抽头数，下采样时按比例增加以保持过渡带宽度
+const int kBaseTaps = 64;
+// 系数总数上限，限制 44101 这类互质采样率产生的超大相位数
+const size_t kMaxCoefficients = 1 << 20;
+
+int Gcd(int a, int b) {
+  while (b != 0) {
+    int t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 64; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+}  // namespace
+
+struct AudioResampler::Filter {
+  // 输出:输入 = up:down
+  int up;
+  int down;
+  // 每相位的抽头数，16 的倍数
+  int taps;
+  // up 个相位依次排列，每相位 taps 个 Q15 系数，按输入时间正序
+  std::vector<int16_t> coefficients;
+};
+
+// 设计一组多相滤波器
+// 原型为 up * taps 阶的低通，工作在 up 倍输入采样率上，
+// 截止频率取输入、输出奈奎斯特频率中较低者的 |kRolloff|。
+std::shared_ptr<const AudioResampler::Filter> AudioResampler::DesignFilter(int up, int down) {
+  // 不析构，避免进程退出时与仍在使用的实例竞争
+  static std::mutex* mutex = new std::mutex();
+  static std::map<std::pair<int, int>, std::weak_ptr<const Filter> >* cache =
+      new std::map<std::pair<int, int>, std::weak_ptr<const Filter> >();
+  std::lock_guard<std::mutex> lock(*mutex);
+  std::weak_ptr<const Filter>& slot = (*cache)[std::make_pair(up, down)];
+  std::shared_ptr<const Filter> cached = slot.lock();
+  if (cached) {
+    return cached;
+  }
+
+  const double ratio = std::min(1.0, static_cast<double>(up) / down);
+  int taps = static_cast<int>(ceil(kBaseTaps / ratio));
+  taps = (taps + 15) & ~15;
+  if (static_cast<size_t>(taps) * up > kMaxCoefficients) {
+    return std::shared_ptr<const Filter>();
+  }
+
+  const int length = taps * up;
+  const double center = (length - 1) / 2.0;
+  const double cutoff = 0.5 * kRolloff * ratio / up;
+  const double window_scale = 1.0 / BesselI0(kKaiserBeta);
+  std::vector<double> prototype(length);
+  for (int n = 0; n < length; ++n) {
+    double x = n - center;
+    double sinc = x == 0.0 ? 1.0 : sin(2.0 * kPi * cutoff * x) / (2.0 * kPi * cutoff * x);
+    double t = length > 1 ? 2.0 * n / (length - 1) - 1.0 : 0.0;
+    double window = BesselI0(kKaiserBeta * sqrt(std::max(0.0, 1.0 - t * t))) * window_scale;
+    prototype[n] = 2.0 * cutoff * up * sinc * window;
+  }
+
+  Filter* filter = new Filter();
+  filter->up = up;
+  filter->down = down;
+  filter->taps = taps;
+  filter->coefficients.resize(static_cast<size_t>(length));
+  for (int phase = 0; phase < up; ++phase) {
+    int16_t* coefficients = &filter->coefficients[static_cast<size_t>(phase) * taps];
+    int sum = 0;
+    int peak = 0;
+    for (int t = 0; t < taps; ++t) {
+      // 窗口末尾是最新的输入，对应原型的第 0 阶
+      double value = prototype[static_cast<size_t>(taps - 1 - t) * up + phase] * 32768.0;
+      int q = static_cast<int>(lrint(std::max(-32768.0, std::min(32767.0, value))));
+      coefficients[t] = static_cast<int16_t>(q);
+      sum += q;
+      if (abs(q) > abs(coefficients[peak])) {
+        peak = t;
+      }
+    }
+    // 量化误差补到最大的抽头上，保证直流增益恰好为 1
+    int adjusted = std::max(-32768, std::min(32767, coefficients[peak] + 32768 - sum));
+    coefficients[peak] = static_cast<int16_t>(adjusted);
+  }
+
+  std::shared_ptr<const Filter> result(filter);
+  slot = result;
+  return result;
+}
+
+AudioResampler::AudioResampler(int output_sample_rate, int output_channels)
+    : output_sample_rate_(output_sample_rate),
+      output_channels_(output_channels),
+      input_sample_rate_(0),
+      input_channels_(0),
+      work_channels_(0),
+      phase_(0) {}
+
+AudioResampler::~AudioResampler() {}
+
+int AudioResampler::Configure(int input_sample_rate, int input_channels) {
+  if (input_sample_rate < kMinSampleRate || input_sample_rate > kMaxSampleRate ||
+      output_sample_rate_ < kMinSampleRate || output_sample_rate_ > kMaxSampleRate ||
+      input_channels < 1 || input_channels > kMaxChannels || output_channels_ < 1 ||
+      output_channels_ > kMaxChannels) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+
+  std::shared_ptr<const Filter> filter;
+  if (input_sample_rate != output_sample_rate_) {
+    int gcd = Gcd(input_sample_rate, output_sample_rate_);
+    filter = DesignFilter(output_sample_rate_ / gcd, input_sample_rate / gcd);
+    if (!filter) {
+      return liteav::trtc::ERR_INVALID_PARAMETER;
+    }
+  }
+
+  input_sample_rate_ = input_sample_rate;
+  input_channels_ = input_channels;
+  work_channels_ = std::min(input_channels, output_channels_);
+  filter_ = filter;
+  history_.resize(static_cast<size_t>(work_channels_));
+  resampled_.resize(static_cast<size_t>(work_channels_));
+  Reset();
+  return liteav::trtc::ERR_OK;
+}
+
+void AudioResampler::Reset() {
+  phase_ = 0;
+  for (size_t c = 0; c < history_.size(); ++c) {
+    // 预置 taps - 1 个静音，第一个输入即可产生输出
+    history_[c].assign(filter_ ? static_cast<size_t>(filter_->taps - 1) : 0, 0);
+  }
+}
+
+double AudioResampler::DelayMs() const {
+  if (!filter_ || input_sample_rate_ == 0) {
+    return 0.0;
+  }
+  double center = (static_cast<double>(filter_->taps) * filter_->up - 1) / 2.0;
+  return center * 1000.0 / filter_->up / input_sample_rate_;
+}
+
+void AudioResampler::Resample(int channel,
+                              const int16_t* input,
+                              size_t count,
+                              size_t stride,
+                              int* phase) {
+  std::vector<int16_t>& history = history_[static_cast<size_t>(channel)];
+  std::vector<int16_t>& output = resampled_[static_cast<size_t>(channel)];
+  const size_t taps = static_cast<size_t>(filter_->taps);
+  const int up = filter_->up;
+  const int down = filter_->down;
+  const int16_t* coefficients = filter_->coefficients.data();
+
+  size_t old_size = history.size();
+  history.resize(old_size + count);
+  int16_t* samples = history.data();
+  for (size_t i = 0; i < count; ++i) {
+    samples[old_size + i] = input[i * stride];
+  }
+
+  output.clear();
+  size_t position = 0;
+  int p = *phase;
+  while (position + taps <= history.size()) {
+    int32_t sum = DotProductS16(samples + position, coefficients + static_cast<size_t>(p) * taps,
+                                taps);
+    int32_t value = (sum + (1 << 14)) >> 15;
+    output.push_back(static_cast<int16_t>(std::max(-32768, std::min(32767, value))));
+    p += down;
+    position += static_cast<size_t>(p / up);
+    p %= up;
+  }
+  history.erase(history.begin(), history.begin() + static_cast<ptrdiff_t>(position));
+  *phase = p;
+}
+
+int AudioResampler::Process(const int16_t* input,
+                            size_t input_frames,
+                            int input_sample_rate,
+                            int input_channels,
+                            std::vector<int16_t>* output) {
+  if (output == nullptr || (input == nullptr && input_frames > 0)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (input_sample_rate != input_sample_rate_ || input_channels != input_channels_) {
+    int result = Configure(input_sample_rate, input_channels);
+    if (result != liteav::trtc::ERR_OK) {
+      return result;
+    }
+  }
+  if (input_frames == 0) {
+    return liteav::trtc::ERR_OK;
+  }
+
+  const size_t work = static_cast<size_t>(work_channels_);
+
+  // 降声道
+  const int16_t* source = input;
+  if (input_channels_ > work_channels_) {
+    downmixed_.resize(input_frames * work);
+    if (work_channels_ == 1 && input_channels_ == 2) {
+      DownmixStereoToMono(input, downmixed_.data(), input_frames);
+    } else if (work_channels_ == 1) {
+      for (size_t i = 0; i < input_frames; ++i) {
+        int sum = 0;
+        for (int c = 0; c < input_channels_; ++c) {
+          sum += input[i * input_channels_ + c];
+        }
+        downmixed_[i] = static_cast<int16_t>(sum / input_channels_);
+      }
+    } else {
+      for (size_t i = 0; i < input_frames; ++i) {
+        memcpy(&downmixed_[i * work], input + i * input_channels_, work * sizeof(int16_t));
+      }
+    }
+    source = downmixed_.data();
+  }
+
+  // 重采样
+  size_t frames = input_frames;
+  if (filter_) {
+    // 各声道从同一相位开始，结束相位也相同
+    int phase = 0;
+    for (size_t c = 0; c < work; ++c) {
+      phase = phase_;
+      Resample(static_cast<int>(c), source + c, input_frames, work, &phase);
+    }
+    phase_ = phase;
+    frames = resampled_[0].size();
+    if (work == 1) {
+      source = resampled_[0].data();
+    } else {
+      interleaved_.resize(frames * work);
+      for (size_t c = 0; c < work; ++c) {
+        const int16_t* plane = resampled_[c].data();
+        for (size_t i = 0; i < frames; ++i) {
+          interleaved_[i * work + c] = plane[i];
+        }
+      }
+      source = interleaved_.data();
+    }
+  }
+
+  // 升声道
+  const size_t out_channels = static_cast<size_t>(output_channels_);
+  size_t offset = output->size();
+  output->resize(offset + frames * out_channels);
+  int16_t* dst = output->data() + offset;
+  if (out_channels == work) {
+    memcpy(dst, source, frames * work * sizeof(int16_t));
+  } else if (work == 1 && out_channels == 2) {
+    UpmixMonoToStereo(source, dst, frames);
+  } else {
+    for (size_t i = 0; i < frames; ++i) {
+      for (size_t c = 0; c < out_channels; ++c) {
+        dst[i * out_channels + c] = source[i * work + c % work];
+      }
+    }
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+int AudioResampler::Process(const AudioFrame& input, AudioFrame* output) {
+  if (output == nullptr || input.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM ||
+      input.bits_per_sample != 16 || input.channels <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  size_t input_frames = input.size() / sizeof(int16_t) / input.channels;
+  converted_.clear();
+  int result = Process(reinterpret_cast<const int16_t*>(input.data()), input_frames,
+                       input.sample_rate, input.channels, &converted_);
+  if (result != liteav::trtc::ERR_OK) {
+    return result;
+  }
+  output->SetData(reinterpret_cast<const uint8_t*>(converted_.data()),
+                  converted_.size() * sizeof(int16_t));
+  output->sample_rate = output_sample_rate_;
+  output->channels = output_channels_;
+  output->bits_per_sample = 16;
+  output->codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+  output->pts = input.pts;
+  return liteav::trtc::ERR_OK;
+}
+
+int AudioResampler::Process(AudioFrame* frame) {
+  if (frame == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return Process(*frame, frame);
+}
+
+}  // namespace swing
@@ -0,0 +1,94 @@
+//
+// 功能说明：
+//   16 位 PCM 的采样率与声道转换。
+//   采样率按 L/M 有理数比例做多相 FIR 重采样（Kaiser 窗 sinc，阻带约 -80dB），
+//   内层点积走 audio_kernels 的 SIMD 实现；跨帧保留滤波器历史，
+//   连续输入的多帧输出与一次性处理的结果一致。
+//
+//   声道转换：多声道转单声道取平均，单声道转多声道复制，
+//   其余情况按声道序号取模映射。降声道在重采样之前，升声道在之后。
+//
+//   滤波器引入约 DelayMs() 的固定延迟，输出帧沿用输入帧的 pts。
+//   非线程安全，每路音频使用独立的实例。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_AUDIO_RESAMPLER_H_
+#define GCHATGPT_TRTC_SWING_AUDIO_RESAMPLER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+
+class AudioResampler {
+ public:
+  AudioResampler(int output_sample_rate, int output_channels);
+  ~AudioResampler();
+
+  // 转换一帧，输入格式变化时丢弃历史重新开始
+  // 输出样本数随相位变化，可能比 input_frames * L / M 多或少一个采样点。
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：非 16 位 PCM，或采样率、声道数不合法
+  int Process(const AudioFrame& input, AudioFrame* output);
+
+  // 原地转换，替换 |frame| 的数据与格式
+  int Process(AudioFrame* frame);
+
+  // 交织 PCM 转换，结果追加到 |output|
+  int Process(const int16_t* input,
+              size_t input_frames,
+              int input_sample_rate,
+              int input_channels,
+              std::vector<int16_t>* output);
+
+  // 清空历史，下一帧从静音开始
+  void Reset();
+
+  // 滤波器延迟，单位毫秒，未发生重采样时为 0
+  double DelayMs() const;
+
+  int output_sample_rate() const { return output_sample_rate_; }
+  int output_channels() const { return output_channels_; }
+
+ private:
+  struct Filter;
+
+  AudioResampler(const AudioResampler&);
+  AudioResampler& operator=(const AudioResampler&);
+
+  static std::shared_ptr<const Filter> DesignFilter(int up, int down);
+
+  int Configure(int input_sample_rate, int input_channels);
+  void Resample(int channel, const int16_t* input, size_t count, size_t stride, int* phase);
+
+  const int output_sample_rate_;
+  const int output_channels_;
+
+  int input_sample_rate_;
+  int input_channels_;
+  // 参与重采样的声道数，取输入与输出的较小值
+  int work_channels_;
+
+  // 相同转换比例的实例共享系数
+  std::shared_ptr<const Filter> filter_;
+  // 每声道一段输入历史，起点即下一个输出窗口的起点
+  std::vector<std::vector<int16_t> > history_;
+  int phase_;
+
+  std::vector<int16_t> downmixed_;
+  std::vector<std::vector<int16_t> > resampled_;
+  std::vector<int16_t> interleaved_;
+  std::vector<int16_t> converted_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_AUDIO_RESAMPLER_H_
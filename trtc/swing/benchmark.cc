@@ -0,0 +1,222 @@
+#include "benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <regex>
+#include <thread>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "aes_kernels.h"
+#include "audio_kernels.h"
+#include "yuv_kernels.h"
+
+namespace swing {
+
+namespace {
+
+const int64_t kMaxIterations = 1000000000;
+
+double Now(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+void AppendEscaped(const std::string& value, std::string* out) {
+  out->push_back('"');
+  for (size_t i = 0; i < value.size(); ++i) {
+    char c = value[i];
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendNumber(double value, std::string* out) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.17g", value);
+  out->append(buffer);
+}
+
+}  // namespace
+
+BenchmarkState::BenchmarkState(int64_t iterations)
+    : iterations_(iterations),
+      remaining_(iterations),
+      running_(false),
+      real_start_(0),
+      cpu_start_(0),
+      real_seconds_(0),
+      cpu_seconds_(0),
+      bytes_processed_(0),
+      items_processed_(0) {}
+
+void BenchmarkState::Start() {
+  running_ = true;
+  real_start_ = Now(CLOCK_MONOTONIC);
+  cpu_start_ = Now(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void BenchmarkState::Stop() {
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  real_seconds_ = Now(CLOCK_MONOTONIC) - real_start_;
+  cpu_seconds_ = Now(CLOCK_THREAD_CPUTIME_ID) - cpu_start_;
+}
+
+void BenchmarkState::SkipWithError(const std::string& message) {
+  error_ = message;
+  remaining_ = 0;
+}
+
+BenchmarkResult RunBenchmark(const Benchmark& benchmark, double min_time_seconds) {
+  BenchmarkResult result;
+  int64_t iterations = 1;
+  for (;;) {
+    BenchmarkState state(iterations);
+    benchmark.run(state);
+    bool done = !state.error().empty() || state.real_seconds() >= min_time_seconds ||
+                iterations >= kMaxIterations;
+    if (done) {
+      result.name = benchmark.name;
+      result.iterations = iterations;
+      result.real_time_ns = state.real_seconds() * 1e9 / iterations;
+      result.cpu_time_ns = state.cpu_seconds() * 1e9 / iterations;
+      result.bytes_per_second =
+          state.real_seconds() > 0 ? state.bytes_processed() / state.real_seconds() : 0;
+      result.items_per_second =
+          state.real_seconds() > 0 ? state.items_processed() / state.real_seconds() : 0;
+      result.label = state.label();
+      result.error = state.error();
+      return result;
+    }
+    // 与 Google Benchmark 相同，按上一轮耗时预估，放大 1.4 倍留余量，最多一次放大 10 倍
+    double multiplier = state.real_seconds() > 0 ? min_time_seconds * 1.4 / state.real_seconds()
+                                                 : 10.0;
+    multiplier = std::min(10.0, std::max(multiplier, 1.0));
+    int64_t next = static_cast<int64_t>(static_cast<double>(iterations) * multiplier + 0.5);
+    iterations = std::min(kMaxIterations, std::max(next, iterations + 1));
+  }
+}
+
+std::string BenchmarkResultsToJson(const std::vector<BenchmarkResult>& results) {
+  std::string out;
+  out.append("{\n  \"context\": {\n");
+
+  char date[64];
+  time_t now = time(nullptr);
+  struct tm local;
+  localtime_r(&now, &local);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &local);
+  char host[256] = {0};
+  gethostname(host, sizeof(host) - 1);
+
+  out.append("    \"date\": ");
+  AppendEscaped(date, &out);
+  out.append(",\n    \"host_name\": ");
+  AppendEscaped(host, &out);
+  out.append(",\n    \"executable\": \"swingbench\",\n    \"num_cpus\": ");
+  out.append(std::to_string(std::thread::hardware_concurrency()));
+#ifdef NDEBUG
+  out.append(",\n    \"library_build_type\": \"release\"");
+#else
+  out.append(",\n    \"library_build_type\": \"debug\"");
+#endif
+  out.append(",\n    \"audio_kernels\": ");
+  AppendEscaped(AudioKernelName(), &out);
+  out.append(",\n    \"yuv_kernels\": ");
+  AppendEscaped(YuvKernelName(), &out);
+  out.append(",\n    \"aes_kernels\": ");
+  AppendEscaped(AesKernelName(), &out);
+  out.append("\n  },\n  \"benchmarks\": [");
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& result = results[i];
+    out.append(i == 0 ? "\n" : ",\n");
+    out.append("    {\n      \"name\": ");
+    AppendEscaped(result.name, &out);
+    out.append(",\n      \"run_name\": ");
+    AppendEscaped(result.name, &out);
+    out.append(",\n      \"run_type\": \"iteration\",\n      \"repetitions\": 1,"
+               "\n      \"repetition_index\": 0,\n      \"threads\": 1,\n      \"iterations\": ");
+    out.append(std::to_string(result.iterations));
+    if (!result.error.empty()) {
+      out.append(",\n      \"error_occurred\": true,\n      \"error_message\": ");
+      AppendEscaped(result.error, &out);
+    }
+    out.append(",\n      \"real_time\": ");
+    AppendNumber(result.real_time_ns, &out);
+    out.append(",\n      \"cpu_time\": ");
+    AppendNumber(result.cpu_time_ns, &out);
+    out.append(",\n      \"time_unit\": \"ns\"");
+    if (result.bytes_per_second > 0) {
+      out.append(",\n      \"bytes_per_second\": ");
+      AppendNumber(result.bytes_per_second, &out);
+    }
+    if (result.items_per_second > 0) {
+      out.append(",\n      \"items_per_second\": ");
+      AppendNumber(result.items_per_second, &out);
+    }
+    if (!result.label.empty()) {
+      out.append(",\n      \"label\": ");
+      AppendEscaped(result.label, &out);
+    }
+    out.append("\n    }");
+  }
+  out.append(results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+  return out;
+}
+
+}  // namespace swing
+
+char* SwingRunBenchmarks(const char* filter, double min_time_seconds, uintptr_t director) {
+  std::regex pattern;
+  bool all = filter == nullptr || filter[0] == '\0';
+  if (!all) {
+    try {
+      pattern.assign(filter, std::regex::ECMAScript);
+    } catch (const std::regex_error&) {
+      return nullptr;
+    }
+  }
+
+  std::vector<swing::Benchmark> benchmarks = swing::AllBenchmarks(director);
+  std::vector<swing::BenchmarkResult> results;
+  for (size_t i = 0; i < benchmarks.size(); ++i) {
+    if (all || std::regex_search(benchmarks[i].name, pattern)) {
+      results.push_back(swing::RunBenchmark(benchmarks[i], min_time_seconds));
+    }
+  }
+  // 基准中可能切换到标量实现，结束后恢复
+  swing::ForceScalarAudioKernels(false);
+  swing::ForceScalarYuvKernels(false);
+  swing::ForceScalarAesKernels(false);
+
+  std::string json = swing::BenchmarkResultsToJson(results);
+  char* out = static_cast<char*>(malloc(json.size() + 1));
+  memcpy(out, json.c_str(), json.size() + 1);
+  return out;
+}
+
+void SwingFreeBenchmarkResults(char* results) {
+  free(results);
+}
+
+size_t SwingBenchmarkFrameSize(const void* frame) {
+  return static_cast<const liteav::trtc::AudioFrame*>(frame)->size();
+}
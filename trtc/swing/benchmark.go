@@ -0,0 +1,80 @@
+package swing
+
+// 微基准，接口说明见 benchmark.h
+
+// #include <stdlib.h>
+// #include "benchmark.h"
+import "C"
+
+import (
+	"errors"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+// 回调往返基准中的 Go 侧对象
+// 与 SWIG director 一样，C++ 只持有整数句柄，回调时经注册表找回 Go 对象再调用接口方法。
+type benchmarkDirector interface {
+	OnFrame(frame unsafe.Pointer, readSize bool) int
+}
+
+type sizeReadingDirector struct{}
+
+func (sizeReadingDirector) OnFrame(frame unsafe.Pointer, readSize bool) int {
+	if readSize {
+		return int(C.SwingBenchmarkFrameSize(frame))
+	}
+	return 0
+}
+
+var (
+	benchmarkDirectorMu     sync.Mutex
+	benchmarkDirectors      = map[uintptr]benchmarkDirector{}
+	benchmarkDirectorNextID uintptr
+)
+
+func registerBenchmarkDirector(d benchmarkDirector) uintptr {
+	benchmarkDirectorMu.Lock()
+	defer benchmarkDirectorMu.Unlock()
+	benchmarkDirectorNextID++
+	benchmarkDirectors[benchmarkDirectorNextID] = d
+	return benchmarkDirectorNextID
+}
+
+func unregisterBenchmarkDirector(handle uintptr) {
+	benchmarkDirectorMu.Lock()
+	defer benchmarkDirectorMu.Unlock()
+	delete(benchmarkDirectors, handle)
+}
+
+func lookupBenchmarkDirector(handle uintptr) benchmarkDirector {
+	benchmarkDirectorMu.Lock()
+	defer benchmarkDirectorMu.Unlock()
+	return benchmarkDirectors[handle]
+}
+
+//export swingBenchmarkDirectorCall
+func swingBenchmarkDirectorCall(handle C.uintptr_t, frame unsafe.Pointer, readSize C.int) C.int {
+	d := lookupBenchmarkDirector(uintptr(handle))
+	if d == nil {
+		return -1
+	}
+	return C.int(d.OnFrame(frame, readSize != 0))
+}
+
+// RunBenchmarks 运行名称匹配 filter（正则，空串表示全部）的基准，
+// 每个至少运行 minTime，返回 Google Benchmark 格式的 JSON
+func RunBenchmarks(filter string, minTime time.Duration) (string, error) {
+	handle := registerBenchmarkDirector(sizeReadingDirector{})
+	defer unregisterBenchmarkDirector(handle)
+
+	cFilter := C.CString(filter)
+	defer C.free(unsafe.Pointer(cFilter))
+	results := C.SwingRunBenchmarks(cFilter, C.double(minTime.Seconds()), C.uintptr_t(handle))
+	if results == nil {
+		return "", errors.New("invalid benchmark filter: " + filter)
+	}
+	defer C.SwingFreeBenchmarkResults(results)
+	return C.GoString(results), nil
+}
@@ -0,0 +1,136 @@
+//
+// 功能说明：
+//   媒体胶水层热点路径的微基准。
+//   覆盖帧对象的构造 / 复制 / SetData、TrtcString、C++ 回调进入 Go 的往返，
+//   以及混音、重采样、合流等算子，尺寸取实际使用的范围
+//   （16kHz ~ 48kHz 音频，360p ~ 4K YUV）。有 SIMD 实现的算子同时测标量版本。
+//
+//   计时方式与 Google Benchmark 相同：逐步加大迭代次数直到单次运行超过最短时长，
+//   结果按 Google Benchmark 的 JSON 格式输出，可直接用其 compare.py 对比两次发布。
+//   命令行入口见 trtc/swingbench。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_BENCHMARK_H_
+#define GCHATGPT_TRTC_SWING_BENCHMARK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 运行名称匹配 |filter|（ECMAScript 正则，部分匹配，空串或 NULL 表示全部）的基准，
+// 每个基准至少运行 |min_time_seconds| 秒。
+// |director| 为 Go 侧注册的回调句柄，0 表示跳过回调往返的基准。
+// 返回 JSON 字符串，需用 SwingFreeBenchmarkResults() 释放；正则非法时返回 NULL。
+char* SwingRunBenchmarks(const char* filter, double min_time_seconds, uintptr_t director);
+void SwingFreeBenchmarkResults(char* results);
+
+// 供 Go 侧回调读取帧长度，模拟 SWIG 包装对象上的方法调用
+size_t SwingBenchmarkFrameSize(const void* frame);
+
+#ifdef __cplusplus
+}  // extern "C"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace swing {
+
+// 阻止编译器优化掉只写不读的结果
+template <class T>
+inline void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void ClobberMemory() {
+  asm volatile("" : : : "memory");
+}
+
+class BenchmarkState {
+ public:
+  explicit BenchmarkState(int64_t iterations);
+
+  // 用法：while (state.KeepRunning()) { ... }
+  // 首次调用时开始计时，返回 false 时停止计时。
+  bool KeepRunning() {
+    if (remaining_ > 0) {
+      if (remaining_-- == iterations_) {
+        Start();
+      }
+      return true;
+    }
+    Stop();
+    return false;
+  }
+
+  int64_t iterations() const { return iterations_; }
+
+  // 整个运行处理的字节数、条目数，用于计算吞吐
+  void SetBytesProcessed(int64_t bytes) { bytes_processed_ = bytes; }
+  void SetItemsProcessed(int64_t items) { items_processed_ = items; }
+  void SetLabel(const std::string& label) { label_ = label; }
+
+  // 不支持的组合（例如缺少 SIMD 实现）标记为跳过
+  void SkipWithError(const std::string& message);
+
+  double real_seconds() const { return real_seconds_; }
+  double cpu_seconds() const { return cpu_seconds_; }
+  int64_t bytes_processed() const { return bytes_processed_; }
+  int64_t items_processed() const { return items_processed_; }
+  const std::string& label() const { return label_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  void Start();
+  void Stop();
+
+  const int64_t iterations_;
+  int64_t remaining_;
+  bool running_;
+  double real_start_;
+  double cpu_start_;
+  double real_seconds_;
+  double cpu_seconds_;
+  int64_t bytes_processed_;
+  int64_t items_processed_;
+  std::string label_;
+  std::string error_;
+};
+
+struct Benchmark {
+  Benchmark(const std::string& name, const std::function<void(BenchmarkState&)>& run)
+      : name(name), run(run) {}
+
+  std::string name;
+  std::function<void(BenchmarkState&)> run;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  int64_t iterations;
+  // 每次迭代的耗时，单位纳秒
+  double real_time_ns;
+  double cpu_time_ns;
+  // 0 表示未设置
+  double bytes_per_second;
+  double items_per_second;
+  std::string label;
+  std::string error;
+};
+
+// 所有基准，|director| 含义同 SwingRunBenchmarks()
+std::vector<Benchmark> AllBenchmarks(uintptr_t director);
+
+BenchmarkResult RunBenchmark(const Benchmark& benchmark, double min_time_seconds);
+
+// Google Benchmark 格式的 JSON
+std::string BenchmarkResultsToJson(const std::vector<BenchmarkResult>& results);
+
+}  // namespace swing
+
+#endif  // __cplusplus
+
+#endif  // GCHATGPT_TRTC_SWING_BENCHMARK_H_
@@ -0,0 +1,1088 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "aes_kernels.h"
+#include "audio_encoder_pool.h"
+#include "audio_kernels.h"
+#include "audio_mixer.h"
+#include "audio_resampler.h"
+#include "benchmark.h"
+#include "fanout_hub.h"
+#include "frame_pacer.h"
+#include "gop_cache.h"
+#include "latency_tracer.h"
+#include "media_crypto.h"
+#include "user_interner.h"
+#include "vad_gate.h"
+#include "video_compositor.h"
+#include "video_jitter_buffer.h"
+#include "yuv_kernels.h"
+
+// Go 侧导出的回调入口，见 benchmark.go
+extern "C" int swingBenchmarkDirectorCall(uintptr_t handle, void* frame, int read_size);
+
+namespace swing {
+
+namespace {
+
+using liteav::trtc::PixelFrame;
+using liteav::trtc::TrtcBuffer;
+using liteav::trtc::TrtcString;
+using liteav::trtc::VideoFrame;
+
+struct AudioFormat {
+  int sample_rate;
+  int channels;
+};
+
+struct VideoSize {
+  const char* name;
+  int width;
+  int height;
+};
+
+const AudioFormat kAudioFormats[] = {{16000, 1}, {48000, 2}};
+
+const VideoSize kVideoSizes[] = {
+    {"360p", 640, 360},
+    {"720p", 1280, 720},
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160},
+};
+
+const size_t kEncodedSizes[] = {8 << 10, 64 << 10, 256 << 10};
+
+std::string AudioSuffix(const AudioFormat& format) {
+  return "/" + std::to_string(format.sample_rate) + "/" + std::to_string(format.channels);
+}
+
+// 20ms 一帧
+size_t AudioFrameBytes(const AudioFormat& format) {
+  return static_cast<size_t>(format.sample_rate / 50) * format.channels * sizeof(int16_t);
+}
+
+size_t I420Bytes(int width, int height) {
+  return static_cast<size_t>(width) * height * 3 / 2;
+}
+
+std::vector<uint8_t> Pattern(size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(i * 31 + (i >> 8));
+  }
+  return data;
+}
+
+std::vector<int16_t> Tone(size_t samples, int period) {
+  std::vector<int16_t> pcm(samples);
+  for (size_t i = 0; i < samples; ++i) {
+    int phase = static_cast<int>(i % period);
+    pcm[i] = static_cast<int16_t>((phase * 2 - period) * 12000 / period);
+  }
+  return pcm;
+}
+
+// 线性插值重采样，作为 AudioResampler 的对照基线，单声道
+// 跨帧保留上一帧最后一个采样点与相位，与 AudioResampler 一样可以流式处理。
+class LinearResampler {
+ public:
+  LinearResampler(int input_rate, int output_rate)
+      : input_rate_(input_rate), output_rate_(output_rate), position_(0), last_(0) {}
+
+  void Process(const int16_t* input, size_t count, std::vector<int16_t>* output) {
+    // |position_| 单位为 1/output_rate 个输入采样点，0 对应上一帧的最后一个采样点
+    const int64_t end = static_cast<int64_t>(count) * output_rate_;
+    while (position_ < end) {
+      const int64_t index = position_ / output_rate_;
+      const int64_t fraction = position_ % output_rate_;
+      const int32_t a = index == 0 ? last_ : input[index - 1];
+      const int32_t b = input[index];
+      output->push_back(static_cast<int16_t>(a + (b - a) * fraction / output_rate_));
+      position_ += input_rate_;
+    }
+    position_ -= end;
+    last_ = input[count - 1];
+  }
+
+ private:
+  const int64_t input_rate_;
+  const int64_t output_rate_;
+  int64_t position_;
+  int32_t last_;
+};
+
+// 重采样质量：输入为通带内的正弦，降采样时再叠加一个高于输出奈奎斯特频率、应被滤除的正弦，
+// 按 20ms 一帧连续处理 1s。输出在通带正弦的频率上做最小二乘拟合，拟合部分为信号，
+// 残差（插值误差、混叠、镜像）为噪声，返回信噪比（dB）。跳过开头 50ms 的滤波器暖机。
+double ResampleSnrDb(int input_rate,
+                     int output_rate,
+                     const std::function<void(const int16_t*, size_t, std::vector<int16_t>*)>& process) {
+  const double kPi = 3.14159265358979323846;
+  const double tone = 0.3 * std::min(input_rate, output_rate);
+  const double alias = 0.375 * input_rate;
+  const size_t frame = static_cast<size_t>(input_rate / 50);
+  std::vector<int16_t> input(static_cast<size_t>(input_rate));
+  for (size_t i = 0; i < input.size(); ++i) {
+    double value = 12000.0 * sin(2 * kPi * tone * i / input_rate);
+    if (output_rate < input_rate) {
+      value += 12000.0 * sin(2 * kPi * alias * i / input_rate);
+    }
+    input[i] = static_cast<int16_t>(lrint(value));
+  }
+  std::vector<int16_t> output;
+  for (size_t offset = 0; offset + frame <= input.size(); offset += frame) {
+    process(input.data() + offset, frame, &output);
+  }
+
+  // 解 [sin cos] 的 2x2 正规方程
+  const size_t skip = static_cast<size_t>(output_rate / 20);
+  double ss = 0, cc = 0, sc = 0, ys = 0, yc = 0;
+  for (size_t i = skip; i < output.size(); ++i) {
+    const double s = sin(2 * kPi * tone * i / output_rate);
+    const double c = cos(2 * kPi * tone * i / output_rate);
+    ss += s * s;
+    cc += c * c;
+    sc += s * c;
+    ys += output[i] * s;
+    yc += output[i] * c;
+  }
+  const double det = ss * cc - sc * sc;
+  const double a = (ys * cc - yc * sc) / det;
+  const double b = (yc * ss - ys * sc) / det;
+  double signal = 0, noise = 0;
+  for (size_t i = skip; i < output.size(); ++i) {
+    const double fit = a * sin(2 * kPi * tone * i / output_rate) +
+                       b * cos(2 * kPi * tone * i / output_rate);
+    signal += fit * fit;
+    noise += (output[i] - fit) * (output[i] - fit);
+  }
+  return 10 * log10(signal / std::max(noise, 1e-9));
+}
+
+std::string SnrLabel(double snr_db) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "snr:%.1fdB", snr_db);
+  return buffer;
+}
+
+void SetPixelFrame(int width, int height, const std::vector<uint8_t>& data, PixelFrame* frame) {
+  frame->width = static_cast<uint32_t>(width);
+  frame->height = static_cast<uint32_t>(height);
+  frame->format = liteav::trtc::VIDEO_PIXEL_FORMAT_YUV420p;
+  frame->rotation = liteav::trtc::VIDEO_ROTATION_0;
+  frame->SetData(data.data(), data.size());
+}
+
+// 切换 SIMD / 标量实现，析构时恢复
+class ScopedAudioKernels {
+ public:
+  explicit ScopedAudioKernels(bool scalar) { ForceScalarAudioKernels(scalar); }
+  ~ScopedAudioKernels() { ForceScalarAudioKernels(false); }
+};
+
+class ScopedYuvKernels {
+ public:
+  explicit ScopedYuvKernels(bool scalar) { ForceScalarYuvKernels(scalar); }
+  ~ScopedYuvKernels() { ForceScalarYuvKernels(false); }
+};
+
+class ScopedAesKernels {
+ public:
+  explicit ScopedAesKernels(bool scalar) { ForceScalarAesKernels(scalar); }
+  ~ScopedAesKernels() { ForceScalarAesKernels(false); }
+};
+
+bool HasSimdAudioKernels() {
+  ForceScalarAudioKernels(false);
+  return strcmp(AudioKernelName(), "c") != 0;
+}
+
+bool HasSimdYuvKernels() {
+  ForceScalarYuvKernels(false);
+  return strcmp(YuvKernelName(), "c") != 0;
+}
+
+bool HasSimdAesKernels() {
+  ForceScalarAesKernels(false);
+  return strcmp(AesKernelName(), "c") != 0;
+}
+
+// 编码线程池的下游，只计数
+class CountingAudioSink : public EncodedAudioSink {
+ public:
+  CountingAudioSink() : frames_(0) {}
+
+  void OnEncodedAudio(int, const AudioFrame& frame, int64_t) override {
+    DoNotOptimize(frame.data());
+    frames_.fetch_add(1, std::memory_order_release);
+  }
+
+  uint64_t Frames() const { return frames_.load(std::memory_order_acquire); }
+
+ private:
+  std::atomic<uint64_t> frames_;
+};
+
+// 未链接 libopus 时使用，只复制 PCM 的前 80 字节，衡量线程池本身的开销
+class CopyAudioEncoder : public AudioEncoder {
+ public:
+  int Encode(const int16_t* pcm, uint8_t* out, size_t capacity) override {
+    size_t size = std::min<size_t>(80, capacity);
+    memcpy(out, pcm, size);
+    return static_cast<int>(size);
+  }
+
+  liteav::trtc::AudioCodecType codec() const override {
+    return liteav::trtc::AUDIO_CODEC_TYPE_OPUS;
+  }
+};
+
+class BenchmarkEncoderFactory : public AudioEncoderFactory {
+ public:
+  int Create(const AudioEncodeParams& params, std::unique_ptr<AudioEncoder>* encoder) override {
+    int result = CreateOpusEncoder(params, encoder);
+    if (result == liteav::trtc::ERR_NOT_SUPPORTED) {
+      encoder->reset(new CopyAudioEncoder());
+      return liteav::trtc::ERR_OK;
+    }
+    return result;
+  }
+};
+
+// 与 SWIG director 相同的结构：C++ 虚函数被 Go 侧覆盖，调用经 cgo 导出函数按句柄找到 Go 对象
+class FrameCallback {
+ public:
+  virtual ~FrameCallback() {}
+  virtual int OnFrame(const AudioFrame& frame) = 0;
+};
+
+class DirectorFrameCallback : public FrameCallback {
+ public:
+  DirectorFrameCallback(uintptr_t handle, bool read_size) : handle_(handle), read_size_(read_size) {}
+
+  int OnFrame(const AudioFrame& frame) override {
+    return swingBenchmarkDirectorCall(handle_, const_cast<AudioFrame*>(&frame), read_size_ ? 1 : 0);
+  }
+
+ private:
+  uintptr_t handle_;
+  bool read_size_;
+};
+
+void AddFrameBenchmarks(std::vector<Benchmark>* benchmarks) {
+  for (size_t i = 0; i < sizeof(kAudioFormats) / sizeof(kAudioFormats[0]); ++i) {
+    const AudioFormat format = kAudioFormats[i];
+    const std::string suffix = AudioSuffix(format);
+
+    benchmarks->push_back(Benchmark("BM_AudioFrameConstruct" + suffix, [](BenchmarkState& state) {
+      while (state.KeepRunning()) {
+        AudioFrame frame;
+        DoNotOptimize(frame);
+      }
+    }));
+    benchmarks->push_back(Benchmark("BM_AudioFrameSetData" + suffix, [format](BenchmarkState& state) {
+      std::vector<uint8_t> pcm = Pattern(AudioFrameBytes(format));
+      AudioFrame frame;
+      frame.sample_rate = format.sample_rate;
+      frame.channels = format.channels;
+      while (state.KeepRunning()) {
+        frame.SetData(pcm.data(), pcm.size());
+        ClobberMemory();
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(pcm.size()));
+    }));
+    benchmarks->push_back(Benchmark("BM_AudioFrameCopy" + suffix, [format](BenchmarkState& state) {
+      std::vector<uint8_t> pcm = Pattern(AudioFrameBytes(format));
+      AudioFrame frame;
+      frame.SetData(pcm.data(), pcm.size());
+      while (state.KeepRunning()) {
+        AudioFrame copy(frame);
+        DoNotOptimize(copy.data());
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(pcm.size()));
+    }));
+  }
+
+  for (size_t i = 0; i < sizeof(kEncodedSizes) / sizeof(kEncodedSizes[0]); ++i) {
+    const size_t size = kEncodedSizes[i];
+    const std::string suffix = "/" + std::to_string(size);
+
+    benchmarks->push_back(Benchmark("BM_VideoFrameSetData" + suffix, [size](BenchmarkState& state) {
+      std::vector<uint8_t> data = Pattern(size);
+      VideoFrame frame;
+      while (state.KeepRunning()) {
+        frame.SetData(data.data(), data.size());
+        ClobberMemory();
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+    }));
+    benchmarks->push_back(Benchmark("BM_VideoFrameCopy" + suffix, [size](BenchmarkState& state) {
+      std::vector<uint8_t> data = Pattern(size);
+      VideoFrame frame;
+      frame.SetData(data.data(), data.size());
+      while (state.KeepRunning()) {
+        VideoFrame copy(frame);
+        DoNotOptimize(copy.data());
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+    }));
+    // 30fps 按序到达，每帧入缓冲后立即取出；数据块在缓冲与输出帧间交换复用
+    benchmarks->push_back(Benchmark("BM_VideoJitterBuffer" + suffix, [size](BenchmarkState& state) {
+      std::vector<uint8_t> data = Pattern(size);
+      VideoFrame frame;
+      frame.SetData(data.data(), data.size());
+      VideoJitterBuffer buffer((VideoJitterBufferConfig()));
+      RingFrame out;
+      int64_t now_ms = 0;
+      uint32_t n = 0;
+      while (state.KeepRunning()) {
+        frame.dts = frame.pts = n * 33;
+        frame.is_key_frame = n % 60 == 0;
+        buffer.Insert(frame, now_ms);
+        DoNotOptimize(buffer.Pop(&out, now_ms));
+        now_ms += 33;
+        ++n;
+      }
+      state.SetItemsProcessed(state.iterations());
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+    }));
+  }
+
+  // 中途加入的消费者取最近 GOP：只增加引用计数，与帧大小无关
+  benchmarks->push_back(Benchmark("BM_GopCacheSnapshot/frames:60", [](BenchmarkState& state) {
+    std::vector<uint8_t> data = Pattern(kEncodedSizes[0]);
+    VideoFrame frame;
+    frame.SetData(data.data(), data.size());
+    GopCache cache((GopCacheConfig()));
+    for (uint32_t n = 0; n < 60; ++n) {
+      frame.dts = frame.pts = n * 33;
+      frame.is_key_frame = n == 0;
+      cache.OnRemoteVideoReceived("user", liteav::trtc::STREAM_TYPE_VIDEO_HIGH, frame);
+    }
+    GopSnapshot snapshot;
+    while (state.KeepRunning()) {
+      DoNotOptimize(cache.Snapshot("user", liteav::trtc::STREAM_TYPE_VIDEO_HIGH, &snapshot));
+    }
+    state.SetItemsProcessed(state.iterations());
+  }));
+
+  // 一路订阅分发到多路输出：每帧只复制一次，输出只增加引用计数
+  const size_t kFanoutOutputs[] = {1, 4, 16};
+  for (size_t i = 0; i < sizeof(kFanoutOutputs) / sizeof(kFanoutOutputs[0]); ++i) {
+    const size_t outputs = kFanoutOutputs[i];
+    benchmarks->push_back(Benchmark(
+        "BM_FanoutHubPublish/outputs:" + std::to_string(outputs), [outputs](BenchmarkState& state) {
+          struct NullSink : FanoutSink {
+            int OnFrame(const SharedFrame& frame) override {
+              DoNotOptimize(frame.size());
+              return liteav::trtc::ERR_OK;
+            }
+          };
+          std::vector<uint8_t> data = Pattern(kEncodedSizes[1]);
+          VideoFrame frame;
+          frame.SetData(data.data(), data.size());
+          NullSink sink;
+          FanoutHub hub;
+          for (size_t n = 0; n < outputs; ++n) {
+            hub.AddOutput(FanoutOutputConfig(), &sink);
+          }
+          uint32_t n = 0;
+          while (state.KeepRunning()) {
+            frame.dts = frame.pts = n * 33;
+            frame.is_key_frame = n++ % 60 == 0;
+            hub.PublishVideo(frame);
+            DoNotOptimize(hub.Drain(0));
+          }
+          state.SetItemsProcessed(state.iterations());
+          state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+        }));
+  }
+
+  // 64 个通道各放入一帧 20ms 音频，预缓冲足够长，只衡量入队与排期的开销
+  benchmarks->push_back(Benchmark("BM_FramePacerPush/channels:64", [](BenchmarkState& state) {
+    struct NullSink : FanoutSink {
+      int OnFrame(const SharedFrame&) override { return liteav::trtc::ERR_OK; }
+    };
+    const int kChannels = 64;
+    const uint32_t kFramesPerRound = 256;
+    FramePacerConfig config;
+    config.prebuffer_ms = 3600 * 1000;
+    config.max_buffered_ms = 3600 * 1000;
+    FramePacer pacer(config);
+    NullSink sink;
+    std::vector<int> channel_ids;
+    for (int n = 0; n < kChannels; ++n) {
+      channel_ids.push_back(pacer.AddChannel(&sink));
+    }
+    std::vector<uint8_t> data = Pattern(AudioFrameBytes(kAudioFormats[0]));
+    AudioFrame frame;
+    frame.sample_rate = kAudioFormats[0].sample_rate;
+    frame.channels = kAudioFormats[0].channels;
+    frame.bits_per_sample = 16;
+    frame.SetData(data.data(), data.size());
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+      frame.pts = n * 20;
+      for (int c = 0; c < kChannels; ++c) {
+        pacer.PushAudio(channel_ids[c], frame);
+      }
+      // 定期清空，队列长度保持在 |kFramesPerRound| 以内
+      if (++n % kFramesPerRound == 0) {
+        for (int c = 0; c < kChannels; ++c) {
+          pacer.Clear(channel_ids[c]);
+        }
+      }
+    }
+    state.SetItemsProcessed(state.iterations() * kChannels);
+  }));
+
+  // 每帧打回调与输出两个点，衡量开启追踪时的打点开销
+  // 使用 STREAM_TYPE_UNKNOWN，追踪已开启时不混入真实流的直方图；
+  // 打点快于后台线程取走时缓冲满的丢弃走的是更短的路径，丢弃数记在 label 中。
+  benchmarks->push_back(Benchmark("BM_TraceStamp", [](BenchmarkState& state) {
+    LatencyTracer& tracer = LatencyTracer::Instance();
+    const bool enabled = tracer.Enabled();
+    if (!enabled) {
+      tracer.Enable(LatencyTracerConfig());
+    }
+    const uint32_t source = NewTraceSource();
+    const uint64_t dropped = tracer.GetStats().dropped;
+    uint32_t pts = 0;
+    while (state.KeepRunning()) {
+      const uint64_t key = TraceKey(source, 1, liteav::trtc::STREAM_TYPE_UNKNOWN, pts++);
+      TraceStampAt(key, kSwingTraceCallback, TraceClock());
+      TraceStamp(key, kSwingTraceOutput);
+    }
+    state.SetLabel("dropped:" + std::to_string(tracer.GetStats().dropped - dropped));
+    if (!enabled) {
+      tracer.Disable();
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+  }));
+
+  for (size_t i = 0; i < sizeof(kVideoSizes) / sizeof(kVideoSizes[0]); ++i) {
+    const VideoSize video = kVideoSizes[i];
+    const std::string suffix = std::string("/") + video.name;
+
+    benchmarks->push_back(Benchmark("BM_PixelFrameSetData" + suffix, [video](BenchmarkState& state) {
+      std::vector<uint8_t> data = Pattern(I420Bytes(video.width, video.height));
+      PixelFrame frame;
+      while (state.KeepRunning()) {
+        SetPixelFrame(video.width, video.height, data, &frame);
+        ClobberMemory();
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    }));
+    benchmarks->push_back(Benchmark("BM_PixelFrameCopy" + suffix, [video](BenchmarkState& state) {
+      std::vector<uint8_t> data = Pattern(I420Bytes(video.width, video.height));
+      PixelFrame frame;
+      SetPixelFrame(video.width, video.height, data, &frame);
+      while (state.KeepRunning()) {
+        PixelFrame copy(frame);
+        DoNotOptimize(copy.data());
+      }
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(data.size()));
+    }));
+  }
+
+  const size_t kStringLengths[] = {16, 64};
+  for (size_t i = 0; i < sizeof(kStringLengths) / sizeof(kStringLengths[0]); ++i) {
+    const std::string value(kStringLengths[i], 'u');
+    const std::string suffix = "/" + std::to_string(value.size());
+
+    benchmarks->push_back(Benchmark("BM_TrtcStringConstruct" + suffix, [value](BenchmarkState& state) {
+      while (state.KeepRunning()) {
+        TrtcString str(value.c_str());
+        DoNotOptimize(str.GetValue());
+      }
+    }));
+    benchmarks->push_back(Benchmark("BM_TrtcStringAssign" + suffix, [value](BenchmarkState& state) {
+      TrtcString source(value.c_str());
+      TrtcString str;
+      while (state.KeepRunning()) {
+        str = source;
+        DoNotOptimize(str.GetValue());
+      }
+    }));
+  }
+}
+
+void AddUserBenchmarks(std::vector<Benchmark>* benchmarks) {
+  // 帧回调中由 user_id 查句柄的开销，与房间人数无关
+  const size_t kUserCounts[] = {8, 256};
+  for (size_t i = 0; i < sizeof(kUserCounts) / sizeof(kUserCounts[0]); ++i) {
+    const size_t users = kUserCounts[i];
+    const std::string name = "BM_UserInternerFind/users:" + std::to_string(users);
+    benchmarks->push_back(Benchmark(name, [users](BenchmarkState& state) {
+      UserInterner interner(users);
+      std::vector<std::string> user_ids;
+      for (size_t n = 0; n < users; ++n) {
+        user_ids.push_back("user_" + std::to_string(n * 7919));
+        interner.Intern(user_ids.back().c_str());
+      }
+      size_t n = 0;
+      while (state.KeepRunning()) {
+        DoNotOptimize(interner.Find(user_ids[n].c_str()));
+        n = n + 1 == users ? 0 : n + 1;
+      }
+      state.SetItemsProcessed(state.iterations());
+    }));
+  }
+}
+
+void AddDirectorBenchmarks(uintptr_t director, std::vector<Benchmark>* benchmarks) {
+  const bool kReadSize[] = {false, true};
+  for (size_t i = 0; i < sizeof(kReadSize) / sizeof(kReadSize[0]); ++i) {
+    const bool read_size = kReadSize[i];
+    const char* name = read_size ? "BM_DirectorRoundTrip/frame_size" : "BM_DirectorRoundTrip/empty";
+    benchmarks->push_back(Benchmark(name, [director, read_size](BenchmarkState& state) {
+      if (director == 0) {
+        state.SkipWithError("no go director registered");
+        return;
+      }
+      std::vector<uint8_t> pcm = Pattern(AudioFrameBytes(kAudioFormats[0]));
+      AudioFrame frame;
+      frame.SetData(pcm.data(), pcm.size());
+      std::unique_ptr<FrameCallback> callback(new DirectorFrameCallback(director, read_size));
+      FrameCallback* target = callback.get();
+      DoNotOptimize(target);
+      while (state.KeepRunning()) {
+        DoNotOptimize(target->OnFrame(frame));
+      }
+      state.SetItemsProcessed(state.iterations());
+    }));
+  }
+}
+
+void AddAudioBenchmarks(std::vector<Benchmark>* benchmarks) {
+  const bool simd = HasSimdAudioKernels();
+  const bool kScalar[] = {false, true};
+
+  for (size_t i = 0; i < sizeof(kAudioFormats) / sizeof(kAudioFormats[0]); ++i) {
+    const AudioFormat format = kAudioFormats[i];
+    const size_t samples = static_cast<size_t>(format.sample_rate / 50) * format.channels;
+
+    for (size_t k = 0; k < 2; ++k) {
+      const bool scalar = kScalar[k];
+      const std::string name =
+          "BM_MixAccumulate" + AudioSuffix(format) + (scalar ? "/c" : "/simd");
+      benchmarks->push_back(Benchmark(name, [samples, scalar, simd](BenchmarkState& state) {
+        if (!scalar && !simd) {
+          state.SkipWithError("no simd kernels on this cpu");
+          return;
+        }
+        ScopedAudioKernels kernels(scalar);
+        std::vector<int16_t> a = Tone(samples, 37);
+        std::vector<int16_t> b = Tone(samples, 91);
+        std::vector<int32_t> acc(samples);
+        std::vector<int16_t> out(samples);
+        const int gain = GainToQ14(0.8f);
+        while (state.KeepRunning()) {
+          memset(acc.data(), 0, acc.size() * sizeof(int32_t));
+          MixAccumulateS16(a.data(), acc.data(), samples, gain);
+          MixAccumulateS16(b.data(), acc.data(), samples, gain);
+          SaturateS32ToS16(acc.data(), out.data(), samples);
+          ClobberMemory();
+        }
+        state.SetLabel(AudioKernelName());
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(samples) * 2 *
+                                static_cast<int64_t>(sizeof(int16_t)));
+      }));
+    }
+
+    if (format.channels == 2) {
+      for (size_t k = 0; k < 2; ++k) {
+        const bool scalar = kScalar[k];
+        const std::string name =
+            "BM_DownmixStereoToMono" + AudioSuffix(format) + (scalar ? "/c" : "/simd");
+        benchmarks->push_back(Benchmark(name, [samples, scalar, simd](BenchmarkState& state) {
+          if (!scalar && !simd) {
+            state.SkipWithError("no simd kernels on this cpu");
+            return;
+          }
+          ScopedAudioKernels kernels(scalar);
+          std::vector<int16_t> stereo = Tone(samples, 53);
+          std::vector<int16_t> mono(samples / 2);
+          while (state.KeepRunning()) {
+            DownmixStereoToMono(stereo.data(), mono.data(), mono.size());
+            ClobberMemory();
+          }
+          state.SetLabel(AudioKernelName());
+          state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(samples) *
+                                  static_cast<int64_t>(sizeof(int16_t)));
+        }));
+      }
+    }
+
+    for (size_t k = 0; k < 2; ++k) {
+      const bool scalar = kScalar[k];
+      const std::string name =
+          "BM_SignalEnergy" + AudioSuffix(format) + (scalar ? "/c" : "/simd");
+      benchmarks->push_back(Benchmark(name, [samples, scalar, simd](BenchmarkState& state) {
+        if (!scalar && !simd) {
+          state.SkipWithError("no simd kernels on this cpu");
+          return;
+        }
+        ScopedAudioKernels kernels(scalar);
+        std::vector<int16_t> pcm = Tone(samples, 37);
+        uint64_t energy = 0;
+        uint64_t diff_energy = 0;
+        while (state.KeepRunning()) {
+          SignalEnergyS16(pcm.data(), pcm.size(), &energy, &diff_energy);
+          DoNotOptimize(energy + diff_energy);
+        }
+        state.SetLabel(AudioKernelName());
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(samples) *
+                                static_cast<int64_t>(sizeof(int16_t)));
+      }));
+    }
+  }
+
+  // 16 个用户一半说话一半静音，下游为空，衡量每帧的判断开销
+  for (size_t i = 0; i < sizeof(kAudioFormats) / sizeof(kAudioFormats[0]); ++i) {
+    const AudioFormat format = kAudioFormats[i];
+    const std::string name = "BM_VadGate" + AudioSuffix(format) + "/users:16";
+    benchmarks->push_back(Benchmark(name, [format](BenchmarkState& state) {
+      const int kUsers = 16;
+      VadGate gate(nullptr, VadConfig());
+      std::vector<std::string> user_ids;
+      std::vector<AudioFrame> frames(kUsers);
+      for (int n = 0; n < kUsers; ++n) {
+        user_ids.push_back("user_" + std::to_string(n));
+        std::vector<int16_t> pcm(AudioFrameBytes(format) / sizeof(int16_t));
+        if (n % 2 == 0) {
+          pcm = Tone(pcm.size(), 61 + n * 5);
+        }
+        frames[n].sample_rate = format.sample_rate;
+        frames[n].channels = format.channels;
+        frames[n].bits_per_sample = 16;
+        frames[n].SetData(reinterpret_cast<const uint8_t*>(pcm.data()),
+                          pcm.size() * sizeof(int16_t));
+      }
+
+      uint32_t pts = 0;
+      while (state.KeepRunning()) {
+        for (int n = 0; n < kUsers; ++n) {
+          frames[n].pts = pts;
+          gate.ProcessAudio(user_ids[n].c_str(), frames[n]);
+        }
+        pts += 20;
+      }
+      state.SetLabel(AudioKernelName());
+      state.SetItemsProcessed(state.iterations() * kUsers);
+    }));
+  }
+
+  // 16 个通道各提交一帧 20ms PCM，计时包含等待全部编码完成
+  const size_t kEncoderThreads[] = {1, 4};
+  for (size_t i = 0; i < sizeof(kAudioFormats) / sizeof(kAudioFormats[0]); ++i) {
+    const AudioFormat format = kAudioFormats[i];
+    for (size_t t = 0; t < sizeof(kEncoderThreads) / sizeof(kEncoderThreads[0]); ++t) {
+      const size_t threads = kEncoderThreads[t];
+      const std::string name = "BM_AudioEncoderPool" + AudioSuffix(format) +
+                               "/channels:16/threads:" + std::to_string(threads);
+      benchmarks->push_back(Benchmark(name, [format, threads](BenchmarkState& state) {
+        const int kChannels = 16;
+        BenchmarkEncoderFactory factory;
+        AudioEncoderPoolConfig config;
+        config.threads = threads;
+        config.factory = &factory;
+        AudioEncoderPool pool(config);
+
+        AudioEncodeParams params;
+        params.sample_rate = format.sample_rate;
+        params.channels = format.channels;
+        params.frame_length_ms = 20;
+        params.bitrate_bps = 32000;
+        CountingAudioSink sink;
+        std::vector<int> channel_ids;
+        for (int n = 0; n < kChannels; ++n) {
+          int id = pool.AddChannel(params, &sink);
+          if (id <= 0) {
+            state.SkipWithError("AddChannel failed");
+            return;
+          }
+          channel_ids.push_back(id);
+        }
+
+        std::vector<int16_t> pcm = Tone(AudioFrameBytes(format) / sizeof(int16_t), 37);
+        AudioFrame frame;
+        frame.sample_rate = format.sample_rate;
+        frame.channels = format.channels;
+        frame.bits_per_sample = 16;
+        frame.codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+        frame.SetData(reinterpret_cast<const uint8_t*>(pcm.data()), pcm.size() * sizeof(int16_t));
+
+        uint64_t submitted = 0;
+        while (state.KeepRunning()) {
+          for (int n = 0; n < kChannels; ++n) {
+            while (pool.Submit(channel_ids[n], frame) == liteav::trtc::ERR_READ_TRY_AGAIN) {
+              std::this_thread::yield();
+            }
+          }
+          frame.pts += 20;
+          submitted += kChannels;
+        }
+        while (sink.Frames() < submitted) {
+          std::this_thread::yield();
+        }
+
+        AudioEncoderPoolStats stats = pool.GetStats();
+        if (stats.encoded_frames > 0) {
+          state.SetLabel("encode_ns:" +
+                         std::to_string(stats.encode_ns_total / stats.encoded_frames));
+        }
+        state.SetItemsProcessed(state.iterations() * kChannels);
+      }));
+    }
+  }
+
+  const int kMixerUsers[] = {2, 8};
+  for (size_t i = 0; i < sizeof(kAudioFormats) / sizeof(kAudioFormats[0]); ++i) {
+    const AudioFormat format = kAudioFormats[i];
+    for (size_t u = 0; u < sizeof(kMixerUsers) / sizeof(kMixerUsers[0]); ++u) {
+      const int users = kMixerUsers[u];
+      const std::string name =
+          "BM_AudioMixer" + AudioSuffix(format) + "/users:" + std::to_string(users);
+      benchmarks->push_back(Benchmark(name, [format, users](BenchmarkState& state) {
+        AudioMixerConfig config;
+        config.output_sample_rate = format.sample_rate;
+        config.output_channels = format.channels;
+        AudioMixer mixer(config);
+
+        std::vector<std::string> user_ids;
+        std::vector<AudioFrame> frames(users);
+        for (int n = 0; n < users; ++n) {
+          user_ids.push_back("user_" + std::to_string(n));
+          std::vector<int16_t> pcm =
+              Tone(AudioFrameBytes(format) / sizeof(int16_t), 29 + n * 7);
+          frames[n].sample_rate = format.sample_rate;
+          frames[n].channels = format.channels;
+          frames[n].bits_per_sample = 16;
+          frames[n].SetData(reinterpret_cast<const uint8_t*>(pcm.data()),
+                            pcm.size() * sizeof(int16_t));
+        }
+
+        AudioFrame output;
+        uint32_t pts = 0;
+        while (state.KeepRunning()) {
+          for (int n = 0; n < users; ++n) {
+            frames[n].pts = pts;
+            mixer.PushFrame(user_ids[n].c_str(), frames[n]);
+          }
+          DoNotOptimize(mixer.Mix(&output));
+          pts += 20;
+        }
+        state.SetLabel(AudioKernelName());
+        state.SetItemsProcessed(state.iterations());
+      }));
+    }
+  }
+
+  const int kResampleRates[][2] = {{48000, 16000}, {16000, 48000}, {44100, 48000}};
+  for (size_t i = 0; i < sizeof(kResampleRates) / sizeof(kResampleRates[0]); ++i) {
+    const int input_rate = kResampleRates[i][0];
+    const int output_rate = kResampleRates[i][1];
+    const std::string name =
+        "BM_AudioResampler/" + std::to_string(input_rate) + "_to_" + std::to_string(output_rate);
+    // 20ms 一帧，44.1kHz 也是整数个采样点
+    const size_t input_frames = static_cast<size_t>(input_rate / 50);
+
+    benchmarks->push_back(Benchmark(name, [input_rate, output_rate, input_frames](
+                                              BenchmarkState& state) {
+      AudioResampler quality(output_rate, 1);
+      const double snr_db = ResampleSnrDb(
+          input_rate, output_rate,
+          [&quality, input_rate](const int16_t* input, size_t count, std::vector<int16_t>* output) {
+            quality.Process(input, count, input_rate, 1, output);
+          });
+
+      AudioResampler resampler(output_rate, 1);
+      std::vector<int16_t> input = Tone(input_frames, 41);
+      std::vector<int16_t> output;
+      output.reserve(input_frames * 4);
+      while (state.KeepRunning()) {
+        output.clear();
+        resampler.Process(input.data(), input_frames, input_rate, 1, &output);
+        DoNotOptimize(output.data());
+      }
+      state.SetLabel(std::string(AudioKernelName()) + " " + SnrLabel(snr_db));
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input_frames) *
+                              static_cast<int64_t>(sizeof(int16_t)));
+    }));
+
+    // 线性插值基线，吞吐与信噪比对照上面的多相实现
+    benchmarks->push_back(Benchmark(name + "/linear", [input_rate, output_rate, input_frames](
+                                                          BenchmarkState& state) {
+      LinearResampler quality(input_rate, output_rate);
+      const double snr_db = ResampleSnrDb(
+          input_rate, output_rate,
+          [&quality](const int16_t* input, size_t count, std::vector<int16_t>* output) {
+            quality.Process(input, count, output);
+          });
+
+      LinearResampler resampler(input_rate, output_rate);
+      std::vector<int16_t> input = Tone(input_frames, 41);
+      std::vector<int16_t> output;
+      output.reserve(input_frames * 4);
+      while (state.KeepRunning()) {
+        output.clear();
+        resampler.Process(input.data(), input_frames, &output);
+        DoNotOptimize(output.data());
+      }
+      state.SetLabel(SnrLabel(snr_db));
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input_frames) *
+                              static_cast<int64_t>(sizeof(int16_t)));
+    }));
+  }
+}
+
+void AddVideoBenchmarks(std::vector<Benchmark>* benchmarks) {
+  const bool simd = HasSimdYuvKernels();
+  const bool kScalar[] = {false, true};
+
+  // 典型的四宫格：4 路 360p 合到不同尺寸的画布
+  for (size_t i = 0; i < sizeof(kVideoSizes) / sizeof(kVideoSizes[0]); ++i) {
+    const VideoSize canvas = kVideoSizes[i];
+    for (size_t k = 0; k < 2; ++k) {
+      const bool scalar = kScalar[k];
+      const std::string name = std::string("BM_VideoCompositor/") + canvas.name +
+                               "/inputs:4" + (scalar ? "/c" : "/simd");
+      benchmarks->push_back(Benchmark(name, [canvas, scalar, simd](BenchmarkState& state) {
+        if (!scalar && !simd) {
+          state.SkipWithError("no simd kernels on this cpu");
+          return;
+        }
+        ScopedYuvKernels kernels(scalar);
+        MultiRecordParams params;
+        params.width = static_cast<uint32_t>(canvas.width);
+        params.height = static_cast<uint32_t>(canvas.height);
+        params.layout_mode = liteav::trtc::kSpeedDial;
+        VideoCompositor compositor(params);
+
+        std::vector<uint8_t> data = Pattern(I420Bytes(640, 360));
+        PixelFrame input;
+        SetPixelFrame(640, 360, data, &input);
+        for (int n = 0; n < 4; ++n) {
+          std::string user_id = "user_" + std::to_string(n);
+          compositor.SetInput(user_id.c_str(), liteav::trtc::STREAM_TYPE_VIDEO_HIGH, input);
+        }
+
+        PixelFrame output;
+        uint32_t pts = 0;
+        while (state.KeepRunning()) {
+          // 输入不变时只重绘变化区域，这里测整幅合成
+          compositor.Invalidate();
+          DoNotOptimize(compositor.Compose(pts, &output));
+          pts += 40;
+        }
+        state.SetLabel(YuvKernelName());
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() *
+                                static_cast<int64_t>(I420Bytes(canvas.width, canvas.height)));
+      }));
+    }
+  }
+
+  // 16 宫格中每帧只有部分用户有新画面：只重绘这些格子
+  const int kChangedInputs[] = {1, 4, 16};
+  for (size_t i = 0; i < sizeof(kChangedInputs) / sizeof(kChangedInputs[0]); ++i) {
+    const int changed = kChangedInputs[i];
+    const std::string name =
+        "BM_VideoCompositorDirty/1080p/inputs:16/changed:" + std::to_string(changed);
+    benchmarks->push_back(Benchmark(name, [changed](BenchmarkState& state) {
+      MultiRecordParams params;
+      params.width = 1920;
+      params.height = 1080;
+      params.layout_mode = liteav::trtc::kSpeedDial;
+      VideoCompositor compositor(params);
+
+      std::vector<uint8_t> data = Pattern(I420Bytes(640, 360));
+      PixelFrame input;
+      SetPixelFrame(640, 360, data, &input);
+      std::vector<std::string> users;
+      for (int n = 0; n < 16; ++n) {
+        users.push_back("user_" + std::to_string(n));
+        compositor.SetInput(users.back().c_str(), liteav::trtc::STREAM_TYPE_VIDEO_HIGH, input);
+      }
+      compositor.Compose();
+
+      int next = 0;
+      int64_t dirty = 0;
+      while (state.KeepRunning()) {
+        for (int n = 0; n < changed; ++n) {
+          compositor.SetInput(users[next].c_str(), liteav::trtc::STREAM_TYPE_VIDEO_HIGH, input);
+          next = (next + 1) % 16;
+        }
+        compositor.Compose();
+        dirty += compositor.DirtyPixels();
+      }
+      DoNotOptimize(dirty);
+      state.SetLabel(YuvKernelName());
+      state.SetItemsProcessed(state.iterations());
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(I420Bytes(1920, 1080)));
+    }));
+  }
+
+  const VideoSize kScales[][2] = {
+      {{"1080p", 1920, 1080}, {"360p", 640, 360}},
+      {{"360p", 640, 360}, {"1080p", 1920, 1080}},
+  };
+  for (size_t i = 0; i < sizeof(kScales) / sizeof(kScales[0]); ++i) {
+    const VideoSize src = kScales[i][0];
+    const VideoSize dst = kScales[i][1];
+    for (size_t k = 0; k < 2; ++k) {
+      const bool scalar = kScalar[k];
+      const std::string name = std::string("BM_PlaneScaler/") + src.name + "_to_" + dst.name +
+                               (scalar ? "/c" : "/simd");
+      benchmarks->push_back(Benchmark(name, [src, dst, scalar, simd](BenchmarkState& state) {
+        if (!scalar && !simd) {
+          state.SkipWithError("no simd kernels on this cpu");
+          return;
+        }
+        ScopedYuvKernels kernels(scalar);
+        std::vector<uint8_t> input = Pattern(static_cast<size_t>(src.width) * src.height);
+        std::vector<uint8_t> output(static_cast<size_t>(dst.width) * dst.height);
+        PlaneScaler scaler;
+        while (state.KeepRunning()) {
+          scaler.Scale(input.data(), src.width, src.width, src.height, output.data(), dst.width,
+                       dst.width, dst.height);
+          ClobberMemory();
+        }
+        state.SetLabel(YuvKernelName());
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(output.size()));
+      }));
+    }
+  }
+
+  // 整幅 1080p 亮度平面的 alpha 混合，水印叠加的上限开销
+  for (size_t k = 0; k < 2; ++k) {
+    const bool scalar = kScalar[k];
+    const std::string name = std::string("BM_BlendRow/1080p") + (scalar ? "/c" : "/simd");
+    benchmarks->push_back(Benchmark(name, [scalar, simd](BenchmarkState& state) {
+      if (!scalar && !simd) {
+        state.SkipWithError("no simd kernels on this cpu");
+        return;
+      }
+      ScopedYuvKernels kernels(scalar);
+      const int width = 1920;
+      const int height = 1080;
+      std::vector<uint8_t> src = Pattern(static_cast<size_t>(width) * height);
+      std::vector<uint8_t> alpha(src.rbegin(), src.rend());
+      std::vector<uint8_t> dst(src.size());
+      while (state.KeepRunning()) {
+        for (int y = 0; y < height; ++y) {
+          const size_t offset = static_cast<size_t>(y) * width;
+          BlendRow(&src[offset], &alpha[offset], &dst[offset], width);
+        }
+        ClobberMemory();
+      }
+      state.SetLabel(YuvKernelName());
+      state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(dst.size()));
+    }));
+  }
+}
+
+void AddCryptoBenchmarks(std::vector<Benchmark>* benchmarks) {
+  const bool simd = HasSimdAesKernels();
+  const bool kScalar[] = {false, true};
+  // 单个 RTP 包大小的载荷与一个较大的视频帧
+  const size_t kPacketSizes[] = {1200, 64 << 10};
+
+  for (size_t i = 0; i < sizeof(kPacketSizes) / sizeof(kPacketSizes[0]); ++i) {
+    const size_t size = kPacketSizes[i];
+    const std::string suffix = "/" + std::to_string(size);
+    for (size_t k = 0; k < 2; ++k) {
+      const bool scalar = kScalar[k];
+      const std::string impl = scalar ? "/c" : "/simd";
+
+      const std::string ctr_name = "BM_AesCtr" + suffix + impl;
+      benchmarks->push_back(Benchmark(ctr_name, [size, scalar, simd](BenchmarkState& state) {
+        if (!scalar && !simd) {
+          state.SkipWithError("no simd kernels on this cpu");
+          return;
+        }
+        ScopedAesKernels kernels(scalar);
+        std::vector<uint8_t> key = Pattern(16);
+        AesKey aes;
+        AesExpandKey(key.data(), key.size(), &aes);
+        uint8_t counter[16] = {0};
+        std::vector<uint8_t> data = Pattern(size);
+        while (state.KeepRunning()) {
+          AesCtrXor(aes, counter, data.data(), data.data(), data.size());
+          ClobberMemory();
+        }
+        state.SetLabel(AesKernelName());
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+      }));
+
+      const bool kDecrypt[] = {false, true};
+      for (size_t d = 0; d < 2; ++d) {
+        const bool decrypt = kDecrypt[d];
+        const std::string name =
+            std::string(decrypt ? "BM_AesGcmDecrypt" : "BM_AesGcmEncrypt") + suffix + impl;
+        benchmarks->push_back(Benchmark(name, [size, scalar, simd, decrypt](BenchmarkState& state) {
+          if (!scalar && !simd) {
+            state.SkipWithError("no simd kernels on this cpu");
+            return;
+          }
+          ScopedAesKernels kernels(scalar);
+          MediaCipher cipher(kCipherAesGcm);
+          std::vector<uint8_t> key = Pattern(16);
+          cipher.SetDefaultKey(std::string(key.begin(), key.end()));
+
+          std::vector<uint8_t> data = Pattern(size);
+          TrtcBuffer plain;
+          TrtcBuffer encrypted;
+          TrtcBuffer decrypted;
+          plain.SetData(data.data(), data.size());
+          EncryptionData encryption;
+          encryption.user_id = "bench_user";
+          encryption.stream_type = liteav::trtc::STREAM_TYPE_VIDEO_HIGH;
+          encryption.decrypted = &plain;
+          encryption.encrypted = &encrypted;
+          DecryptionData decryption;
+          decryption.user_id = "bench_user";
+          decryption.stream_type = liteav::trtc::STREAM_TYPE_VIDEO_HIGH;
+          decryption.encrypted = &encrypted;
+          decryption.decrypted = &decrypted;
+          if (!cipher.OnDataEncrypt(encryption) || !cipher.OnDataDecrypt(decryption)) {
+            state.SkipWithError("round trip failed");
+            return;
+          }
+          while (state.KeepRunning()) {
+            bool ok = decrypt ? cipher.OnDataDecrypt(decryption) : cipher.OnDataEncrypt(encryption);
+            DoNotOptimize(ok);
+          }
+          state.SetLabel(AesKernelName());
+          state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(size));
+        }));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+std::vector<Benchmark> AllBenchmarks(uintptr_t director) {
+  std::vector<Benchmark> benchmarks;
+  AddFrameBenchmarks(&benchmarks);
+  AddUserBenchmarks(&benchmarks);
+  AddDirectorBenchmarks(director, &benchmarks);
+  AddAudioBenchmarks(&benchmarks);
+  AddVideoBenchmarks(&benchmarks);
+  AddCryptoBenchmarks(&benchmarks);
+  return benchmarks;
+}
+
+}  // namespace swing
@@ -0,0 +1,92 @@
+#include "data_event.h"
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+
+namespace swing {
+
+namespace {
+
+int FutexWait(std::atomic<int>* word, int expected, const struct timespec* timeout) {
+  return static_cast<int>(syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT_PRIVATE,
+                                  expected, timeout, nullptr, 0));
+}
+
+void FutexWake(std::atomic<int>* word) {
+  syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+}  // namespace
+
+DataEvent::DataEvent()
+    : state_(0), waiters_(0), fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+DataEvent::~DataEvent() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+void DataEvent::Notify() {
+  // 与 Wait() 中 waiters_ 的读写构成 Dekker 式配对，需要 seq_cst
+  if (state_.exchange(1, std::memory_order_seq_cst) != 0) {
+    return;
+  }
+  if (fd_ >= 0) {
+    uint64_t one = 1;
+    ssize_t ret = write(fd_, &one, sizeof(one));
+    (void)ret;
+  }
+  if (waiters_.load(std::memory_order_seq_cst) > 0) {
+    FutexWake(&state_);
+  }
+}
+
+bool DataEvent::TryConsume() {
+  if (state_.load(std::memory_order_relaxed) == 0 ||
+      state_.exchange(0, std::memory_order_acq_rel) == 0) {
+    return false;
+  }
+  // 先清状态再读 eventfd：读完之后到来的 Notify() 会重新写入，不会丢
+  if (fd_ >= 0) {
+    uint64_t value;
+    ssize_t ret = read(fd_, &value, sizeof(value));
+    (void)ret;
+  }
+  return true;
+}
+
+bool DataEvent::Wait(int timeout_ms) {
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+  for (;;) {
+    if (TryConsume()) {
+      return true;
+    }
+    struct timespec timeout;
+    struct timespec* timeout_ptr = nullptr;
+    if (timeout_ms >= 0) {
+      int64_t remaining_ns =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - Clock::now()).count();
+      if (remaining_ns <= 0) {
+        return false;
+      }
+      timeout.tv_sec = static_cast<time_t>(remaining_ns / 1000000000);
+      timeout.tv_nsec = static_cast<long>(remaining_ns % 1000000000);
+      timeout_ptr = &timeout;
+    }
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    // state_ 仍为 0 时才睡眠，Notify() 已置 1 时立即返回
+    FutexWait(&state_, 0, timeout_ptr);
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+  }
+}
+
+}  // namespace swing
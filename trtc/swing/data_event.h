@@ -0,0 +1,49 @@
+//
+// 功能说明：
+//   "有新数据" 通知，替代按定时器轮询。
+//   生产者每产生一批数据调用 Notify()，连续多次通知在被消费前只算一次，
+//   只有第一次需要唤醒，其余只是一次原子交换。
+//   消费者有两种等法：
+//   - Wait()：在 futex 上阻塞，适合专门的消费线程；
+//   - fd()：eventfd，可以和其他 fd 一起放进 epoll，可读后调用 TryConsume()。
+//   两种方式可以混用，但同一时刻只应有一个消费者。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_DATA_EVENT_H_
+#define GCHATGPT_TRTC_SWING_DATA_EVENT_H_
+
+#include <atomic>
+
+namespace swing {
+
+class DataEvent {
+ public:
+  DataEvent();
+  ~DataEvent();
+
+  // 生产者调用，任意线程
+  void Notify();
+
+  // 等待通知并消费，|timeout_ms| < 0 表示一直等待
+  // 返回值：true 表示收到通知，false 表示超时
+  bool Wait(int timeout_ms);
+
+  // 不等待，有未消费的通知时消费并返回 true
+  bool TryConsume();
+
+  // eventfd，有未消费的通知时可读；创建失败时为 -1，此时只能用 Wait()
+  int fd() const { return fd_; }
+
+ private:
+  DataEvent(const DataEvent&);
+  DataEvent& operator=(const DataEvent&);
+
+  // 0：无通知，1：有未消费的通知
+  std::atomic<int> state_;
+  std::atomic<int> waiters_;
+  int fd_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_DATA_EVENT_H_
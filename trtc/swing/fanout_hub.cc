@@ -0,0 +1,409 @@
+#include "fanout_hub.h"
+
+#include <algorithm>
+
+namespace swing {
+
+namespace {
+
+// 队列按需增长的初始容量
+const size_t kInitialQueueSlots = 8;
+
+}  // namespace
+
+// 一路输出：有界的指针环形队列，每个元素持有一份引用
+class FanoutHub::Output {
+ public:
+  Output(int id, const FanoutOutputConfig& config, FanoutSink* sink)
+      : id_(id),
+        config_(config),
+        sink_(sink),
+        head_(0),
+        count_(0),
+        bytes_(0),
+        waiting_keyframe_(false) {}
+
+  ~Output() {
+    while (count_ > 0) {
+      PopFront()->Release();
+    }
+  }
+
+  int id() const { return id_; }
+
+  void Push(const SharedFrame* frame) {
+    if (frame->is_video() ? !config_.video : !config_.audio) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t size = frame->size();
+    while (count_ > 0 && (count_ >= config_.max_frames || bytes_ + size > config_.max_bytes)) {
+      if (config_.drop_policy == kFanoutDropNewest) {
+        ++stats_.dropped;
+        return;
+      }
+      if (config_.drop_policy == kFanoutDropOldest) {
+        PopFront()->Release();
+        ++stats_.dropped;
+      } else {
+        DropToKeyframe();
+      }
+    }
+    if (size > config_.max_bytes) {
+      ++stats_.dropped;
+      waiting_keyframe_ = frame->is_video() && config_.drop_policy == kFanoutDropToKeyframe;
+      return;
+    }
+    if (frame->is_video() && config_.drop_policy == kFanoutDropToKeyframe) {
+      if (frame->is_key_frame) {
+        waiting_keyframe_ = false;
+      } else if (waiting_keyframe_) {
+        ++stats_.dropped;
+        return;
+      }
+    }
+
+    if (count_ == ring_.size()) {
+      Grow();
+    }
+    frame->AddRef();
+    ring_[(head_ + count_) % ring_.size()] = frame;
+    ++count_;
+    bytes_ += size;
+  }
+
+  size_t Drain(size_t max_frames) {
+    // |batch_| 只在 Drain() 线程使用，投递时不持有队列锁，发布线程不被 Sink 阻塞
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      size_t n = max_frames == 0 ? count_ : std::min(count_, max_frames);
+      while (n-- > 0) {
+        batch_.push_back(PopFront());
+      }
+    }
+    if (batch_.empty()) {
+      return 0;
+    }
+    uint64_t failed = 0;
+    for (size_t i = 0; i < batch_.size(); ++i) {
+      if (sink_->OnFrame(*batch_[i]) != liteav::trtc::ERR_OK) {
+        ++failed;
+      }
+      batch_[i]->Release();
+    }
+    const size_t delivered = batch_.size();
+    batch_.clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.delivered += delivered;
+    stats_.failed += failed;
+    return delivered;
+  }
+
+  FanoutOutputStats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FanoutOutputStats stats = stats_;
+    stats.queued = count_;
+    stats.queued_bytes = bytes_;
+    return stats;
+  }
+
+ private:
+  Output(const Output&);
+  Output& operator=(const Output&);
+
+  const SharedFrame* PopFront() {
+    const SharedFrame* frame = ring_[head_];
+    head_ = (head_ + 1) % ring_.size();
+    --count_;
+    bytes_ -= frame->size();
+    return frame;
+  }
+
+  const SharedFrame* At(size_t index) const { return ring_[(head_ + index) % ring_.size()]; }
+
+  // 容量按需翻倍到 |max_frames|，空闲的输出不占用队列内存
+  void Grow() {
+    const size_t capacity =
+        std::min(config_.max_frames, std::max(kInitialQueueSlots, ring_.size() * 2));
+    std::vector<const SharedFrame*> ring(capacity);
+    for (size_t i = 0; i < count_; ++i) {
+      ring[i] = At(i);
+    }
+    ring_.swap(ring);
+    head_ = 0;
+  }
+
+  // 丢弃到队列中下一个视频关键帧之前，没有则丢弃所有视频帧并等待关键帧
+  void DropToKeyframe() {
+    size_t next = 1;
+    while (next < count_ && !(At(next)->is_video() && At(next)->is_key_frame)) {
+      ++next;
+    }
+    if (next < count_) {
+      stats_.dropped += next;
+      while (next-- > 0) {
+        PopFront()->Release();
+      }
+      return;
+    }
+
+    // 保留音频，按原顺序压缩到队首
+    const size_t count = count_;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+      const SharedFrame* frame = At(i);
+      if (frame->is_video()) {
+        bytes_ -= frame->size();
+        frame->Release();
+        ++stats_.dropped;
+      } else {
+        ring_[(head_ + kept++) % ring_.size()] = frame;
+      }
+    }
+    count_ = kept;
+    waiting_keyframe_ = true;
+    if (kept == count) {
+      // 队列中全是音频
+      PopFront()->Release();
+      ++stats_.dropped;
+    }
+  }
+
+  const int id_;
+  const FanoutOutputConfig config_;
+  FanoutSink* const sink_;
+
+  mutable std::mutex mutex_;
+  std::vector<const SharedFrame*> ring_;
+  size_t head_;
+  size_t count_;
+  size_t bytes_;
+  // 视频解码链断开，丢弃到下一个关键帧
+  bool waiting_keyframe_;
+  FanoutOutputStats stats_;
+
+  std::vector<const SharedFrame*> batch_;
+};
+
+SharedFrame::SharedFrame(bool video)
+    : pts(0),
+      dts(0),
+      is_key_frame(false),
+      codec(0),
+      rotation(0),
+      sample_rate(0),
+      channels(0),
+      bits_per_sample(0),
+      video_(video),
+      ref_count_(1) {}
+
+SharedFrame::~SharedFrame() {}
+
+SharedFrame* SharedFrame::FromVideo(const VideoFrame& frame) {
+  SharedFrame* shared = new SharedFrame(true);
+  shared->pts = frame.pts;
+  shared->dts = frame.dts;
+  shared->is_key_frame = frame.is_key_frame;
+  shared->codec = frame.codec;
+  shared->rotation = frame.rotation;
+  shared->payload_.Assign(frame.data(), frame.size());
+  return shared;
+}
+
+SharedFrame* SharedFrame::FromAudio(const AudioFrame& frame) {
+  SharedFrame* shared = new SharedFrame(false);
+  shared->pts = frame.pts;
+  shared->dts = frame.pts;
+  shared->codec = frame.codec;
+  shared->sample_rate = frame.sample_rate;
+  shared->channels = frame.channels;
+  shared->bits_per_sample = frame.bits_per_sample;
+  shared->payload_.Assign(frame.data(), frame.size());
+  return shared;
+}
+
+void SharedFrame::AddRef() const {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SharedFrame::Release() const {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+void SharedFrame::ToVideoFrame(VideoFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->dts = dts;
+  frame->is_key_frame = is_key_frame;
+  frame->codec = static_cast<liteav::trtc::VideoCodecType>(codec);
+  frame->rotation = static_cast<liteav::trtc::VideoRotation>(rotation);
+}
+
+void SharedFrame::ToVideoFrame(liteav::live::VideoFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->dts = dts;
+  frame->is_key_frame = is_key_frame;
+  frame->codec = static_cast<liteav::live::VideoCodecType>(codec);
+  frame->rotation = static_cast<liteav::live::VideoRotation>(rotation);
+}
+
+void SharedFrame::ToAudioFrame(AudioFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->codec = static_cast<liteav::trtc::AudioCodecType>(codec);
+  frame->sample_rate = sample_rate;
+  frame->channels = channels;
+  frame->bits_per_sample = bits_per_sample;
+}
+
+void SharedFrame::ToAudioFrame(liteav::live::AudioFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->codec = static_cast<liteav::live::AudioCodecType>(codec);
+  frame->sample_rate = sample_rate;
+  frame->channels = channels;
+  frame->bits_per_sample = bits_per_sample;
+}
+
+int PusherFanoutSink::OnFrame(const SharedFrame& frame) {
+  if (frame.is_video()) {
+    frame.ToVideoFrame(&video_);
+    return pusher_->SendVideoFrame(video_);
+  }
+  if (frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM &&
+      frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_OPUS) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  frame.ToAudioFrame(&audio_);
+  return pusher_->SendAudioFrame(audio_);
+}
+
+int CloudFanoutSink::OnFrame(const SharedFrame& frame) {
+  if (frame.is_video()) {
+    frame.ToVideoFrame(&video_);
+    return cloud_->SendVideoFrame(video_type_, video_);
+  }
+  frame.ToAudioFrame(&audio_);
+  return cloud_->SendAudioFrame(audio_);
+}
+
+int MuxerFanoutSink::OnFrame(const SharedFrame& frame) {
+  if (frame.is_video()) {
+    frame.ToVideoFrame(&video_);
+    return muxer_->WriteVideo(video_);
+  }
+  frame.ToAudioFrame(&audio_);
+  return muxer_->WriteAudio(audio_);
+}
+
+FanoutHub::FanoutHub() : outputs_(std::make_shared<const OutputList>()), next_id_(0) {}
+
+FanoutHub::~FanoutHub() {}
+
+std::shared_ptr<const FanoutHub::OutputList> FanoutHub::Outputs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return outputs_;
+}
+
+int FanoutHub::AddOutput(const FanoutOutputConfig& config, FanoutSink* sink) {
+  if (sink == nullptr || config.max_frames == 0 || config.max_bytes == 0 ||
+      (!config.audio && !config.video)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<OutputList> outputs = std::make_shared<OutputList>(*outputs_);
+  const int id = next_id_++;
+  outputs->push_back(std::make_shared<Output>(id, config, sink));
+  outputs_ = outputs;
+  return id;
+}
+
+int FanoutHub::RemoveOutput(int output_id) {
+  // 等待正在进行的投递结束，返回后不再回调该输出的 Sink
+  std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<OutputList> outputs = std::make_shared<OutputList>();
+  outputs->reserve(outputs_->size());
+  for (size_t i = 0; i < outputs_->size(); ++i) {
+    if ((*outputs_)[i]->id() != output_id) {
+      outputs->push_back((*outputs_)[i]);
+    }
+  }
+  if (outputs->size() == outputs_->size()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  // 发布线程可能仍持有旧列表，队列随最后一个引用释放
+  outputs_ = outputs;
+  return liteav::trtc::ERR_OK;
+}
+
+void FanoutHub::PublishVideo(const VideoFrame& frame) {
+  if (frame.data() == nullptr || frame.size() == 0) {
+    return;
+  }
+  std::shared_ptr<const OutputList> outputs = Outputs();
+  if (outputs->empty()) {
+    return;
+  }
+  SharedFrame* shared = SharedFrame::FromVideo(frame);
+  for (size_t i = 0; i < outputs->size(); ++i) {
+    (*outputs)[i]->Push(shared);
+  }
+  shared->Release();
+}
+
+void FanoutHub::PublishAudio(const AudioFrame& frame) {
+  if (frame.data() == nullptr || frame.size() == 0) {
+    return;
+  }
+  std::shared_ptr<const OutputList> outputs = Outputs();
+  if (outputs->empty()) {
+    return;
+  }
+  SharedFrame* shared = SharedFrame::FromAudio(frame);
+  for (size_t i = 0; i < outputs->size(); ++i) {
+    (*outputs)[i]->Push(shared);
+  }
+  shared->Release();
+}
+
+void FanoutHub::Publish(const SharedFrame* frame) {
+  if (frame == nullptr) {
+    return;
+  }
+  std::shared_ptr<const OutputList> outputs = Outputs();
+  for (size_t i = 0; i < outputs->size(); ++i) {
+    (*outputs)[i]->Push(frame);
+  }
+}
+
+size_t FanoutHub::Drain(size_t max_per_output) {
+  std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+  std::shared_ptr<const OutputList> outputs = Outputs();
+  size_t delivered = 0;
+  for (size_t i = 0; i < outputs->size(); ++i) {
+    delivered += (*outputs)[i]->Drain(max_per_output);
+  }
+  return delivered;
+}
+
+size_t FanoutHub::OutputCount() const {
+  return Outputs()->size();
+}
+
+int FanoutHub::GetOutputStats(int output_id, FanoutOutputStats* stats) const {
+  std::shared_ptr<const OutputList> outputs = Outputs();
+  for (size_t i = 0; i < outputs->size(); ++i) {
+    if ((*outputs)[i]->id() == output_id) {
+      *stats = (*outputs)[i]->GetStats();
+      return liteav::trtc::ERR_OK;
+    }
+  }
+  return liteav::trtc::ERR_INVALID_PARAMETER;
+}
+
+}  // namespace swing
@@ -0,0 +1,221 @@
+//
+// 功能说明：
+//   单路订阅到多路输出的分发（转推多个 V2TXLivePusher、多个本地录制等）。
+//   SDK 帧类的拷贝构造会深拷贝数据，每路输出各复制一次；FanoutHub 在发布时把帧
+//   复制一次到不可变、引用计数的 SharedFrame，各输出的队列只保存指针并各持一份
+//   引用，最后一个输出处理完后数据块还给 FramePool。
+//
+//   每路输出有独立的有界队列与丢帧策略，互不影响：某路推流卡住只会丢自己的帧。
+//   输出本身只占一个对象和按需增长的指针队列，增加输出不增加帧数据的内存。
+//
+//   投递：Drain() 依次把各输出队列中的帧交给其 FanoutSink，在调用 Drain() 的
+//   线程执行；SDK 的发送接口只接受 VideoFrame / AudioFrame，发送前的 SetData()
+//   复制由 SDK 决定，无法省去，内置的 Sink 复用同一个帧对象。
+//
+//   线程安全：Publish*() 可在多个线程调用（音频、视频回调线程），
+//   AddOutput() / RemoveOutput() 可随时调用，Drain() 内部串行化，
+//   通常由一个线程循环调用，不为每路输出创建线程。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_FANOUT_HUB_H_
+#define GCHATGPT_TRTC_SWING_FANOUT_HUB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../include/live/liteav_live_pusher.h"
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "frame_pool.h"
+#include "frame_view.h"
+#include "stream_muxer.h"
+
+namespace swing {
+
+using liteav::live::V2TXLivePusher;
+using liteav::trtc::AudioFrame;
+using liteav::trtc::StreamType;
+using liteav::trtc::TRTCCloud;
+using liteav::trtc::VideoFrame;
+
+// 不可变的共享帧，引用计数，数据块取自 FramePool
+class SharedFrame {
+ public:
+  static SharedFrame* FromVideo(const VideoFrame& frame);
+  static SharedFrame* FromAudio(const AudioFrame& frame);
+
+  void AddRef() const;
+  void Release() const;
+
+  bool is_video() const { return video_; }
+  ByteSpan Bytes() const { return payload_.Bytes(); }
+  size_t size() const { return payload_.size(); }
+
+  // 复制到 SDK 帧对象，用于发送
+  void ToVideoFrame(VideoFrame* frame) const;
+  void ToVideoFrame(liteav::live::VideoFrame* frame) const;
+  void ToAudioFrame(AudioFrame* frame) const;
+  void ToAudioFrame(liteav::live::AudioFrame* frame) const;
+
+  uint32_t pts;
+  uint32_t dts;
+  bool is_key_frame;
+  // 视频为 VideoCodecType，音频为 AudioCodecType
+  int codec;
+  int rotation;
+  int sample_rate;
+  int channels;
+  int bits_per_sample;
+
+ private:
+  explicit SharedFrame(bool video);
+  ~SharedFrame();
+  SharedFrame(const SharedFrame&);
+  SharedFrame& operator=(const SharedFrame&);
+
+  const bool video_;
+  mutable std::atomic<int> ref_count_;
+  PooledBuffer payload_;
+};
+
+// 队列满时的处理方式
+enum FanoutDropPolicy {
+  // 丢弃最早的帧
+  kFanoutDropOldest = 0,
+  // 丢弃新到的帧
+  kFanoutDropNewest = 1,
+  // 丢弃到队列中下一个视频关键帧为止，没有则清空视频并等待下一个关键帧，
+  // 保证输出的视频始终可解码
+  kFanoutDropToKeyframe = 2,
+};
+
+struct FanoutOutputConfig {
+  FanoutOutputConfig()
+      : max_frames(64),
+        max_bytes(8 << 20),
+        drop_policy(kFanoutDropToKeyframe),
+        audio(true),
+        video(true) {}
+
+  // 队列上限，按帧数与字节数（共享数据按每路输出计）
+  size_t max_frames;
+  size_t max_bytes;
+  FanoutDropPolicy drop_policy;
+
+  // 是否接收音频 / 视频
+  bool audio;
+  bool video;
+};
+
+struct FanoutOutputStats {
+  FanoutOutputStats() : queued(0), queued_bytes(0), delivered(0), dropped(0), failed(0) {}
+
+  size_t queued;
+  size_t queued_bytes;
+  uint64_t delivered;
+  uint64_t dropped;
+  // Sink 返回非 ERR_OK 的次数
+  uint64_t failed;
+};
+
+// 输出的处理回调，在 Drain() 线程执行
+// |frame| 仅在回调期间有效，需要持有时调用 frame.AddRef()。
+class FanoutSink {
+ public:
+  virtual ~FanoutSink() {}
+  virtual int OnFrame(const SharedFrame& frame) = 0;
+};
+
+// 发送到 V2TXLivePusher，只支持 PCM / Opus 音频
+class PusherFanoutSink : public FanoutSink {
+ public:
+  explicit PusherFanoutSink(V2TXLivePusher* pusher) : pusher_(pusher) {}
+  int OnFrame(const SharedFrame& frame) override;
+
+ private:
+  V2TXLivePusher* pusher_;
+  liteav::live::VideoFrame video_;
+  liteav::live::AudioFrame audio_;
+};
+
+// 发送到 TRTCCloud，视频使用 |video_type|
+class CloudFanoutSink : public FanoutSink {
+ public:
+  CloudFanoutSink(TRTCCloud* cloud, StreamType video_type)
+      : cloud_(cloud), video_type_(video_type) {}
+  int OnFrame(const SharedFrame& frame) override;
+
+ private:
+  TRTCCloud* cloud_;
+  StreamType video_type_;
+  VideoFrame video_;
+  AudioFrame audio_;
+};
+
+// 写入本地录制
+class MuxerFanoutSink : public FanoutSink {
+ public:
+  explicit MuxerFanoutSink(StreamMuxer* muxer) : muxer_(muxer) {}
+  int OnFrame(const SharedFrame& frame) override;
+
+ private:
+  StreamMuxer* muxer_;
+  VideoFrame video_;
+  AudioFrame audio_;
+};
+
+class FanoutHub {
+ public:
+  FanoutHub();
+  ~FanoutHub();
+
+  // 增加一路输出，返回输出 ID（>= 0），参数无效时返回 ERR_INVALID_PARAMETER
+  // |sink| 需在 RemoveOutput() 或本对象销毁之后才能销毁。
+  int AddOutput(const FanoutOutputConfig& config, FanoutSink* sink);
+
+  // 移除输出并释放其队列，不存在时返回 ERR_INVALID_PARAMETER
+  // 不能在该输出的 Sink 回调中调用。
+  int RemoveOutput(int output_id);
+
+  // 发布一帧：复制一次，各输出共享
+  void PublishVideo(const VideoFrame& frame);
+  void PublishAudio(const AudioFrame& frame);
+
+  // 发布已有的共享帧，只增加引用计数
+  void Publish(const SharedFrame* frame);
+
+  // 依次把每路输出队列中最多 |max_per_output| 帧交给其 Sink，返回总帧数
+  // |max_per_output| 为 0 表示不限。
+  size_t Drain(size_t max_per_output);
+
+  size_t OutputCount() const;
+
+  // 输出不存在时返回 ERR_INVALID_PARAMETER
+  int GetOutputStats(int output_id, FanoutOutputStats* stats) const;
+
+ private:
+  class Output;
+
+  FanoutHub(const FanoutHub&);
+  FanoutHub& operator=(const FanoutHub&);
+
+  typedef std::vector<std::shared_ptr<Output> > OutputList;
+
+  std::shared_ptr<const OutputList> Outputs() const;
+
+  // 写时复制：发布线程只在取列表时加锁
+  mutable std::mutex mutex_;
+  std::shared_ptr<const OutputList> outputs_;
+  int next_id_;
+
+  // Drain() 期间持有，RemoveOutput() 等待正在进行的投递结束
+  std::mutex drain_mutex_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_FANOUT_HUB_H_
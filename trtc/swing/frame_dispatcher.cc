@@ -0,0 +1,496 @@
+#include "frame_dispatcher.h"
+
+#include "latency_tracer.h"
+
+namespace swing {
+
+namespace {
+
+// 每个用户的流类型：音频、大流、小流、辅流
+const size_t kStreamSlots = 4;
+
+// 流类型在用户槽位中的下标，不支持的类型返回 kStreamSlots
+size_t StreamSlot(StreamType type) {
+  switch (type) {
+    case liteav::trtc::STREAM_TYPE_AUDIO:
+      return 0;
+    case liteav::trtc::STREAM_TYPE_VIDEO_HIGH:
+      return 1;
+    case liteav::trtc::STREAM_TYPE_VIDEO_LOW:
+      return 2;
+    case liteav::trtc::STREAM_TYPE_VIDEO_AUX:
+      return 3;
+    default:
+      return kStreamSlots;
+  }
+}
+
+// 槽位复用时保留着上一帧的字段，填充前恢复默认值，|payload| 保留容量
+void ResetSlot(RingFrame* slot) {
+  slot->kind = kFrameKindAudio;
+  slot->pts = 0;
+  slot->dts = 0;
+  slot->is_key_frame = false;
+  slot->codec = 0;
+  slot->sample_rate = 0;
+  slot->channels = 0;
+  slot->width = 0;
+  slot->height = 0;
+  slot->rotation = 0;
+  slot->trace_key = 0;
+}
+
+void CopyPayload(RingFrame* slot, const uint8_t* data, size_t size) {
+  // Assign 不会缩小容量，槽位复用后不再分配
+  slot->payload.Assign(data, size);
+}
+
+}  // namespace
+
+ByteSpan RingFrame::Bytes() const {
+  return payload.Bytes();
+}
+
+StreamRing::StreamRing(const std::string& user_id,
+                       StreamType type,
+                       size_t capacity,
+                       uint32_t user_handle)
+    : user_id_(user_id),
+      type_(type),
+      user_handle_(user_handle),
+      trace_base_(0),
+      ring_(capacity),
+      pushed_(0),
+      dropped_(0),
+      state_(kRingActive),
+      entry_index_(0) {}
+
+RingFrame* StreamRing::BeginPush() {
+  RingFrame* slot = ring_.BeginPush();
+  if (slot == nullptr) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  return slot;
+}
+
+void StreamRing::CommitPush() {
+  ring_.CommitPush();
+  pushed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StreamRing::Reuse(const std::string& user_id, StreamType type, uint32_t user_handle) {
+  user_id_ = user_id;
+  type_ = type;
+  user_handle_ = user_handle;
+  pushed_.store(0, std::memory_order_relaxed);
+  dropped_.store(0, std::memory_order_relaxed);
+  state_.store(kRingActive, std::memory_order_release);
+}
+
+FrameDispatcher::FrameDispatcher(liteav::trtc::TRTCCloudDelegate* target,
+                                 const FrameRingConfig& config)
+    : target_(target),
+      config_(config),
+      users_(config.max_streams),
+      by_user_(config.max_streams * kStreamSlots),
+      producers_(config.max_streams * kStreamSlots),
+      mixed_handle_(kInvalidUser),
+      retiring_(config.max_streams, 0),
+      exited_(config.max_streams, false),
+      streams_(config.max_streams, nullptr),
+      stream_count_(0),
+      dropped_no_stream_(0),
+      dropped_retired_(0),
+      trace_source_(NewTraceSource()),
+      event_(nullptr) {
+  for (size_t i = 0; i < by_user_.size(); ++i) {
+    by_user_[i].store(nullptr, std::memory_order_relaxed);
+    producers_[i].store(0, std::memory_order_relaxed);
+  }
+  mixed_handle_ = users_.Intern("");
+}
+
+FrameDispatcher::~FrameDispatcher() {
+  size_t count = stream_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; ++i) {
+    delete streams_[i];
+  }
+}
+
+StreamRing* FrameDispatcher::BeginProduce(const char* user_id, StreamType type, size_t* index) {
+  const size_t slot = StreamSlot(type);
+  if (slot == kStreamSlots) {
+    return nullptr;
+  }
+  // 只在进房回调中驻留，这里只是一次无锁查找
+  const uint32_t handle = users_.Find(user_id);
+  if (handle == kInvalidUser) {
+    return nullptr;
+  }
+  const size_t entry = handle * kStreamSlots + slot;
+  // 先登记再读槽位，与 RetireUser() 摘除、Drain() 检查计数构成顺序一致的握手：
+  // Drain() 读到计数为 0 时，之后登记的生产者只会读到摘除后的槽位
+  producers_[entry].fetch_add(1, std::memory_order_seq_cst);
+  StreamRing* ring = by_user_[entry].load(std::memory_order_seq_cst);
+  if (ring == nullptr) {
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    ring = by_user_[entry].load(std::memory_order_acquire);
+    if (ring == nullptr && users_.Find(user_id) == handle && !exited_[handle]) {
+      ring = CreateLocked(handle, type, entry);
+    }
+  } else if (users_.Find(user_id) != handle) {
+    // 查找之后用户已退房，句柄又分配给了新用户，槽位中是新用户的队列
+    ring = nullptr;
+  }
+  if (ring == nullptr) {
+    producers_[entry].fetch_sub(1, std::memory_order_release);
+    return nullptr;
+  }
+  *index = entry;
+  return ring;
+}
+
+void FrameDispatcher::EndProduce(size_t index) {
+  producers_[index].fetch_sub(1, std::memory_order_release);
+}
+
+StreamRing* FrameDispatcher::CreateLocked(uint32_t handle, StreamType type, size_t index) {
+  size_t capacity = type == liteav::trtc::STREAM_TYPE_AUDIO ? config_.audio_capacity
+                                                            : config_.video_capacity;
+  size_t count = stream_count_.load(std::memory_order_relaxed);
+  StreamRing* ring = nullptr;
+  for (size_t i = 0; i < count; ++i) {
+    StreamRing* idle = streams_[i];
+    if (idle->state_.load(std::memory_order_acquire) == StreamRing::kRingIdle &&
+        idle->Capacity() == capacity) {
+      dropped_retired_.fetch_add(idle->Dropped(), std::memory_order_relaxed);
+      idle->Reuse(users_.Name(handle), type, handle);
+      ring = idle;
+      break;
+    }
+  }
+  if (ring == nullptr) {
+    if (count >= config_.max_streams) {
+      return nullptr;
+    }
+    ring = new StreamRing(users_.Name(handle), type, capacity, handle);
+    streams_[count] = ring;
+    stream_count_.store(count + 1, std::memory_order_release);
+  }
+  ring->trace_base_ = TraceKey(trace_source_, handle, type, 0);
+  ring->entry_index_ = index;
+  by_user_[index].store(ring, std::memory_order_release);
+  return ring;
+}
+
+void FrameDispatcher::RetireUser(const char* user_id) {
+  std::lock_guard<std::mutex> lock(create_mutex_);
+  const uint32_t handle = users_.Find(user_id);
+  if (handle == kInvalidUser || handle == mixed_handle_) {
+    return;
+  }
+  for (size_t slot = 0; slot < kStreamSlots; ++slot) {
+    StreamRing* ring =
+        by_user_[handle * kStreamSlots + slot].exchange(nullptr, std::memory_order_seq_cst);
+    if (ring != nullptr) {
+      ring->state_.store(StreamRing::kRingRetired, std::memory_order_release);
+      ++retiring_[handle];
+    }
+  }
+  // 退役队列里还有该用户的帧，等 Drain() 全部取空后再归还句柄
+  if (retiring_[handle] == 0) {
+    users_.Release(handle);
+  } else {
+    exited_[handle] = true;
+  }
+}
+
+void FrameDispatcher::IdleLocked(StreamRing* ring) {
+  const uint32_t handle = ring->user_handle();
+  ring->state_.store(StreamRing::kRingIdle, std::memory_order_release);
+  // 用户在取空前重新进房时 |exited_| 已清除，句柄继续使用
+  if (--retiring_[handle] == 0 && exited_[handle]) {
+    exited_[handle] = false;
+    users_.Release(handle);
+  }
+}
+
+size_t FrameDispatcher::Drain(FrameSink* sink, size_t max_per_stream) {
+  size_t total = 0;
+  size_t count = stream_count_.load(std::memory_order_acquire);
+  for (size_t i = 0; i < count; ++i) {
+    StreamRing* ring = streams_[i];
+    size_t readable = ring->Readable();
+    if (readable == 0) {
+      // 退役队列没有在途生产者且已取空，此后可复用给新的流
+      // 先读计数再读队列：计数为 0 时已退出的生产者提交的帧都可见
+      if (ring->state_.load(std::memory_order_acquire) == StreamRing::kRingRetired &&
+          producers_[ring->entry_index()].load(std::memory_order_seq_cst) == 0 &&
+          ring->Readable() == 0) {
+        std::lock_guard<std::mutex> lock(create_mutex_);
+        IdleLocked(ring);
+      }
+      continue;
+    }
+    if (max_per_stream > 0 && readable > max_per_stream) {
+      readable = max_per_stream;
+    }
+    const int64_t trace_ns = TraceClock();
+    if (trace_ns != 0) {
+      for (size_t n = 0; n < readable; ++n) {
+        TraceStampAt(ring->Peek(n)->trace_key, kSwingTraceHandoff, trace_ns);
+      }
+    }
+    sink->OnFrames(ring, readable);
+    ring->Consume(readable);
+    total += readable;
+  }
+  return total;
+}
+
+void FrameDispatcher::SetDataEvent(DataEvent* event) {
+  event_.store(event, std::memory_order_release);
+}
+
+void FrameDispatcher::NotifyEvent() {
+  DataEvent* event = event_.load(std::memory_order_acquire);
+  if (event != nullptr) {
+    event->Notify();
+  }
+}
+
+size_t FrameDispatcher::StreamCount() const {
+  return stream_count_.load(std::memory_order_acquire);
+}
+
+StreamRing* FrameDispatcher::GetStream(size_t index) const {
+  if (index >= StreamCount()) {
+    return nullptr;
+  }
+  return streams_[index];
+}
+
+size_t FrameDispatcher::TotalSize() const {
+  size_t total = 0;
+  size_t count = StreamCount();
+  for (size_t i = 0; i < count; ++i) {
+    total += streams_[i]->Size();
+  }
+  return total;
+}
+
+uint64_t FrameDispatcher::TotalDropped() const {
+  uint64_t total = dropped_no_stream_.load(std::memory_order_relaxed) +
+                   dropped_retired_.load(std::memory_order_relaxed);
+  size_t count = StreamCount();
+  for (size_t i = 0; i < count; ++i) {
+    total += streams_[i]->Dropped();
+  }
+  return total;
+}
+
+void FrameDispatcher::OnError(liteav::trtc::Error error) {
+  if (target_ != nullptr) {
+    target_->OnError(error);
+  }
+}
+
+void FrameDispatcher::OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                               liteav::trtc::ConnectionState new_state) {
+  if (target_ != nullptr) {
+    target_->OnConnectionStateChanged(old_state, new_state);
+  }
+}
+
+void FrameDispatcher::OnEnterRoom() {
+  if (target_ != nullptr) {
+    target_->OnEnterRoom();
+  }
+}
+
+void FrameDispatcher::OnExitRoom() {
+  if (target_ != nullptr) {
+    target_->OnExitRoom();
+  }
+}
+
+void FrameDispatcher::OnLocalAudioChannelCreated() {
+  if (target_ != nullptr) {
+    target_->OnLocalAudioChannelCreated();
+  }
+}
+
+void FrameDispatcher::OnLocalAudioChannelDestroyed() {
+  if (target_ != nullptr) {
+    target_->OnLocalAudioChannelDestroyed();
+  }
+}
+
+void FrameDispatcher::OnLocalVideoChannelCreated(StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnLocalVideoChannelCreated(type);
+  }
+}
+
+void FrameDispatcher::OnLocalVideoChannelDestroyed(StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnLocalVideoChannelDestroyed(type);
+  }
+}
+
+void FrameDispatcher::OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) {
+  if (target_ != nullptr) {
+    target_->OnRequestChangeVideoEncodeBitrate(type, bitrate_bps);
+  }
+}
+
+void FrameDispatcher::OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) {
+  {
+    std::lock_guard<std::mutex> lock(create_mutex_);
+    const uint32_t handle = users_.Intern(info.user_id.GetValue());
+    if (handle != kInvalidUser) {
+      exited_[handle] = false;
+    }
+  }
+  if (target_ != nullptr) {
+    target_->OnRemoteUserEnterRoom(info);
+  }
+}
+
+void FrameDispatcher::OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) {
+  RetireUser(info.user_id.GetValue());
+  if (target_ != nullptr) {
+    target_->OnRemoteUserExitRoom(info);
+  }
+}
+
+void FrameDispatcher::OnRemoteAudioAvailable(const char* user_id, bool available) {
+  if (target_ != nullptr) {
+    target_->OnRemoteAudioAvailable(user_id, available);
+  }
+}
+
+void FrameDispatcher::OnRemoteVideoAvailable(const char* user_id,
+                                             bool available,
+                                             StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnRemoteVideoAvailable(user_id, available, type);
+  }
+}
+
+void FrameDispatcher::OnRemoteVideoReceived(const char* user_id,
+                                            StreamType type,
+                                            const VideoFrame& frame) {
+  const int64_t trace_ns = TraceClock();
+  size_t index = 0;
+  StreamRing* ring = BeginProduce(user_id, type, &index);
+  if (ring == nullptr) {
+    dropped_no_stream_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RingFrame* slot = ring->BeginPush();
+  if (slot == nullptr) {
+    EndProduce(index);
+    return;
+  }
+  ResetSlot(slot);
+  slot->kind = kFrameKindVideo;
+  slot->pts = frame.pts;
+  slot->dts = frame.dts;
+  slot->is_key_frame = frame.is_key_frame;
+  slot->codec = frame.codec;
+  slot->rotation = frame.rotation;
+  slot->trace_key = ring->trace_base() | frame.pts;
+  CopyPayload(slot, frame.data(), frame.size());
+  // 入队时间在发布前取，保证早于消费者的交付时间
+  if (trace_ns != 0) {
+    TraceStampAt(slot->trace_key, kSwingTraceCallback, trace_ns);
+    TraceStamp(slot->trace_key, kSwingTraceQueue);
+  }
+  ring->CommitPush();
+  EndProduce(index);
+  NotifyEvent();
+}
+
+void FrameDispatcher::OnRemoteVideoReceived(const char* user_id,
+                                            StreamType type,
+                                            const PixelFrame& frame) {
+  const int64_t trace_ns = TraceClock();
+  size_t index = 0;
+  StreamRing* ring = BeginProduce(user_id, type, &index);
+  if (ring == nullptr) {
+    dropped_no_stream_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RingFrame* slot = ring->BeginPush();
+  if (slot == nullptr) {
+    EndProduce(index);
+    return;
+  }
+  ResetSlot(slot);
+  slot->kind = kFrameKindPixel;
+  slot->pts = frame.pts;
+  slot->dts = frame.pts;
+  slot->codec = frame.format;
+  slot->width = frame.width;
+  slot->height = frame.height;
+  slot->rotation = frame.rotation;
+  slot->trace_key = ring->trace_base() | frame.pts;
+  CopyPayload(slot, frame.data(), frame.size());
+  // 入队时间在发布前取，保证早于消费者的交付时间
+  if (trace_ns != 0) {
+    TraceStampAt(slot->trace_key, kSwingTraceCallback, trace_ns);
+    TraceStamp(slot->trace_key, kSwingTraceQueue);
+  }
+  ring->CommitPush();
+  EndProduce(index);
+  NotifyEvent();
+}
+
+void FrameDispatcher::OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) {
+  const int64_t trace_ns = TraceClock();
+  size_t index = 0;
+  StreamRing* ring = BeginProduce(user_id, liteav::trtc::STREAM_TYPE_AUDIO, &index);
+  if (ring == nullptr) {
+    dropped_no_stream_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RingFrame* slot = ring->BeginPush();
+  if (slot == nullptr) {
+    EndProduce(index);
+    return;
+  }
+  ResetSlot(slot);
+  slot->kind = kFrameKindAudio;
+  slot->pts = frame.pts;
+  slot->dts = frame.pts;
+  slot->codec = frame.codec;
+  slot->sample_rate = frame.sample_rate;
+  slot->channels = frame.channels;
+  slot->trace_key = ring->trace_base() | frame.pts;
+  CopyPayload(slot, frame.data(), frame.size());
+  // 入队时间在发布前取，保证早于消费者的交付时间
+  if (trace_ns != 0) {
+    TraceStampAt(slot->trace_key, kSwingTraceCallback, trace_ns);
+    TraceStamp(slot->trace_key, kSwingTraceQueue);
+  }
+  ring->CommitPush();
+  EndProduce(index);
+  NotifyEvent();
+}
+
+void FrameDispatcher::OnRemoteMixedAudioReceived(const AudioFrame& frame) {
+  OnRemoteAudioReceived("", frame);
+}
+
+void FrameDispatcher::OnSeiMessageReceived(const char* user_id,
+                                           StreamType stream_type,
+                                           int message_type,
+                                           const uint8_t* message,
+                                           int length) {
+  if (target_ != nullptr) {
+    target_->OnSeiMessageReceived(user_id, stream_type, message_type, message, length);
+  }
+}
+
+}  // namespace swing
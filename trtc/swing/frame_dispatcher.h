@@ -0,0 +1,292 @@
+//
+// 功能说明：
+//   远端帧投递层。
+//   FrameDispatcher 作为 TRTCCloudDelegate 传给 TRTCCloud::Create()，
+//   帧回调只把数据复制进对应 (user_id, StreamType) 的 SPSC 队列后立即返回，
+//   SDK 线程不再直接回调 Go；消费者通过 Drain() 批量取帧。
+//   混音后的音频（OnRemoteMixedAudioReceived）进入 user_id 为空的音频队列，
+//   空 user_id 在构造时驻留，占用一个句柄。
+//   用户只在 OnRemoteUserEnterRoom 时驻留为整数句柄（见 UserInterner），帧回调
+//   查到句柄后按 [句柄][流类型] 直接下标取队列，未进房或已退房用户的帧丢弃并计数；
+//   StreamRing::user_handle() 供消费者用同样的方式索引自己的用户状态。
+//   用户退房后其队列退役：不再接收新帧，Drain() 取空且没有仍在写入的生产者后
+//   留待复用，新出现的流优先复用同容量的空闲队列，长期运行的房间不会耗尽 |max_streams|。
+//   该用户的退役队列全部取空后才归还句柄，此前句柄不会分配给新用户，消费者按
+//   user_handle() 索引的状态与时延追踪的 key 不会混入新用户的帧。
+//   时延追踪开启时，帧回调记录 SDK 回调与入队时间，Drain() 记录交给消费者的时间。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_FRAME_DISPATCHER_H_
+#define GCHATGPT_TRTC_SWING_FRAME_DISPATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "data_event.h"
+#include "frame_pool.h"
+#include "frame_view.h"
+#include "spsc_ring.h"
+#include "user_interner.h"
+
+namespace swing {
+
+using liteav::trtc::StreamType;
+
+// 帧类型
+enum FrameKind {
+  kFrameKindAudio = 0,
+  kFrameKindVideo = 1,
+  kFrameKindPixel = 2,
+};
+
+// 队列中的一帧
+// |payload| 取自 FramePool，槽位复用时保留容量，稳定运行时不重新分配。
+struct RingFrame {
+  RingFrame()
+      : kind(kFrameKindAudio),
+        pts(0),
+        dts(0),
+        is_key_frame(false),
+        codec(0),
+        sample_rate(0),
+        channels(0),
+        width(0),
+        height(0),
+        rotation(0),
+        trace_key(0) {}
+
+  // 帧数据，消费者 Consume() 之前有效
+  ByteSpan Bytes() const;
+
+  FrameKind kind;
+  uint32_t pts;
+  uint32_t dts;
+  bool is_key_frame;
+  // 音频为 AudioCodecType，视频为 VideoCodecType
+  int codec;
+  int sample_rate;
+  int channels;
+  uint32_t width;
+  uint32_t height;
+  int rotation;
+  // 时延追踪的 key，下游阶段用它调用 TraceStamp()，见 latency_tracer.h
+  uint64_t trace_key;
+  PooledBuffer payload;
+};
+
+// 队列配置
+struct FrameRingConfig {
+  FrameRingConfig() : audio_capacity(64), video_capacity(32), max_streams(256) {}
+
+  // 每路音频队列的帧数，20ms 一帧，默认约 1.28s
+  size_t audio_capacity;
+
+  // 每路视频队列的帧数
+  size_t video_capacity;
+
+  // 最多同时投递的 (user_id, StreamType) 路数，超出的流直接丢弃并计数
+  // 同时也是驻留的用户数上限，混音音频占用其中一个。
+  // 已退房用户的队列取空后可复用，不计入。
+  size_t max_streams;
+};
+
+// 单路流的队列
+// 生产者是该流的 SDK 回调线程，消费者是调用 Drain() 的线程。
+// 经 FrameDispatcher 创建的队列在用户退房、取空后会复用给另一路流，
+// user_id() / user_handle() / type() 随之改变，消费者只应在 OnFrames() 中读取。
+class StreamRing {
+ public:
+  StreamRing(const std::string& user_id,
+             StreamType type,
+             size_t capacity,
+             uint32_t user_handle = kInvalidUser);
+
+  const char* user_id() const { return user_id_.c_str(); }
+  // 所属 FrameDispatcher 分配的用户句柄，不经 FrameDispatcher 创建时为 kInvalidUser
+  uint32_t user_handle() const { return user_handle_; }
+  StreamType type() const { return type_; }
+
+  // 当前积压帧数
+  size_t Size() const { return ring_.Size(); }
+  size_t Capacity() const { return ring_.Capacity(); }
+
+  // 成功入队的帧数
+  uint64_t Pushed() const { return pushed_.load(std::memory_order_relaxed); }
+
+  // 队列满丢弃的帧数
+  uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+  // 本队列帧的 trace key，与 pts 按位或即得 RingFrame::trace_key
+  uint64_t trace_base() const { return trace_base_; }
+
+  // 所属用户已退房，剩余帧取完后队列留待复用
+  bool retired() const { return state_.load(std::memory_order_acquire) != kRingActive; }
+
+  ///////////////////////////////////////////////////////////////////////
+  //                     消费者接口，仅限 Drain 线程                  //
+  /////////////////////////////////////////////////////////////////////
+
+  size_t Readable() { return ring_.Readable(); }
+  const RingFrame* Peek(size_t index) { return ring_.Peek(index); }
+  void Consume(size_t count) { ring_.Consume(count); }
+
+ private:
+  friend class AudioPuller;
+  friend class FrameDispatcher;
+
+  // 队列状态：使用中、已退役待取空、已取空可复用
+  enum State {
+    kRingActive = 0,
+    kRingRetired = 1,
+    kRingIdle = 2,
+  };
+
+  // 生产者接口，队列满时返回 nullptr 并计入丢帧
+  RingFrame* BeginPush();
+  void CommitPush();
+
+  // 把已取空的队列交给另一路流，计数清零
+  void Reuse(const std::string& user_id, StreamType type, uint32_t user_handle);
+
+  // 在 FrameDispatcher::by_user_ 中的下标
+  size_t entry_index() const { return entry_index_; }
+
+  std::string user_id_;
+  StreamType type_;
+  uint32_t user_handle_;
+  uint64_t trace_base_;
+  SpscRing<RingFrame> ring_;
+  std::atomic<uint64_t> pushed_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<int> state_;
+  size_t entry_index_;
+};
+
+// 批量消费回调
+// |ring| 中前 |count| 帧可通过 ring->Peek(i) 读取，回调返回后自动 Consume。
+class FrameSink {
+ public:
+  virtual ~FrameSink() {}
+  virtual void OnFrames(StreamRing* ring, size_t count) = 0;
+};
+
+class FrameDispatcher : public liteav::trtc::TRTCCloudDelegate {
+ public:
+  // |target| 接收帧以外的回调，可以为 nullptr
+  FrameDispatcher(liteav::trtc::TRTCCloudDelegate* target, const FrameRingConfig& config);
+  virtual ~FrameDispatcher();
+
+  // 批量取帧
+  // 依次把每路非空队列中最多 |max_per_stream| 帧交给 |sink|，返回总帧数。
+  // |max_per_stream| 为 0 表示不限。
+  // 同一时刻只允许一个线程调用。
+  size_t Drain(FrameSink* sink, size_t max_per_stream);
+
+  // 有帧入队时通知 |event|，Drain 线程可以在 event 上等待而不必定时轮询
+  // 传 nullptr 取消，|event| 需在本对象之后销毁
+  void SetDataEvent(DataEvent* event);
+
+  // 已创建的队列个数，队列不会销毁，退役取空后复用，见 StreamRing::retired()
+  size_t StreamCount() const;
+  StreamRing* GetStream(size_t index) const;
+
+  // 用户句柄，未进房的用户返回 kInvalidUser，已退房的用户在句柄归还前仍可查到
+  uint32_t FindUser(const char* user_id) const { return users_.Find(user_id); }
+  const char* UserName(uint32_t handle) const { return users_.Name(handle); }
+
+  // 当前驻留的用户数，句柄取值 [0, max_streams)，退房用户的句柄会分配给新用户
+  size_t UserCount() const { return users_.Size(); }
+
+  // 所有队列的积压帧数之和
+  size_t TotalSize() const;
+
+  // 所有队列的丢帧数之和，含用户未进房、超出 |max_streams| 丢弃的帧与已复用队列此前的丢帧
+  uint64_t TotalDropped() const;
+
+  void OnError(liteav::trtc::Error error) override;
+  void OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                liteav::trtc::ConnectionState new_state) override;
+  void OnEnterRoom() override;
+  void OnExitRoom() override;
+  void OnLocalAudioChannelCreated() override;
+  void OnLocalAudioChannelDestroyed() override;
+  void OnLocalVideoChannelCreated(StreamType type) override;
+  void OnLocalVideoChannelDestroyed(StreamType type) override;
+  void OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) override;
+  void OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteAudioAvailable(const char* user_id, bool available) override;
+  void OnRemoteVideoAvailable(const char* user_id, bool available, StreamType type) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const VideoFrame& frame) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const PixelFrame& frame) override;
+  void OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) override;
+  void OnRemoteMixedAudioReceived(const AudioFrame& frame) override;
+  void OnSeiMessageReceived(const char* user_id,
+                            StreamType stream_type,
+                            int message_type,
+                            const uint8_t* message,
+                            int length) override;
+
+ private:
+  FrameDispatcher(const FrameDispatcher&);
+  FrameDispatcher& operator=(const FrameDispatcher&);
+
+  // 生产者取 (user_id, type) 的队列，不存在时创建，优先复用已取空的退役队列
+  // 先在 |producers_| 登记为在途生产者再读队列槽位，成功时写入 |index|，调用方写完
+  // 后调用 EndProduce(index)。用户未驻留或超出 |max_streams| 时返回 nullptr。
+  // 查找无锁，仅首次创建时加锁。
+  StreamRing* BeginProduce(const char* user_id, StreamType type, size_t* index);
+  void EndProduce(size_t index);
+
+  // 创建 |handle| 的 |type| 队列，调用方持有 |create_mutex_|
+  StreamRing* CreateLocked(uint32_t handle, StreamType type, size_t index);
+
+  // 用户退房：摘下其所有队列并标记退役，由 Drain() 取空，最后一个取空时归还用户句柄
+  void RetireUser(const char* user_id);
+  // 退役队列已取空，标记为可复用，调用方持有 |create_mutex_|
+  void IdleLocked(StreamRing* ring);
+
+  void NotifyEvent();
+
+  liteav::trtc::TRTCCloudDelegate* target_;
+  const FrameRingConfig config_;
+
+  UserInterner users_;
+
+  // 按 [用户句柄][流类型] 排列，在 |create_mutex_| 下写入，用户退房时清空
+  std::vector<std::atomic<StreamRing*> > by_user_;
+  // 与 |by_user_| 对应，正在写入该槽位队列的生产者数
+  // 退役队列要等对应计数为 0 才可复用，读到旧队列的生产者不会与新的生产者并发写入。
+  std::vector<std::atomic<int> > producers_;
+  // 混音音频的用户句柄
+  uint32_t mixed_handle_;
+  // 按用户句柄排列，在 |create_mutex_| 下访问
+  // 尚未取空的退役队列数，以及用户是否已退房、等待归还句柄
+  std::vector<size_t> retiring_;
+  std::vector<bool> exited_;
+
+  // 按创建顺序排列的队列，供 Drain() 遍历，槽位一旦写入不再修改
+  std::vector<StreamRing*> streams_;
+  std::atomic<size_t> stream_count_;
+
+  std::mutex create_mutex_;
+  std::atomic<uint64_t> dropped_no_stream_;
+  // 复用前队列的丢帧数之和
+  std::atomic<uint64_t> dropped_retired_;
+  const uint32_t trace_source_;
+  std::atomic<DataEvent*> event_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_FRAME_DISPATCHER_H_
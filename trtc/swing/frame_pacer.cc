@@ -0,0 +1,614 @@
+#include "frame_pacer.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+
+namespace swing {
+
+namespace {
+
+// 没有 timerfd 时的最长睡眠，新帧最多晚这么久被发现
+const int64_t kFallbackSleepNs = 1000000;
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void SleepUntil(int64_t deadline_ns) {
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(deadline_ns / 1000000000);
+  ts.tv_nsec = static_cast<long>(deadline_ns % 1000000000);
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
+// 回绕安全的 pts 差值，单位毫秒
+int32_t PtsDiff(uint32_t a, uint32_t b) {
+  return static_cast<int32_t>(a - b);
+}
+
+void AddStats(const FramePacerStats& from, FramePacerStats* to) {
+  to->audio_frames += from.audio_frames;
+  to->video_frames += from.video_frames;
+  to->rejected_frames += from.rejected_frames;
+  to->skipped_audio_frames += from.skipped_audio_frames;
+  to->skipped_video_frames += from.skipped_video_frames;
+  to->rebuffers += from.rebuffers;
+  to->rebases += from.rebases;
+  to->failed += from.failed;
+  to->audio_jitter.Merge(from.audio_jitter);
+  to->video_jitter.Merge(from.video_jitter);
+}
+
+}  // namespace
+
+JitterHistogram::JitterHistogram() : count_(0), sum_ns_(0), max_ns_(0) {
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+void JitterHistogram::Record(int64_t jitter_ns) {
+  if (jitter_ns < 0) {
+    jitter_ns = 0;
+  }
+  uint64_t us = static_cast<uint64_t>(jitter_ns / 1000);
+  int bucket = 0;
+  while (us > 0 && bucket < kBuckets - 1) {
+    us >>= 1;
+    ++bucket;
+  }
+  ++buckets_[bucket];
+  ++count_;
+  sum_ns_ += jitter_ns;
+  max_ns_ = std::max(max_ns_, jitter_ns);
+}
+
+void JitterHistogram::Merge(const JitterHistogram& other) {
+  for (int i = 0; i < kBuckets; ++i) {
+    buckets_[i] += other.buckets_[i];
+  }
+  count_ += other.count_;
+  sum_ns_ += other.sum_ns_;
+  max_ns_ = std::max(max_ns_, other.max_ns_);
+}
+
+uint64_t JitterHistogram::BucketCount(int bucket) const {
+  return bucket >= 0 && bucket < kBuckets ? buckets_[bucket] : 0;
+}
+
+int64_t JitterHistogram::BucketUpperUs(int bucket) {
+  if (bucket < 0 || bucket >= kBuckets - 1) {
+    return -1;
+  }
+  return static_cast<int64_t>(1) << bucket;
+}
+
+int64_t JitterHistogram::MeanUs() const {
+  return count_ == 0 ? 0 : sum_ns_ / static_cast<int64_t>(count_) / 1000;
+}
+
+int64_t JitterHistogram::PercentileUs(double q) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  q = std::min(1.0, std::max(0.0, q));
+  uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1)) + 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBuckets - 1; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::min(BucketUpperUs(i), MaxUs());
+    }
+  }
+  return MaxUs();
+}
+
+struct FramePacer::Channel {
+  Channel()
+      : id(0),
+        sink(nullptr),
+        removed(false),
+        playing(false),
+        buffer_start_ns(0),
+        anchor_ns(0),
+        base_pts(0),
+        has_audio_pts(false),
+        last_audio_pts(0),
+        has_video_pts(false),
+        last_video_pts(0),
+        wait_key_frame(false),
+        scheduled_ns(-1) {}
+
+  struct Item {
+    const SharedFrame* frame;
+    // pts 不连续，到达队首时从该帧重新建立时间基
+    bool rebase;
+  };
+
+  int64_t Due(uint32_t pts) const {
+    return anchor_ns + static_cast<int64_t>(PtsDiff(pts, base_pts)) * 1000000;
+  }
+
+  bool empty() const { return audio.empty() && video.empty(); }
+
+  int id;
+  FanoutSink* sink;
+  std::atomic<bool> removed;
+
+  std::deque<Item> audio;
+  std::deque<Item> video;
+
+  // false 时处于预缓冲，|buffer_start_ns| 为预缓冲开始的时间
+  bool playing;
+  int64_t buffer_start_ns;
+  // 时间基：pts 为 |base_pts| 的帧在 |anchor_ns| 发送
+  int64_t anchor_ns;
+  uint32_t base_pts;
+
+  // 最近放入队列的 pts，用于判断不连续
+  bool has_audio_pts;
+  uint32_t last_audio_pts;
+  bool has_video_pts;
+  uint32_t last_video_pts;
+
+  // 丢过视频帧，需要等到下一个关键帧
+  bool wait_key_frame;
+
+  // 在 |schedule_| 中的到期时间，未排期时为 -1
+  int64_t scheduled_ns;
+
+  FramePacerStats stats;
+};
+
+struct FramePacer::Ready {
+  std::shared_ptr<Channel> channel;
+  const SharedFrame* frame;
+  bool video;
+  int64_t due_ns;
+  int64_t sent_ns;
+  int result;
+};
+
+FramePacer::FramePacer(const FramePacerConfig& config)
+    : config_(config),
+      timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC)),
+      armed_ns_(-1),
+      next_channel_id_(1),
+      running_(true) {
+  thread_ = std::thread(&FramePacer::Run, this);
+}
+
+FramePacer::~FramePacer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    ArmTimer(1);
+  }
+  thread_.join();
+  if (timer_fd_ >= 0) {
+    close(timer_fd_);
+  }
+  for (std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.begin();
+       it != channels_.end(); ++it) {
+    Channel* channel = it->second.get();
+    for (size_t i = 0; i < channel->audio.size(); ++i) {
+      channel->audio[i].frame->Release();
+    }
+    for (size_t i = 0; i < channel->video.size(); ++i) {
+      channel->video[i].frame->Release();
+    }
+  }
+}
+
+int FramePacer::AddChannel(FanoutSink* sink) {
+  if (sink == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::shared_ptr<Channel> channel(new Channel());
+  channel->sink = sink;
+  std::lock_guard<std::mutex> lock(mutex_);
+  channel->id = next_channel_id_++;
+  channels_[channel->id] = channel;
+  return channel->id;
+}
+
+int FramePacer::RemoveChannel(int channel_id) {
+  std::shared_ptr<Channel> channel;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.find(channel_id);
+    if (it == channels_.end()) {
+      return liteav::trtc::ERR_INVALID_PARAMETER;
+    }
+    channel = it->second;
+    channels_.erase(it);
+    if (channel->scheduled_ns >= 0) {
+      schedule_.erase(WakeKey(channel->scheduled_ns, channel->id));
+      channel->scheduled_ns = -1;
+    }
+    channel->removed.store(true, std::memory_order_relaxed);
+  }
+
+  // 等待进行中的投递结束，之后定时线程不再访问该通道
+  std::lock_guard<std::mutex> send_lock(send_mutex_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < channel->audio.size(); ++i) {
+    channel->audio[i].frame->Release();
+  }
+  for (size_t i = 0; i < channel->video.size(); ++i) {
+    channel->video[i].frame->Release();
+  }
+  channel->audio.clear();
+  channel->video.clear();
+  AddStats(channel->stats, &removed_stats_);
+  return liteav::trtc::ERR_OK;
+}
+
+int FramePacer::PushAudio(int channel_id, const AudioFrame& frame) {
+  if (frame.data() == nullptr || frame.size() == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  SharedFrame* shared = SharedFrame::FromAudio(frame);
+  int result = Push(channel_id, shared);
+  shared->Release();
+  return result;
+}
+
+int FramePacer::PushVideo(int channel_id, const VideoFrame& frame) {
+  if (frame.data() == nullptr || frame.size() == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  SharedFrame* shared = SharedFrame::FromVideo(frame);
+  int result = Push(channel_id, shared);
+  shared->Release();
+  return result;
+}
+
+int FramePacer::Push(int channel_id, const SharedFrame* frame) {
+  if (frame == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.find(channel_id);
+  if (it == channels_.end()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Channel* channel = it->second.get();
+  const bool video = frame->is_video();
+  std::deque<Channel::Item>& queue = video ? channel->video : channel->audio;
+  if (!queue.empty() && PtsDiff(frame->pts, queue.front().frame->pts) > config_.max_buffered_ms) {
+    ++channel->stats.rejected_frames;
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+
+  bool& has_pts = video ? channel->has_video_pts : channel->has_audio_pts;
+  uint32_t& last_pts = video ? channel->last_video_pts : channel->last_audio_pts;
+  Channel::Item item;
+  item.frame = frame;
+  item.rebase = false;
+  if (has_pts) {
+    int32_t gap = PtsDiff(frame->pts, last_pts);
+    item.rebase = gap < 0 || gap > config_.max_pts_gap_ms;
+  }
+  has_pts = true;
+  last_pts = frame->pts;
+
+  const int64_t now = MonotonicNs();
+  if (channel->empty()) {
+    if (!channel->playing) {
+      channel->buffer_start_ns = now;
+    } else if (!item.rebase &&
+               now - channel->Due(frame->pts) >
+                   static_cast<int64_t>(config_.max_catch_up_ms) * 1000000) {
+      // 来源供不上，新帧到达时已过期：重新预缓冲，而不是丢帧
+      channel->playing = false;
+      channel->buffer_start_ns = now;
+      ++channel->stats.rebuffers;
+    }
+  }
+
+  frame->AddRef();
+  queue.push_back(item);
+  Reschedule(channel);
+  return liteav::trtc::ERR_OK;
+}
+
+int FramePacer::Clear(int channel_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, std::shared_ptr<Channel> >::iterator it = channels_.find(channel_id);
+  if (it == channels_.end()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Channel* channel = it->second.get();
+  const size_t count = channel->audio.size() + channel->video.size();
+  for (size_t i = 0; i < channel->audio.size(); ++i) {
+    channel->audio[i].frame->Release();
+  }
+  for (size_t i = 0; i < channel->video.size(); ++i) {
+    channel->video[i].frame->Release();
+  }
+  if (!channel->video.empty()) {
+    channel->wait_key_frame = true;
+  }
+  channel->audio.clear();
+  channel->video.clear();
+  channel->playing = false;
+  channel->has_audio_pts = false;
+  channel->has_video_pts = false;
+  Reschedule(channel);
+  return static_cast<int>(count);
+}
+
+size_t FramePacer::ChannelCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return channels_.size();
+}
+
+FramePacerStats FramePacer::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FramePacerStats stats;
+  AddStats(removed_stats_, &stats);
+  for (std::map<int, std::shared_ptr<Channel> >::const_iterator it = channels_.begin();
+       it != channels_.end(); ++it) {
+    AddStats(it->second->stats, &stats);
+  }
+  stats.channels = channels_.size();
+  return stats;
+}
+
+int FramePacer::GetChannelStats(int channel_id, FramePacerStats* stats) const {
+  if (stats == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<int, std::shared_ptr<Channel> >::const_iterator it = channels_.find(channel_id);
+  if (it == channels_.end()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  *stats = it->second->stats;
+  stats->channels = 1;
+  return liteav::trtc::ERR_OK;
+}
+
+int64_t FramePacer::NextWake(const Channel& channel) const {
+  if (channel.empty()) {
+    return -1;
+  }
+  if (!channel.playing) {
+    const int32_t prebuffer = config_.prebuffer_ms;
+    if ((channel.audio.size() > 1 &&
+         PtsDiff(channel.audio.back().frame->pts, channel.audio.front().frame->pts) >= prebuffer) ||
+        (channel.video.size() > 1 &&
+         PtsDiff(channel.video.back().frame->pts, channel.video.front().frame->pts) >= prebuffer)) {
+      return 0;
+    }
+    return channel.buffer_start_ns + static_cast<int64_t>(prebuffer) * 1000000;
+  }
+  int64_t wake = -1;
+  if (!channel.audio.empty()) {
+    const Channel::Item& head = channel.audio.front();
+    wake = head.rebase ? 0 : channel.Due(head.frame->pts);
+  }
+  if (!channel.video.empty()) {
+    const Channel::Item& head = channel.video.front();
+    int64_t due = head.rebase ? 0 : channel.Due(head.frame->pts);
+    wake = wake < 0 ? due : std::min(wake, due);
+  }
+  return wake;
+}
+
+void FramePacer::Reschedule(Channel* channel) {
+  const int64_t wake = NextWake(*channel);
+  if (wake == channel->scheduled_ns) {
+    return;
+  }
+  if (channel->scheduled_ns >= 0) {
+    schedule_.erase(WakeKey(channel->scheduled_ns, channel->id));
+  }
+  channel->scheduled_ns = wake;
+  if (wake >= 0) {
+    schedule_.insert(WakeKey(wake, channel->id));
+    if (armed_ns_ < 0 || wake < armed_ns_) {
+      ArmTimer(wake);
+    }
+  }
+}
+
+void FramePacer::ArmTimer(int64_t deadline_ns) {
+  armed_ns_ = deadline_ns;
+  if (timer_fd_ < 0) {
+    return;
+  }
+  // it_value 为 0 表示停止定时器，已过期的时间点用 1ns 代替
+  const int64_t value = std::max<int64_t>(1, deadline_ns);
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = static_cast<time_t>(value / 1000000000);
+  spec.it_value.tv_nsec = static_cast<long>(value % 1000000000);
+  timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+void FramePacer::Collect(const std::shared_ptr<Channel>& channel,
+                         int64_t now,
+                         std::vector<Ready>* ready) {
+  Channel* c = channel.get();
+  if (!c->playing) {
+    if (c->empty() || NextWake(*c) > now) {
+      return;
+    }
+    // 预缓冲结束，最早的一帧现在发送
+    uint32_t base = 0;
+    if (!c->audio.empty()) {
+      base = c->audio.front().frame->pts;
+      if (!c->video.empty() && PtsDiff(c->video.front().frame->pts, base) < 0) {
+        base = c->video.front().frame->pts;
+      }
+    } else {
+      base = c->video.front().frame->pts;
+    }
+    c->base_pts = base;
+    c->anchor_ns = now;
+    c->playing = true;
+    if (!c->audio.empty()) {
+      c->audio.front().rebase = false;
+    }
+    if (!c->video.empty()) {
+      c->video.front().rebase = false;
+    }
+  }
+
+  const int64_t catch_up_ns = static_cast<int64_t>(config_.max_catch_up_ms) * 1000000;
+  for (int kind = 0; kind < 2; ++kind) {
+    const bool video = kind == 1;
+    std::deque<Channel::Item>& queue = video ? c->video : c->audio;
+    while (!queue.empty()) {
+      Channel::Item& head = queue.front();
+      if (head.rebase) {
+        c->base_pts = head.frame->pts;
+        c->anchor_ns = now;
+        head.rebase = false;
+        ++c->stats.rebases;
+      }
+      const int64_t due = c->Due(head.frame->pts);
+      if (due > now) {
+        break;
+      }
+      const SharedFrame* frame = head.frame;
+      queue.pop_front();
+
+      bool skip = now - due > catch_up_ns;
+      if (video) {
+        if (skip) {
+          c->wait_key_frame = true;
+        } else if (c->wait_key_frame) {
+          skip = !frame->is_key_frame;
+          c->wait_key_frame = skip;
+        }
+      }
+      if (skip) {
+        ++(video ? c->stats.skipped_video_frames : c->stats.skipped_audio_frames);
+        frame->Release();
+        continue;
+      }
+
+      Ready item;
+      item.channel = channel;
+      item.frame = frame;
+      item.video = video;
+      item.due_ns = due;
+      item.sent_ns = 0;
+      item.result = liteav::trtc::ERR_OK;
+      ready->push_back(item);
+    }
+  }
+}
+
+void FramePacer::Run() {
+  // 默认 50us 的 timer slack 会推迟定时器到期
+  prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+  if (config_.realtime_priority > 0) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = config_.realtime_priority;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  }
+
+  std::vector<Ready> ready;
+  std::vector<std::shared_ptr<Channel> > due;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        return;
+      }
+      const int64_t now = MonotonicNs();
+      while (!schedule_.empty() && schedule_.begin()->first <= now) {
+        std::map<int, std::shared_ptr<Channel> >::iterator it =
+            channels_.find(schedule_.begin()->second);
+        schedule_.erase(schedule_.begin());
+        it->second->scheduled_ns = -1;
+        due.push_back(it->second);
+      }
+      for (size_t i = 0; i < due.size(); ++i) {
+        Collect(due[i], now, &ready);
+        Reschedule(due[i].get());
+      }
+      due.clear();
+    }
+
+    if (!ready.empty()) {
+      std::lock_guard<std::mutex> send_lock(send_mutex_);
+      for (size_t i = 0; i < ready.size(); ++i) {
+        Ready& item = ready[i];
+        // 读到旧值时 RemoveChannel() 仍在等待 |send_mutex_|，回调不会越过其返回
+        if (!item.channel->removed.load(std::memory_order_relaxed)) {
+          item.sent_ns = MonotonicNs();
+          item.result = item.channel->sink->OnFrame(*item.frame);
+        }
+        item.frame->Release();
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < ready.size(); ++i) {
+        const Ready& item = ready[i];
+        if (item.sent_ns == 0) {
+          continue;
+        }
+        FramePacerStats& stats = item.channel->stats;
+        if (item.video) {
+          ++stats.video_frames;
+          stats.video_jitter.Record(item.sent_ns - item.due_ns);
+        } else {
+          ++stats.audio_frames;
+          stats.audio_jitter.Record(item.sent_ns - item.due_ns);
+        }
+        if (item.result != liteav::trtc::ERR_OK) {
+          ++stats.failed;
+        }
+      }
+      ready.clear();
+    }
+
+    int64_t next = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) {
+        return;
+      }
+      if (!schedule_.empty()) {
+        next = schedule_.begin()->first;
+        if (next <= MonotonicNs()) {
+          continue;
+        }
+      }
+      if (next >= 0) {
+        ArmTimer(next);
+      } else {
+        armed_ns_ = -1;
+      }
+    }
+
+    if (timer_fd_ >= 0) {
+      // 没有排期时定时器由 Push*() 或析构函数设置
+      uint64_t expirations = 0;
+      while (read(timer_fd_, &expirations, sizeof(expirations)) < 0 && errno == EINTR) {
+      }
+    } else {
+      const int64_t limit = MonotonicNs() + kFallbackSleepNs;
+      SleepUntil(next >= 0 ? std::min(next, limit) : limit);
+    }
+  }
+}
+
+}  // namespace swing
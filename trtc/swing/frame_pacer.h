@@ -0,0 +1,214 @@
+//
+// 功能说明：
+//   发送端按 pts 节拍放帧。TTS、文件等来源成批产生音频，而
+//   TRTCCloud::SendAudioFrame() 期望按 frame_length_ms 均匀送达，发得太快或太慢
+//   都会造成接收端抖动与断音。FramePacer 缓存各通道的 AudioFrame / VideoFrame，
+//   在一个定时线程上按 pts 换算的时间点把帧交给通道的 FanoutSink
+//   （发送到 TRTCCloud 用 CloudFanoutSink）：
+//
+//   - 同一通道的音频和视频共用一个时间基，|pts| 差值即发送时间差，音画保持同步；
+//   - 预缓冲：通道开始（或断流后重新开始）时，缓存的 pts 跨度达到
+//     |prebuffer_ms|，或首帧已等待 |prebuffer_ms|，才按当前时间建立时间基；
+//   - 追赶：定时线程晚到不超过 |max_catch_up_ms| 的帧立即连续发出，随后回到节拍；
+//   - 跳帧：晚于 |max_catch_up_ms| 的帧丢弃，视频丢到下一个关键帧为止；
+//     来源供不上（队列已空、新帧到达时已过期）不算晚到，而是重新预缓冲；
+//   - pts 回退或跳变超过 |max_pts_gap_ms| 时，从该帧重新建立时间基。
+//
+//   所有通道共用一个线程：按最早的到期时间设置 timerfd（绝对时间），
+//   新帧使最早到期时间提前时由 Push*() 重设定时器，不轮询；
+//   timerfd 不可用时退回 clock_nanosleep。线程的 timer slack 设为 1ns，
+//   每帧的发送时间相对计划时间的偏差记入 JitterHistogram，见 GetStats()。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_FRAME_PACER_H_
+#define GCHATGPT_TRTC_SWING_FRAME_PACER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "fanout_hub.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+using liteav::trtc::VideoFrame;
+
+// 发送时间偏差的分布，按微秒以 2 的幂分桶
+class JitterHistogram {
+ public:
+  // 第 0 桶为 [0, 1us)，第 i 桶为 [2^(i-1), 2^i) us，最后一桶不设上限
+  static const int kBuckets = 28;
+
+  JitterHistogram();
+
+  void Record(int64_t jitter_ns);
+  void Merge(const JitterHistogram& other);
+
+  uint64_t Count() const { return count_; }
+  uint64_t BucketCount(int bucket) const;
+  // 第 |bucket| 桶的上界，单位微秒，最后一桶返回 -1
+  static int64_t BucketUpperUs(int bucket);
+
+  int64_t MeanUs() const;
+  int64_t MaxUs() const { return max_ns_ / 1000; }
+
+  // 分位数，|q| 取 [0, 1]，返回所在桶的上界，单位微秒；没有样本时返回 0
+  int64_t PercentileUs(double q) const;
+
+ private:
+  uint64_t buckets_[kBuckets];
+  uint64_t count_;
+  int64_t sum_ns_;
+  int64_t max_ns_;
+};
+
+struct FramePacerConfig {
+  FramePacerConfig()
+      : prebuffer_ms(60),
+        max_catch_up_ms(100),
+        max_buffered_ms(10000),
+        max_pts_gap_ms(1000),
+        realtime_priority(0) {}
+
+  // 开始发送前缓存的 pts 跨度，也是首帧最长的等待时间
+  int prebuffer_ms;
+
+  // 计划时间已过多久的帧仍然发送，超出则丢弃
+  int max_catch_up_ms;
+
+  // 每个通道的音频、视频队列各自最多缓存的 pts 跨度，超出时 Push*() 返回 ERR_READ_TRY_AGAIN
+  int max_buffered_ms;
+
+  // 相邻两帧 pts 差超过该值（或回退）视为不连续，从该帧重新建立时间基
+  int max_pts_gap_ms;
+
+  // 大于 0 时把定时线程设为 SCHED_FIFO 并使用该优先级，权限不足时忽略
+  int realtime_priority;
+};
+
+struct FramePacerStats {
+  FramePacerStats()
+      : channels(0),
+        audio_frames(0),
+        video_frames(0),
+        rejected_frames(0),
+        skipped_audio_frames(0),
+        skipped_video_frames(0),
+        rebuffers(0),
+        rebases(0),
+        failed(0) {}
+
+  size_t channels;
+
+  // 交给 Sink 的帧数
+  uint64_t audio_frames;
+  uint64_t video_frames;
+
+  // 队列达到 |max_buffered_ms| 被拒绝的帧数
+  uint64_t rejected_frames;
+
+  // 晚于 |max_catch_up_ms| 或等待关键帧而丢弃的帧数
+  uint64_t skipped_audio_frames;
+  uint64_t skipped_video_frames;
+
+  // 来源供不上而重新预缓冲的次数，不含首次
+  uint64_t rebuffers;
+
+  // pts 不连续而重建时间基的次数
+  uint64_t rebases;
+
+  // Sink 返回非 ERR_OK 的次数
+  uint64_t failed;
+
+  // 实际交给 Sink 的时间相对计划时间的偏差
+  JitterHistogram audio_jitter;
+  JitterHistogram video_jitter;
+};
+
+class FramePacer {
+ public:
+  explicit FramePacer(const FramePacerConfig& config);
+  ~FramePacer();
+
+  // 增加一个通道，返回大于 0 的通道 ID，|sink| 为空时返回 ERR_INVALID_PARAMETER
+  // |sink| 在定时线程上被调用，需保持有效直到 RemoveChannel() 返回。
+  int AddChannel(FanoutSink* sink);
+
+  // 移除通道并丢弃未发送的帧，返回后不再回调其 |sink|
+  // 不能在 Sink 回调中调用；通道不存在时返回 ERR_INVALID_PARAMETER。
+  int RemoveChannel(int channel_id);
+
+  // 复制一帧放入通道队列，任意线程
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：通道不存在或帧为空
+  // - ERR_READ_TRY_AGAIN：队列已达到 |max_buffered_ms|，稍后重试
+  int PushAudio(int channel_id, const AudioFrame& frame);
+  int PushVideo(int channel_id, const VideoFrame& frame);
+
+  // 放入已有的共享帧，只增加引用计数，返回值同上
+  int Push(int channel_id, const SharedFrame* frame);
+
+  // 丢弃通道中未发送的帧（如用户打断机器人说话），下一帧重新预缓冲
+  // 返回丢弃的帧数，通道不存在时返回 ERR_INVALID_PARAMETER。
+  int Clear(int channel_id);
+
+  size_t ChannelCount() const;
+
+  // 所有通道的汇总，含已移除的通道
+  FramePacerStats GetStats() const;
+
+  // 通道不存在时返回 ERR_INVALID_PARAMETER
+  int GetChannelStats(int channel_id, FramePacerStats* stats) const;
+
+ private:
+  struct Channel;
+  struct Ready;
+  typedef std::pair<int64_t, int> WakeKey;
+
+  FramePacer(const FramePacer&);
+  FramePacer& operator=(const FramePacer&);
+
+  void Run();
+
+  // 以下调用时需持有 |mutex_|
+  // 通道下次需要处理的时间，-1 表示队列为空
+  int64_t NextWake(const Channel& channel) const;
+  void Reschedule(Channel* channel);
+  // 定时器在 |deadline_ns| 前到期
+  void ArmTimer(int64_t deadline_ns);
+  // 取出到期的帧放入 |ready|
+  void Collect(const std::shared_ptr<Channel>& channel, int64_t now, std::vector<Ready>* ready);
+
+  const FramePacerConfig config_;
+  int timer_fd_;
+
+  // 定时线程投递一批帧时持有，移除通道时据此等待投递结束
+  // 加锁顺序：先 |send_mutex_| 后 |mutex_|
+  std::mutex send_mutex_;
+
+  mutable std::mutex mutex_;
+  std::map<int, std::shared_ptr<Channel> > channels_;
+  // 按到期时间排序的通道
+  std::set<WakeKey> schedule_;
+  // 定时器当前的到期时间，未设置时为 -1
+  int64_t armed_ns_;
+  int next_channel_id_;
+  bool running_;
+  FramePacerStats removed_stats_;
+
+  std::thread thread_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_FRAME_PACER_H_
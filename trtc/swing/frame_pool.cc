@@ -0,0 +1,265 @@
+#include "frame_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace swing {
+
+const int FramePool::kClassCount;
+const size_t FramePool::kMinBlockSize;
+
+namespace {
+
+// 线程缓存每个等级的块数，大块少缓存，避免线程间占用过多内存
+const int kThreadCacheSlots = 8;
+const size_t kThreadCacheLargeBlock = 64 * 1024;
+const int kThreadCacheLargeSlots = 2;
+
+struct ClassDepot {
+  ClassDepot() : hits(0), misses(0) {}
+
+  std::mutex mutex;
+  std::vector<uint8_t*> blocks;
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> misses;
+};
+
+struct PoolState {
+  PoolState()
+      : max_cached_bytes(256u * 1024 * 1024), in_use(0), high_water(0), oversize(0) {}
+
+  ClassDepot depots[FramePool::kClassCount];
+  std::atomic<size_t> max_cached_bytes;
+  std::atomic<size_t> in_use;
+  std::atomic<size_t> high_water;
+  std::atomic<uint64_t> oversize;
+};
+
+// 进程内唯一，不析构，避免线程缓存在进程退出时访问已销毁的仓库
+PoolState& State() {
+  static PoolState* state = new PoolState();
+  return *state;
+}
+
+int ThreadCacheLimit(int size_class) {
+  return FramePool::ClassSize(size_class) > kThreadCacheLargeBlock ? kThreadCacheLargeSlots
+                                                                   : kThreadCacheSlots;
+}
+
+void ReturnToDepot(uint8_t* block, int size_class) {
+  PoolState& state = State();
+  ClassDepot& depot = state.depots[size_class];
+  size_t limit = state.max_cached_bytes.load(std::memory_order_relaxed) /
+                 FramePool::ClassSize(size_class);
+  {
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    if (depot.blocks.size() < limit) {
+      depot.blocks.push_back(block);
+      return;
+    }
+  }
+  free(block);
+}
+
+// 线程退出时 |t_cache| 析构后，其它 thread_local 对象的析构仍可能归还块
+thread_local bool t_cache_destroyed = false;
+
+struct ThreadCache {
+  ThreadCache() { memset(counts, 0, sizeof(counts)); }
+
+  ~ThreadCache() {
+    t_cache_destroyed = true;
+    for (int c = 0; c < FramePool::kClassCount; ++c) {
+      for (int i = 0; i < counts[c]; ++i) {
+        ReturnToDepot(blocks[c][i], c);
+      }
+    }
+  }
+
+  uint8_t* blocks[FramePool::kClassCount][kThreadCacheSlots];
+  int counts[FramePool::kClassCount];
+};
+
+thread_local ThreadCache t_cache;
+
+void AddInUse(size_t bytes) {
+  PoolState& state = State();
+  size_t now = state.in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  size_t peak = state.high_water.load(std::memory_order_relaxed);
+  while (now > peak &&
+         !state.high_water.compare_exchange_weak(peak, now, std::memory_order_relaxed)) {
+  }
+}
+
+}  // namespace
+
+int FramePool::ClassFor(size_t size) {
+  size_t block = kMinBlockSize;
+  for (int c = 0; c < kClassCount; ++c, block <<= 1) {
+    if (size <= block) {
+      return c;
+    }
+  }
+  return -1;
+}
+
+size_t FramePool::ClassSize(int size_class) {
+  return kMinBlockSize << size_class;
+}
+
+uint8_t* FramePool::Allocate(size_t size, size_t* capacity) {
+  PoolState& state = State();
+  int c = ClassFor(size);
+  if (c < 0) {
+    state.oversize.fetch_add(1, std::memory_order_relaxed);
+    AddInUse(size);
+    *capacity = size;
+    return static_cast<uint8_t*>(malloc(size));
+  }
+
+  ClassDepot& depot = state.depots[c];
+  uint8_t* block = nullptr;
+  if (!t_cache_destroyed && t_cache.counts[c] > 0) {
+    block = t_cache.blocks[c][--t_cache.counts[c]];
+  } else {
+    std::lock_guard<std::mutex> lock(depot.mutex);
+    if (!depot.blocks.empty()) {
+      block = depot.blocks.back();
+      depot.blocks.pop_back();
+    }
+  }
+
+  if (block != nullptr) {
+    depot.hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    depot.misses.fetch_add(1, std::memory_order_relaxed);
+    block = static_cast<uint8_t*>(malloc(ClassSize(c)));
+  }
+  *capacity = ClassSize(c);
+  AddInUse(*capacity);
+  return block;
+}
+
+void FramePool::Free(uint8_t* block, size_t capacity) {
+  if (block == nullptr) {
+    return;
+  }
+  State().in_use.fetch_sub(capacity, std::memory_order_relaxed);
+  int c = ClassFor(capacity);
+  if (c < 0) {
+    free(block);
+    return;
+  }
+  if (!t_cache_destroyed && t_cache.counts[c] < ThreadCacheLimit(c)) {
+    t_cache.blocks[c][t_cache.counts[c]++] = block;
+    return;
+  }
+  ReturnToDepot(block, c);
+}
+
+void FramePool::SetMaxCachedBytes(size_t bytes) {
+  State().max_cached_bytes.store(bytes, std::memory_order_relaxed);
+}
+
+FramePoolClassStats FramePool::GetClassStats(int size_class) {
+  FramePoolClassStats stats;
+  if (size_class < 0 || size_class >= kClassCount) {
+    return stats;
+  }
+  ClassDepot& depot = State().depots[size_class];
+  stats.block_size = ClassSize(size_class);
+  stats.hits = depot.hits.load(std::memory_order_relaxed);
+  stats.misses = depot.misses.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(depot.mutex);
+  stats.cached_blocks = depot.blocks.size();
+  return stats;
+}
+
+size_t FramePool::InUseBytes() {
+  return State().in_use.load(std::memory_order_relaxed);
+}
+
+size_t FramePool::HighWaterBytes() {
+  return State().high_water.load(std::memory_order_relaxed);
+}
+
+uint64_t FramePool::OversizeAllocations() {
+  return State().oversize.load(std::memory_order_relaxed);
+}
+
+PooledBuffer::PooledBuffer() : data_(nullptr), size_(0), capacity_(0) {}
+
+PooledBuffer::PooledBuffer(size_t size) : data_(nullptr), size_(0), capacity_(0) {
+  Resize(size);
+}
+
+PooledBuffer::PooledBuffer(PooledBuffer&& other)
+    : data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.capacity_ = 0;
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) {
+  if (this != &other) {
+    Clear();
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+  }
+  return *this;
+}
+
+PooledBuffer::~PooledBuffer() {
+  Clear();
+}
+
+void PooledBuffer::Reserve(size_t capacity, bool keep) {
+  if (capacity <= capacity_) {
+    return;
+  }
+  size_t new_capacity = 0;
+  uint8_t* data = FramePool::Allocate(capacity, &new_capacity);
+  size_t size = keep ? size_ : 0;
+  if (size > 0) {
+    memcpy(data, data_, size);
+  }
+  Clear();
+  data_ = data;
+  size_ = size;
+  capacity_ = new_capacity;
+}
+
+void PooledBuffer::Resize(size_t size) {
+  Reserve(size, true);
+  size_ = size;
+}
+
+void PooledBuffer::Assign(const uint8_t* data, size_t size) {
+  Reserve(size, false);
+  if (size > 0) {
+    memcpy(data_, data, size);
+  }
+  size_ = size;
+}
+
+void PooledBuffer::Clear() {
+  FramePool::Free(data_, capacity_);
+  data_ = nullptr;
+  size_ = 0;
+  capacity_ = 0;
+}
+
+ByteSpan PooledBuffer::Bytes() const {
+  ByteSpan span = {data_, size_};
+  return span;
+}
+
+}  // namespace swing
@@ -0,0 +1,112 @@
+//
+// 功能说明：
+//   帧数据内存池。
+//   按 2 的幂划分尺寸等级（256B ~ 16MB），每个线程先在本线程缓存中取还，
+//   缓存不足再访问全局仓库，仓库也没有时才向系统申请。稳定推流 / 收流时
+//   每帧的数据块都在池内循环，不再产生堆分配。
+//
+//   SDK 的 AudioFrame / VideoFrame / PixelFrame::SetData() 内部仍会复制一次，
+//   发送前组帧时请先在 PooledBuffer 中准备数据，再调用 SetData()。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_FRAME_POOL_H_
+#define GCHATGPT_TRTC_SWING_FRAME_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame_view.h"
+
+namespace swing {
+
+// 单个尺寸等级的统计
+struct FramePoolClassStats {
+  FramePoolClassStats() : block_size(0), hits(0), misses(0), cached_blocks(0) {}
+
+  // 该等级的块大小，单位 bytes
+  size_t block_size;
+
+  // 从线程缓存或全局仓库取到块的次数
+  uint64_t hits;
+
+  // 向系统申请新块的次数
+  uint64_t misses;
+
+  // 全局仓库中空闲块个数（不含线程缓存）
+  size_t cached_blocks;
+};
+
+class FramePool {
+ public:
+  static const int kClassCount = 17;
+  static const size_t kMinBlockSize = 256;
+
+  // 申请不少于 |size| 字节的块，|capacity| 返回块的实际大小
+  // 超过最大等级的块直接向系统申请，|capacity| 等于 |size|。
+  static uint8_t* Allocate(size_t size, size_t* capacity);
+
+  // 归还块，|capacity| 为 Allocate() 返回的大小
+  static void Free(uint8_t* block, size_t capacity);
+
+  // |size| 对应的尺寸等级，超过最大等级返回 -1
+  static int ClassFor(size_t size);
+  static size_t ClassSize(int size_class);
+
+  // 每个尺寸等级的全局仓库中空闲块的字节数上限，默认 256MB，超出部分直接释放
+  static void SetMaxCachedBytes(size_t bytes);
+
+  static FramePoolClassStats GetClassStats(int size_class);
+
+  // 当前借出的字节数（按块大小计）
+  static size_t InUseBytes();
+
+  // |InUseBytes()| 的历史最大值
+  static size_t HighWaterBytes();
+
+  // 超过最大等级、直接向系统申请的次数
+  static uint64_t OversizeAllocations();
+
+ private:
+  FramePool();
+};
+
+// 池化的连续内存
+// 只可移动，析构时把块还给 FramePool。
+class PooledBuffer {
+ public:
+  PooledBuffer();
+  explicit PooledBuffer(size_t size);
+  PooledBuffer(PooledBuffer&& other);
+  PooledBuffer& operator=(PooledBuffer&& other);
+  ~PooledBuffer();
+
+  // 调整有效长度，容量不足时换一个更大的块并保留原有数据
+  void Resize(size_t size);
+
+  // 复制 |data|，容量足够时不重新分配
+  void Assign(const uint8_t* data, size_t size);
+
+  void Clear();
+
+  uint8_t* data() { return data_; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+
+  ByteSpan Bytes() const;
+
+ private:
+  PooledBuffer(const PooledBuffer&);
+  PooledBuffer& operator=(const PooledBuffer&);
+
+  void Reserve(size_t capacity, bool keep);
+
+  uint8_t* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_FRAME_POOL_H_
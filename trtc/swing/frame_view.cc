@@ -0,0 +1,220 @@
+#include "frame_view.h"
+
+#include <string.h>
+
+#include "frame_pool.h"
+
+namespace swing {
+
+namespace {
+
+// 作用域槽位个数，线程按顺序分配槽位，超过后复用
+// 两个线程共用一个槽位时，后打开的作用域会使前者的视图提前失效，不会误判有效。
+const uint32_t kScopeSlotCount = 256;
+
+std::atomic<uint64_t> g_scope_epochs[kScopeSlotCount];
+std::atomic<uint32_t> g_next_slot(0);
+
+struct ThreadScope {
+  ThreadScope() : slot(g_next_slot.fetch_add(1) % kScopeSlotCount), depth(0), epoch(0) {}
+
+  uint32_t slot;
+  int depth;
+  uint64_t epoch;
+};
+
+thread_local ThreadScope t_scope;
+
+FrameView MakeView(const uint8_t* data, size_t size) {
+  FrameView view;
+  if (t_scope.depth == 0) {
+    return view;
+  }
+  view.data = data;
+  view.size = size;
+  view.slot = t_scope.slot;
+  view.epoch = t_scope.epoch;
+  return view;
+}
+
+}  // namespace
+
+bool FrameView::Valid() const {
+  if (data == nullptr) {
+    return false;
+  }
+  if (slot == kRetainedSlot) {
+    return true;
+  }
+  if (slot >= kScopeSlotCount) {
+    return false;
+  }
+  return g_scope_epochs[slot].load(std::memory_order_acquire) == epoch;
+}
+
+ByteSpan FrameView::Bytes() const {
+  ByteSpan span = {nullptr, 0};
+  if (Valid()) {
+    span.data = data;
+    span.size = size;
+  }
+  return span;
+}
+
+FrameScope::FrameScope() {
+  if (t_scope.depth++ == 0) {
+    t_scope.epoch = g_scope_epochs[t_scope.slot].fetch_add(1, std::memory_order_acq_rel) + 1;
+  }
+}
+
+FrameScope::~FrameScope() {
+  if (--t_scope.depth == 0) {
+    uint64_t expected = t_scope.epoch;
+    g_scope_epochs[t_scope.slot].compare_exchange_strong(expected, expected + 1,
+                                                          std::memory_order_acq_rel);
+  }
+}
+
+bool FrameScope::Active() {
+  return t_scope.depth > 0;
+}
+
+FrameView Borrow(const AudioFrame& frame) {
+  return MakeView(frame.data(), frame.size());
+}
+
+FrameView Borrow(const VideoFrame& frame) {
+  return MakeView(frame.data(), frame.size());
+}
+
+FrameView Borrow(const PixelFrame& frame) {
+  return MakeView(frame.data(), frame.size());
+}
+
+RetainedFrame* RetainedFrame::Retain(const FrameView& view) {
+  if (!view.Valid()) {
+    return nullptr;
+  }
+  RetainedFrame* retained = new RetainedFrame();
+  retained->data_ = FramePool::Allocate(view.size, &retained->capacity_);
+  retained->size_ = view.size;
+  memcpy(retained->data_, view.data, view.size);
+  return retained;
+}
+
+RetainedFrame::RetainedFrame() : ref_count_(1), data_(nullptr), size_(0), capacity_(0) {}
+
+RetainedFrame::~RetainedFrame() {
+  FramePool::Free(data_, capacity_);
+}
+
+void RetainedFrame::AddRef() {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RetainedFrame::Release() {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+FrameView RetainedFrame::View() const {
+  FrameView view;
+  view.data = data_;
+  view.size = size_;
+  view.slot = kRetainedSlot;
+  return view;
+}
+
+BorrowingCloudDelegate::BorrowingCloudDelegate(liteav::trtc::TRTCCloudDelegate* target)
+    : target_(target) {}
+
+void BorrowingCloudDelegate::OnError(liteav::trtc::Error error) {
+  target_->OnError(error);
+}
+
+void BorrowingCloudDelegate::OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                                      liteav::trtc::ConnectionState new_state) {
+  target_->OnConnectionStateChanged(old_state, new_state);
+}
+
+void BorrowingCloudDelegate::OnEnterRoom() {
+  target_->OnEnterRoom();
+}
+
+void BorrowingCloudDelegate::OnExitRoom() {
+  target_->OnExitRoom();
+}
+
+void BorrowingCloudDelegate::OnLocalAudioChannelCreated() {
+  target_->OnLocalAudioChannelCreated();
+}
+
+void BorrowingCloudDelegate::OnLocalAudioChannelDestroyed() {
+  target_->OnLocalAudioChannelDestroyed();
+}
+
+void BorrowingCloudDelegate::OnLocalVideoChannelCreated(liteav::trtc::StreamType type) {
+  target_->OnLocalVideoChannelCreated(type);
+}
+
+void BorrowingCloudDelegate::OnLocalVideoChannelDestroyed(liteav::trtc::StreamType type) {
+  target_->OnLocalVideoChannelDestroyed(type);
+}
+
+void BorrowingCloudDelegate::OnRequestChangeVideoEncodeBitrate(liteav::trtc::StreamType type,
+                                                               int bitrate_bps) {
+  target_->OnRequestChangeVideoEncodeBitrate(type, bitrate_bps);
+}
+
+void BorrowingCloudDelegate::OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) {
+  target_->OnRemoteUserEnterRoom(info);
+}
+
+void BorrowingCloudDelegate::OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) {
+  target_->OnRemoteUserExitRoom(info);
+}
+
+void BorrowingCloudDelegate::OnRemoteAudioAvailable(const char* user_id, bool available) {
+  target_->OnRemoteAudioAvailable(user_id, available);
+}
+
+void BorrowingCloudDelegate::OnRemoteVideoAvailable(const char* user_id,
+                                                    bool available,
+                                                    liteav::trtc::StreamType type) {
+  target_->OnRemoteVideoAvailable(user_id, available, type);
+}
+
+void BorrowingCloudDelegate::OnRemoteVideoReceived(const char* user_id,
+                                                   liteav::trtc::StreamType type,
+                                                   const VideoFrame& frame) {
+  FrameScope scope;
+  target_->OnRemoteVideoReceived(user_id, type, frame);
+}
+
+void BorrowingCloudDelegate::OnRemoteVideoReceived(const char* user_id,
+                                                   liteav::trtc::StreamType type,
+                                                   const PixelFrame& frame) {
+  FrameScope scope;
+  target_->OnRemoteVideoReceived(user_id, type, frame);
+}
+
+void BorrowingCloudDelegate::OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) {
+  FrameScope scope;
+  target_->OnRemoteAudioReceived(user_id, frame);
+}
+
+void BorrowingCloudDelegate::OnRemoteMixedAudioReceived(const AudioFrame& frame) {
+  FrameScope scope;
+  target_->OnRemoteMixedAudioReceived(frame);
+}
+
+void BorrowingCloudDelegate::OnSeiMessageReceived(const char* user_id,
+                                                  liteav::trtc::StreamType stream_type,
+                                                  int message_type,
+                                                  const uint8_t* message,
+                                                  int length) {
+  target_->OnSeiMessageReceived(user_id, stream_type, message_type, message, length);
+}
+
+}  // namespace swing
@@ -0,0 +1,142 @@
+//
+// 功能说明：
+//   远端音视频帧的借用视图（zero-copy）。
+//   SDK 回调中的 AudioFrame / VideoFrame / PixelFrame 只在回调期间有效，
+//   BorrowingCloudDelegate 在每次帧回调期间打开一个 FrameScope，回调内通过
+//   Borrow() 取得指向 SDK 缓冲的只读视图，回调返回后视图自动失效。
+//   需要在回调之外继续使用数据时，调用 Retain() 复制一份，由调用方 Release()。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_FRAME_VIEW_H_
+#define GCHATGPT_TRTC_SWING_FRAME_VIEW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+using liteav::trtc::PixelFrame;
+using liteav::trtc::VideoFrame;
+
+// 连续内存区间，Go 侧映射为 []byte（不复制）
+struct ByteSpan {
+  const uint8_t* data;
+  size_t size;
+};
+
+// Retain() 得到的视图使用该 slot，不受回调作用域约束
+const uint32_t kRetainedSlot = 0xFFFFFFFF;
+
+// 帧数据的只读视图
+// |slot| / |epoch| 记录借出时所在的回调作用域，用于检查视图是否过期。
+struct FrameView {
+  FrameView() : data(nullptr), size(0), slot(0), epoch(0) {}
+
+  // 视图是否仍然可读
+  bool Valid() const;
+
+  // 视图数据，过期时返回空区间
+  ByteSpan Bytes() const;
+
+  const uint8_t* data;
+  size_t size;
+  uint32_t slot;
+  uint64_t epoch;
+};
+
+// 帧回调作用域
+// 同一线程内可嵌套，最外层作用域结束时，该线程借出的所有视图失效。
+class FrameScope {
+ public:
+  FrameScope();
+  ~FrameScope();
+
+  // 当前线程是否处于帧回调作用域内
+  static bool Active();
+
+ private:
+  FrameScope(const FrameScope&);
+  FrameScope& operator=(const FrameScope&);
+};
+
+// 在当前回调作用域内借用帧数据
+// 不在作用域内调用时返回无效视图。
+FrameView Borrow(const AudioFrame& frame);
+FrameView Borrow(const VideoFrame& frame);
+FrameView Borrow(const PixelFrame& frame);
+
+// 回调结束后仍需持有的帧数据
+// 引用计数，数据块取自 FramePool，最后一次 Release() 时归还。
+class RetainedFrame {
+ public:
+  // 复制 |view| 的数据，|view| 已过期时返回 nullptr
+  static RetainedFrame* Retain(const FrameView& view);
+
+  void AddRef();
+  void Release();
+
+  FrameView View() const;
+  size_t size() const { return size_; }
+
+ private:
+  RetainedFrame();
+  ~RetainedFrame();
+  RetainedFrame(const RetainedFrame&);
+  RetainedFrame& operator=(const RetainedFrame&);
+
+  std::atomic<int> ref_count_;
+  uint8_t* data_;
+  size_t size_;
+  size_t capacity_;
+};
+
+// TRTCCloudDelegate 包装
+// 帧回调外层套 FrameScope 后转发给 |target|，其余回调原样转发。
+// 将其传给 TRTCCloud::Create()，|target| 内即可使用 Borrow()。
+class BorrowingCloudDelegate : public liteav::trtc::TRTCCloudDelegate {
+ public:
+  explicit BorrowingCloudDelegate(liteav::trtc::TRTCCloudDelegate* target);
+  virtual ~BorrowingCloudDelegate() {}
+
+  void OnError(liteav::trtc::Error error) override;
+  void OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                liteav::trtc::ConnectionState new_state) override;
+  void OnEnterRoom() override;
+  void OnExitRoom() override;
+  void OnLocalAudioChannelCreated() override;
+  void OnLocalAudioChannelDestroyed() override;
+  void OnLocalVideoChannelCreated(liteav::trtc::StreamType type) override;
+  void OnLocalVideoChannelDestroyed(liteav::trtc::StreamType type) override;
+  void OnRequestChangeVideoEncodeBitrate(liteav::trtc::StreamType type, int bitrate_bps) override;
+  void OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteAudioAvailable(const char* user_id, bool available) override;
+  void OnRemoteVideoAvailable(const char* user_id,
+                              bool available,
+                              liteav::trtc::StreamType type) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             liteav::trtc::StreamType type,
+                             const VideoFrame& frame) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             liteav::trtc::StreamType type,
+                             const PixelFrame& frame) override;
+  void OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) override;
+  void OnRemoteMixedAudioReceived(const AudioFrame& frame) override;
+  void OnSeiMessageReceived(const char* user_id,
+                            liteav::trtc::StreamType stream_type,
+                            int message_type,
+                            const uint8_t* message,
+                            int length) override;
+
+ private:
+  liteav::trtc::TRTCCloudDelegate* target_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_FRAME_VIEW_H_
@@ -0,0 +1,291 @@
+#include "gop_cache.h"
+
+namespace swing {
+
+namespace {
+
+// 每个用户的视频流类型：大流、小流、辅流
+const size_t kVideoSlots = 3;
+
+size_t VideoSlot(StreamType type) {
+  switch (type) {
+    case liteav::trtc::STREAM_TYPE_VIDEO_HIGH:
+      return 0;
+    case liteav::trtc::STREAM_TYPE_VIDEO_LOW:
+      return 1;
+    case liteav::trtc::STREAM_TYPE_VIDEO_AUX:
+      return 2;
+    default:
+      return kVideoSlots;
+  }
+}
+
+}  // namespace
+
+struct GopCache::Stream {
+  Stream() : index(0), bytes(0), waiting_keyframe(true) {}
+
+  std::mutex mutex;
+  // 在 |by_user_| 中的下标，取得 |mutex| 后据此确认仍属于查找时的路
+  size_t index;
+  // 从关键帧开始的当前 GOP
+  std::vector<CachedVideoFrame*> frames;
+  size_t bytes;
+  // 尚未收到关键帧，或 GOP 因超出上限被丢弃
+  bool waiting_keyframe;
+};
+
+CachedVideoFrame::CachedVideoFrame(const VideoFrame& frame)
+    : pts(frame.pts),
+      dts(frame.dts),
+      is_key_frame(frame.is_key_frame),
+      codec(frame.codec),
+      rotation(frame.rotation),
+      ref_count_(1) {
+  payload_.Assign(frame.data(), frame.size());
+}
+
+CachedVideoFrame::~CachedVideoFrame() {}
+
+void CachedVideoFrame::AddRef() {
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CachedVideoFrame::Release() {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+void CachedVideoFrame::ToVideoFrame(VideoFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->dts = dts;
+  frame->is_key_frame = is_key_frame;
+  frame->codec = static_cast<liteav::trtc::VideoCodecType>(codec);
+  frame->rotation = static_cast<liteav::trtc::VideoRotation>(rotation);
+}
+
+void CachedVideoFrame::ToVideoFrame(liteav::live::VideoFrame* frame) const {
+  frame->SetData(payload_.data(), payload_.size());
+  frame->pts = pts;
+  frame->dts = dts;
+  frame->is_key_frame = is_key_frame;
+  frame->codec = static_cast<liteav::live::VideoCodecType>(codec);
+  frame->rotation = static_cast<liteav::live::VideoRotation>(rotation);
+}
+
+GopSnapshot::GopSnapshot() {}
+
+GopSnapshot::~GopSnapshot() {
+  Clear();
+}
+
+const CachedVideoFrame* GopSnapshot::Frame(size_t index) const {
+  return index < frames_.size() ? frames_[index] : nullptr;
+}
+
+size_t GopSnapshot::Bytes() const {
+  size_t bytes = 0;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    bytes += frames_[i]->size();
+  }
+  return bytes;
+}
+
+void GopSnapshot::Clear() {
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    frames_[i]->Release();
+  }
+  frames_.clear();
+}
+
+int GopSnapshot::SendTo(V2TXLivePusher* pusher) const {
+  if (frames_.empty()) {
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+  liteav::live::VideoFrame frame;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    frames_[i]->ToVideoFrame(&frame);
+    int ret = pusher->SendVideoFrame(frame);
+    if (ret != liteav::trtc::ERR_OK) {
+      return ret;
+    }
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+int GopSnapshot::SendTo(TRTCCloud* cloud, StreamType type) const {
+  if (frames_.empty()) {
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+  VideoFrame frame;
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    frames_[i]->ToVideoFrame(&frame);
+    int ret = cloud->SendVideoFrame(type, frame);
+    if (ret != liteav::trtc::ERR_OK) {
+      return ret;
+    }
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+GopCache::GopCache(const GopCacheConfig& config)
+    : config_(config),
+      users_(config.max_streams),
+      by_user_(config.max_streams * kVideoSlots),
+      streams_(config.max_streams, nullptr),
+      stream_count_(0),
+      total_bytes_(0),
+      dropped_gops_(0),
+      dropped_frames_(0) {}
+
+GopCache::~GopCache() {
+  for (size_t i = 0; i < stream_count_; ++i) {
+    ResetLocked(streams_[i]);
+    delete streams_[i];
+  }
+}
+
+GopCache::Stream* GopCache::Find(const char* user_id, StreamType type) const {
+  const size_t slot = VideoSlot(type);
+  const uint32_t handle = users_.Find(user_id);
+  if (slot == kVideoSlots || handle == kInvalidUser) {
+    return nullptr;
+  }
+  return by_user_[handle * kVideoSlots + slot].load(std::memory_order_acquire);
+}
+
+GopCache::Stream* GopCache::FindOrCreate(const char* user_id, StreamType type) {
+  const size_t slot = VideoSlot(type);
+  if (slot == kVideoSlots) {
+    return nullptr;
+  }
+  uint32_t handle = users_.Find(user_id);
+  if (handle != kInvalidUser) {
+    Stream* stream = by_user_[handle * kVideoSlots + slot].load(std::memory_order_acquire);
+    if (stream != nullptr) {
+      return stream;
+    }
+  }
+
+  // 驻留与 RemoveUser() 归还句柄都在 |create_mutex_| 下
+  std::lock_guard<std::mutex> lock(create_mutex_);
+  handle = users_.Intern(user_id);
+  if (handle == kInvalidUser) {
+    return nullptr;
+  }
+  const size_t index = handle * kVideoSlots + slot;
+  Stream* stream = by_user_[index].load(std::memory_order_acquire);
+  if (stream != nullptr) {
+    return stream;
+  }
+  if (!free_streams_.empty()) {
+    stream = free_streams_.back();
+    free_streams_.pop_back();
+  } else if (stream_count_ < config_.max_streams) {
+    stream = new Stream();
+    streams_[stream_count_++] = stream;
+  } else {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> stream_lock(stream->mutex);
+    stream->index = index;
+  }
+  by_user_[index].store(stream, std::memory_order_release);
+  return stream;
+}
+
+bool GopCache::OwnsLocked(const Stream* stream) const {
+  return by_user_[stream->index].load(std::memory_order_acquire) == stream;
+}
+
+void GopCache::OnRemoteVideoReceived(const char* user_id,
+                                     StreamType type,
+                                     const VideoFrame& frame) {
+  Stream* stream = FindOrCreate(user_id, type);
+  if (stream == nullptr || frame.data() == nullptr || frame.size() == 0) {
+    dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(stream->mutex);
+  if (!OwnsLocked(stream)) {
+    // 查找之后用户已被移除
+    dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (frame.is_key_frame) {
+    ResetLocked(stream);
+    stream->waiting_keyframe = false;
+  } else if (stream->waiting_keyframe) {
+    return;
+  }
+
+  const size_t size = frame.size();
+  if (stream->bytes + size > config_.max_bytes_per_stream ||
+      total_bytes_.load(std::memory_order_relaxed) + size > config_.max_total_bytes) {
+    ResetLocked(stream);
+    stream->waiting_keyframe = true;
+    dropped_gops_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  // 数据复制在缓存内完成，快照只增加引用计数
+  stream->frames.push_back(new CachedVideoFrame(frame));
+  stream->bytes += size;
+  total_bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+size_t GopCache::Snapshot(const char* user_id, StreamType type, GopSnapshot* out) {
+  out->Clear();
+  Stream* stream = Find(user_id, type);
+  if (stream == nullptr) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(stream->mutex);
+  if (!OwnsLocked(stream) || stream->waiting_keyframe) {
+    return 0;
+  }
+  out->frames_.reserve(stream->frames.size());
+  for (size_t i = 0; i < stream->frames.size(); ++i) {
+    stream->frames[i]->AddRef();
+    out->frames_.push_back(stream->frames[i]);
+  }
+  return out->frames_.size();
+}
+
+void GopCache::RemoveUser(const char* user_id) {
+  std::lock_guard<std::mutex> lock(create_mutex_);
+  const uint32_t handle = users_.Find(user_id);
+  if (handle == kInvalidUser) {
+    return;
+  }
+  for (size_t slot = 0; slot < kVideoSlots; ++slot) {
+    std::atomic<Stream*>& entry = by_user_[handle * kVideoSlots + slot];
+    Stream* stream = entry.load(std::memory_order_acquire);
+    if (stream == nullptr) {
+      continue;
+    }
+    {
+      // 在 stream->mutex 下摘除，之后取得锁的写入与快照都能发现已不属于该路
+      std::lock_guard<std::mutex> stream_lock(stream->mutex);
+      entry.store(nullptr, std::memory_order_release);
+      ResetLocked(stream);
+      stream->waiting_keyframe = true;
+    }
+    free_streams_.push_back(stream);
+  }
+  users_.Release(handle);
+}
+
+void GopCache::ResetLocked(Stream* stream) {
+  for (size_t i = 0; i < stream->frames.size(); ++i) {
+    stream->frames[i]->Release();
+  }
+  stream->frames.clear();
+  total_bytes_.fetch_sub(stream->bytes, std::memory_order_relaxed);
+  stream->bytes = 0;
+}
+
+}  // namespace swing
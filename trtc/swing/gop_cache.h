@@ -0,0 +1,175 @@
+//
+// 功能说明：
+//   最近一个 GOP 的缓存，供中途加入的消费者（转推的 V2TXLivePusher、新建的录制、
+//   预览等）立即起播，不必等待下一个关键帧。
+//   在 TRTCCloudDelegate::OnRemoteVideoReceived(const VideoFrame&) 中调用
+//   GopCache::OnRemoteVideoReceived()，每路 (user_id, 视频 StreamType) 保留从最近
+//   一个关键帧开始的所有帧；新关键帧到达时丢弃上一个 GOP。
+//
+//   缓存的帧按引用计数共享：Snapshot() 只增加引用计数，不复制数据，
+//   快照持有的帧在缓存换组后仍然有效，随快照析构释放。
+//
+//   内存上限：单路 GOP 超过 |max_bytes_per_stream|，或所有路合计超过
+//   |max_total_bytes| 时，丢弃当前写入路的整个 GOP，直到下一个关键帧重新开始缓存；
+//   只缓存完整可解码的 GOP。上限只统计缓存自身持有的帧，不含快照仍在引用的旧帧。
+//
+//   线程安全：各路流可在不同线程写入，Snapshot() 可在任意线程调用。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_GOP_CACHE_H_
+#define GCHATGPT_TRTC_SWING_GOP_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "../include/live/liteav_live_pusher.h"
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "frame_pool.h"
+#include "frame_view.h"
+#include "user_interner.h"
+
+namespace swing {
+
+using liteav::live::V2TXLivePusher;
+using liteav::trtc::StreamType;
+using liteav::trtc::TRTCCloud;
+using liteav::trtc::VideoFrame;
+
+struct GopCacheConfig {
+  GopCacheConfig()
+      : max_bytes_per_stream(8 << 20), max_total_bytes(64 << 20), max_streams(256) {}
+
+  size_t max_bytes_per_stream;
+  size_t max_total_bytes;
+
+  // 最多缓存的 (user_id, StreamType) 路数
+  size_t max_streams;
+};
+
+// 缓存的一帧编码视频，引用计数，数据块取自 FramePool
+class CachedVideoFrame {
+ public:
+  void AddRef();
+  void Release();
+
+  ByteSpan Bytes() const { return payload_.Bytes(); }
+  size_t size() const { return payload_.size(); }
+
+  // 复制数据到 |frame|，用于发送
+  void ToVideoFrame(VideoFrame* frame) const;
+  void ToVideoFrame(liteav::live::VideoFrame* frame) const;
+
+  uint32_t pts;
+  uint32_t dts;
+  bool is_key_frame;
+  int codec;
+  int rotation;
+
+ private:
+  friend class GopCache;
+
+  explicit CachedVideoFrame(const VideoFrame& frame);
+  ~CachedVideoFrame();
+  CachedVideoFrame(const CachedVideoFrame&);
+  CachedVideoFrame& operator=(const CachedVideoFrame&);
+
+  std::atomic<int> ref_count_;
+  PooledBuffer payload_;
+};
+
+// 一个 GOP 的快照，第一帧为关键帧
+class GopSnapshot {
+ public:
+  GopSnapshot();
+  ~GopSnapshot();
+
+  size_t Size() const { return frames_.size(); }
+  bool Empty() const { return frames_.empty(); }
+
+  // 第 |index| 帧，快照析构前有效
+  const CachedVideoFrame* Frame(size_t index) const;
+
+  // 所有帧的字节数
+  size_t Bytes() const;
+
+  void Clear();
+
+  // 按顺序发送所有帧，遇到失败立即返回发送接口的错误码
+  // 快照为空时返回 ERR_READ_TRY_AGAIN。
+  int SendTo(V2TXLivePusher* pusher) const;
+  int SendTo(TRTCCloud* cloud, StreamType type) const;
+
+ private:
+  friend class GopCache;
+
+  GopSnapshot(const GopSnapshot&);
+  GopSnapshot& operator=(const GopSnapshot&);
+
+  std::vector<CachedVideoFrame*> frames_;
+};
+
+class GopCache {
+ public:
+  explicit GopCache(const GopCacheConfig& config);
+  ~GopCache();
+
+  // 缓存一帧，只接受大流、小流与辅流
+  void OnRemoteVideoReceived(const char* user_id, StreamType type, const VideoFrame& frame);
+
+  // 取 (user_id, type) 最近的 GOP，|out| 原有内容被替换
+  // 返回帧数，没有完整 GOP 时返回 0。
+  size_t Snapshot(const char* user_id, StreamType type, GopSnapshot* out);
+
+  // 丢弃用户所有流的缓存并归还其路数与用户句柄，通常在 OnRemoteUserExitRoom 中调用
+  // 调用后不应再写入该用户的帧，再次写入时按新用户缓存。
+  void RemoveUser(const char* user_id);
+
+  // 缓存持有的字节数
+  size_t CachedBytes() const { return total_bytes_.load(std::memory_order_relaxed); }
+
+  // 因超出内存上限丢弃的 GOP 数
+  uint64_t DroppedGops() const { return dropped_gops_.load(std::memory_order_relaxed); }
+
+  // 因超出 |max_streams|、流类型不支持或用户已移除而未缓存的帧数
+  uint64_t DroppedFrames() const { return dropped_frames_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Stream;
+
+  GopCache(const GopCache&);
+  GopCache& operator=(const GopCache&);
+
+  // 查找或创建 (user_id, type) 的缓存，超出 |max_streams| 返回 nullptr
+  Stream* FindOrCreate(const char* user_id, StreamType type);
+  Stream* Find(const char* user_id, StreamType type) const;
+  // |stream| 仍登记在 by_user_ 中，调用方持有 stream->mutex
+  bool OwnsLocked(const Stream* stream) const;
+
+  // 释放 |stream| 当前的 GOP，调用方持有 stream->mutex
+  void ResetLocked(Stream* stream);
+
+  const GopCacheConfig config_;
+
+  UserInterner users_;
+
+  // 按 [用户句柄][流类型] 排列，在 |create_mutex_| 下写入，RemoveUser() 时清空
+  std::vector<std::atomic<Stream*> > by_user_;
+  // 分配过的所有 Stream，析构时释放
+  std::vector<Stream*> streams_;
+  size_t stream_count_;
+  // 已移除、可分配给新路的 Stream
+  std::vector<Stream*> free_streams_;
+  std::mutex create_mutex_;
+
+  std::atomic<size_t> total_bytes_;
+  std::atomic<uint64_t> dropped_gops_;
+  std::atomic<uint64_t> dropped_frames_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_GOP_CACHE_H_
@@ -0,0 +1,477 @@
+#include "latency_tracer.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#include "spsc_ring.h"
+
+namespace swing {
+
+namespace {
+
+// 后台线程的处理间隔
+const int kCollectIntervalMs = 10;
+
+// 晚于该时间的时间戳留到下一轮，等其他线程缓冲中更早的打点被取走
+const int64_t kGraceNs = 2000000;
+
+// 追踪中的帧超过该时间未到达输出阶段则清理
+const int64_t kMaxInFlightNs = 10000000000LL;
+
+// 直方图上限 60s，两位有效数字
+const int64_t kHighestTrackableNs = 60000000000LL;
+const int kSignificantFigures = 2;
+
+std::atomic<bool> g_enabled(false);
+std::atomic<int> g_sample_shift(0);
+std::atomic<uint32_t> g_next_source(0);
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 与 FrameDispatcher 的用户槽位一致，其余类型归入最后一个
+const StreamType kSlotTypes[] = {
+    liteav::trtc::STREAM_TYPE_AUDIO,
+    liteav::trtc::STREAM_TYPE_VIDEO_HIGH,
+    liteav::trtc::STREAM_TYPE_VIDEO_LOW,
+    liteav::trtc::STREAM_TYPE_VIDEO_AUX,
+    liteav::trtc::STREAM_TYPE_UNKNOWN,
+};
+
+uint64_t StreamSlot(StreamType type) {
+  for (uint64_t i = 0; i + 1 < sizeof(kSlotTypes) / sizeof(kSlotTypes[0]); ++i) {
+    if (kSlotTypes[i] == type) {
+      return i;
+    }
+  }
+  return sizeof(kSlotTypes) / sizeof(kSlotTypes[0]) - 1;
+}
+
+bool Sampled(uint64_t key) {
+  const int shift = g_sample_shift.load(std::memory_order_relaxed);
+  if (shift <= 0) {
+    return true;
+  }
+  return ((key * 0x9E3779B97F4A7C15ULL) >> (64 - shift)) == 0;
+}
+
+}  // namespace
+
+HdrHistogram::HdrHistogram(int64_t highest_trackable, int significant_figures)
+    : highest_trackable_(std::max<int64_t>(2, highest_trackable)),
+      total_(0),
+      min_(0),
+      max_(0),
+      sum_(0) {
+  significant_figures = std::min(5, std::max(1, significant_figures));
+  int64_t single_unit_resolution = 2;
+  for (int i = 0; i < significant_figures; ++i) {
+    single_unit_resolution *= 10;
+  }
+  int magnitude = 0;
+  while ((static_cast<int64_t>(1) << magnitude) < single_unit_resolution) {
+    ++magnitude;
+  }
+  sub_bucket_half_count_magnitude_ = magnitude - 1;
+  sub_bucket_count_ = static_cast<int64_t>(1) << magnitude;
+  sub_bucket_half_count_ = sub_bucket_count_ / 2;
+  sub_bucket_mask_ = sub_bucket_count_ - 1;
+
+  // 每个桶的值域是上一个的两倍，直到覆盖 |highest_trackable_|
+  int buckets = 1;
+  int64_t smallest_untrackable = sub_bucket_count_;
+  while (smallest_untrackable <= highest_trackable_) {
+    if (smallest_untrackable > INT64_MAX / 2) {
+      ++buckets;
+      break;
+    }
+    smallest_untrackable <<= 1;
+    ++buckets;
+  }
+  counts_.assign(static_cast<size_t>((buckets + 1) * sub_bucket_half_count_), 0);
+}
+
+int HdrHistogram::BucketIndex(int64_t value) const {
+  const uint64_t masked = static_cast<uint64_t>(value) | static_cast<uint64_t>(sub_bucket_mask_);
+  const int pow2_ceiling = 64 - __builtin_clzll(masked);
+  return pow2_ceiling - (sub_bucket_half_count_magnitude_ + 1);
+}
+
+int HdrHistogram::CountsIndex(int64_t value) const {
+  const int bucket = BucketIndex(value);
+  const int64_t sub_bucket = value >> bucket;
+  return static_cast<int>(((static_cast<int64_t>(bucket) + 1) << sub_bucket_half_count_magnitude_) +
+                          (sub_bucket - sub_bucket_half_count_));
+}
+
+int64_t HdrHistogram::ValueFromIndex(int index) const {
+  int bucket = (index >> sub_bucket_half_count_magnitude_) - 1;
+  int64_t sub_bucket = (index & (sub_bucket_half_count_ - 1)) + sub_bucket_half_count_;
+  if (bucket < 0) {
+    sub_bucket -= sub_bucket_half_count_;
+    bucket = 0;
+  }
+  return sub_bucket << bucket;
+}
+
+int64_t HdrHistogram::HighestEquivalent(int64_t value) const {
+  const int bucket = BucketIndex(value);
+  const int64_t sub_bucket = value >> bucket;
+  const int range_bucket = sub_bucket >= sub_bucket_count_ ? bucket + 1 : bucket;
+  const int64_t lowest = sub_bucket << bucket;
+  return lowest + (static_cast<int64_t>(1) << range_bucket) - 1;
+}
+
+void HdrHistogram::Record(int64_t value) {
+  value = std::min(highest_trackable_, std::max<int64_t>(0, value));
+  const int index = CountsIndex(value);
+  if (index < 0 || static_cast<size_t>(index) >= counts_.size()) {
+    return;
+  }
+  ++counts_[static_cast<size_t>(index)];
+  min_ = total_ == 0 ? value : std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+  ++total_;
+}
+
+void HdrHistogram::Merge(const HdrHistogram& other) {
+  if (other.counts_.size() != counts_.size() || other.total_ == 0) {
+    return;
+  }
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  min_ = total_ == 0 ? other.min_ : std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  total_ += other.total_;
+}
+
+void HdrHistogram::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  total_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0;
+}
+
+int64_t HdrHistogram::Mean() const {
+  return total_ == 0 ? 0 : sum_ / static_cast<int64_t>(total_);
+}
+
+int64_t HdrHistogram::ValueAtPercentile(double percentile) const {
+  if (total_ == 0) {
+    return 0;
+  }
+  percentile = std::min(100.0, std::max(0.0, percentile));
+  uint64_t target =
+      static_cast<uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_)));
+  target = std::max<uint64_t>(1, target);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= target) {
+      return std::min(max_, HighestEquivalent(ValueFromIndex(static_cast<int>(i))));
+    }
+  }
+  return max_;
+}
+
+uint32_t NewTraceSource() {
+  // 从 1 开始，key 不会为 0
+  return g_next_source.fetch_add(1, std::memory_order_relaxed) % 0xFFF + 1;
+}
+
+uint64_t TraceKey(uint32_t source, uint32_t user, StreamType type, uint32_t pts) {
+  return (static_cast<uint64_t>(source & 0xFFF) << 52) |
+         (static_cast<uint64_t>(user & 0xFFFF) << 36) | (StreamSlot(type) << 32) | pts;
+}
+
+int64_t TraceClock() {
+  return g_enabled.load(std::memory_order_relaxed) ? MonotonicNs() : 0;
+}
+
+struct LatencyTracer::ThreadBuffer {
+  explicit ThreadBuffer(size_t capacity) : ring(capacity), dropped(0), exited(false) {}
+
+  SpscRing<Record> ring;
+  std::atomic<uint64_t> dropped;
+  // 线程已退出，取空后移除
+  std::atomic<bool> exited;
+};
+
+void TraceStampAt(uint64_t key, int stage, int64_t ns) {
+  if (ns == 0 || key == 0 || stage < 0 || stage >= kSwingTraceStageCount || !Sampled(key)) {
+    return;
+  }
+  LatencyTracer::ThreadBuffer* buffer = LatencyTracer::Instance().LocalBuffer();
+  if (buffer == nullptr) {
+    return;
+  }
+  LatencyTracer::Record* record = buffer->ring.BeginPush();
+  if (record == nullptr) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  record->key = key;
+  record->ns = ns;
+  record->stage = stage;
+  buffer->ring.CommitPush();
+}
+
+void TraceStamp(uint64_t key, int stage) {
+  TraceStampAt(key, stage, TraceClock());
+}
+
+LatencyTracer& LatencyTracer::Instance() {
+  // 不析构，线程退出时的打点仍可访问
+  static LatencyTracer* tracer = new LatencyTracer();
+  return *tracer;
+}
+
+LatencyTracer::LatencyTracer() : next_expire_ns_(0) {
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+LatencyTracer::ThreadBuffer* LatencyTracer::LocalBuffer() {
+  // 线程退出时通知后台线程回收缓冲
+  struct Holder {
+    ~Holder() {
+      if (buffer) {
+        buffer->exited.store(true, std::memory_order_release);
+      }
+    }
+    std::shared_ptr<ThreadBuffer> buffer;
+  };
+  thread_local Holder holder;
+  if (!holder.buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    holder.buffer.reset(new ThreadBuffer(config_.thread_buffer_records));
+    buffers_.push_back(holder.buffer);
+  }
+  return holder.buffer.get();
+}
+
+void LatencyTracer::Enable(const LatencyTracerConfig& config) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    g_sample_shift.store(std::min(63, std::max(0, config.sample_shift)),
+                         std::memory_order_relaxed);
+    g_enabled.store(true, std::memory_order_relaxed);
+    if (!thread_.joinable()) {
+      thread_ = std::thread(&LatencyTracer::Run, this);
+    }
+  }
+  cond_.notify_one();
+}
+
+void LatencyTracer::Disable() {
+  g_enabled.store(false, std::memory_order_relaxed);
+}
+
+bool LatencyTracer::Enabled() const {
+  return g_enabled.load(std::memory_order_relaxed);
+}
+
+HdrHistogram* LatencyTracer::Histogram(int slot, int stage, int cumulative) {
+  std::unique_ptr<HdrHistogram>& histogram = histograms_[slot][stage][cumulative];
+  if (!histogram) {
+    histogram.reset(new HdrHistogram(kHighestTrackableNs, kSignificantFigures));
+  }
+  return histogram.get();
+}
+
+void LatencyTracer::Snapshot(std::vector<SwingTraceRow>* rows) const {
+  rows->clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int slot = 0; slot < kStreamSlots; ++slot) {
+    for (int stage = kSwingTraceQueue; stage < kSwingTraceStageCount; ++stage) {
+      for (int cumulative = 0; cumulative < 2; ++cumulative) {
+        const HdrHistogram* histogram = histograms_[slot][stage][cumulative].get();
+        if (histogram == nullptr || histogram->Count() == 0) {
+          continue;
+        }
+        SwingTraceRow row;
+        row.stream_type = kSlotTypes[slot];
+        row.stage = stage;
+        row.cumulative = cumulative;
+        row.count = histogram->Count();
+        row.min_ns = histogram->Min();
+        row.mean_ns = histogram->Mean();
+        row.p50_ns = histogram->ValueAtPercentile(50);
+        row.p90_ns = histogram->ValueAtPercentile(90);
+        row.p99_ns = histogram->ValueAtPercentile(99);
+        row.p999_ns = histogram->ValueAtPercentile(99.9);
+        row.max_ns = histogram->Max();
+        rows->push_back(row);
+      }
+    }
+  }
+}
+
+SwingTraceStats LatencyTracer::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SwingTraceStats stats = stats_;
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    stats.dropped += buffers_[i]->dropped.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void LatencyTracer::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int slot = 0; slot < kStreamSlots; ++slot) {
+    for (int stage = 0; stage < kSwingTraceStageCount; ++stage) {
+      for (int cumulative = 0; cumulative < 2; ++cumulative) {
+        if (histograms_[slot][stage][cumulative]) {
+          histograms_[slot][stage][cumulative]->Reset();
+        }
+      }
+    }
+  }
+  const uint64_t in_flight = stats_.in_flight;
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.in_flight = in_flight;
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    buffers_[i]->dropped.store(0, std::memory_order_relaxed);
+  }
+}
+
+void LatencyTracer::Run() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait_for(lock, std::chrono::milliseconds(kCollectIntervalMs));
+      // 关闭后处理完留在宽限期内的时间戳，再等待重新开启
+      cond_.wait(lock, [this] {
+        return g_enabled.load(std::memory_order_relaxed) || !pending_.empty();
+      });
+      snapshot_ = buffers_;
+    }
+    Collect(MonotonicNs());
+  }
+}
+
+void LatencyTracer::Collect(int64_t now) {
+  std::vector<std::shared_ptr<ThreadBuffer> > exited;
+  for (size_t i = 0; i < snapshot_.size(); ++i) {
+    ThreadBuffer* buffer = snapshot_[i].get();
+    // 先读退出标记，取空后即可安全移除
+    const bool gone = buffer->exited.load(std::memory_order_acquire);
+    const size_t readable = buffer->ring.Readable();
+    for (size_t n = 0; n < readable; ++n) {
+      pending_.push_back(*buffer->ring.Peek(n));
+    }
+    buffer->ring.Consume(readable);
+    if (gone) {
+      exited.push_back(snapshot_[i]);
+    }
+  }
+  snapshot_.clear();
+
+  std::sort(pending_.begin(), pending_.end(), [](const Record& a, const Record& b) {
+    return a.ns != b.ns ? a.ns < b.ns : a.stage < b.stage;
+  });
+  size_t ready = 0;
+  while (ready < pending_.size() && pending_[ready].ns <= now - kGraceNs) {
+    ++ready;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < exited.size(); ++i) {
+    std::vector<std::shared_ptr<ThreadBuffer> >::iterator it =
+        std::find(buffers_.begin(), buffers_.end(), exited[i]);
+    if (it != buffers_.end()) {
+      stats_.dropped += (*it)->dropped.load(std::memory_order_relaxed);
+      buffers_.erase(it);
+    }
+  }
+
+  for (size_t i = 0; i < ready; ++i) {
+    const Record& record = pending_[i];
+    ++stats_.stamps;
+    if (record.stage == kSwingTraceCallback) {
+      InFlight& frame = in_flight_[record.key];
+      frame.callback_ns = record.ns;
+      frame.last_ns = record.ns;
+      frame.last_stage = kSwingTraceCallback;
+      continue;
+    }
+    std::unordered_map<uint64_t, InFlight>::iterator it = in_flight_.find(record.key);
+    if (it == in_flight_.end() || record.stage <= it->second.last_stage) {
+      ++stats_.unmatched;
+      continue;
+    }
+    InFlight& frame = it->second;
+    const int slot = static_cast<int>((record.key >> 32) & 0xF);
+    Histogram(slot, record.stage, 0)->Record(record.ns - frame.last_ns);
+    Histogram(slot, record.stage, 1)->Record(record.ns - frame.callback_ns);
+    frame.last_ns = record.ns;
+    frame.last_stage = record.stage;
+    if (record.stage == kSwingTraceOutput) {
+      in_flight_.erase(it);
+    }
+  }
+  pending_.erase(pending_.begin(), pending_.begin() + static_cast<ptrdiff_t>(ready));
+
+  if (now >= next_expire_ns_) {
+    next_expire_ns_ = now + 1000000000;
+    for (std::unordered_map<uint64_t, InFlight>::iterator it = in_flight_.begin();
+         it != in_flight_.end();) {
+      if (now - it->second.callback_ns > kMaxInFlightNs) {
+        it = in_flight_.erase(it);
+        ++stats_.expired;
+      } else {
+        ++it;
+      }
+    }
+  }
+  stats_.in_flight = in_flight_.size();
+}
+
+}  // namespace swing
+
+void SwingTraceEnable(int sample_shift) {
+  if (sample_shift < 0) {
+    swing::LatencyTracer::Instance().Disable();
+    return;
+  }
+  swing::LatencyTracerConfig config;
+  config.sample_shift = sample_shift;
+  swing::LatencyTracer::Instance().Enable(config);
+}
+
+void SwingTraceStamp(uint64_t key, int stage) {
+  swing::TraceStamp(key, stage);
+}
+
+int SwingTraceSnapshot(SwingTraceRow* rows, int max_rows) {
+  if (rows == nullptr || max_rows <= 0) {
+    return 0;
+  }
+  std::vector<SwingTraceRow> snapshot;
+  swing::LatencyTracer::Instance().Snapshot(&snapshot);
+  const int count = std::min(max_rows, static_cast<int>(snapshot.size()));
+  std::copy(snapshot.begin(), snapshot.begin() + count, rows);
+  return count;
+}
+
+void SwingTraceGetStats(SwingTraceStats* stats) {
+  if (stats != nullptr) {
+    *stats = swing::LatencyTracer::Instance().GetStats();
+  }
+}
+
+void SwingTraceReset() {
+  swing::LatencyTracer::Instance().Reset();
+}
@@ -0,0 +1,230 @@
+//
+// 功能说明：
+//   逐帧时延追踪。帧在流水线的每个阶段打一个时间戳：
+//   SDK 回调 -> 入队 -> 交给 Go -> 处理完成 -> 输出给客户端，
+//   后台线程按帧把相邻阶段配对，记入按阶段、按 StreamType 划分的 HdrHistogram，
+//   用来回答"从 SDK 回调到字节送达客户端，时间花在了哪里"。
+//
+//   - 帧以 64 位 key 标识：追踪源编号、用户句柄、流类型与 pts，见 TraceKey()；
+//     RingFrame::trace_key、SwingVoiceEvent::trace_key 把 key 带到下游阶段；
+//   - 打点只写入本线程的 SPSC 环形缓冲，不加锁、不分配；缓冲满时丢弃并计数；
+//   - 后台线程每 10ms 取走各线程的时间戳，按时间排序后配对，每个阶段记两个值：
+//     距上一阶段的耗时与距 SDK 回调的累计耗时；
+//   - 未开启时打点只有一次原子读；可按 key 抽样，同一帧的各阶段同时选中或同时跳过。
+//
+//   Go 侧通过下方 C 接口打点与读取（见 trace.go），server 在 /trace/latency 导出。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_LATENCY_TRACER_H_
+#define GCHATGPT_TRTC_SWING_LATENCY_TRACER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 阶段
+enum {
+  kSwingTraceCallback = 0,
+  kSwingTraceQueue = 1,
+  kSwingTraceHandoff = 2,
+  kSwingTraceProcess = 3,
+  kSwingTraceOutput = 4,
+  kSwingTraceStageCount = 5,
+};
+
+// 一个直方图的摘要，时间单位纳秒
+typedef struct SwingTraceRow {
+  // StreamType
+  int stream_type;
+  // 阶段，不含 kSwingTraceCallback
+  int stage;
+  // 0：距上一个打点阶段的耗时，1：距 SDK 回调的累计耗时
+  int cumulative;
+  uint64_t count;
+  int64_t min_ns;
+  int64_t mean_ns;
+  int64_t p50_ns;
+  int64_t p90_ns;
+  int64_t p99_ns;
+  int64_t p999_ns;
+  int64_t max_ns;
+} SwingTraceRow;
+
+typedef struct SwingTraceStats {
+  // 已配对处理的时间戳数
+  uint64_t stamps;
+  // 线程缓冲满而丢弃的时间戳数
+  uint64_t dropped;
+  // 找不到同一帧 SDK 回调时间戳的打点数
+  uint64_t unmatched;
+  // 未到达输出阶段、超时清理的帧数
+  uint64_t expired;
+  // 正在追踪的帧数
+  uint64_t in_flight;
+} SwingTraceStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C 接口，供 cgo 调用，含义与下方 swing::LatencyTracer 的同名方法相同
+// |sample_shift| 为负时关闭追踪。
+void SwingTraceEnable(int sample_shift);
+void SwingTraceStamp(uint64_t key, int stage);
+int SwingTraceSnapshot(SwingTraceRow* rows, int max_rows);
+void SwingTraceGetStats(SwingTraceStats* stats);
+void SwingTraceReset();
+
+#ifdef __cplusplus
+}  // extern "C"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::StreamType;
+
+// 高动态范围直方图（HdrHistogram 的计数布局）
+// 在 [0, |highest_trackable|] 内按 |significant_figures| 位有效数字分桶，
+// 相对误差不超过 10^-significant_figures，内存与值域的对数成正比。非线程安全。
+class HdrHistogram {
+ public:
+  // |significant_figures| 取 1 ~ 5
+  HdrHistogram(int64_t highest_trackable, int significant_figures);
+
+  // 负值按 0、超出上限按上限记录
+  void Record(int64_t value);
+
+  // 合并同样参数构造的直方图
+  void Merge(const HdrHistogram& other);
+  void Reset();
+
+  uint64_t Count() const { return total_; }
+  int64_t Min() const { return total_ == 0 ? 0 : min_; }
+  int64_t Max() const { return max_; }
+  int64_t Mean() const;
+
+  // |percentile| 取 [0, 100]，返回该分位所在计数单元的最大等价值
+  int64_t ValueAtPercentile(double percentile) const;
+
+ private:
+  int BucketIndex(int64_t value) const;
+  int CountsIndex(int64_t value) const;
+  int64_t ValueFromIndex(int index) const;
+  int64_t HighestEquivalent(int64_t value) const;
+
+  int64_t highest_trackable_;
+  int sub_bucket_half_count_magnitude_;
+  int64_t sub_bucket_count_;
+  int64_t sub_bucket_half_count_;
+  int64_t sub_bucket_mask_;
+  std::vector<uint64_t> counts_;
+  uint64_t total_;
+  int64_t min_;
+  int64_t max_;
+  int64_t sum_;
+};
+
+// 分配一个追踪源编号（12 位，非 0，循环使用），每个 FrameDispatcher / VoiceSource 一个，
+// 使不同房间里句柄与 pts 相同的帧 key 不同
+uint32_t NewTraceSource();
+
+// 组合帧的 key：源 12 位、用户 16 位、流类型 4 位、pts 32 位
+uint64_t TraceKey(uint32_t source, uint32_t user, StreamType type, uint32_t pts);
+
+// 未开启时返回 0，否则返回当前 CLOCK_MONOTONIC 纳秒
+// 回调入口先取时间，确定 key 后再用 TraceStampAt() 记录。
+int64_t TraceClock();
+
+// 记录 key 为 |key| 的帧到达 |stage|，|ns| 为 0 或未被抽中时忽略，|key| 为 0 时忽略
+void TraceStampAt(uint64_t key, int stage, int64_t ns);
+void TraceStamp(uint64_t key, int stage);
+
+struct LatencyTracerConfig {
+  LatencyTracerConfig() : sample_shift(0), thread_buffer_records(8192) {}
+
+  // 每 2^sample_shift 帧追踪一帧，0 表示全部
+  int sample_shift;
+
+  // 每个打点线程的缓冲条数，向上取整为 2 的幂
+  size_t thread_buffer_records;
+};
+
+class LatencyTracer {
+ public:
+  // 进程内唯一，不析构
+  static LatencyTracer& Instance();
+
+  // 开启追踪并启动后台线程，可重复调用以修改抽样
+  void Enable(const LatencyTracerConfig& config);
+  void Disable();
+  bool Enabled() const;
+
+  // 当前所有非空直方图的摘要
+  void Snapshot(std::vector<SwingTraceRow>* rows) const;
+  SwingTraceStats GetStats() const;
+
+  // 清空直方图与计数，正在追踪的帧保留
+  void Reset();
+
+ private:
+  struct ThreadBuffer;
+
+  struct Record {
+    uint64_t key;
+    int64_t ns;
+    int stage;
+  };
+
+  // 已记录 SDK 回调、尚未到达输出阶段的帧
+  struct InFlight {
+    int64_t callback_ns;
+    int64_t last_ns;
+    int last_stage;
+  };
+
+  // 直方图下标：[流类型][阶段][cumulative]
+  static const int kStreamSlots = 5;
+
+  friend void TraceStampAt(uint64_t key, int stage, int64_t ns);
+
+  LatencyTracer();
+  LatencyTracer(const LatencyTracer&);
+  LatencyTracer& operator=(const LatencyTracer&);
+
+  // 当前线程的缓冲，首次调用时注册
+  ThreadBuffer* LocalBuffer();
+
+  void Run();
+  // 取走各线程缓冲中的时间戳，配对早于 |now| - 宽限期的部分
+  void Collect(int64_t now);
+  HdrHistogram* Histogram(int slot, int stage, int cumulative);
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  LatencyTracerConfig config_;
+  std::vector<std::shared_ptr<ThreadBuffer> > buffers_;
+  std::thread thread_;
+
+  // 以下在 |mutex_| 下访问
+  std::unique_ptr<HdrHistogram> histograms_[kStreamSlots][kSwingTraceStageCount][2];
+  SwingTraceStats stats_;
+
+  // 以下仅后台线程访问
+  std::vector<std::shared_ptr<ThreadBuffer> > snapshot_;
+  std::vector<Record> pending_;
+  std::unordered_map<uint64_t, InFlight> in_flight_;
+  int64_t next_expire_ns_;
+};
+
+}  // namespace swing
+
+#endif  // __cplusplus
+
+#endif  // GCHATGPT_TRTC_SWING_LATENCY_TRACER_H_
@@ -0,0 +1,75 @@
+//go:build loopback
+
+package swing
+
+// 进程内回环后端，接口说明见 loopback.h
+
+// #include <stdlib.h>
+// #include "loopback.h"
+import "C"
+
+import "unsafe"
+
+type LoopbackStats struct {
+	AudioFramesGenerated uint64
+	VideoFramesGenerated uint64
+	SeiMessagesGenerated uint64
+	FramesSent           uint64
+	Callbacks            uint64
+	CallbackNsTotal      uint64
+	CallbackNsMax        uint64
+	LateTicks            uint64
+	MaxLagUs             uint64
+}
+
+func LoopbackSetWorkerThreads(count int) int {
+	return int(C.LoopbackSetWorkerThreads(C.int(count)))
+}
+
+// 合成用户 ID 为 userPrefix 加序号，sampleRate 为 0 时不产生音频，width 为 0 时不产生视频
+func LoopbackAddSyntheticUsers(sdkAppID uint32, roomID, userPrefix string, count, sampleRate, channels, width, height, frameRate int) int {
+	cRoomID := C.CString(roomID)
+	defer C.free(unsafe.Pointer(cRoomID))
+	cUserPrefix := C.CString(userPrefix)
+	defer C.free(unsafe.Pointer(cUserPrefix))
+	return int(C.LoopbackAddSyntheticUsers(C.uint32_t(sdkAppID), cRoomID, cUserPrefix, C.int(count),
+		C.int(sampleRate), C.int(channels), C.int(width), C.int(height), C.int(frameRate)))
+}
+
+// 只产生单声道音频的合成用户，说话 speechOnMs 与静音 speechOffMs 交替
+func LoopbackAddSyntheticSpeakers(sdkAppID uint32, roomID, userPrefix string, count, sampleRate, speechOnMs, speechOffMs int) int {
+	cRoomID := C.CString(roomID)
+	defer C.free(unsafe.Pointer(cRoomID))
+	cUserPrefix := C.CString(userPrefix)
+	defer C.free(unsafe.Pointer(cUserPrefix))
+	return int(C.LoopbackAddSyntheticSpeakers(C.uint32_t(sdkAppID), cRoomID, cUserPrefix, C.int(count),
+		C.int(sampleRate), C.int(speechOnMs), C.int(speechOffMs)))
+}
+
+func LoopbackRemoveSyntheticUser(sdkAppID uint32, roomID, userID string) int {
+	cRoomID := C.CString(roomID)
+	defer C.free(unsafe.Pointer(cRoomID))
+	cUserID := C.CString(userID)
+	defer C.free(unsafe.Pointer(cUserID))
+	return int(C.LoopbackRemoveSyntheticUser(C.uint32_t(sdkAppID), cRoomID, cUserID))
+}
+
+func GetLoopbackStats() LoopbackStats {
+	var stats C.LoopbackStats
+	C.LoopbackGetStats(&stats)
+	return LoopbackStats{
+		AudioFramesGenerated: uint64(stats.audio_frames_generated),
+		VideoFramesGenerated: uint64(stats.video_frames_generated),
+		SeiMessagesGenerated: uint64(stats.sei_messages_generated),
+		FramesSent:           uint64(stats.frames_sent),
+		Callbacks:            uint64(stats.callbacks),
+		CallbackNsTotal:      uint64(stats.callback_ns_total),
+		CallbackNsMax:        uint64(stats.callback_ns_max),
+		LateTicks:            uint64(stats.late_ticks),
+		MaxLagUs:             uint64(stats.max_lag_us),
+	}
+}
+
+func ResetLoopbackStats() {
+	C.LoopbackResetStats()
+}
@@ -0,0 +1,152 @@
+//
+// 功能说明：
+//   进程内回环后端。
+//   以 go build -tags loopback 构建时，本目录的 loopback_*.cc 代替 libliteav
+//   实现 include/ 下的全部接口（TRTCCloud、Room、Recorder、V2TXLivePlayer、
+//   V2TXLivePusher 以及帧、字符串等值类型），不连接网络。
+//   同一进程内进入同一房间的实例互相收发，另可按配置合成远端用户，
+//   以固定速率产生音频、视频和 SEI，用于在 Linux 上压测自己的处理链路。
+//
+//   房间按 (sdk_app_id, 房间号) 区分，房间号取 str_room_id，为空时取 room_id
+//   的十进制字符串。直播 URL 按以下规则映射到房间：
+//   - 房间号取参数 strroomid / roomid，缺省为路径中的流 ID；
+//   - 推流用户取参数 userid，缺省为流 ID；
+//   - 播放的远端用户取参数 remoteuserid，缺省为流 ID。
+//   例如 trtc://loopback/push/s1?sdkappid=1 推出的流可由
+//   trtc://loopback/play/s1?sdkappid=1 播放。
+//
+//   所有回调在回环工作线程上执行，每个房间固定在一个工作线程上。
+//   行为差异：
+//   - 不做编解码，H264 与 YUV 之间不转换，接收方只收到与自己输出格式一致的帧；
+//     合成用户两种格式都能提供，H264 只有合法的 SPS/PPS 和 NAL 结构，无法解码；
+//   - 录制模式只输出 PCM，RecordConfig::output_audio_codec_type 被忽略；
+//   - Recorder 只统计录制的数据量并按进度回调，不写文件。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_LOOPBACK_H_
+#define GCHATGPT_TRTC_SWING_LOOPBACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 统计信息，计数从进程启动或上次 LoopbackResetStats() 起累计
+typedef struct LoopbackStats {
+  // 合成用户产生的帧数
+  uint64_t audio_frames_generated;
+  uint64_t video_frames_generated;
+  uint64_t sei_messages_generated;
+  // 实例发送的帧数
+  uint64_t frames_sent;
+  // 投递给委托的媒体回调次数及耗时（纳秒），反映调用方处理链路的开销
+  uint64_t callbacks;
+  uint64_t callback_ns_total;
+  uint64_t callback_ns_max;
+  // 工作线程落后于合成节拍的次数及最大落后时间（微秒）
+  uint64_t late_ticks;
+  uint64_t max_lag_us;
+} LoopbackStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C 接口，供 cgo 调用，含义与下方 swing::Loopback 的同名方法相同
+// 合成用户 ID 为 |user_prefix| 加序号，从 0 开始。
+// |audio_sample_rate| 为 0 时不产生音频，|video_width| 为 0 时不产生视频。
+int LoopbackAddSyntheticUsers(uint32_t sdk_app_id,
+                              const char* room_id,
+                              const char* user_prefix,
+                              int count,
+                              int audio_sample_rate,
+                              int audio_channels,
+                              int video_width,
+                              int video_height,
+                              int video_frame_rate);
+// 只产生单声道音频的合成用户，说话 |speech_on_ms| 与静音 |speech_off_ms| 交替
+int LoopbackAddSyntheticSpeakers(uint32_t sdk_app_id,
+                                 const char* room_id,
+                                 const char* user_prefix,
+                                 int count,
+                                 int audio_sample_rate,
+                                 int speech_on_ms,
+                                 int speech_off_ms);
+int LoopbackRemoveSyntheticUser(uint32_t sdk_app_id, const char* room_id, const char* user_id);
+int LoopbackSetWorkerThreads(int count);
+void LoopbackGetStats(LoopbackStats* stats);
+void LoopbackResetStats(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+
+#include "../include/trtc/liteav_trtc_defines.h"
+
+namespace swing {
+
+// 合成用户的媒体参数
+struct LoopbackUserConfig {
+  LoopbackUserConfig()
+      : audio(true),
+        audio_sample_rate(48000),
+        audio_channels(1),
+        audio_frame_length_ms(20),
+        speech_on_ms(0),
+        speech_off_ms(0),
+        video(true),
+        video_type(liteav::trtc::STREAM_TYPE_VIDEO_HIGH),
+        video_width(640),
+        video_height(360),
+        video_frame_rate(15),
+        video_bitrate_bps(800000),
+        gop_frames(30),
+        sei_interval_ms(0) {}
+
+  bool audio;
+  int audio_sample_rate;
+  int audio_channels;
+  int audio_frame_length_ms;
+  // 说话与静音交替的时长，均大于 0 时生效，否则持续发声
+  int speech_on_ms;
+  int speech_off_ms;
+
+  bool video;
+  liteav::trtc::StreamType video_type;
+  int video_width;
+  int video_height;
+  int video_frame_rate;
+  // 决定 H264 帧的大小，关键帧为普通帧的 4 倍
+  int video_bitrate_bps;
+  // 关键帧间隔，单位帧
+  int gop_frames;
+
+  // 发送 SEI 的间隔，0 表示不发送
+  int sei_interval_ms;
+};
+
+class Loopback {
+ public:
+  // 工作线程数，默认 1，需在首次进房或加入合成用户之前调用
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：|count| 不在 [1, 64] 内
+  // - ERR_INVALID_OPERATION：工作线程已经启动
+  static int SetWorkerThreads(int count);
+
+  // 在房间中加入一个合成用户，房间不存在时创建
+  // 返回 ERR_INVALID_PARAMETER 表示参数不合法或用户已存在。
+  static int AddSyntheticUser(uint32_t sdk_app_id,
+                              const char* room_id,
+                              const char* user_id,
+                              const LoopbackUserConfig& config);
+
+  // 移除合成用户，其他成员收到退房回调
+  static int RemoveSyntheticUser(uint32_t sdk_app_id, const char* room_id, const char* user_id);
+
+  static LoopbackStats GetStats();
+  static void ResetStats();
+};
+
+}  // namespace swing
+
+#endif  // __cplusplus
+
+#endif  // GCHATGPT_TRTC_SWING_LOOPBACK_H_
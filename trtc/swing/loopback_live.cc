@@ -0,0 +1,367 @@
+//go:build loopback
+
+// 回环后端：V2TXLivePlayer 与 V2TXLivePusher
+// URL 到房间的映射见 loopback.h。
+
+#include <atomic>
+#include <string>
+
+#include "../include/live/liteav_live_player.h"
+#include "../include/live/liteav_live_pusher.h"
+#include "loopback_server.h"
+
+namespace swing {
+
+namespace {
+
+using liteav::live::LivePusherStatistics;
+using liteav::live::PlayerOption;
+using liteav::live::PushOption;
+using liteav::live::V2TXLivePlayer;
+using liteav::live::V2TXLivePlayerDelegate;
+using liteav::live::V2TXLivePusher;
+using liteav::live::V2TXLivePusherDelegate;
+
+// 网络质量和推流统计的回调间隔
+const int64_t kReportIntervalUs = 2000000;
+
+class LoopbackPlayer : public V2TXLivePlayer, public LoopbackEndpoint {
+ public:
+  explicit LoopbackPlayer(V2TXLivePlayerDelegate* delegate);
+  ~LoopbackPlayer();
+
+  // V2TXLivePlayer
+  int StartPlay(const char* url, const PlayerOption& option) override;
+  int StopPlay() override;
+  bool IsPlaying() override { return playing_; }
+
+  // LoopbackEndpoint
+  void OnAudio(const std::string& user_id, const AudioFrame& frame) override;
+  void OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) override;
+  void OnPixel(const std::string& user_id, StreamType type, const PixelFrame& frame) override;
+  void OnSei(const std::string& user_id,
+             StreamType type,
+             int message_type,
+             const uint8_t* message,
+             size_t length) override;
+  void OnTick(int64_t now_us) override;
+
+ private:
+  LoopbackPlayer(const LoopbackPlayer&);
+  LoopbackPlayer& operator=(const LoopbackPlayer&);
+
+  V2TXLivePlayerDelegate* const delegate_;
+  LoopbackServer& server_;
+  bool playing_;
+
+  // 播放期间只读
+  std::string remote_user_id_;
+  PlayerOption option_;
+
+  // 以下在工作线程上访问
+  std::unique_ptr<LoopbackAudioOutput> audio_output_;
+  AudioFrame audio_;
+  liteav::live::AudioFrame live_audio_;
+  liteav::live::VideoFrame live_video_;
+  liteav::live::PixelFrame live_pixel_;
+  int64_t next_report_us_;
+};
+
+LoopbackPlayer::LoopbackPlayer(V2TXLivePlayerDelegate* delegate)
+    : delegate_(delegate),
+      server_(LoopbackServer::Instance()),
+      playing_(false),
+      next_report_us_(0) {}
+
+LoopbackPlayer::~LoopbackPlayer() {
+  StopPlay();
+}
+
+int LoopbackPlayer::StartPlay(const char* url, const PlayerOption& option) {
+  if (playing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  std::string room;
+  std::string remote_user_id;
+  if (!ParseLoopbackUrl(url, "remoteuserid", &room, &remote_user_id) ||
+      (option.audio_samplerate != 16000 && option.audio_samplerate != 48000) ||
+      (option.audio_channels != 1 && option.audio_channels != 2) ||
+      (option.video_type != 1 && option.video_type != 2)) {
+    return liteav::live::ERR_INVALID_PARAMETER;
+  }
+  playing_ = true;
+  remote_user_id_ = remote_user_id;
+  option_ = option;
+  audio_output_.reset(new LoopbackAudioOutput(option.audio_samplerate, option.audio_channels, 20));
+  next_report_us_ = 0;
+  SetIdentity(std::string(), option.video_type == 1 ? kVideoEncoded : kVideoPixel);
+  server_.Join(room, this);
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPlayer::StopPlay() {
+  if (playing_) {
+    server_.Leave(this, false);
+    playing_ = false;
+  }
+  return liteav::live::ERR_OK;
+}
+
+void LoopbackPlayer::OnAudio(const std::string& user_id, const AudioFrame& frame) {
+  if (user_id != remote_user_id_ || !audio_output_->Push(frame)) {
+    return;
+  }
+  while (audio_output_->Pop(&audio_)) {
+    live_audio_.SetData(audio_.data(), audio_.size());
+    live_audio_.sample_rate = audio_.sample_rate;
+    live_audio_.channels = audio_.channels;
+    live_audio_.bits_per_sample = audio_.bits_per_sample;
+    live_audio_.codec = liteav::live::AUDIO_CODEC_TYPE_PCM;
+    live_audio_.pts = audio_.pts;
+    delegate_->OnRemoteAudioReceived(live_audio_);
+  }
+}
+
+void LoopbackPlayer::OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) {
+  if (user_id != remote_user_id_ || type != liteav::trtc::STREAM_TYPE_VIDEO_HIGH) {
+    return;
+  }
+  live_video_.SetData(frame.data(), frame.size());
+  live_video_.pts = frame.pts;
+  live_video_.dts = frame.dts;
+  live_video_.is_key_frame = frame.is_key_frame;
+  live_video_.codec = static_cast<liteav::live::VideoCodecType>(frame.codec);
+  live_video_.rotation = static_cast<liteav::live::VideoRotation>(frame.rotation);
+  delegate_->OnRemoteVideoReceived(live_video_);
+}
+
+void LoopbackPlayer::OnPixel(const std::string& user_id, StreamType type, const PixelFrame& frame) {
+  if (user_id != remote_user_id_ || type != liteav::trtc::STREAM_TYPE_VIDEO_HIGH) {
+    return;
+  }
+  live_pixel_.SetData(frame.data(), frame.size());
+  live_pixel_.pts = frame.pts;
+  live_pixel_.width = frame.width;
+  live_pixel_.height = frame.height;
+  live_pixel_.format = liteav::live::VIDEO_PIXEL_FORMAT_YUV420p;
+  live_pixel_.rotation = static_cast<liteav::live::VideoRotation>(frame.rotation);
+  delegate_->OnRemoteVideoReceived(live_pixel_);
+}
+
+void LoopbackPlayer::OnSei(const std::string& user_id,
+                           StreamType type,
+                           int message_type,
+                           const uint8_t* message,
+                           size_t length) {
+  if (user_id == remote_user_id_) {
+    delegate_->OnSeiMessageReceived(message_type, message, length);
+  }
+}
+
+void LoopbackPlayer::OnTick(int64_t now_us) {
+  if (now_us >= next_report_us_) {
+    next_report_us_ = now_us + kReportIntervalUs;
+    delegate_->OnNetworkQuality(liteav::live::NETWORK_QUALITY_EXCELLENT);
+  }
+}
+
+class LoopbackPusher : public V2TXLivePusher, public LoopbackEndpoint {
+ public:
+  explicit LoopbackPusher(V2TXLivePusherDelegate* delegate);
+  ~LoopbackPusher();
+
+  // V2TXLivePusher
+  int StartPush(const char* url, const PushOption& option) override;
+  int StopPush() override;
+  bool IsPushing() override { return pushing_; }
+  int SendAudioFrame(const liteav::live::AudioFrame& frame) override;
+  int SendVideoFrame(const liteav::live::VideoFrame& frame) override;
+  int SendVideoFrame(const liteav::live::PixelFrame& frame) override;
+  int SendSeiMessage(int message_type, const uint8_t* message, size_t size) override;
+
+  // LoopbackEndpoint
+  void OnTick(int64_t now_us) override;
+
+ private:
+  LoopbackPusher(const LoopbackPusher&);
+  LoopbackPusher& operator=(const LoopbackPusher&);
+
+  V2TXLivePusherDelegate* const delegate_;
+  LoopbackServer& server_;
+  bool pushing_;
+  PushOption option_;
+  LoopbackSeiLimiter sei_limiter_;
+  AudioFrame audio_;
+  VideoFrame video_;
+  PixelFrame pixel_;
+  // 调用线程计数，工作线程按周期读取
+  std::atomic<uint32_t> video_frames_;
+
+  // 以下在工作线程上访问
+  int64_t next_report_us_;
+  uint32_t reported_frames_;
+};
+
+LoopbackPusher::LoopbackPusher(V2TXLivePusherDelegate* delegate)
+    : delegate_(delegate),
+      server_(LoopbackServer::Instance()),
+      pushing_(false),
+      video_frames_(0),
+      next_report_us_(0),
+      reported_frames_(0) {}
+
+LoopbackPusher::~LoopbackPusher() {
+  StopPush();
+}
+
+int LoopbackPusher::StartPush(const char* url, const PushOption& option) {
+  if (pushing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  std::string room;
+  std::string user_id;
+  if (!ParseLoopbackUrl(url, "userid", &room, &user_id) ||
+      (option.video_type != 1 && option.video_type != 2)) {
+    return liteav::live::ERR_INVALID_PARAMETER;
+  }
+  pushing_ = true;
+  option_ = option;
+  next_report_us_ = 0;
+  reported_frames_ = video_frames_.load(std::memory_order_relaxed);
+  SetIdentity(user_id, kVideoEncoded);
+  server_.Join(room, this);
+  server_.Publish(this, liteav::trtc::STREAM_TYPE_AUDIO, true);
+  server_.Publish(this, liteav::trtc::STREAM_TYPE_VIDEO_HIGH, true);
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPusher::StopPush() {
+  if (pushing_) {
+    server_.Leave(this, false);
+    pushing_ = false;
+  }
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPusher::SendAudioFrame(const liteav::live::AudioFrame& frame) {
+  if (!pushing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  if (frame.codec != liteav::live::AUDIO_CODEC_TYPE_PCM || frame.bits_per_sample != 16 ||
+      (frame.sample_rate != 16000 && frame.sample_rate != 48000) ||
+      (frame.channels != 1 && frame.channels != 2) ||
+      frame.size() != static_cast<size_t>(frame.sample_rate / 50 * frame.channels) * 2) {
+    return liteav::live::ERR_INVALID_PARAMETER;
+  }
+  audio_.SetData(frame.data(), frame.size());
+  audio_.sample_rate = frame.sample_rate;
+  audio_.channels = frame.channels;
+  audio_.bits_per_sample = 16;
+  audio_.codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+  audio_.pts = frame.pts;
+  server_.CountSent();
+  server_.SendAudio(this, audio_);
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPusher::SendVideoFrame(const liteav::live::VideoFrame& frame) {
+  if (!pushing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  if (option_.video_type != 1 || frame.size() == 0) {
+    return liteav::live::ERR_INVALID_PARAMETER;
+  }
+  video_.SetData(frame.data(), frame.size());
+  video_.pts = frame.pts;
+  video_.dts = frame.dts;
+  video_.is_key_frame = frame.is_key_frame;
+  video_.codec = static_cast<liteav::trtc::VideoCodecType>(frame.codec);
+  video_.rotation = static_cast<liteav::trtc::VideoRotation>(frame.rotation);
+  video_frames_.fetch_add(1, std::memory_order_relaxed);
+  server_.CountSent();
+  server_.SendVideo(this, liteav::trtc::STREAM_TYPE_VIDEO_HIGH, video_);
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPusher::SendVideoFrame(const liteav::live::PixelFrame& frame) {
+  if (!pushing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  if (option_.video_type != 2 || frame.width == 0 || frame.height == 0 ||
+      frame.size() < static_cast<size_t>(frame.width) * frame.height * 3 / 2) {
+    return liteav::live::ERR_INVALID_PARAMETER;
+  }
+  pixel_.SetData(frame.data(), frame.size());
+  pixel_.pts = frame.pts;
+  pixel_.width = frame.width;
+  pixel_.height = frame.height;
+  pixel_.format = liteav::trtc::VIDEO_PIXEL_FORMAT_YUV420p;
+  pixel_.rotation = static_cast<liteav::trtc::VideoRotation>(frame.rotation);
+  video_frames_.fetch_add(1, std::memory_order_relaxed);
+  server_.CountSent();
+  server_.SendPixel(this, liteav::trtc::STREAM_TYPE_VIDEO_HIGH, pixel_);
+  return liteav::live::ERR_OK;
+}
+
+int LoopbackPusher::SendSeiMessage(int message_type, const uint8_t* message, size_t size) {
+  if (!pushing_) {
+    return liteav::live::ERR_INVALID_OPERATION;
+  }
+  int result = sei_limiter_.Check(message_type, message, size);
+  if (result != liteav::trtc::ERR_OK) {
+    return result;
+  }
+  server_.SendSei(this, liteav::trtc::STREAM_TYPE_VIDEO_HIGH, message_type, message, size);
+  return liteav::live::ERR_OK;
+}
+
+void LoopbackPusher::OnTick(int64_t now_us) {
+  if (next_report_us_ == 0) {
+    next_report_us_ = now_us + kReportIntervalUs;
+    return;
+  }
+  if (now_us < next_report_us_) {
+    return;
+  }
+  uint32_t frames = video_frames_.load(std::memory_order_relaxed);
+  LivePusherStatistics stats;
+  stats.video_frame_rate_sent = (frames - reported_frames_) * 1000000 /
+                                static_cast<uint32_t>(kReportIntervalUs + now_us - next_report_us_);
+  stats.video_frame_rate_received = stats.video_frame_rate_sent;
+  reported_frames_ = frames;
+  next_report_us_ = now_us + kReportIntervalUs;
+  delegate_->OnNetworkQuality(liteav::live::NETWORK_QUALITY_EXCELLENT);
+  delegate_->OnStatisticsUpdate(stats);
+}
+
+}  // namespace
+
+}  // namespace swing
+
+namespace liteav {
+namespace live {
+
+V2TXLivePlayer* V2TXLivePlayer::Create(V2TXLivePlayerDelegate* delegate) {
+  if (delegate == nullptr) {
+    return nullptr;
+  }
+  return new swing::LoopbackPlayer(delegate);
+}
+
+void V2TXLivePlayer::Destroy(V2TXLivePlayer* player) {
+  delete player;
+}
+
+V2TXLivePusher* V2TXLivePusher::Create(V2TXLivePusherDelegate* delegate) {
+  if (delegate == nullptr) {
+    return nullptr;
+  }
+  return new swing::LoopbackPusher(delegate);
+}
+
+void V2TXLivePusher::Destroy(V2TXLivePusher* pusher) {
+  delete pusher;
+}
+
+}  // namespace live
+}  // namespace liteav
@@ -0,0 +1,404 @@
+//go:build loopback
+
+// 回环后端：Room 与 Recorder
+// Recorder 不封装文件，只按 RecordParams 统计会被录制的数据量，
+// 按进度、分片回调，结束时给出按命名规则生成的文件路径。
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_recorder.h"
+#include "loopback_server.h"
+
+namespace swing {
+
+namespace {
+
+using liteav::trtc::LayoutParams;
+using liteav::trtc::RecordDelegate;
+using liteav::trtc::RecordParams;
+using liteav::trtc::Recorder;
+using liteav::trtc::Room;
+using liteav::trtc::RoomDelegate;
+using liteav::trtc::RoomParams;
+using liteav::trtc::TrtcString;
+using liteav::trtc::WatermarkConfig;
+
+const int64_t kProgressIntervalUs = 1000000;
+
+int64_t WallClockMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+class LoopbackRecorder;
+
+class LoopbackRoom : public Room, public LoopbackEndpoint {
+ public:
+  LoopbackRoom(const RoomParams& params, RoomDelegate* delegate);
+  ~LoopbackRoom();
+
+  // Room
+  void EnterRoom() override;
+  void ExitRoom() override;
+  const RoomParams& GetRoomParams() override { return params_; }
+
+  // LoopbackEndpoint
+  void OnJoined() override;
+  void OnLeft() override;
+  void OnUserEnter(const std::string& user_id) override;
+  void OnUserExit(const std::string& user_id) override;
+  void OnStreamAvailable(const std::string& user_id, StreamType type, bool available) override;
+  void OnAudio(const std::string& user_id, const AudioFrame& frame) override;
+  void OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) override;
+  void OnTick(int64_t now_us) override;
+
+  // 以下在工作线程上调用
+  void Attach(LoopbackRecorder* recorder);
+  void Detach(LoopbackRecorder* recorder);
+  bool joined() const { return joined_; }
+
+  const std::string& key() const { return key_; }
+  const std::string& room_id() const { return room_id_; }
+
+ private:
+  LoopbackRoom(const LoopbackRoom&);
+  LoopbackRoom& operator=(const LoopbackRoom&);
+
+  RoomDelegate* const delegate_;
+  LoopbackServer& server_;
+  const RoomParams params_;
+  std::string room_id_;
+  std::string key_;
+  bool entered_;
+
+  // 以下在工作线程上访问
+  bool joined_;
+  std::vector<LoopbackRecorder*> recorders_;
+};
+
+class LoopbackRecorder : public Recorder {
+ public:
+  LoopbackRecorder(LoopbackRoom* room, RecordDelegate* delegate);
+  ~LoopbackRecorder();
+
+  // Recorder
+  void Start(const RecordParams& params) override;
+  void Stop() override;
+  void UpdateLayout(const LayoutParams layouts[], size_t layouts_count) override;
+  void UpdateWatermark(const WatermarkConfig watermarks[], size_t watermark_count) override;
+  const RecordParams& GetRecordParams() override { return params_; }
+
+  // 以下在工作线程上调用
+  void OnAudio(const std::string& user_id, const AudioFrame& frame);
+  void OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame);
+  void OnTick(int64_t now_us);
+  void OnRoomLeft();
+
+ private:
+  LoopbackRecorder(const LoopbackRecorder&);
+  LoopbackRecorder& operator=(const LoopbackRecorder&);
+
+  bool Records(const std::string& user_id) const;
+  void Finish();
+
+  LoopbackRoom* const room_;
+  RecordDelegate* const delegate_;
+  LoopbackServer& server_;
+
+  // 以下在调用线程上访问，录制期间 |params_| 只读
+  bool started_;
+  RecordParams params_;
+  std::vector<LayoutParams> layouts_;
+  std::vector<WatermarkConfig> watermarks_;
+
+  // 以下在工作线程上访问
+  bool recording_;
+  // 音视频录制从第一帧视频开始
+  bool has_video_;
+  int64_t bytes_;
+  int64_t segment_start_us_;
+  int64_t segment_start_ms_;
+  int64_t next_progress_us_;
+};
+
+LoopbackRoom::LoopbackRoom(const RoomParams& params, RoomDelegate* delegate)
+    : delegate_(delegate),
+      server_(LoopbackServer::Instance()),
+      params_(params),
+      entered_(false),
+      joined_(false) {
+  room_id_ = params.str_room_id.GetValue();
+  if (room_id_.empty() && params.room_id != 0) {
+    room_id_ = std::to_string(params.room_id);
+  }
+  key_ = LoopbackRoomKey(params.sdk_app_id, room_id_);
+}
+
+LoopbackRoom::~LoopbackRoom() {
+  if (entered_) {
+    server_.Leave(this, false);
+  }
+  server_.Invoke(key_, [this]() {
+    joined_ = false;
+    recorders_.clear();
+  });
+}
+
+void LoopbackRoom::EnterRoom() {
+  if (entered_) {
+    return;
+  }
+  liteav::trtc::Error error = liteav::trtc::ERR_OK;
+  if (params_.sdk_app_id == 0) {
+    error = liteav::trtc::ERR_INVALID_SDK_APP_ID;
+  } else if (room_id_.empty()) {
+    error = liteav::trtc::ERR_INVALID_ROOM_ID;
+  }
+  if (error != liteav::trtc::ERR_OK) {
+    server_.Post(key_, [this, error]() { delegate_->OnRoomError(this, error); });
+    return;
+  }
+  entered_ = true;
+  // 旁观者，不出现在其他成员的用户列表中
+  SetIdentity(std::string(), kVideoEncoded);
+  server_.Join(key_, this);
+}
+
+void LoopbackRoom::ExitRoom() {
+  if (!entered_) {
+    return;
+  }
+  entered_ = false;
+  server_.Leave(this, true);
+}
+
+void LoopbackRoom::OnJoined() {
+  joined_ = true;
+  delegate_->OnEnterRoom(this);
+}
+
+void LoopbackRoom::OnLeft() {
+  joined_ = false;
+  for (size_t i = 0; i < recorders_.size(); ++i) {
+    recorders_[i]->OnRoomLeft();
+  }
+  delegate_->OnExitRoom(this);
+}
+
+void LoopbackRoom::OnUserEnter(const std::string& user_id) {
+  delegate_->OnRemoteUserEnterRoom(this, TrtcString(user_id.c_str()));
+}
+
+void LoopbackRoom::OnUserExit(const std::string& user_id) {
+  delegate_->OnRemoteUserLeaveRoom(this, TrtcString(user_id.c_str()));
+}
+
+void LoopbackRoom::OnStreamAvailable(const std::string& user_id, StreamType type, bool available) {
+  delegate_->OnRemoteStreamAvailable(this, TrtcString(user_id.c_str()), type, available);
+}
+
+void LoopbackRoom::OnAudio(const std::string& user_id, const AudioFrame& frame) {
+  for (size_t i = 0; i < recorders_.size(); ++i) {
+    recorders_[i]->OnAudio(user_id, frame);
+  }
+}
+
+void LoopbackRoom::OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) {
+  for (size_t i = 0; i < recorders_.size(); ++i) {
+    recorders_[i]->OnVideo(user_id, type, frame);
+  }
+}
+
+void LoopbackRoom::OnTick(int64_t now_us) {
+  for (size_t i = 0; i < recorders_.size(); ++i) {
+    recorders_[i]->OnTick(now_us);
+  }
+}
+
+void LoopbackRoom::Attach(LoopbackRecorder* recorder) {
+  recorders_.push_back(recorder);
+}
+
+void LoopbackRoom::Detach(LoopbackRecorder* recorder) {
+  recorders_.erase(std::remove(recorders_.begin(), recorders_.end(), recorder), recorders_.end());
+}
+
+LoopbackRecorder::LoopbackRecorder(LoopbackRoom* room, RecordDelegate* delegate)
+    : room_(room),
+      delegate_(delegate),
+      server_(LoopbackServer::Instance()),
+      started_(false),
+      recording_(false),
+      has_video_(false),
+      bytes_(0),
+      segment_start_us_(0),
+      segment_start_ms_(0),
+      next_progress_us_(0) {
+  server_.Invoke(room_->key(), [this]() { room_->Attach(this); });
+}
+
+LoopbackRecorder::~LoopbackRecorder() {
+  server_.Invoke(room_->key(), [this]() { room_->Detach(this); });
+}
+
+void LoopbackRecorder::Start(const RecordParams& params) {
+  if (started_) {
+    return;
+  }
+  started_ = true;
+  params_ = params;
+  server_.Post(room_->key(), [this]() {
+    if (!room_->joined()) {
+      delegate_->OnRecordError(this, liteav::trtc::kErrorNotFoundRoom);
+      return;
+    }
+    recording_ = true;
+    has_video_ = false;
+    bytes_ = 0;
+    segment_start_us_ = LoopbackServer::NowUs();
+    segment_start_ms_ = WallClockMs();
+    next_progress_us_ = segment_start_us_ + kProgressIntervalUs;
+    delegate_->OnRecordStarted(this);
+  });
+}
+
+void LoopbackRecorder::Stop() {
+  if (!started_) {
+    return;
+  }
+  started_ = false;
+  server_.Post(room_->key(), [this]() {
+    if (recording_) {
+      Finish();
+      recording_ = false;
+    }
+  });
+}
+
+void LoopbackRecorder::UpdateLayout(const LayoutParams layouts[], size_t layouts_count) {
+  layouts_.assign(layouts, layouts + layouts_count);
+}
+
+void LoopbackRecorder::UpdateWatermark(const WatermarkConfig watermarks[], size_t watermark_count) {
+  watermarks_.assign(watermarks, watermarks + watermark_count);
+}
+
+bool LoopbackRecorder::Records(const std::string& user_id) const {
+  return params_.record_mode == liteav::trtc::kRecordMultiStreams ||
+         user_id == params_.single_record_params.user_id.GetValue();
+}
+
+void LoopbackRecorder::OnAudio(const std::string& user_id, const AudioFrame& frame) {
+  if (!recording_ || params_.record_type == liteav::trtc::kVideoOnly || !Records(user_id)) {
+    return;
+  }
+  if (params_.record_type == liteav::trtc::kAudioAndVideo && !has_video_) {
+    return;
+  }
+  bytes_ += static_cast<int64_t>(frame.size());
+}
+
+void LoopbackRecorder::OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) {
+  if (!recording_ || params_.record_type == liteav::trtc::kAudioOnly || !Records(user_id)) {
+    return;
+  }
+  if (params_.record_mode == liteav::trtc::kRecordSingleStream &&
+      type != params_.single_record_params.stream_type) {
+    return;
+  }
+  has_video_ = true;
+  bytes_ += static_cast<int64_t>(frame.size());
+}
+
+void LoopbackRecorder::OnTick(int64_t now_us) {
+  if (!recording_) {
+    return;
+  }
+  if (now_us >= next_progress_us_) {
+    next_progress_us_ += kProgressIntervalUs;
+    delegate_->OnRecordProgress(this, static_cast<int>(std::min<int64_t>(bytes_, INT32_MAX)));
+  }
+  int64_t segment_us = static_cast<int64_t>(params_.segment_duration_in_seconds) * 1000000;
+  if (segment_us > 0 && now_us - segment_start_us_ >= segment_us) {
+    Finish();
+    bytes_ = 0;
+    segment_start_us_ = now_us;
+    segment_start_ms_ = WallClockMs();
+  }
+}
+
+void LoopbackRecorder::OnRoomLeft() {
+  if (recording_) {
+    Finish();
+    recording_ = false;
+  }
+}
+
+// out_${record_mode}_${sdk_app_id}_${room_id}_${remote_user_id}_f_${start_ts}_e_${stop_ts}.${file_format}
+void LoopbackRecorder::Finish() {
+  std::string path = params_.storage_directory.GetValue();
+  if (path.empty()) {
+    path = ".";
+  }
+  const char* mode = params_.record_type == liteav::trtc::kAudioOnly
+                         ? "audio"
+                         : (params_.record_type == liteav::trtc::kVideoOnly ? "video" : "av");
+  const char* extension = params_.file_format == liteav::trtc::kMp4
+                              ? "mp4"
+                              : (params_.file_format == liteav::trtc::kMp3 ? "mp3" : "flv");
+  std::string user_id = params_.record_mode == liteav::trtc::kRecordMultiStreams
+                            ? std::string("mixed")
+                            : std::string(params_.single_record_params.user_id.GetValue());
+  path.append("/out_")
+      .append(mode)
+      .append("_")
+      .append(std::to_string(room_->GetRoomParams().sdk_app_id))
+      .append("_")
+      .append(room_->room_id())
+      .append("_")
+      .append(user_id)
+      .append("_f_")
+      .append(std::to_string(segment_start_ms_))
+      .append("_e_")
+      .append(std::to_string(WallClockMs()))
+      .append(".")
+      .append(extension);
+  delegate_->OnRecordFinished(this, TrtcString(path.c_str()));
+}
+
+}  // namespace
+
+}  // namespace swing
+
+namespace liteav {
+namespace trtc {
+
+Room* Room::Create(const RoomParams& params, RoomDelegate* delegate) {
+  if (delegate == nullptr) {
+    return nullptr;
+  }
+  return new swing::LoopbackRoom(params, delegate);
+}
+
+void Room::Destroy(Room* room) {
+  delete room;
+}
+
+Recorder* Recorder::Create(Room* room, RecordDelegate* delegate) {
+  if (room == nullptr || delegate == nullptr) {
+    return nullptr;
+  }
+  // 本构建中所有 Room 都由 Room::Create() 创建
+  return new swing::LoopbackRecorder(static_cast<swing::LoopbackRoom*>(room), delegate);
+}
+
+void Recorder::Destroy(Recorder* recorder) {
+  delete recorder;
+}
+
+}  // namespace trtc
+}  // namespace liteav
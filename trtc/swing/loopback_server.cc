@@ -0,0 +1,1206 @@
+//go:build loopback
+
+#include "loopback_server.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <thread>
+
+namespace swing {
+
+namespace {
+
+const int64_t kTickIntervalUs = 100000;
+// 落后超过该值时放弃补发，直接跳到当前时间
+const int64_t kMaxCatchUpUs = 1000000;
+const int kMaxWorkerThreads = 64;
+
+uint32_t HashString(const std::string& value) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < value.size(); ++i) {
+    hash = (hash ^ static_cast<uint8_t>(value[i])) * 16777619u;
+  }
+  return hash;
+}
+
+void UpdateMax(std::atomic<uint64_t>* target, uint64_t value) {
+  uint64_t current = target->load(std::memory_order_relaxed);
+  while (value > current &&
+         !target->compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+bool IsVideoType(StreamType type) {
+  return type == liteav::trtc::STREAM_TYPE_VIDEO_HIGH ||
+         type == liteav::trtc::STREAM_TYPE_VIDEO_LOW ||
+         type == liteav::trtc::STREAM_TYPE_VIDEO_AUX;
+}
+
+// H264 RBSP 位写入
+class BitWriter {
+ public:
+  BitWriter() : bits_(0) {}
+
+  void Bits(uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; --i) {
+      if (bits_ % 8 == 0) {
+        bytes_.push_back(0);
+      }
+      if ((value >> i) & 1) {
+        bytes_.back() |= static_cast<uint8_t>(0x80 >> (bits_ % 8));
+      }
+      ++bits_;
+    }
+  }
+
+  void UE(uint32_t value) {
+    uint32_t coded = value + 1;
+    int length = 0;
+    while ((coded >> length) > 1) {
+      ++length;
+    }
+    Bits(0, length);
+    Bits(coded, length + 1);
+  }
+
+  void SE(int32_t value) { UE(value > 0 ? 2 * value - 1 : -2 * value); }
+
+  // rbsp_trailing_bits
+  void Finish() {
+    Bits(1, 1);
+    while (bits_ % 8 != 0) {
+      Bits(0, 1);
+    }
+  }
+
+  const std::vector<uint8_t>& bytes() const { return bytes_; }
+
+ private:
+  std::vector<uint8_t> bytes_;
+  size_t bits_;
+};
+
+// 追加一个带起始码的 NAL，插入防竞争字节
+void AppendNal(uint8_t header, const std::vector<uint8_t>& rbsp, std::vector<uint8_t>* out) {
+  static const uint8_t kStartCode[] = {0, 0, 0, 1};
+  out->insert(out->end(), kStartCode, kStartCode + sizeof(kStartCode));
+  out->push_back(header);
+  int zeros = 0;
+  for (size_t i = 0; i < rbsp.size(); ++i) {
+    if (zeros == 2 && rbsp[i] <= 3) {
+      out->push_back(3);
+      zeros = 0;
+    }
+    out->push_back(rbsp[i]);
+    zeros = rbsp[i] == 0 ? zeros + 1 : 0;
+  }
+}
+
+// Baseline profile 的 SPS 和 PPS
+void BuildParameterSets(int width, int height, std::vector<uint8_t>* out) {
+  int mbs_width = (width + 15) / 16;
+  int mbs_height = (height + 15) / 16;
+  int mbs = mbs_width * mbs_height;
+  uint32_t level = mbs <= 3600 ? 31 : (mbs <= 8192 ? 40 : 51);
+
+  BitWriter sps;
+  sps.Bits(66, 8);    // profile_idc
+  sps.Bits(0xC0, 8);  // constraint_set0_flag, constraint_set1_flag
+  sps.Bits(level, 8);
+  sps.UE(0);  // seq_parameter_set_id
+  sps.UE(0);  // log2_max_frame_num_minus4
+  sps.UE(2);  // pic_order_cnt_type
+  sps.UE(1);  // max_num_ref_frames
+  sps.Bits(0, 1);
+  sps.UE(static_cast<uint32_t>(mbs_width - 1));
+  sps.UE(static_cast<uint32_t>(mbs_height - 1));
+  sps.Bits(1, 1);  // frame_mbs_only_flag
+  sps.Bits(1, 1);  // direct_8x8_inference_flag
+  int crop_right = (mbs_width * 16 - width) / 2;
+  int crop_bottom = (mbs_height * 16 - height) / 2;
+  if (crop_right != 0 || crop_bottom != 0) {
+    sps.Bits(1, 1);
+    sps.UE(0);
+    sps.UE(static_cast<uint32_t>(crop_right));
+    sps.UE(0);
+    sps.UE(static_cast<uint32_t>(crop_bottom));
+  } else {
+    sps.Bits(0, 1);
+  }
+  sps.Bits(0, 1);  // vui_parameters_present_flag
+  sps.Finish();
+  AppendNal(0x67, sps.bytes(), out);
+
+  BitWriter pps;
+  pps.UE(0);  // pic_parameter_set_id
+  pps.UE(0);  // seq_parameter_set_id
+  pps.Bits(0, 1);
+  pps.Bits(0, 1);
+  pps.UE(0);  // num_slice_groups_minus1
+  pps.UE(0);
+  pps.UE(0);
+  pps.Bits(0, 1);
+  pps.Bits(0, 2);
+  pps.SE(0);  // pic_init_qp_minus26
+  pps.SE(0);
+  pps.SE(0);
+  pps.Bits(1, 1);  // deblocking_filter_control_present_flag
+  pps.Bits(0, 1);
+  pps.Bits(0, 1);
+  pps.Finish();
+  AppendNal(0x68, pps.bytes(), out);
+}
+
+}  // namespace
+
+LoopbackEndpoint::LoopbackEndpoint() : video_output_(kVideoEncoded), worker_(0) {}
+
+void LoopbackEndpoint::SetIdentity(const std::string& user_id, VideoOutput video_output) {
+  user_id_ = user_id;
+  video_output_ = video_output;
+}
+
+struct LoopbackServer::Entry {
+  LoopbackEndpoint* endpoint;
+  // 已发布的流，按 StreamType 取位
+  uint32_t published;
+  bool active;
+};
+
+struct LoopbackServer::Synthetic {
+  std::string user_id;
+  LoopbackUserConfig config;
+  bool active;
+  int64_t start_us;
+  uint32_t start_ms;
+
+  // 音频：一个周期的单声道正弦波，循环输出
+  std::vector<int16_t> tone;
+  size_t tone_position;
+  uint64_t audio_count;
+  int64_t audio_due_us;
+  std::vector<int16_t> samples;
+  AudioFrame audio;
+
+  // 视频
+  uint64_t video_count;
+  int64_t video_due_us;
+  std::vector<uint8_t> parameter_sets;
+  std::vector<uint8_t> noise;
+  std::vector<uint8_t> nal;
+  std::vector<uint8_t> pixels;
+  int bar_x;
+  VideoFrame encoded;
+  PixelFrame pixel;
+
+  uint64_t sei_count;
+  int64_t sei_due_us;
+};
+
+struct LoopbackServer::Room {
+  std::vector<Entry> entries;
+  std::vector<std::unique_ptr<Synthetic> > synthetic;
+};
+
+struct LoopbackServer::Worker {
+  Worker() : next_tick_us(0) {}
+
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::function<void()> > tasks;
+
+  // 以下仅在工作线程上访问
+  std::map<std::string, std::unique_ptr<Room> > rooms;
+  int64_t next_tick_us;
+};
+
+LoopbackServer& LoopbackServer::Instance() {
+  // 不析构，工作线程随进程退出
+  static LoopbackServer* server = new LoopbackServer();
+  return *server;
+}
+
+LoopbackServer::LoopbackServer()
+    : worker_count_(1),
+      started_(false),
+      audio_frames_generated_(0),
+      video_frames_generated_(0),
+      sei_messages_generated_(0),
+      frames_sent_(0),
+      callbacks_(0),
+      callback_ns_total_(0),
+      callback_ns_max_(0),
+      late_ticks_(0),
+      max_lag_us_(0) {}
+
+LoopbackServer::~LoopbackServer() {}
+
+int64_t LoopbackServer::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int LoopbackServer::SetWorkerThreads(int count) {
+  if (count < 1 || count > kMaxWorkerThreads) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_.load(std::memory_order_acquire)) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  worker_count_ = count;
+  return liteav::trtc::ERR_OK;
+}
+
+void LoopbackServer::Start() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (started_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  for (int i = 0; i < worker_count_; ++i) {
+    workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    Worker* worker = workers_[i].get();
+    worker->thread = std::thread([this, worker]() { Run(worker); });
+  }
+  started_.store(true, std::memory_order_release);
+}
+
+LoopbackServer::Worker* LoopbackServer::WorkerFor(const std::string& room) {
+  if (!started_.load(std::memory_order_acquire)) {
+    Start();
+  }
+  return workers_[HashString(room) % workers_.size()].get();
+}
+
+void LoopbackServer::Post(const std::string& room, const std::function<void()>& task) {
+  Worker* worker = WorkerFor(room);
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->tasks.push_back(task);
+  }
+  worker->cv.notify_one();
+}
+
+void LoopbackServer::Invoke(const std::string& room, const std::function<void()>& task) {
+  Worker* worker = WorkerFor(room);
+  if (worker->thread.get_id() == std::this_thread::get_id()) {
+    task();
+    return;
+  }
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  Post(room, [&]() {
+    task();
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    cv.notify_one();
+  });
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&]() { return done; });
+}
+
+LoopbackServer::Room* LoopbackServer::FindRoom(Worker* worker, const std::string& room, bool create) {
+  std::map<std::string, std::unique_ptr<Room> >::iterator it = worker->rooms.find(room);
+  if (it != worker->rooms.end()) {
+    return it->second.get();
+  }
+  if (!create) {
+    return nullptr;
+  }
+  Room* result = new Room();
+  worker->rooms[room] = std::unique_ptr<Room>(result);
+  return result;
+}
+
+LoopbackServer::Entry* LoopbackServer::FindEntry(Room* room, const LoopbackEndpoint* endpoint) {
+  for (size_t i = 0; i < room->entries.size(); ++i) {
+    if (room->entries[i].active && room->entries[i].endpoint == endpoint) {
+      return &room->entries[i];
+    }
+  }
+  return nullptr;
+}
+
+void LoopbackServer::NotifyUser(Room* room,
+                                const LoopbackEndpoint* except,
+                                const std::string& user_id,
+                                bool enter) {
+  for (size_t i = 0; i < room->entries.size(); ++i) {
+    Entry& entry = room->entries[i];
+    if (!entry.active || entry.endpoint == except) {
+      continue;
+    }
+    if (enter) {
+      entry.endpoint->OnUserEnter(user_id);
+    } else {
+      entry.endpoint->OnUserExit(user_id);
+    }
+  }
+}
+
+void LoopbackServer::NotifyStream(Room* room,
+                                  const LoopbackEndpoint* except,
+                                  const std::string& user_id,
+                                  StreamType type,
+                                  bool available) {
+  for (size_t i = 0; i < room->entries.size(); ++i) {
+    Entry& entry = room->entries[i];
+    if (entry.active && entry.endpoint != except) {
+      entry.endpoint->OnStreamAvailable(user_id, type, available);
+    }
+  }
+}
+
+void LoopbackServer::Join(const std::string& room, LoopbackEndpoint* endpoint) {
+  Worker* worker = WorkerFor(room);
+  endpoint->room_ = room;
+  endpoint->worker_ = static_cast<size_t>(HashString(room) % workers_.size());
+  Post(room, [this, worker, endpoint]() { DoJoin(worker, endpoint); });
+}
+
+void LoopbackServer::DoJoin(Worker* worker, LoopbackEndpoint* endpoint) {
+  Room* room = FindRoom(worker, endpoint->room_, true);
+  if (FindEntry(room, endpoint) != nullptr) {
+    return;
+  }
+  Entry joined = {endpoint, 0, true};
+  room->entries.push_back(joined);
+  endpoint->OnJoined();
+
+  for (size_t i = 0; i + 1 < room->entries.size(); ++i) {
+    Entry& entry = room->entries[i];
+    if (!entry.active || entry.endpoint->user_id().empty()) {
+      continue;
+    }
+    endpoint->OnUserEnter(entry.endpoint->user_id());
+    for (int type = 0; type < 32; ++type) {
+      if (entry.published & (1u << type)) {
+        endpoint->OnStreamAvailable(entry.endpoint->user_id(), static_cast<StreamType>(type), true);
+      }
+    }
+  }
+  for (size_t i = 0; i < room->synthetic.size(); ++i) {
+    Synthetic* user = room->synthetic[i].get();
+    if (!user->active) {
+      continue;
+    }
+    endpoint->OnUserEnter(user->user_id);
+    if (user->config.audio) {
+      endpoint->OnStreamAvailable(user->user_id, liteav::trtc::STREAM_TYPE_AUDIO, true);
+    }
+    if (user->config.video) {
+      endpoint->OnStreamAvailable(user->user_id, user->config.video_type, true);
+    }
+  }
+
+  if (!endpoint->user_id().empty()) {
+    NotifyUser(room, endpoint, endpoint->user_id(), true);
+  }
+}
+
+void LoopbackServer::Leave(LoopbackEndpoint* endpoint, bool notify) {
+  if (endpoint->room_.empty()) {
+    return;
+  }
+  Worker* worker = WorkerFor(endpoint->room_);
+  std::function<void()> task = [this, worker, endpoint, notify]() {
+    DoLeave(worker, endpoint, notify);
+  };
+  if (notify) {
+    Post(endpoint->room_, task);
+  } else {
+    Invoke(endpoint->room_, task);
+  }
+}
+
+void LoopbackServer::DoLeave(Worker* worker, LoopbackEndpoint* endpoint, bool notify) {
+  Room* room = FindRoom(worker, endpoint->room_, false);
+  Entry* entry = room != nullptr ? FindEntry(room, endpoint) : nullptr;
+  if (entry == nullptr) {
+    return;
+  }
+  uint32_t published = entry->published;
+  entry->active = false;
+  const std::string& user_id = endpoint->user_id();
+  if (!user_id.empty()) {
+    for (int type = 0; type < 32; ++type) {
+      if (published & (1u << type)) {
+        NotifyStream(room, endpoint, user_id, static_cast<StreamType>(type), false);
+      }
+    }
+    NotifyUser(room, endpoint, user_id, false);
+  }
+  if (notify) {
+    endpoint->OnLeft();
+  }
+}
+
+void LoopbackServer::Publish(LoopbackEndpoint* endpoint, StreamType type, bool available) {
+  Worker* worker = WorkerFor(endpoint->room_);
+  Post(endpoint->room_, [this, worker, endpoint, type, available]() {
+    DoPublish(worker, endpoint, type, available);
+  });
+}
+
+void LoopbackServer::DoPublish(Worker* worker,
+                               LoopbackEndpoint* endpoint,
+                               StreamType type,
+                               bool available) {
+  Room* room = FindRoom(worker, endpoint->room_, false);
+  Entry* entry = room != nullptr ? FindEntry(room, endpoint) : nullptr;
+  if (entry == nullptr || type < 0 || type >= 32) {
+    return;
+  }
+  uint32_t bit = 1u << type;
+  if (((entry->published & bit) != 0) == available) {
+    return;
+  }
+  entry->published ^= bit;
+  if (!endpoint->user_id().empty()) {
+    NotifyStream(room, endpoint, endpoint->user_id(), type, available);
+  }
+}
+
+void LoopbackServer::Deliver(Room* room,
+                             const LoopbackEndpoint* sender,
+                             const std::function<void(LoopbackEndpoint*)>& deliver) {
+  // 回调中可能有成员离开，按下标遍历并检查 |active|
+  for (size_t i = 0; i < room->entries.size(); ++i) {
+    if (!room->entries[i].active || room->entries[i].endpoint == sender) {
+      continue;
+    }
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    deliver(room->entries[i].endpoint);
+    uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::steady_clock::now() - begin)
+                                                 .count());
+    callbacks_.fetch_add(1, std::memory_order_relaxed);
+    callback_ns_total_.fetch_add(elapsed, std::memory_order_relaxed);
+    UpdateMax(&callback_ns_max_, elapsed);
+  }
+}
+
+void LoopbackServer::SendAudio(LoopbackEndpoint* sender, const AudioFrame& frame) {
+  Worker* worker = WorkerFor(sender->room_);
+  std::shared_ptr<AudioFrame> copy(new AudioFrame(frame));
+  Post(sender->room_, [this, worker, sender, copy]() {
+    Room* room = FindRoom(worker, sender->room_, false);
+    if (room == nullptr || FindEntry(room, sender) == nullptr) {
+      return;
+    }
+    const std::string& user_id = sender->user_id();
+    Deliver(room, sender, [&](LoopbackEndpoint* endpoint) { endpoint->OnAudio(user_id, *copy); });
+  });
+}
+
+void LoopbackServer::SendVideo(LoopbackEndpoint* sender, StreamType type, const VideoFrame& frame) {
+  Worker* worker = WorkerFor(sender->room_);
+  std::shared_ptr<VideoFrame> copy(new VideoFrame(frame));
+  Post(sender->room_, [this, worker, sender, type, copy]() {
+    Room* room = FindRoom(worker, sender->room_, false);
+    if (room == nullptr || FindEntry(room, sender) == nullptr) {
+      return;
+    }
+    const std::string& user_id = sender->user_id();
+    Deliver(room, sender, [&](LoopbackEndpoint* endpoint) {
+      if (endpoint->video_output() == LoopbackEndpoint::kVideoEncoded) {
+        endpoint->OnVideo(user_id, type, *copy);
+      }
+    });
+  });
+}
+
+void LoopbackServer::SendPixel(LoopbackEndpoint* sender, StreamType type, const PixelFrame& frame) {
+  Worker* worker = WorkerFor(sender->room_);
+  std::shared_ptr<PixelFrame> copy(new PixelFrame(frame));
+  Post(sender->room_, [this, worker, sender, type, copy]() {
+    Room* room = FindRoom(worker, sender->room_, false);
+    if (room == nullptr || FindEntry(room, sender) == nullptr) {
+      return;
+    }
+    const std::string& user_id = sender->user_id();
+    Deliver(room, sender, [&](LoopbackEndpoint* endpoint) {
+      if (endpoint->video_output() == LoopbackEndpoint::kVideoPixel) {
+        endpoint->OnPixel(user_id, type, *copy);
+      }
+    });
+  });
+}
+
+void LoopbackServer::SendSei(LoopbackEndpoint* sender,
+                             StreamType type,
+                             int message_type,
+                             const uint8_t* message,
+                             size_t length) {
+  Worker* worker = WorkerFor(sender->room_);
+  std::shared_ptr<std::vector<uint8_t> > copy(new std::vector<uint8_t>(message, message + length));
+  Post(sender->room_, [this, worker, sender, type, message_type, copy]() {
+    Room* room = FindRoom(worker, sender->room_, false);
+    if (room == nullptr || FindEntry(room, sender) == nullptr) {
+      return;
+    }
+    const std::string& user_id = sender->user_id();
+    Deliver(room, sender, [&](LoopbackEndpoint* endpoint) {
+      endpoint->OnSei(user_id, type, message_type, copy->data(), copy->size());
+    });
+  });
+}
+
+int LoopbackServer::AddSyntheticUser(const std::string& room,
+                                     const std::string& user_id,
+                                     const LoopbackUserConfig& config) {
+  if (user_id.empty() || (!config.audio && !config.video)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (config.audio &&
+      (config.audio_sample_rate < 8000 || config.audio_sample_rate > 48000 ||
+       config.audio_channels < 1 || config.audio_channels > 2 ||
+       config.audio_frame_length_ms < 10 || config.audio_frame_length_ms > 1000 ||
+       static_cast<int64_t>(config.audio_sample_rate) * config.audio_frame_length_ms % 1000 != 0)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (config.video &&
+      (!IsVideoType(config.video_type) || config.video_width < 16 || config.video_width > 4096 ||
+       config.video_height < 16 || config.video_height > 4096 || config.video_width % 2 != 0 ||
+       config.video_height % 2 != 0 || config.video_frame_rate < 1 ||
+       config.video_frame_rate > 120 || config.video_bitrate_bps <= 0 || config.gop_frames < 1)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+
+  Worker* worker = WorkerFor(room);
+  int result = liteav::trtc::ERR_OK;
+  Invoke(room, [&]() {
+    Room* state = FindRoom(worker, room, true);
+    for (size_t i = 0; i < state->entries.size(); ++i) {
+      if (state->entries[i].active && state->entries[i].endpoint->user_id() == user_id) {
+        result = liteav::trtc::ERR_INVALID_PARAMETER;
+        return;
+      }
+    }
+    for (size_t i = 0; i < state->synthetic.size(); ++i) {
+      if (state->synthetic[i]->active && state->synthetic[i]->user_id == user_id) {
+        result = liteav::trtc::ERR_INVALID_PARAMETER;
+        return;
+      }
+    }
+
+    Synthetic* user = new Synthetic();
+    user->user_id = user_id;
+    user->config = config;
+    user->active = true;
+    user->start_us = NowUs();
+    user->start_ms = static_cast<uint32_t>(user->start_us / 1000);
+    uint32_t hash = HashString(user_id);
+
+    if (config.audio) {
+      // 每个用户取不同的音高，150 ~ 450Hz
+      size_t period = static_cast<size_t>(config.audio_sample_rate / (150 + hash % 300));
+      user->tone.resize(period);
+      for (size_t i = 0; i < period; ++i) {
+        user->tone[i] = static_cast<int16_t>(8000.0 * sin(2.0 * 3.14159265358979 * i / period));
+      }
+      user->tone_position = 0;
+      user->samples.resize(static_cast<size_t>(config.audio_sample_rate) *
+                           config.audio_frame_length_ms / 1000 * config.audio_channels);
+    }
+    user->audio_count = 0;
+    user->audio_due_us = user->start_us;
+
+    if (config.video) {
+      BuildParameterSets(config.video_width, config.video_height, &user->parameter_sets);
+      size_t frame_bytes = std::max(64, config.video_bitrate_bps / 8 / config.video_frame_rate);
+      user->noise.resize(frame_bytes * 4);
+      uint32_t seed = hash | 1;
+      for (size_t i = 0; i < user->noise.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        // 非零字节，保证负载中不会出现起始码
+        user->noise[i] = static_cast<uint8_t>(1 + (seed >> 16) % 255);
+      }
+      // first_mb_in_slice = 0
+      user->noise[0] |= 0x80;
+
+      size_t luma = static_cast<size_t>(config.video_width) * config.video_height;
+      user->pixels.resize(luma * 3 / 2);
+      for (int y = 0; y < config.video_height; ++y) {
+        for (int x = 0; x < config.video_width; ++x) {
+          user->pixels[static_cast<size_t>(y) * config.video_width + x] =
+              static_cast<uint8_t>(16 + x * 219 / config.video_width);
+        }
+      }
+      memset(&user->pixels[luma], static_cast<int>(64 + hash % 128), luma / 4);
+      memset(&user->pixels[luma + luma / 4], static_cast<int>(64 + (hash >> 8) % 128), luma / 4);
+      user->bar_x = -1;
+    }
+    user->video_count = 0;
+    user->video_due_us = user->start_us;
+    user->sei_count = 0;
+    user->sei_due_us = user->start_us + static_cast<int64_t>(config.sei_interval_ms) * 1000;
+
+    state->synthetic.push_back(std::unique_ptr<Synthetic>(user));
+    NotifyUser(state, nullptr, user_id, true);
+    if (config.audio) {
+      NotifyStream(state, nullptr, user_id, liteav::trtc::STREAM_TYPE_AUDIO, true);
+    }
+    if (config.video) {
+      NotifyStream(state, nullptr, user_id, config.video_type, true);
+    }
+  });
+  if (result == liteav::trtc::ERR_OK) {
+    // 唤醒工作线程重新计算下一个节拍
+    Post(room, std::function<void()>([]() {}));
+  }
+  return result;
+}
+
+int LoopbackServer::RemoveSyntheticUser(const std::string& room, const std::string& user_id) {
+  Worker* worker = WorkerFor(room);
+  int result = liteav::trtc::ERR_INVALID_PARAMETER;
+  Invoke(room, [&]() {
+    Room* state = FindRoom(worker, room, false);
+    if (state == nullptr) {
+      return;
+    }
+    for (size_t i = 0; i < state->synthetic.size(); ++i) {
+      Synthetic* user = state->synthetic[i].get();
+      if (!user->active || user->user_id != user_id) {
+        continue;
+      }
+      user->active = false;
+      if (user->config.audio) {
+        NotifyStream(state, nullptr, user_id, liteav::trtc::STREAM_TYPE_AUDIO, false);
+      }
+      if (user->config.video) {
+        NotifyStream(state, nullptr, user_id, user->config.video_type, false);
+      }
+      NotifyUser(state, nullptr, user_id, false);
+      result = liteav::trtc::ERR_OK;
+      return;
+    }
+  });
+  return result;
+}
+
+void LoopbackServer::Produce(Worker* worker, Room* room, Synthetic* user, int64_t now_us) {
+  const LoopbackUserConfig& config = user->config;
+
+  if (config.audio) {
+    const int64_t interval = static_cast<int64_t>(config.audio_frame_length_ms) * 1000;
+    if (now_us - user->audio_due_us > kMaxCatchUpUs) {
+      late_ticks_.fetch_add(1, std::memory_order_relaxed);
+      user->audio_count = static_cast<uint64_t>((now_us - user->start_us) / interval);
+      user->audio_due_us = user->start_us + static_cast<int64_t>(user->audio_count) * interval;
+    }
+    while (user->active && user->audio_due_us <= now_us) {
+      int64_t lag = now_us - user->audio_due_us;
+      if (lag > interval) {
+        late_ticks_.fetch_add(1, std::memory_order_relaxed);
+      }
+      UpdateMax(&max_lag_us_, static_cast<uint64_t>(lag));
+
+      uint32_t elapsed_ms = static_cast<uint32_t>(user->audio_count * config.audio_frame_length_ms);
+      bool speaking = true;
+      if (config.speech_on_ms > 0 && config.speech_off_ms > 0) {
+        speaking = elapsed_ms % (config.speech_on_ms + config.speech_off_ms) <
+                   static_cast<uint32_t>(config.speech_on_ms);
+      }
+      const size_t channels = static_cast<size_t>(config.audio_channels);
+      const size_t frames = user->samples.size() / channels;
+      for (size_t i = 0; i < frames; ++i) {
+        int16_t value = speaking ? user->tone[user->tone_position] : 0;
+        user->tone_position = (user->tone_position + 1) % user->tone.size();
+        for (size_t c = 0; c < channels; ++c) {
+          user->samples[i * channels + c] = value;
+        }
+      }
+      user->audio.SetData(reinterpret_cast<const uint8_t*>(user->samples.data()),
+                          user->samples.size() * sizeof(int16_t));
+      user->audio.sample_rate = config.audio_sample_rate;
+      user->audio.channels = config.audio_channels;
+      user->audio.bits_per_sample = 16;
+      user->audio.codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+      user->audio.pts = user->start_ms + elapsed_ms;
+      audio_frames_generated_.fetch_add(1, std::memory_order_relaxed);
+
+      Deliver(room, nullptr, [user](LoopbackEndpoint* endpoint) {
+        endpoint->OnAudio(user->user_id, user->audio);
+      });
+      ++user->audio_count;
+      user->audio_due_us = user->start_us + static_cast<int64_t>(user->audio_count) * interval;
+    }
+  }
+
+  if (config.video) {
+    const double interval = 1000000.0 / config.video_frame_rate;
+    if (now_us - user->video_due_us > kMaxCatchUpUs) {
+      late_ticks_.fetch_add(1, std::memory_order_relaxed);
+      user->video_count = static_cast<uint64_t>((now_us - user->start_us) / interval);
+      user->video_due_us =
+          user->start_us + static_cast<int64_t>(static_cast<double>(user->video_count) * interval);
+    }
+    while (user->active && user->video_due_us <= now_us) {
+      UpdateMax(&max_lag_us_, static_cast<uint64_t>(now_us - user->video_due_us));
+      uint32_t pts = user->start_ms +
+                     static_cast<uint32_t>(user->video_count * 1000 / config.video_frame_rate);
+      bool need_encoded = false;
+      bool need_pixel = false;
+      for (size_t i = 0; i < room->entries.size(); ++i) {
+        if (room->entries[i].active) {
+          if (room->entries[i].endpoint->video_output() == LoopbackEndpoint::kVideoEncoded) {
+            need_encoded = true;
+          } else {
+            need_pixel = true;
+          }
+        }
+      }
+
+      if (need_encoded) {
+        bool key = user->video_count % static_cast<uint64_t>(config.gop_frames) == 0;
+        size_t size = user->noise.size() / (key ? 1 : 4);
+        user->nal.clear();
+        if (key) {
+          user->nal = user->parameter_sets;
+        }
+        // 负载前几个字节随帧号变化，仍保持非零
+        uint8_t* noise = user->noise.data();
+        for (int i = 1; i < 5 && static_cast<size_t>(i) < size; ++i) {
+          noise[i] = static_cast<uint8_t>(((user->video_count >> (8 * (i - 1))) & 0x7F) | 0x80);
+        }
+        static const uint8_t kStartCode[] = {0, 0, 0, 1};
+        user->nal.insert(user->nal.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        user->nal.push_back(key ? 0x65 : 0x41);
+        user->nal.insert(user->nal.end(), noise, noise + size);
+        user->encoded.SetData(user->nal.data(), user->nal.size());
+        user->encoded.pts = pts;
+        user->encoded.dts = pts;
+        user->encoded.is_key_frame = key;
+        user->encoded.codec = liteav::trtc::VIDEO_CODEC_TYPE_H264;
+        user->encoded.rotation = liteav::trtc::VIDEO_ROTATION_0;
+      }
+
+      if (need_pixel) {
+        // 渐变背景上一根每帧右移 8 像素的竖条
+        const int width = config.video_width;
+        const int height = config.video_height;
+        const int bar_width = 16;
+        int bar_x = static_cast<int>((user->video_count * 8) % static_cast<uint64_t>(width));
+        uint8_t* luma = user->pixels.data();
+        for (int y = 0; y < height; ++y) {
+          uint8_t* row = luma + static_cast<size_t>(y) * width;
+          if (user->bar_x >= 0) {
+            for (int x = user->bar_x; x < std::min(width, user->bar_x + bar_width); ++x) {
+              row[x] = static_cast<uint8_t>(16 + x * 219 / width);
+            }
+          }
+          memset(row + bar_x, 235, static_cast<size_t>(std::min(bar_width, width - bar_x)));
+        }
+        user->bar_x = bar_x;
+        user->pixel.SetData(user->pixels.data(), user->pixels.size());
+        user->pixel.pts = pts;
+        user->pixel.width = static_cast<uint32_t>(width);
+        user->pixel.height = static_cast<uint32_t>(height);
+        user->pixel.format = liteav::trtc::VIDEO_PIXEL_FORMAT_YUV420p;
+        user->pixel.rotation = liteav::trtc::VIDEO_ROTATION_0;
+      }
+      video_frames_generated_.fetch_add(1, std::memory_order_relaxed);
+
+      const StreamType type = config.video_type;
+      Deliver(room, nullptr, [user, type](LoopbackEndpoint* endpoint) {
+        if (endpoint->video_output() == LoopbackEndpoint::kVideoEncoded) {
+          endpoint->OnVideo(user->user_id, type, user->encoded);
+        } else {
+          endpoint->OnPixel(user->user_id, type, user->pixel);
+        }
+      });
+      ++user->video_count;
+      user->video_due_us =
+          user->start_us + static_cast<int64_t>(static_cast<double>(user->video_count) * interval);
+    }
+  }
+
+  if (config.sei_interval_ms > 0) {
+    const int64_t interval = static_cast<int64_t>(config.sei_interval_ms) * 1000;
+    if (user->active && user->sei_due_us <= now_us) {
+      char message[128];
+      int length = snprintf(message, sizeof(message), "loopback:%s:%llu", user->user_id.c_str(),
+                            static_cast<unsigned long long>(user->sei_count));
+      length = std::min(length, static_cast<int>(sizeof(message)) - 1);
+      sei_messages_generated_.fetch_add(1, std::memory_order_relaxed);
+      const StreamType type = config.video ? config.video_type : liteav::trtc::STREAM_TYPE_VIDEO_HIGH;
+      Deliver(room, nullptr, [&](LoopbackEndpoint* endpoint) {
+        endpoint->OnSei(user->user_id, type, 242, reinterpret_cast<const uint8_t*>(message),
+                        static_cast<size_t>(length));
+      });
+      ++user->sei_count;
+      user->sei_due_us = std::max(user->sei_due_us + interval, now_us);
+    }
+  }
+}
+
+int64_t LoopbackServer::NextDeadline(Worker* worker) const {
+  int64_t deadline = worker->next_tick_us;
+  for (std::map<std::string, std::unique_ptr<Room> >::const_iterator it = worker->rooms.begin();
+       it != worker->rooms.end(); ++it) {
+    const Room* room = it->second.get();
+    for (size_t i = 0; i < room->synthetic.size(); ++i) {
+      const Synthetic* user = room->synthetic[i].get();
+      if (!user->active) {
+        continue;
+      }
+      if (user->config.audio) {
+        deadline = std::min(deadline, user->audio_due_us);
+      }
+      if (user->config.video) {
+        deadline = std::min(deadline, user->video_due_us);
+      }
+      if (user->config.sei_interval_ms > 0) {
+        deadline = std::min(deadline, user->sei_due_us);
+      }
+    }
+  }
+  return deadline;
+}
+
+void LoopbackServer::Compact(Worker* worker) {
+  std::map<std::string, std::unique_ptr<Room> >::iterator it = worker->rooms.begin();
+  while (it != worker->rooms.end()) {
+    Room* room = it->second.get();
+    std::vector<Entry>& entries = room->entries;
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const Entry& entry) { return !entry.active; }),
+                  entries.end());
+    std::vector<std::unique_ptr<Synthetic> >& synthetic = room->synthetic;
+    synthetic.erase(std::remove_if(synthetic.begin(), synthetic.end(),
+                                   [](const std::unique_ptr<Synthetic>& user) {
+                                     return !user->active;
+                                   }),
+                    synthetic.end());
+    if (entries.empty() && synthetic.empty()) {
+      it = worker->rooms.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void LoopbackServer::Run(Worker* worker) {
+  std::vector<std::function<void()> > tasks;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      for (;;) {
+        if (!worker->tasks.empty()) {
+          break;
+        }
+        int64_t deadline = NextDeadline(worker);
+        if (NowUs() >= deadline) {
+          break;
+        }
+        worker->cv.wait_until(
+            lock, std::chrono::steady_clock::time_point(std::chrono::microseconds(deadline)));
+      }
+      tasks.swap(worker->tasks);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]();
+    }
+    tasks.clear();
+
+    // 回调中可能新建房间，std::map 插入不会使迭代器失效
+    int64_t now = NowUs();
+    for (std::map<std::string, std::unique_ptr<Room> >::iterator it = worker->rooms.begin();
+         it != worker->rooms.end(); ++it) {
+      Room* room = it->second.get();
+      for (size_t i = 0; i < room->synthetic.size(); ++i) {
+        Produce(worker, room, room->synthetic[i].get(), now);
+      }
+    }
+    if (now >= worker->next_tick_us) {
+      worker->next_tick_us = now + kTickIntervalUs;
+      for (std::map<std::string, std::unique_ptr<Room> >::iterator it = worker->rooms.begin();
+           it != worker->rooms.end(); ++it) {
+        Room* room = it->second.get();
+        for (size_t i = 0; i < room->entries.size(); ++i) {
+          if (room->entries[i].active) {
+            room->entries[i].endpoint->OnTick(now);
+          }
+        }
+      }
+    }
+    Compact(worker);
+  }
+}
+
+LoopbackStats LoopbackServer::GetStats() const {
+  LoopbackStats stats;
+  stats.audio_frames_generated = audio_frames_generated_.load(std::memory_order_relaxed);
+  stats.video_frames_generated = video_frames_generated_.load(std::memory_order_relaxed);
+  stats.sei_messages_generated = sei_messages_generated_.load(std::memory_order_relaxed);
+  stats.frames_sent = frames_sent_.load(std::memory_order_relaxed);
+  stats.callbacks = callbacks_.load(std::memory_order_relaxed);
+  stats.callback_ns_total = callback_ns_total_.load(std::memory_order_relaxed);
+  stats.callback_ns_max = callback_ns_max_.load(std::memory_order_relaxed);
+  stats.late_ticks = late_ticks_.load(std::memory_order_relaxed);
+  stats.max_lag_us = max_lag_us_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void LoopbackServer::ResetStats() {
+  audio_frames_generated_.store(0, std::memory_order_relaxed);
+  video_frames_generated_.store(0, std::memory_order_relaxed);
+  sei_messages_generated_.store(0, std::memory_order_relaxed);
+  frames_sent_.store(0, std::memory_order_relaxed);
+  callbacks_.store(0, std::memory_order_relaxed);
+  callback_ns_total_.store(0, std::memory_order_relaxed);
+  callback_ns_max_.store(0, std::memory_order_relaxed);
+  late_ticks_.store(0, std::memory_order_relaxed);
+  max_lag_us_.store(0, std::memory_order_relaxed);
+}
+
+LoopbackAudioOutput::LoopbackAudioOutput(int sample_rate, int channels, int frame_length_ms)
+    : resampler_(sample_rate, channels),
+      frame_length_ms_(frame_length_ms),
+      frame_samples_(static_cast<size_t>(sample_rate) * frame_length_ms / 1000 * channels),
+      head_(0),
+      next_pts_(0) {}
+
+bool LoopbackAudioOutput::Push(const AudioFrame& frame) {
+  if (frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM || frame.bits_per_sample != 16 ||
+      frame.channels <= 0) {
+    return false;
+  }
+  if (head_ == pending_.size()) {
+    pending_.clear();
+    head_ = 0;
+    next_pts_ = frame.pts;
+  }
+  size_t frames = frame.size() / sizeof(int16_t) / frame.channels;
+  return resampler_.Process(reinterpret_cast<const int16_t*>(frame.data()), frames,
+                            frame.sample_rate, frame.channels,
+                            &pending_) == liteav::trtc::ERR_OK;
+}
+
+bool LoopbackAudioOutput::Pop(AudioFrame* frame) {
+  if (frame_samples_ == 0 || pending_.size() - head_ < frame_samples_) {
+    return false;
+  }
+  frame->SetData(reinterpret_cast<const uint8_t*>(&pending_[head_]),
+                 frame_samples_ * sizeof(int16_t));
+  frame->sample_rate = resampler_.output_sample_rate();
+  frame->channels = resampler_.output_channels();
+  frame->bits_per_sample = 16;
+  frame->codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+  frame->pts = next_pts_;
+  next_pts_ += static_cast<uint32_t>(frame_length_ms_);
+  head_ += frame_samples_;
+  if (head_ == pending_.size()) {
+    pending_.clear();
+    head_ = 0;
+  }
+  return true;
+}
+
+int LoopbackAudioOutput::PendingMs() const {
+  size_t per_ms = static_cast<size_t>(resampler_.output_sample_rate()) *
+                  resampler_.output_channels() / 1000;
+  return per_ms == 0 ? 0 : static_cast<int>((pending_.size() - head_) / per_ms);
+}
+
+int LoopbackSeiLimiter::Check(int message_type, const uint8_t* message, size_t length) {
+  if ((message_type != 5 && message_type != 242) || message == nullptr || length == 0 ||
+      length > 1000) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  int64_t now = LoopbackServer::NowUs();
+  if (now - window_start_us_ >= 1000000) {
+    window_start_us_ = now;
+    count_ = 0;
+    bytes_ = 0;
+  }
+  if (count_ + 1 > 30 || bytes_ + length > 8000) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  ++count_;
+  bytes_ += length;
+  return liteav::trtc::ERR_OK;
+}
+
+std::string LoopbackRoomKey(uint32_t sdk_app_id, const std::string& room) {
+  char prefix[16];
+  snprintf(prefix, sizeof(prefix), "%u/", sdk_app_id);
+  return prefix + room;
+}
+
+bool ParseLoopbackUrl(const char* url,
+                      const char* user_param,
+                      std::string* room,
+                      std::string* user_id) {
+  static const char kScheme[] = "trtc://";
+  if (url == nullptr || strncmp(url, kScheme, sizeof(kScheme) - 1) != 0) {
+    return false;
+  }
+  std::string rest(url + sizeof(kScheme) - 1);
+  std::string query;
+  size_t question = rest.find('?');
+  if (question != std::string::npos) {
+    query = rest.substr(question + 1);
+    rest.resize(question);
+  }
+  size_t slash = rest.rfind('/');
+  std::string stream_id = slash == std::string::npos ? std::string() : rest.substr(slash + 1);
+
+  uint32_t sdk_app_id = 0;
+  std::string room_id = stream_id;
+  std::string user = stream_id;
+  size_t begin = 0;
+  while (begin < query.size()) {
+    size_t end = query.find('&', begin);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+    std::string pair = query.substr(begin, end - begin);
+    begin = end + 1;
+    size_t equal = pair.find('=');
+    if (equal == std::string::npos) {
+      continue;
+    }
+    std::string key = pair.substr(0, equal);
+    std::string value = pair.substr(equal + 1);
+    for (size_t i = 0; i < key.size(); ++i) {
+      key[i] = static_cast<char>(tolower(static_cast<unsigned char>(key[i])));
+    }
+    if (key == "sdkappid") {
+      sdk_app_id = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+    } else if ((key == "strroomid" || key == "roomid") && !value.empty()) {
+      room_id = value;
+    } else if (key == user_param && !value.empty()) {
+      user = value;
+    }
+  }
+  if (room_id.empty() || user.empty()) {
+    return false;
+  }
+  *room = LoopbackRoomKey(sdk_app_id, room_id);
+  *user_id = user;
+  return true;
+}
+
+int Loopback::SetWorkerThreads(int count) {
+  return LoopbackServer::Instance().SetWorkerThreads(count);
+}
+
+int Loopback::AddSyntheticUser(uint32_t sdk_app_id,
+                               const char* room_id,
+                               const char* user_id,
+                               const LoopbackUserConfig& config) {
+  if (room_id == nullptr || room_id[0] == '\0' || user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return LoopbackServer::Instance().AddSyntheticUser(LoopbackRoomKey(sdk_app_id, room_id), user_id,
+                                                     config);
+}
+
+int Loopback::RemoveSyntheticUser(uint32_t sdk_app_id, const char* room_id, const char* user_id) {
+  if (room_id == nullptr || user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return LoopbackServer::Instance().RemoveSyntheticUser(LoopbackRoomKey(sdk_app_id, room_id),
+                                                        user_id);
+}
+
+LoopbackStats Loopback::GetStats() {
+  return LoopbackServer::Instance().GetStats();
+}
+
+void Loopback::ResetStats() {
+  LoopbackServer::Instance().ResetStats();
+}
+
+}  // namespace swing
+
+int LoopbackAddSyntheticUsers(uint32_t sdk_app_id,
+                              const char* room_id,
+                              const char* user_prefix,
+                              int count,
+                              int audio_sample_rate,
+                              int audio_channels,
+                              int video_width,
+                              int video_height,
+                              int video_frame_rate) {
+  if (user_prefix == nullptr || count <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  swing::LoopbackUserConfig config;
+  config.audio = audio_sample_rate > 0;
+  config.audio_sample_rate = audio_sample_rate;
+  config.audio_channels = audio_channels;
+  config.video = video_width > 0;
+  config.video_width = video_width;
+  config.video_height = video_height;
+  config.video_frame_rate = video_frame_rate;
+  for (int i = 0; i < count; ++i) {
+    std::string user_id = user_prefix + std::to_string(i);
+    int result = swing::Loopback::AddSyntheticUser(sdk_app_id, room_id, user_id.c_str(), config);
+    if (result != liteav::trtc::ERR_OK) {
+      return result;
+    }
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackAddSyntheticSpeakers(uint32_t sdk_app_id,
+                                 const char* room_id,
+                                 const char* user_prefix,
+                                 int count,
+                                 int audio_sample_rate,
+                                 int speech_on_ms,
+                                 int speech_off_ms) {
+  if (user_prefix == nullptr || count <= 0 || audio_sample_rate <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  swing::LoopbackUserConfig config;
+  config.audio_sample_rate = audio_sample_rate;
+  config.audio_channels = 1;
+  config.speech_on_ms = speech_on_ms;
+  config.speech_off_ms = speech_off_ms;
+  config.video = false;
+  for (int i = 0; i < count; ++i) {
+    std::string user_id = user_prefix + std::to_string(i);
+    int result = swing::Loopback::AddSyntheticUser(sdk_app_id, room_id, user_id.c_str(), config);
+    if (result != liteav::trtc::ERR_OK) {
+      return result;
+    }
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackRemoveSyntheticUser(uint32_t sdk_app_id, const char* room_id, const char* user_id) {
+  return swing::Loopback::RemoveSyntheticUser(sdk_app_id, room_id, user_id);
+}
+
+int LoopbackSetWorkerThreads(int count) {
+  return swing::Loopback::SetWorkerThreads(count);
+}
+
+void LoopbackGetStats(LoopbackStats* stats) {
+  if (stats != nullptr) {
+    *stats = swing::Loopback::GetStats();
+  }
+}
+
+void LoopbackResetStats(void) {
+  swing::Loopback::ResetStats();
+}
@@ -0,0 +1,226 @@
+//
+// 功能说明：
+//   回环后端的房间服务，仅供 loopback_*.cc 内部使用。
+//   LoopbackServer 管理房间、成员和合成用户，并在工作线程上把事件和帧
+//   扇出给同房间的其他成员；各 SDK 接口的实现以 LoopbackEndpoint 的身份加入房间。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_LOOPBACK_SERVER_H_
+#define GCHATGPT_TRTC_SWING_LOOPBACK_SERVER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "audio_resampler.h"
+#include "loopback.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+using liteav::trtc::PixelFrame;
+using liteav::trtc::StreamType;
+using liteav::trtc::VideoFrame;
+
+// 房间成员
+// 回调均在房间所属的工作线程上执行，默认忽略。
+class LoopbackEndpoint {
+ public:
+  // 接收视频的格式
+  enum VideoOutput {
+    kVideoEncoded,
+    kVideoPixel,
+  };
+
+  LoopbackEndpoint();
+  virtual ~LoopbackEndpoint() {}
+
+  // 成员自身的用户 ID，为空表示旁观者（录制、播放），不出现在其他成员的用户列表中
+  const std::string& user_id() const { return user_id_; }
+  VideoOutput video_output() const { return video_output_; }
+
+  virtual void OnJoined() {}
+  virtual void OnLeft() {}
+  virtual void OnUserEnter(const std::string& user_id) {}
+  virtual void OnUserExit(const std::string& user_id) {}
+  virtual void OnStreamAvailable(const std::string& user_id, StreamType type, bool available) {}
+  virtual void OnAudio(const std::string& user_id, const AudioFrame& frame) {}
+  virtual void OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) {}
+  virtual void OnPixel(const std::string& user_id, StreamType type, const PixelFrame& frame) {}
+  virtual void OnSei(const std::string& user_id,
+                     StreamType type,
+                     int message_type,
+                     const uint8_t* message,
+                     size_t length) {}
+
+  // 周期回调，间隔约 100ms
+  virtual void OnTick(int64_t now_us) {}
+
+ protected:
+  // 进房前设置，在房间内时不可修改
+  void SetIdentity(const std::string& user_id, VideoOutput video_output);
+
+ private:
+  friend class LoopbackServer;
+
+  std::string user_id_;
+  VideoOutput video_output_;
+  // 所在房间及其工作线程，由 LoopbackServer::Join() 设置
+  std::string room_;
+  size_t worker_;
+};
+
+class LoopbackServer {
+ public:
+  static LoopbackServer& Instance();
+
+  int SetWorkerThreads(int count);
+
+  // 单调时钟，单位微秒
+  static int64_t NowUs();
+
+  // 加入房间，异步执行，成功后回调 OnJoined()
+  // 已在房间内的其他成员依次通过 OnUserEnter() / OnStreamAvailable() 告知。
+  void Join(const std::string& room, LoopbackEndpoint* endpoint);
+
+  // 离开房间
+  // |notify| 为 true 时异步执行并回调 OnLeft()；
+  // 为 false 时同步执行且不再回调 |endpoint|，返回后可以安全销毁。
+  void Leave(LoopbackEndpoint* endpoint, bool notify);
+
+  // 发布或取消发布一路流，房间内其他成员收到 OnStreamAvailable()
+  void Publish(LoopbackEndpoint* endpoint, StreamType type, bool available);
+
+  // 向房间内其他成员发送，数据会被复制
+  void SendAudio(LoopbackEndpoint* sender, const AudioFrame& frame);
+  void SendVideo(LoopbackEndpoint* sender, StreamType type, const VideoFrame& frame);
+  void SendPixel(LoopbackEndpoint* sender, StreamType type, const PixelFrame& frame);
+  void SendSei(LoopbackEndpoint* sender,
+               StreamType type,
+               int message_type,
+               const uint8_t* message,
+               size_t length);
+
+  // 在房间所属的工作线程上异步执行 |task|
+  void Post(const std::string& room, const std::function<void()>& task);
+
+  // 同上，等待执行完成；在该工作线程上调用时直接执行
+  void Invoke(const std::string& room, const std::function<void()>& task);
+
+  int AddSyntheticUser(const std::string& room,
+                       const std::string& user_id,
+                       const LoopbackUserConfig& config);
+  int RemoveSyntheticUser(const std::string& room, const std::string& user_id);
+
+  LoopbackStats GetStats() const;
+  void ResetStats();
+  void CountSent() { frames_sent_.fetch_add(1, std::memory_order_relaxed); }
+
+ private:
+  struct Entry;
+  struct Room;
+  struct Synthetic;
+  struct Worker;
+
+  LoopbackServer();
+  ~LoopbackServer();
+
+  Worker* WorkerFor(const std::string& room);
+  void Start();
+  void Run(Worker* worker);
+
+  // 以下在工作线程上执行
+  Room* FindRoom(Worker* worker, const std::string& room, bool create);
+  Entry* FindEntry(Room* room, const LoopbackEndpoint* endpoint);
+  void DoJoin(Worker* worker, LoopbackEndpoint* endpoint);
+  void DoLeave(Worker* worker, LoopbackEndpoint* endpoint, bool notify);
+  void DoPublish(Worker* worker, LoopbackEndpoint* endpoint, StreamType type, bool available);
+  void NotifyUser(Room* room, const LoopbackEndpoint* except, const std::string& user_id, bool enter);
+  void NotifyStream(Room* room,
+                    const LoopbackEndpoint* except,
+                    const std::string& user_id,
+                    StreamType type,
+                    bool available);
+  void Produce(Worker* worker, Room* room, Synthetic* user, int64_t now_us);
+  void Compact(Worker* worker);
+  int64_t NextDeadline(Worker* worker) const;
+
+  // 对房间内除 |sender| 外的成员逐个调用 |deliver|，统计回调耗时
+  void Deliver(Room* room,
+               const LoopbackEndpoint* sender,
+               const std::function<void(LoopbackEndpoint*)>& deliver);
+
+  std::mutex mutex_;
+  int worker_count_;
+  std::vector<std::unique_ptr<Worker> > workers_;
+  std::atomic<bool> started_;
+
+  std::atomic<uint64_t> audio_frames_generated_;
+  std::atomic<uint64_t> video_frames_generated_;
+  std::atomic<uint64_t> sei_messages_generated_;
+  std::atomic<uint64_t> frames_sent_;
+  std::atomic<uint64_t> callbacks_;
+  std::atomic<uint64_t> callback_ns_total_;
+  std::atomic<uint64_t> callback_ns_max_;
+  std::atomic<uint64_t> late_ticks_;
+  std::atomic<uint64_t> max_lag_us_;
+};
+
+// 把任意格式的 PCM 转为固定格式、固定帧长的输出
+class LoopbackAudioOutput {
+ public:
+  LoopbackAudioOutput(int sample_rate, int channels, int frame_length_ms);
+
+  // 写入一帧，非 16 位 PCM 返回 false
+  bool Push(const AudioFrame& frame);
+
+  // 取出一帧，不足一帧时返回 false
+  bool Pop(AudioFrame* frame);
+
+  // 缓存的时长，单位毫秒
+  int PendingMs() const;
+
+ private:
+  LoopbackAudioOutput(const LoopbackAudioOutput&);
+  LoopbackAudioOutput& operator=(const LoopbackAudioOutput&);
+
+  AudioResampler resampler_;
+  const int frame_length_ms_;
+  const size_t frame_samples_;
+  std::vector<int16_t> pending_;
+  size_t head_;
+  uint32_t next_pts_;
+};
+
+// SEI 发送限制：单条不超过 1000 字节，每秒不超过 30 条、8000 字节
+class LoopbackSeiLimiter {
+ public:
+  LoopbackSeiLimiter() : window_start_us_(0), count_(0), bytes_(0) {}
+
+  // 返回 ERR_OK、ERR_INVALID_PARAMETER 或 ERR_INVALID_OPERATION
+  int Check(int message_type, const uint8_t* message, size_t length);
+
+ private:
+  std::mutex mutex_;
+  int64_t window_start_us_;
+  int count_;
+  size_t bytes_;
+};
+
+// 房间键："<sdk_app_id>/<房间号>"
+std::string LoopbackRoomKey(uint32_t sdk_app_id, const std::string& room);
+
+// 解析直播 URL，规则见 loopback.h
+// |user_param| 为取用户 ID 的参数名，推流为 "userid"，播放为 "remoteuserid"。
+bool ParseLoopbackUrl(const char* url, const char* user_param, std::string* room, std::string* user_id);
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_LOOPBACK_SERVER_H_
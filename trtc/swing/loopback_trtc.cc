@@ -0,0 +1,526 @@
+//go:build loopback
+
+// 回环后端：TRTCCloud
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "audio_mixer.h"
+#include "loopback_server.h"
+
+namespace swing {
+
+namespace {
+
+using liteav::trtc::AudioEncodeParams;
+using liteav::trtc::EnterRoomParams;
+using liteav::trtc::TRTCCloud;
+using liteav::trtc::TRTCCloudDelegate;
+using liteav::trtc::TrtcBuffer;
+
+// GetAudioFrame() 每路最多缓存的时长，超出后丢弃最早的数据
+const int kMaxPlayoutMs = 1000;
+
+bool IsVideoType(StreamType type) {
+  return type == liteav::trtc::STREAM_TYPE_VIDEO_HIGH ||
+         type == liteav::trtc::STREAM_TYPE_VIDEO_LOW ||
+         type == liteav::trtc::STREAM_TYPE_VIDEO_AUX;
+}
+
+class LoopbackCloud : public TRTCCloud, public LoopbackEndpoint {
+ public:
+  explicit LoopbackCloud(TRTCCloudDelegate* delegate);
+  ~LoopbackCloud();
+
+  // TRTCCloud
+  int EnterRoom(const EnterRoomParams& params) override;
+  int ExitRoom() override;
+  int Subscribe(const char* user_id, StreamType type) override;
+  int Unsubscribe(const char* user_id, StreamType type) override;
+  int GetAudioFrame(const char* user_id, AudioFrame* frame) override;
+  int CreateLocalAudioChannel(const AudioEncodeParams& params) override;
+  int SendAudioFrame(const AudioFrame& frame) override;
+  int DestroyLocalAudioChannel() override;
+  int CreateLocalVideoChannel(StreamType type) override;
+  int SendVideoFrame(StreamType type, const VideoFrame& frame) override;
+  int SendVideoFrame(StreamType type, const PixelFrame& frame) override;
+  int SendSeiMessage(int message_type, const uint8_t* message, int length) override;
+  int DestroyLocalVideoChannel(StreamType type) override;
+
+  // LoopbackEndpoint
+  void OnJoined() override;
+  void OnUserEnter(const std::string& user_id) override;
+  void OnUserExit(const std::string& user_id) override;
+  void OnStreamAvailable(const std::string& user_id, StreamType type, bool available) override;
+  void OnAudio(const std::string& user_id, const AudioFrame& frame) override;
+  void OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) override;
+  void OnPixel(const std::string& user_id, StreamType type, const PixelFrame& frame) override;
+  void OnSei(const std::string& user_id,
+             StreamType type,
+             int message_type,
+             const uint8_t* message,
+             size_t length) override;
+
+ private:
+  struct Playout {
+    int sample_rate;
+    int channels;
+    std::unique_ptr<LoopbackAudioOutput> output;
+  };
+
+  LoopbackCloud(const LoopbackCloud&);
+  LoopbackCloud& operator=(const LoopbackCloud&);
+
+  bool Subscribed(const std::string& user_id, StreamType type) const;
+  void SetSubscribed(const char* user_id, StreamType type, bool subscribed);
+  bool record_scene() const { return params_.scene == liteav::trtc::TRTC_SCENE_RECORD; }
+
+  TRTCCloudDelegate* const delegate_;
+  LoopbackServer& server_;
+
+  // 以下在调用线程上访问，进房后只读的部分也在工作线程上读取
+  bool entered_;
+  std::string room_;
+  EnterRoomParams params_;
+  bool audio_channel_;
+  AudioEncodeParams audio_params_;
+  uint32_t video_channels_;
+  LoopbackSeiLimiter sei_limiter_;
+  TrtcBuffer send_plain_;
+  TrtcBuffer send_cipher_;
+  VideoFrame send_frame_;
+
+  // 以下在工作线程上访问
+  std::set<std::pair<std::string, int> > unsubscribed_;
+  std::map<std::string, std::unique_ptr<LoopbackAudioOutput> > outputs_;
+  std::unique_ptr<AudioMixer> mixer_;
+  AudioFrame output_frame_;
+  AudioFrame mixed_frame_;
+  TrtcBuffer receive_cipher_;
+  TrtcBuffer receive_plain_;
+  VideoFrame receive_frame_;
+
+  // GetAudioFrame() 的缓存，工作线程写入，调用线程读取
+  std::mutex playout_mutex_;
+  std::map<std::string, Playout> playout_;
+  AudioFrame dropped_frame_;
+};
+
+LoopbackCloud::LoopbackCloud(TRTCCloudDelegate* delegate)
+    : delegate_(delegate),
+      server_(LoopbackServer::Instance()),
+      entered_(false),
+      audio_channel_(false),
+      video_channels_(0) {}
+
+LoopbackCloud::~LoopbackCloud() {
+  if (entered_) {
+    server_.Leave(this, false);
+  }
+}
+
+int LoopbackCloud::EnterRoom(const EnterRoomParams& params) {
+  if (entered_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  const liteav::trtc::RoomParams& room = params.room;
+  std::string room_id = room.str_room_id.GetValue();
+  if (room_id.empty() && room.room_id != 0) {
+    room_id = std::to_string(room.room_id);
+  }
+  std::string user_id = room.user_id.GetValue();
+  std::string key = LoopbackRoomKey(room.sdk_app_id, room_id);
+
+  liteav::trtc::Error error = liteav::trtc::ERR_OK;
+  if (room.sdk_app_id == 0) {
+    error = liteav::trtc::ERR_INVALID_SDK_APP_ID;
+  } else if (room_id.empty()) {
+    error = liteav::trtc::ERR_INVALID_ROOM_ID;
+  } else if (user_id.empty()) {
+    error = liteav::trtc::ERR_INVALID_USER_ID;
+  }
+  if (error != liteav::trtc::ERR_OK) {
+    TRTCCloudDelegate* delegate = delegate_;
+    server_.Post(key, [delegate, error]() { delegate->OnError(error); });
+    return liteav::trtc::ERR_OK;
+  }
+
+  entered_ = true;
+  room_ = key;
+  params_ = params;
+  audio_channel_ = false;
+  video_channels_ = 0;
+  SetIdentity(user_id, params.use_pixel_frame_output ? kVideoPixel : kVideoEncoded);
+  server_.Join(key, this);
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::ExitRoom() {
+  if (!entered_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  // 同步离开，之后即可再次进房或销毁实例
+  server_.Leave(this, false);
+  entered_ = false;
+  TRTCCloudDelegate* delegate = delegate_;
+  server_.Post(room_, [delegate]() {
+    delegate->OnConnectionStateChanged(liteav::trtc::CONNECTION_STATE_CONNECTED,
+                                       liteav::trtc::CONNECTION_STATE_DISCONNECTED);
+    delegate->OnExitRoom();
+  });
+  std::lock_guard<std::mutex> lock(playout_mutex_);
+  playout_.clear();
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::Subscribe(const char* user_id, StreamType type) {
+  if (user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (!entered_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  SetSubscribed(user_id, type, true);
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::Unsubscribe(const char* user_id, StreamType type) {
+  if (user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (!entered_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  SetSubscribed(user_id, type, false);
+  return liteav::trtc::ERR_OK;
+}
+
+void LoopbackCloud::SetSubscribed(const char* user_id, StreamType type, bool subscribed) {
+  std::pair<std::string, int> key(user_id, static_cast<int>(type));
+  server_.Post(room_, [this, key, subscribed]() {
+    if (subscribed) {
+      unsubscribed_.erase(key);
+    } else {
+      unsubscribed_.insert(key);
+    }
+  });
+}
+
+bool LoopbackCloud::Subscribed(const std::string& user_id, StreamType type) const {
+  return unsubscribed_.empty() ||
+         unsubscribed_.find(std::make_pair(user_id, static_cast<int>(type))) == unsubscribed_.end();
+}
+
+int LoopbackCloud::GetAudioFrame(const char* user_id, AudioFrame* frame) {
+  if (user_id == nullptr || frame == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (!entered_ || record_scene()) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  std::lock_guard<std::mutex> lock(playout_mutex_);
+  std::map<std::string, Playout>::iterator it = playout_.find(user_id);
+  if (it == playout_.end() || !it->second.output->Pop(frame)) {
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+  return static_cast<int>(frame->size());
+}
+
+int LoopbackCloud::CreateLocalAudioChannel(const AudioEncodeParams& params) {
+  if (!entered_ || audio_channel_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  audio_channel_ = true;
+  audio_params_ = params;
+  server_.Publish(this, liteav::trtc::STREAM_TYPE_AUDIO, true);
+  TRTCCloudDelegate* delegate = delegate_;
+  server_.Post(room_, [delegate]() { delegate->OnLocalAudioChannelCreated(); });
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::SendAudioFrame(const AudioFrame& frame) {
+  if (!audio_channel_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  if (audio_params_.need_encode &&
+      (frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM || frame.bits_per_sample != 16)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  server_.CountSent();
+  server_.SendAudio(this, frame);
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::DestroyLocalAudioChannel() {
+  if (!audio_channel_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  audio_channel_ = false;
+  server_.Publish(this, liteav::trtc::STREAM_TYPE_AUDIO, false);
+  TRTCCloudDelegate* delegate = delegate_;
+  server_.Post(room_, [delegate]() { delegate->OnLocalAudioChannelDestroyed(); });
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::CreateLocalVideoChannel(StreamType type) {
+  if (!IsVideoType(type)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  uint32_t bit = 1u << type;
+  if (!entered_ || (video_channels_ & bit) != 0) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  video_channels_ |= bit;
+  server_.Publish(this, type, true);
+  TRTCCloudDelegate* delegate = delegate_;
+  int bitrate = type == liteav::trtc::STREAM_TYPE_VIDEO_LOW ? 300000 : 1000000;
+  server_.Post(room_, [delegate, type, bitrate]() {
+    delegate->OnLocalVideoChannelCreated(type);
+    delegate->OnRequestChangeVideoEncodeBitrate(type, bitrate);
+  });
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::SendVideoFrame(StreamType type, const VideoFrame& frame) {
+  if (!IsVideoType(type) || frame.size() == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if ((video_channels_ & (1u << type)) == 0 || params_.use_pixel_frame_input) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  const VideoFrame* sent = &frame;
+  liteav::trtc::EncryptionDelegate* encryption = params_.room.encryption_delegate;
+  if (encryption != nullptr) {
+    liteav::trtc::EncryptionData data;
+    data.room_id = static_cast<int32_t>(params_.room.room_id);
+    data.str_room_id = params_.room.str_room_id;
+    data.user_id = params_.room.user_id;
+    data.stream_type = type;
+    send_plain_.SetData(frame.data(), frame.size());
+    data.decrypted = &send_plain_;
+    data.encrypted = &send_cipher_;
+    if (!encryption->OnDataEncrypt(data)) {
+      return liteav::trtc::ERR_FAILED;
+    }
+    send_frame_ = frame;
+    send_frame_.SetData(send_cipher_.cdata(), send_cipher_.size());
+    sent = &send_frame_;
+  }
+  server_.CountSent();
+  server_.SendVideo(this, type, *sent);
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::SendVideoFrame(StreamType type, const PixelFrame& frame) {
+  if (!IsVideoType(type) || frame.width == 0 || frame.height == 0 ||
+      frame.size() < static_cast<size_t>(frame.width) * frame.height * 3 / 2) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if ((video_channels_ & (1u << type)) == 0 || !params_.use_pixel_frame_input) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  server_.CountSent();
+  server_.SendPixel(this, type, frame);
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::SendSeiMessage(int message_type, const uint8_t* message, int length) {
+  if (length < 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (video_channels_ == 0) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  int result = sei_limiter_.Check(message_type, message, static_cast<size_t>(length));
+  if (result != liteav::trtc::ERR_OK) {
+    return result;
+  }
+  // 随大流发送，没有大流时取已创建的其他视频通道
+  StreamType type = liteav::trtc::STREAM_TYPE_VIDEO_HIGH;
+  if ((video_channels_ & (1u << type)) == 0) {
+    type = (video_channels_ & (1u << liteav::trtc::STREAM_TYPE_VIDEO_LOW)) != 0
+               ? liteav::trtc::STREAM_TYPE_VIDEO_LOW
+               : liteav::trtc::STREAM_TYPE_VIDEO_AUX;
+  }
+  server_.SendSei(this, type, message_type, message, static_cast<size_t>(length));
+  return liteav::trtc::ERR_OK;
+}
+
+int LoopbackCloud::DestroyLocalVideoChannel(StreamType type) {
+  if (!IsVideoType(type)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  uint32_t bit = 1u << type;
+  if ((video_channels_ & bit) == 0) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  video_channels_ &= ~bit;
+  server_.Publish(this, type, false);
+  TRTCCloudDelegate* delegate = delegate_;
+  server_.Post(room_, [delegate, type]() { delegate->OnLocalVideoChannelDestroyed(type); });
+  return liteav::trtc::ERR_OK;
+}
+
+void LoopbackCloud::OnJoined() {
+  unsubscribed_.clear();
+  outputs_.clear();
+  mixer_.reset();
+  if (record_scene() && params_.record_config.enable_remote_audio_mix) {
+    mixer_.reset(new AudioMixer(AudioMixerConfig(params_.record_config)));
+  }
+  delegate_->OnConnectionStateChanged(liteav::trtc::CONNECTION_STATE_INIT,
+                                      liteav::trtc::CONNECTION_STATE_CONNECTING);
+  delegate_->OnConnectionStateChanged(liteav::trtc::CONNECTION_STATE_CONNECTING,
+                                      liteav::trtc::CONNECTION_STATE_CONNECTED);
+  delegate_->OnEnterRoom();
+}
+
+void LoopbackCloud::OnUserEnter(const std::string& user_id) {
+  liteav::trtc::UserInfo info;
+  info.user_id = user_id.c_str();
+  delegate_->OnRemoteUserEnterRoom(info);
+}
+
+void LoopbackCloud::OnUserExit(const std::string& user_id) {
+  {
+    std::lock_guard<std::mutex> lock(playout_mutex_);
+    playout_.erase(user_id);
+  }
+  liteav::trtc::UserInfo info;
+  info.user_id = user_id.c_str();
+  delegate_->OnRemoteUserExitRoom(info);
+}
+
+void LoopbackCloud::OnStreamAvailable(const std::string& user_id, StreamType type, bool available) {
+  if (type == liteav::trtc::STREAM_TYPE_AUDIO) {
+    if (!available) {
+      outputs_.erase(user_id);
+      if (mixer_) {
+        mixer_->RemoveUser(user_id.c_str());
+      }
+    }
+    delegate_->OnRemoteAudioAvailable(user_id.c_str(), available);
+  } else {
+    delegate_->OnRemoteVideoAvailable(user_id.c_str(), available, type);
+  }
+}
+
+void LoopbackCloud::OnAudio(const std::string& user_id, const AudioFrame& frame) {
+  // 不做解码，只处理 PCM
+  if (frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM || frame.bits_per_sample != 16 ||
+      !Subscribed(user_id, liteav::trtc::STREAM_TYPE_AUDIO)) {
+    return;
+  }
+
+  if (!record_scene()) {
+    std::lock_guard<std::mutex> lock(playout_mutex_);
+    Playout& playout = playout_[user_id];
+    if (!playout.output || playout.sample_rate != frame.sample_rate ||
+        playout.channels != frame.channels) {
+      playout.sample_rate = frame.sample_rate;
+      playout.channels = frame.channels;
+      playout.output.reset(new LoopbackAudioOutput(frame.sample_rate, frame.channels, 20));
+    }
+    playout.output->Push(frame);
+    while (playout.output->PendingMs() > kMaxPlayoutMs) {
+      playout.output->Pop(&dropped_frame_);
+    }
+    return;
+  }
+
+  const liteav::trtc::RecordConfig& config = params_.record_config;
+  std::unique_ptr<LoopbackAudioOutput>& output = outputs_[user_id];
+  if (!output) {
+    output.reset(new LoopbackAudioOutput(config.output_sample_rate, config.output_channels,
+                                         config.output_frame_length_ms));
+  }
+  output->Push(frame);
+  while (output->Pop(&output_frame_)) {
+    if (mixer_) {
+      mixer_->PushFrame(user_id.c_str(), output_frame_);
+    } else {
+      delegate_->OnRemoteAudioReceived(user_id.c_str(), output_frame_);
+    }
+  }
+  if (mixer_) {
+    while (mixer_->Mix(&mixed_frame_) == liteav::trtc::ERR_OK) {
+      delegate_->OnRemoteMixedAudioReceived(mixed_frame_);
+    }
+  }
+}
+
+void LoopbackCloud::OnVideo(const std::string& user_id, StreamType type, const VideoFrame& frame) {
+  if (!Subscribed(user_id, type)) {
+    return;
+  }
+  liteav::trtc::DecryptionDelegate* decryption = params_.room.decryption_delegate;
+  if (decryption == nullptr) {
+    delegate_->OnRemoteVideoReceived(user_id.c_str(), type, frame);
+    return;
+  }
+  liteav::trtc::DecryptionData data;
+  data.room_id = static_cast<int32_t>(params_.room.room_id);
+  data.str_room_id = params_.room.str_room_id;
+  data.user_id = user_id.c_str();
+  data.stream_type = type;
+  receive_cipher_.SetData(frame.data(), frame.size());
+  data.encrypted = &receive_cipher_;
+  data.decrypted = &receive_plain_;
+  if (!decryption->OnDataDecrypt(data)) {
+    return;
+  }
+  receive_frame_ = frame;
+  receive_frame_.SetData(receive_plain_.cdata(), receive_plain_.size());
+  delegate_->OnRemoteVideoReceived(user_id.c_str(), type, receive_frame_);
+}
+
+void LoopbackCloud::OnPixel(const std::string& user_id, StreamType type, const PixelFrame& frame) {
+  if (Subscribed(user_id, type)) {
+    delegate_->OnRemoteVideoReceived(user_id.c_str(), type, frame);
+  }
+}
+
+void LoopbackCloud::OnSei(const std::string& user_id,
+                          StreamType type,
+                          int message_type,
+                          const uint8_t* message,
+                          size_t length) {
+  if (Subscribed(user_id, type)) {
+    delegate_->OnSeiMessageReceived(user_id.c_str(), type, message_type, message,
+                                    static_cast<int>(length));
+  }
+}
+
+}  // namespace
+
+}  // namespace swing
+
+namespace liteav {
+namespace trtc {
+
+TRTCCloud* TRTCCloud::Create(TRTCCloudDelegate* delegate) {
+  if (delegate == nullptr) {
+    return nullptr;
+  }
+  return new swing::LoopbackCloud(delegate);
+}
+
+void TRTCCloud::Destroy(TRTCCloud* cloud) {
+  delete cloud;
+}
+
+TRTCCloud* CreateTRTCCloud(TRTCCloudDelegate* delegate) {
+  return TRTCCloud::Create(delegate);
+}
+
+void DestroyTRTCCloud(TRTCCloud* cloud) {
+  TRTCCloud::Destroy(cloud);
+}
+
+}  // namespace trtc
+}  // namespace liteav
@@ -0,0 +1,467 @@
+//go:build loopback
+
+// 回环后端：SDK 值类型的实现
+// 帧数据保存在 PooledBuffer 中，复制帧时复用池内的块。
+
+#include <stdio.h>
+
+#include <string>
+
+#include "../include/live/liteav_live_defines.h"
+#include "../include/live/liteav_live_premier.h"
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "../include/trtc/liteav_trtc_recorder.h"
+#include "frame_pool.h"
+
+namespace {
+
+swing::PooledBuffer* Buffer(void* handle) {
+  return static_cast<swing::PooledBuffer*>(handle);
+}
+
+std::string* String(void* str) {
+  return static_cast<std::string*>(str);
+}
+
+}  // namespace
+
+// 帧类型共用的数据存取
+#define LOOPBACK_FRAME_DATA(Frame)                                     \
+  Frame::~Frame() { delete Buffer(handle_); }                          \
+  void Frame::SetData(const uint8_t* data, size_t size) {              \
+    Buffer(handle_)->Assign(data, size);                               \
+  }                                                                    \
+  const uint8_t* Frame::data() const { return Buffer(handle_)->data(); } \
+  size_t Frame::size() const { return Buffer(handle_)->size(); }
+
+namespace liteav {
+namespace trtc {
+
+AudioFrame::AudioFrame()
+    : sample_rate(48000),
+      channels(1),
+      bits_per_sample(16),
+      codec(AUDIO_CODEC_TYPE_PCM),
+      pts(0),
+      handle_(new swing::PooledBuffer()) {}
+
+AudioFrame::AudioFrame(const AudioFrame& other)
+    : sample_rate(other.sample_rate),
+      channels(other.channels),
+      bits_per_sample(other.bits_per_sample),
+      codec(other.codec),
+      pts(other.pts),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+AudioFrame& AudioFrame::operator=(const AudioFrame& other) {
+  if (this != &other) {
+    sample_rate = other.sample_rate;
+    channels = other.channels;
+    bits_per_sample = other.bits_per_sample;
+    codec = other.codec;
+    pts = other.pts;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(AudioFrame)
+
+VideoFrame::VideoFrame()
+    : pts(0),
+      dts(0),
+      is_key_frame(false),
+      codec(VIDEO_CODEC_TYPE_H264),
+      rotation(VIDEO_ROTATION_0),
+      handle_(new swing::PooledBuffer()) {}
+
+VideoFrame::VideoFrame(const VideoFrame& other)
+    : pts(other.pts),
+      dts(other.dts),
+      is_key_frame(other.is_key_frame),
+      codec(other.codec),
+      rotation(other.rotation),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+VideoFrame& VideoFrame::operator=(const VideoFrame& other) {
+  if (this != &other) {
+    pts = other.pts;
+    dts = other.dts;
+    is_key_frame = other.is_key_frame;
+    codec = other.codec;
+    rotation = other.rotation;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(VideoFrame)
+
+PixelFrame::PixelFrame()
+    : pts(0),
+      width(0),
+      height(0),
+      format(VIDEO_PIXEL_FORMAT_YUV420p),
+      rotation(VIDEO_ROTATION_0),
+      handle_(new swing::PooledBuffer()) {}
+
+PixelFrame::PixelFrame(const PixelFrame& other)
+    : pts(other.pts),
+      width(other.width),
+      height(other.height),
+      format(other.format),
+      rotation(other.rotation),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+PixelFrame& PixelFrame::operator=(const PixelFrame& other) {
+  if (this != &other) {
+    pts = other.pts;
+    width = other.width;
+    height = other.height;
+    format = other.format;
+    rotation = other.rotation;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(PixelFrame)
+
+TrtcString::TrtcString() : str_(new std::string()) {}
+
+TrtcString::TrtcString(const char* str) : str_(new std::string(str != nullptr ? str : "")) {}
+
+TrtcString::TrtcString(const TrtcString& other)
+    : str_(new std::string(*static_cast<const std::string*>(other.str_))) {}
+
+TrtcString::~TrtcString() {
+  delete String(str_);
+}
+
+TrtcString& TrtcString::operator=(const char* str) {
+  String(str_)->assign(str != nullptr ? str : "");
+  return *this;
+}
+
+TrtcString& TrtcString::operator=(const TrtcString& other) {
+  if (this != &other) {
+    *String(str_) = *static_cast<const std::string*>(other.str_);
+  }
+  return *this;
+}
+
+void TrtcString::SetValue(const char* str) {
+  *this = str;
+}
+
+const char* TrtcString::GetValue() const {
+  return static_cast<const std::string*>(str_)->c_str();
+}
+
+TrtcBuffer::TrtcBuffer() : handle_(new swing::PooledBuffer()) {}
+
+TrtcBuffer::TrtcBuffer(const TrtcBuffer& other) : handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.cdata(), other.size());
+}
+
+TrtcBuffer& TrtcBuffer::operator=(const TrtcBuffer& other) {
+  if (this != &other) {
+    Buffer(handle_)->Assign(other.cdata(), other.size());
+  }
+  return *this;
+}
+
+TrtcBuffer::~TrtcBuffer() {
+  delete Buffer(handle_);
+}
+
+void TrtcBuffer::SetData(const uint8_t* data, size_t size) {
+  Buffer(handle_)->Assign(data, size);
+}
+
+void TrtcBuffer::SetSize(size_t size) {
+  Buffer(handle_)->Resize(size);
+}
+
+uint8_t* TrtcBuffer::data() {
+  return Buffer(handle_)->data();
+}
+
+const uint8_t* TrtcBuffer::cdata() const {
+  return Buffer(handle_)->data();
+}
+
+size_t TrtcBuffer::size() const {
+  return Buffer(handle_)->size();
+}
+
+EncryptionData::EncryptionData() : stream_type(STREAM_TYPE_UNKNOWN) {}
+
+EncryptionData::~EncryptionData() {}
+
+DecryptionData::DecryptionData() : stream_type(STREAM_TYPE_UNKNOWN) {}
+
+DecryptionData::~DecryptionData() {}
+
+RoomParams::RoomParams() {}
+
+RoomParams::RoomParams(const RoomParams& other)
+    : sdk_app_id(other.sdk_app_id),
+      user_id(other.user_id),
+      user_sig(other.user_sig),
+      room_id(other.room_id),
+      str_room_id(other.str_room_id),
+      custom_data(other.custom_data),
+      decryption_delegate(other.decryption_delegate),
+      encryption_delegate(other.encryption_delegate) {}
+
+RoomParams::~RoomParams() {}
+
+WatermarkConfig::WatermarkConfig() {}
+
+WatermarkConfig::WatermarkConfig(const WatermarkConfig& other)
+    : type(other.type),
+      offset_x(other.offset_x),
+      offset_y(other.offset_y),
+      width(other.width),
+      height(other.height),
+      path_to_font(other.path_to_font),
+      font_size(other.font_size),
+      content(other.content) {}
+
+WatermarkConfig::~WatermarkConfig() {}
+
+TrtcString WatermarkConfig::ToString() const {
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer), "{type: %d, x: %d, y: %d, width: %d, height: %d, font_size: %zu, ",
+           static_cast<int>(type), offset_x, offset_y, width, height, font_size);
+  std::string result(buffer);
+  result.append("content: ").append(content.GetValue()).append("}");
+  return TrtcString(result.c_str());
+}
+
+EnterRoomParams::EnterRoomParams()
+    : scene(TRTC_SCENE_VIDEO_CALL),
+      role(TRTC_ROLE_ANCHOR),
+      use_pixel_frame_input(false),
+      use_pixel_frame_output(false) {}
+
+EnterRoomParams::~EnterRoomParams() {}
+
+SingleRecordParams::SingleRecordParams() {}
+
+SingleRecordParams::SingleRecordParams(const SingleRecordParams& other)
+    : user_id(other.user_id), stream_type(other.stream_type) {}
+
+SingleRecordParams::~SingleRecordParams() {}
+
+TrtcString SingleRecordParams::ToString() const {
+  std::string result("{user_id: ");
+  result.append(user_id.GetValue())
+      .append(", stream_type: ")
+      .append(std::to_string(static_cast<int>(stream_type)))
+      .append("}");
+  return TrtcString(result.c_str());
+}
+
+MultiRecordParams::MultiRecordParams() {}
+
+MultiRecordParams::MultiRecordParams(const MultiRecordParams& other)
+    : width(other.width),
+      height(other.height),
+      video_frame_rate(other.video_frame_rate),
+      background_color(other.background_color),
+      layout_mode(other.layout_mode),
+      max_layout_count(other.max_layout_count) {}
+
+MultiRecordParams::~MultiRecordParams() {}
+
+TrtcString MultiRecordParams::ToString() const {
+  char buffer[160];
+  snprintf(buffer, sizeof(buffer),
+           "{width: %u, height: %u, video_frame_rate: %u, background_color: 0x%06x, "
+           "layout_mode: %d, max_layout_count: %u}",
+           width, height, video_frame_rate, background_color, static_cast<int>(layout_mode),
+           max_layout_count);
+  return TrtcString(buffer);
+}
+
+RecordParams::RecordParams() {}
+
+RecordParams::RecordParams(const RecordParams& other)
+    : file_format(other.file_format),
+      record_type(other.record_type),
+      storage_directory(other.storage_directory),
+      segment_duration_in_seconds(other.segment_duration_in_seconds),
+      record_mode(other.record_mode),
+      single_record_params(other.single_record_params),
+      multi_record_params(other.multi_record_params),
+      custom_data(other.custom_data) {}
+
+RecordParams::~RecordParams() {}
+
+TrtcString RecordParams::ToString() const {
+  char buffer[128];
+  snprintf(buffer, sizeof(buffer),
+           "{file_format: %d, record_type: %d, segment_duration_in_seconds: %u, record_mode: %d, ",
+           static_cast<int>(file_format), static_cast<int>(record_type),
+           segment_duration_in_seconds, static_cast<int>(record_mode));
+  std::string result(buffer);
+  result.append("storage_directory: ")
+      .append(storage_directory.GetValue())
+      .append(", single_record_params: ")
+      .append(single_record_params.ToString().GetValue())
+      .append(", multi_record_params: ")
+      .append(multi_record_params.ToString().GetValue())
+      .append("}");
+  return TrtcString(result.c_str());
+}
+
+LayoutParams::LayoutParams() {}
+
+LayoutParams::~LayoutParams() {}
+
+TrtcString LayoutParams::ToString() const {
+  char buffer[160];
+  snprintf(buffer, sizeof(buffer),
+           ", stream_type: %d, x: %u, y: %u, width: %u, height: %u, zorder: %u, mode: %d, "
+           "color: 0x%06x}",
+           static_cast<int>(stream_type), x, y, width, height, zorder, static_cast<int>(mode),
+           color);
+  std::string result("{user_id: ");
+  result.append(user_id.GetValue()).append(buffer);
+  return TrtcString(result.c_str());
+}
+
+}  // namespace trtc
+
+namespace live {
+
+AudioFrame::AudioFrame()
+    : sample_rate(48000),
+      channels(1),
+      bits_per_sample(16),
+      codec(AUDIO_CODEC_TYPE_PCM),
+      pts(0),
+      handle_(new swing::PooledBuffer()) {}
+
+AudioFrame::AudioFrame(const AudioFrame& other)
+    : sample_rate(other.sample_rate),
+      channels(other.channels),
+      bits_per_sample(other.bits_per_sample),
+      codec(other.codec),
+      pts(other.pts),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+AudioFrame& AudioFrame::operator=(const AudioFrame& other) {
+  if (this != &other) {
+    sample_rate = other.sample_rate;
+    channels = other.channels;
+    bits_per_sample = other.bits_per_sample;
+    codec = other.codec;
+    pts = other.pts;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(AudioFrame)
+
+VideoFrame::VideoFrame()
+    : pts(0),
+      dts(0),
+      is_key_frame(false),
+      codec(VIDEO_CODEC_TYPE_H264),
+      rotation(VIDEO_ROTATION_0),
+      handle_(new swing::PooledBuffer()) {}
+
+VideoFrame::VideoFrame(const VideoFrame& other)
+    : pts(other.pts),
+      dts(other.dts),
+      is_key_frame(other.is_key_frame),
+      codec(other.codec),
+      rotation(other.rotation),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+VideoFrame& VideoFrame::operator=(const VideoFrame& other) {
+  if (this != &other) {
+    pts = other.pts;
+    dts = other.dts;
+    is_key_frame = other.is_key_frame;
+    codec = other.codec;
+    rotation = other.rotation;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(VideoFrame)
+
+PixelFrame::PixelFrame()
+    : pts(0),
+      width(0),
+      height(0),
+      format(VIDEO_PIXEL_FORMAT_YUV420p),
+      rotation(VIDEO_ROTATION_0),
+      handle_(new swing::PooledBuffer()) {}
+
+PixelFrame::PixelFrame(const PixelFrame& other)
+    : pts(other.pts),
+      width(other.width),
+      height(other.height),
+      format(other.format),
+      rotation(other.rotation),
+      handle_(new swing::PooledBuffer()) {
+  Buffer(handle_)->Assign(other.data(), other.size());
+}
+
+PixelFrame& PixelFrame::operator=(const PixelFrame& other) {
+  if (this != &other) {
+    pts = other.pts;
+    width = other.width;
+    height = other.height;
+    format = other.format;
+    rotation = other.rotation;
+    Buffer(handle_)->Assign(other.data(), other.size());
+  }
+  return *this;
+}
+
+LOOPBACK_FRAME_DATA(PixelFrame)
+
+// 回环后端没有日志、代理和接入环境，全部直接成功
+bool TXLiveSDK::SetLogPath(const char* path) {
+  return true;
+}
+
+void TXLiveSDK::SetLogLevel(int level) {}
+
+void TXLiveSDK::EnableConsoleLog() {}
+
+void TXLiveSDK::DisableConsoleLog() {}
+
+bool TXLiveSDK::SetSocks5Proxy(const char* ip,
+                               unsigned short port,
+                               const char* username,
+                               const char* password) {
+  return true;
+}
+
+bool TXLiveSDK::SetEnvironment(const char* env) {
+  return true;
+}
+
+}  // namespace live
+}  // namespace liteav
+
+#undef LOOPBACK_FRAME_DATA
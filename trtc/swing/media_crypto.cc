@@ -0,0 +1,296 @@
+#include "media_crypto.h"
+
+#include <string.h>
+
+#include <random>
+
+#include "aes_kernels.h"
+
+namespace swing {
+
+namespace {
+
+const size_t kNonceSize = 12;
+const size_t kHeaderSize = 1 + kNonceSize;
+const size_t kTagSize = 16;
+
+// GCM 分段处理，CTR 写出的密文还在 L1 里时接着做 GHASH
+const size_t kGcmChunkSize = 4096;
+
+// 回调线程最近一次命中的密钥
+struct KeyCache {
+  KeyCache() : owner(nullptr), version(0), stream_type(liteav::trtc::STREAM_TYPE_UNKNOWN) {}
+
+  const void* owner;
+  uint64_t version;
+  StreamType stream_type;
+  std::string user_id;
+  std::shared_ptr<const void> key;
+};
+
+thread_local KeyCache t_key_cache;
+
+// 所有实例共用，保证不同实例、同一地址先后创建的实例版本号都不相同
+std::atomic<uint64_t> g_key_version(0);
+
+uint64_t NextKeyVersion() {
+  return g_key_version.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void StoreBE32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v >> 24);
+  p[1] = static_cast<uint8_t>(v >> 16);
+  p[2] = static_cast<uint8_t>(v >> 8);
+  p[3] = static_cast<uint8_t>(v);
+}
+
+void StoreBE64(uint8_t* p, uint64_t v) {
+  StoreBE32(p, static_cast<uint32_t>(v >> 32));
+  StoreBE32(p + 4, static_cast<uint32_t>(v));
+}
+
+uint64_t KeySlot(uint32_t user, StreamType stream_type) {
+  return (static_cast<uint64_t>(user) << 32) | static_cast<uint32_t>(stream_type);
+}
+
+// J0 = nonce || 0x00000001，载荷从 inc32(J0) 开始
+// |counter| 为第 |block_index| 个载荷分组的计数块
+void CounterBlock(const uint8_t* nonce, uint32_t block_index, uint8_t counter[16]) {
+  memcpy(counter, nonce, kNonceSize);
+  StoreBE32(counter + kNonceSize, 2 + block_index);
+}
+
+}  // namespace
+
+struct MediaCipher::CipherKey {
+  AesKey aes;
+  GhashKey ghash;
+};
+
+MediaCipher::MediaCipher(CipherMode mode)
+    : mode_(mode),
+      salt_(0),
+      sequence_(0),
+      failures_(0),
+      version_(NextKeyVersion()),
+      users_(kMaxKeyUsers) {
+  // random_device 每次返回 32 位，三次共 96 位
+  std::random_device random;
+  salt_ = random();
+  const uint64_t high = random();
+  sequence_.store((high << 32) | random(), std::memory_order_relaxed);
+}
+
+MediaCipher::~MediaCipher() {}
+
+int MediaCipher::SetDefaultKey(const std::string& key) {
+  std::shared_ptr<CipherKey> expanded(new CipherKey);
+  if (!AesExpandKey(reinterpret_cast<const uint8_t*>(key.data()), key.size(), &expanded->aes)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  GhashInit(expanded->aes, &expanded->ghash);
+  std::lock_guard<std::mutex> lock(mutex_);
+  default_key_ = expanded;
+  version_.store(NextKeyVersion(), std::memory_order_release);
+  return liteav::trtc::ERR_OK;
+}
+
+int MediaCipher::SetKey(const char* user_id, StreamType stream_type, const std::string& key) {
+  if (user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::shared_ptr<CipherKey> expanded(new CipherKey);
+  if (!AesExpandKey(reinterpret_cast<const uint8_t*>(key.data()), key.size(), &expanded->aes)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  GhashInit(expanded->aes, &expanded->ghash);
+  // 驻留与 RemoveKey() 归还句柄都在 |mutex_| 下，句柄不会在写入前被归还
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t user = users_.Intern(user_id);
+  if (user == kInvalidUser) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  keys_[KeySlot(user, stream_type)] = expanded;
+  version_.store(NextKeyVersion(), std::memory_order_release);
+  return liteav::trtc::ERR_OK;
+}
+
+int MediaCipher::RemoveKey(const char* user_id, StreamType stream_type) {
+  if (user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t user = users_.Find(user_id);
+  if (user == kInvalidUser || keys_.erase(KeySlot(user, stream_type)) == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  // 用户的密钥全部移除后归还句柄，kMaxKeyUsers 限制的是同时持有密钥的用户数
+  std::map<uint64_t, std::shared_ptr<const CipherKey> >::const_iterator it =
+      keys_.lower_bound(static_cast<uint64_t>(user) << 32);
+  if (it == keys_.end() || (it->first >> 32) != user) {
+    users_.Release(user);
+  }
+  version_.store(NextKeyVersion(), std::memory_order_release);
+  return liteav::trtc::ERR_OK;
+}
+
+size_t MediaCipher::Overhead() const {
+  return kHeaderSize + (mode_ == kCipherAesGcm ? kTagSize : 0);
+}
+
+std::shared_ptr<const MediaCipher::CipherKey> MediaCipher::FindKey(const char* user_id,
+                                                                   StreamType stream_type) {
+  if (user_id == nullptr) {
+    user_id = "";
+  }
+  KeyCache& cache = t_key_cache;
+  if (cache.owner == this && cache.version == version_.load(std::memory_order_acquire) &&
+      cache.stream_type == stream_type && cache.user_id == user_id) {
+    return std::static_pointer_cast<const CipherKey>(cache.key);
+  }
+
+  std::shared_ptr<const CipherKey> key;
+  uint64_t version;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    version = version_.load(std::memory_order_relaxed);
+    // 在锁内查句柄，避免句柄在查表前被归还并分配给其他用户
+    const uint32_t user = users_.Find(user_id);
+    if (user != kInvalidUser) {
+      std::map<uint64_t, std::shared_ptr<const CipherKey> >::const_iterator it =
+          keys_.find(KeySlot(user, stream_type));
+      if (it == keys_.end()) {
+        it = keys_.find(KeySlot(user, liteav::trtc::STREAM_TYPE_UNKNOWN));
+      }
+      if (it != keys_.end()) {
+        key = it->second;
+      }
+    }
+    if (!key) {
+      key = default_key_;
+    }
+  }
+  cache.owner = this;
+  cache.version = version;
+  cache.stream_type = stream_type;
+  cache.user_id = user_id;
+  cache.key = key;
+  return key;
+}
+
+bool MediaCipher::OnDataEncrypt(EncryptionData& data) {
+  if (data.decrypted == nullptr || data.encrypted == nullptr) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  std::shared_ptr<const CipherKey> key = FindKey(data.user_id.GetValue(), data.stream_type);
+  if (!key) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const size_t length = data.decrypted->size();
+  data.encrypted->SetSize(length + Overhead());
+  return Encrypt(*key, data.decrypted->cdata(), length, data.encrypted->data());
+}
+
+bool MediaCipher::OnDataDecrypt(DecryptionData& data) {
+  if (data.encrypted == nullptr || data.decrypted == nullptr ||
+      data.encrypted->size() < Overhead()) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  std::shared_ptr<const CipherKey> key = FindKey(data.user_id.GetValue(), data.stream_type);
+  if (!key) {
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  const size_t length = data.encrypted->size() - Overhead();
+  data.decrypted->SetSize(length);
+  if (!Decrypt(*key, data.encrypted->cdata(), length, data.decrypted->data())) {
+    data.decrypted->SetSize(0);
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+bool MediaCipher::Encrypt(const CipherKey& key, const uint8_t* in, size_t length, uint8_t* out) {
+  out[0] = static_cast<uint8_t>(mode_);
+  StoreBE32(out + 1, salt_);
+  StoreBE64(out + 5, sequence_.fetch_add(1, std::memory_order_relaxed));
+  const uint8_t* nonce = out + 1;
+  uint8_t* payload = out + kHeaderSize;
+
+  uint8_t counter[16];
+  if (mode_ == kCipherAesCtr) {
+    CounterBlock(nonce, 0, counter);
+    AesCtrXor(key.aes, counter, in, payload, length);
+    return true;
+  }
+
+  uint8_t state[16] = {0};
+  GhashUpdate(key.ghash, state, out, kHeaderSize);
+  for (size_t offset = 0; offset < length; offset += kGcmChunkSize) {
+    size_t n = length - offset < kGcmChunkSize ? length - offset : kGcmChunkSize;
+    CounterBlock(nonce, static_cast<uint32_t>(offset / kAesBlockSize), counter);
+    AesCtrXor(key.aes, counter, in + offset, payload + offset, n);
+    GhashUpdate(key.ghash, state, payload + offset, n);
+  }
+  uint8_t lengths[16];
+  StoreBE64(lengths, static_cast<uint64_t>(kHeaderSize) * 8);
+  StoreBE64(lengths + 8, static_cast<uint64_t>(length) * 8);
+  GhashUpdate(key.ghash, state, lengths, sizeof(lengths));
+
+  uint8_t j0[16];
+  memcpy(j0, nonce, kNonceSize);
+  StoreBE32(j0 + kNonceSize, 1);
+  uint8_t mask[16];
+  AesEncryptBlock(key.aes, j0, mask);
+  uint8_t* tag = payload + length;
+  for (size_t i = 0; i < kTagSize; ++i) {
+    tag[i] = state[i] ^ mask[i];
+  }
+  return true;
+}
+
+bool MediaCipher::Decrypt(const CipherKey& key, const uint8_t* in, size_t length, uint8_t* out) {
+  if (in[0] != static_cast<uint8_t>(mode_)) {
+    return false;
+  }
+  const uint8_t* nonce = in + 1;
+  const uint8_t* payload = in + kHeaderSize;
+
+  uint8_t counter[16];
+  CounterBlock(nonce, 0, counter);
+  if (mode_ == kCipherAesCtr) {
+    AesCtrXor(key.aes, counter, payload, out, length);
+    return true;
+  }
+
+  // 先认证再解密，认证失败时不输出明文
+  uint8_t state[16] = {0};
+  GhashUpdate(key.ghash, state, in, kHeaderSize);
+  GhashUpdate(key.ghash, state, payload, length);
+  uint8_t lengths[16];
+  StoreBE64(lengths, static_cast<uint64_t>(kHeaderSize) * 8);
+  StoreBE64(lengths + 8, static_cast<uint64_t>(length) * 8);
+  GhashUpdate(key.ghash, state, lengths, sizeof(lengths));
+
+  uint8_t j0[16];
+  memcpy(j0, nonce, kNonceSize);
+  StoreBE32(j0 + kNonceSize, 1);
+  uint8_t mask[16];
+  AesEncryptBlock(key.aes, j0, mask);
+  const uint8_t* tag = payload + length;
+  uint8_t diff = 0;
+  for (size_t i = 0; i < kTagSize; ++i) {
+    diff |= static_cast<uint8_t>(tag[i] ^ state[i] ^ mask[i]);
+  }
+  if (diff != 0) {
+    return false;
+  }
+  AesCtrXor(key.aes, counter, payload, out, length);
+  return true;
+}
+
+}  // namespace swing
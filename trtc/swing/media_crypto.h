@@ -0,0 +1,119 @@
+//
+// 功能说明：
+//   自定义音视频加解密（RoomParams::encryption_delegate / decryption_delegate）的
+//   AES-GCM / AES-CTR 实现，分组运算见 aes_kernels.h（VAES / AES-NI / 标量）。
+//
+//   密钥按 (用户, StreamType) 配置，查找顺序：
+//   (user_id, stream_type) -> (user_id, STREAM_TYPE_UNKNOWN) -> 默认密钥。
+//   加密时 user_id 为本端用户，解密时为远端发送者，因此各端用同一份配置即可互通。
+//   用户 ID 在设置密钥时经 UserInterner 驻留为整数，回调线程缓存最近一次命中的密钥，
+//   同一路流连续的包不需要加锁查表。
+//
+//   密文格式：
+//     [1 字节模式][12 字节 nonce][密文][16 字节 GCM 标签，仅 GCM]
+//   nonce 为 96 位：实例创建时随机取 32 位前缀与 64 位计数起点，每包计数加一；
+//   GCM 以模式字节和 nonce 作为附加认证数据。
+//
+//   密钥共享规则：同一密钥可以由任意多个实例（发送端、进程重启）共用，
+//   nonce 起点随机，不同实例之间 (key, nonce) 重复的概率可忽略，但每个密钥
+//   在所有发送端累计加密的包数应低于 2^32（随机 nonce 的 GCM 使用上限），
+//   超出前需要换密钥。不要把随机数不可靠的环境（如克隆后不重新播种的虚拟机）
+//   下创建的实例与其他实例共用密钥。
+//   加解密结果直接写入回调给出的 |encrypted| / |decrypted|，SDK 复用这两个缓冲时
+//   容量足够便不会重新分配，也不经过中间缓冲。
+//
+//   线程安全：回调可在任意线程并发执行，密钥可随时更新。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_MEDIA_CRYPTO_H_
+#define GCHATGPT_TRTC_SWING_MEDIA_CRYPTO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "user_interner.h"
+
+namespace swing {
+
+using liteav::trtc::DecryptionData;
+using liteav::trtc::DecryptionDelegate;
+using liteav::trtc::EncryptionData;
+using liteav::trtc::EncryptionDelegate;
+using liteav::trtc::StreamType;
+
+enum CipherMode {
+  kCipherAesGcm = 1,
+  kCipherAesCtr = 2,
+};
+
+class MediaCipher : public EncryptionDelegate, public DecryptionDelegate {
+ public:
+  static const size_t kMaxKeyUsers = 4096;
+
+  explicit MediaCipher(CipherMode mode);
+  ~MediaCipher() override;
+
+  // |key| 长度为 16、24 或 32 字节，对应 AES-128 / 192 / 256
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：密钥长度不合法
+  int SetDefaultKey(const std::string& key);
+
+  // |stream_type| 为 STREAM_TYPE_UNKNOWN 时对该用户的所有流生效
+  // 除上述返回值外，同时持有密钥的用户超过 kMaxKeyUsers 时返回 ERR_INVALID_OPERATION，
+  // 用户的密钥全部移除后不再计入。
+  int SetKey(const char* user_id, StreamType stream_type, const std::string& key);
+
+  // 移除 SetKey() 设置的密钥，不存在时返回 ERR_INVALID_PARAMETER
+  int RemoveKey(const char* user_id, StreamType stream_type);
+
+  // 供 RoomParams 使用，多重继承在 Go 侧无法直接向上转换
+  EncryptionDelegate* encryption_delegate() { return this; }
+  DecryptionDelegate* decryption_delegate() { return this; }
+
+  CipherMode mode() const { return mode_; }
+
+  // 每个包增加的字节数
+  size_t Overhead() const;
+
+  // 没有可用密钥、包格式错误或 GCM 认证失败而丢弃的包数
+  uint64_t Failures() const { return failures_.load(std::memory_order_relaxed); }
+
+  bool OnDataEncrypt(EncryptionData& data) override;
+  bool OnDataDecrypt(DecryptionData& data) override;
+
+ private:
+  struct CipherKey;
+
+  MediaCipher(const MediaCipher&);
+  MediaCipher& operator=(const MediaCipher&);
+
+  std::shared_ptr<const CipherKey> FindKey(const char* user_id, StreamType stream_type);
+  bool Encrypt(const CipherKey& key, const uint8_t* in, size_t length, uint8_t* out);
+  bool Decrypt(const CipherKey& key, const uint8_t* in, size_t length, uint8_t* out);
+
+  const CipherMode mode_;
+  // nonce 的随机前缀与计数，计数起点也是随机的
+  uint32_t salt_;
+  std::atomic<uint64_t> sequence_;
+  std::atomic<uint64_t> failures_;
+
+  // 密钥变更时更新，取全局递增值，回调线程据此判断缓存是否失效
+  std::atomic<uint64_t> version_;
+
+  std::mutex mutex_;
+  UserInterner users_;
+  std::map<uint64_t, std::shared_ptr<const CipherKey> > keys_;
+  std::shared_ptr<const CipherKey> default_key_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_MEDIA_CRYPTO_H_
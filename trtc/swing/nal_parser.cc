@@ -0,0 +1,297 @@
+#include "nal_parser.h"
+
+#include <string.h>
+
+namespace swing {
+
+namespace {
+
+// 去掉防竞争字节 0x000003 中的 03
+std::vector<uint8_t> UnescapeRbsp(const uint8_t* data, size_t size) {
+  std::vector<uint8_t> rbsp;
+  rbsp.reserve(size);
+  int zeros = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (zeros >= 2 && data[i] == 0x03) {
+      zeros = 0;
+      continue;
+    }
+    zeros = data[i] == 0 ? zeros + 1 : 0;
+    rbsp.push_back(data[i]);
+  }
+  return rbsp;
+}
+
+// 指数哥伦布码读取，越界后 ok() 为 false，读数返回 0
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, size_t size) : data_(data), size_(size), bit_(0), ok_(true) {}
+
+  uint32_t Bits(int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i) {
+      if (bit_ >= size_ * 8) {
+        ok_ = false;
+        return 0;
+      }
+      value = (value << 1) | ((data_[bit_ >> 3] >> (7 - (bit_ & 7))) & 1);
+      ++bit_;
+    }
+    return value;
+  }
+
+  void Skip(size_t count) {
+    bit_ += count;
+    if (bit_ > size_ * 8) {
+      ok_ = false;
+    }
+  }
+
+  uint32_t Ue() {
+    int zeros = 0;
+    while (Bits(1) == 0) {
+      if (!ok_ || ++zeros > 31) {
+        ok_ = false;
+        return 0;
+      }
+    }
+    return zeros == 0 ? 0 : ((1u << zeros) - 1) + Bits(zeros);
+  }
+
+  int32_t Se() {
+    uint32_t value = Ue();
+    return (value & 1) ? static_cast<int32_t>((value + 1) / 2)
+                       : -static_cast<int32_t>(value / 2);
+  }
+
+  bool ok() const { return ok_; }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t bit_;
+  bool ok_;
+};
+
+void SkipScalingList(BitReader* reader, int size) {
+  int last = 8;
+  int next = 8;
+  for (int j = 0; j < size; ++j) {
+    if (next != 0) {
+      next = (last + reader->Se() + 256) % 256;
+    }
+    last = next == 0 ? last : next;
+  }
+}
+
+bool ParseH264Sps(const std::vector<uint8_t>& rbsp, VideoParameterSets* sets) {
+  BitReader reader(rbsp.data(), rbsp.size());
+  reader.Skip(8);  // NAL 头
+  const uint32_t profile_idc = reader.Bits(8);
+  reader.Skip(16);  // constraint_set 标志与 level_idc
+  reader.Ue();      // seq_parameter_set_id
+  uint32_t chroma_format_idc = 1;
+  if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 || profile_idc == 244 ||
+      profile_idc == 44 || profile_idc == 83 || profile_idc == 86 || profile_idc == 118 ||
+      profile_idc == 128 || profile_idc == 138 || profile_idc == 139 || profile_idc == 134 ||
+      profile_idc == 135) {
+    chroma_format_idc = reader.Ue();
+    if (chroma_format_idc == 3) {
+      reader.Skip(1);  // separate_colour_plane_flag
+    }
+    reader.Ue();      // bit_depth_luma_minus8
+    reader.Ue();      // bit_depth_chroma_minus8
+    reader.Skip(1);   // qpprime_y_zero_transform_bypass_flag
+    if (reader.Bits(1)) {
+      const int lists = chroma_format_idc != 3 ? 8 : 12;
+      for (int i = 0; i < lists; ++i) {
+        if (reader.Bits(1)) {
+          SkipScalingList(&reader, i < 6 ? 16 : 64);
+        }
+      }
+    }
+  }
+  reader.Ue();  // log2_max_frame_num_minus4
+  const uint32_t poc_type = reader.Ue();
+  if (poc_type == 0) {
+    reader.Ue();
+  } else if (poc_type == 1) {
+    reader.Skip(1);
+    reader.Se();
+    reader.Se();
+    const uint32_t cycle = reader.Ue();
+    for (uint32_t i = 0; i < cycle && reader.ok(); ++i) {
+      reader.Se();
+    }
+  }
+  reader.Ue();     // max_num_ref_frames
+  reader.Skip(1);  // gaps_in_frame_num_value_allowed_flag
+  const uint32_t width_in_mbs = reader.Ue() + 1;
+  const uint32_t height_in_map_units = reader.Ue() + 1;
+  const uint32_t frame_mbs_only = reader.Bits(1);
+  if (!frame_mbs_only) {
+    reader.Skip(1);  // mb_adaptive_frame_field_flag
+  }
+  reader.Skip(1);  // direct_8x8_inference_flag
+  uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+  if (reader.Bits(1)) {
+    crop_left = reader.Ue();
+    crop_right = reader.Ue();
+    crop_top = reader.Ue();
+    crop_bottom = reader.Ue();
+  }
+  if (!reader.ok()) {
+    return false;
+  }
+  const uint32_t crop_unit_x = chroma_format_idc == 1 || chroma_format_idc == 2 ? 2 : 1;
+  const uint32_t crop_unit_y =
+      (chroma_format_idc == 1 ? 2 : 1) * (2 - frame_mbs_only);
+  sets->width = static_cast<int>(width_in_mbs * 16 - crop_unit_x * (crop_left + crop_right));
+  sets->height = static_cast<int>((2 - frame_mbs_only) * height_in_map_units * 16 -
+                                  crop_unit_y * (crop_top + crop_bottom));
+  return sets->width > 0 && sets->height > 0;
+}
+
+bool ParseH265Sps(const std::vector<uint8_t>& rbsp, VideoParameterSets* sets) {
+  // NAL 头 2 字节 + vps_id / max_sub_layers / temporal_id_nesting 1 字节 + PTL 12 字节
+  if (rbsp.size() < 15) {
+    return false;
+  }
+  BitReader reader(rbsp.data(), rbsp.size());
+  reader.Skip(16);
+  reader.Skip(4);  // sps_video_parameter_set_id
+  const uint32_t max_sub_layers_minus1 = reader.Bits(3);
+  sets->max_sub_layers = static_cast<int>(max_sub_layers_minus1) + 1;
+  sets->temporal_id_nesting = reader.Bits(1) != 0;
+  memcpy(sets->general_profile_tier_level, rbsp.data() + 3, 12);
+  reader.Skip(96);
+
+  bool sub_profile[8] = {false};
+  bool sub_level[8] = {false};
+  for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+    sub_profile[i] = reader.Bits(1) != 0;
+    sub_level[i] = reader.Bits(1) != 0;
+  }
+  if (max_sub_layers_minus1 > 0) {
+    reader.Skip(2 * (8 - max_sub_layers_minus1));
+  }
+  for (uint32_t i = 0; i < max_sub_layers_minus1; ++i) {
+    if (sub_profile[i]) {
+      reader.Skip(88);
+    }
+    if (sub_level[i]) {
+      reader.Skip(8);
+    }
+  }
+
+  reader.Ue();  // sps_seq_parameter_set_id
+  const uint32_t chroma_format_idc = reader.Ue();
+  bool separate_colour_plane = false;
+  if (chroma_format_idc == 3) {
+    separate_colour_plane = reader.Bits(1) != 0;
+  }
+  const uint32_t width = reader.Ue();
+  const uint32_t height = reader.Ue();
+  uint32_t left = 0, right = 0, top = 0, bottom = 0;
+  if (reader.Bits(1)) {
+    left = reader.Ue();
+    right = reader.Ue();
+    top = reader.Ue();
+    bottom = reader.Ue();
+  }
+  const uint32_t bit_depth_luma = reader.Ue() + 8;
+  const uint32_t bit_depth_chroma = reader.Ue() + 8;
+  if (!reader.ok()) {
+    return false;
+  }
+  const uint32_t chroma_array_type = separate_colour_plane ? 0 : chroma_format_idc;
+  const uint32_t sub_width = chroma_array_type == 1 || chroma_array_type == 2 ? 2 : 1;
+  const uint32_t sub_height = chroma_array_type == 1 ? 2 : 1;
+  sets->width = static_cast<int>(width - sub_width * (left + right));
+  sets->height = static_cast<int>(height - sub_height * (top + bottom));
+  sets->chroma_format_idc = static_cast<int>(chroma_format_idc);
+  sets->bit_depth_luma = static_cast<int>(bit_depth_luma);
+  sets->bit_depth_chroma = static_cast<int>(bit_depth_chroma);
+  return sets->width > 0 && sets->height > 0;
+}
+
+}  // namespace
+
+bool SplitAnnexB(VideoCodecType codec,
+                 const uint8_t* data,
+                 size_t size,
+                 std::vector<NalUnit>* out) {
+  if (size < 4 || data[0] != 0 || data[1] != 0 ||
+      !(data[2] == 1 || (data[2] == 0 && data[3] == 1))) {
+    return false;
+  }
+  size_t i = 0;
+  size_t start = 0;
+  bool in_nal = false;
+  while (i + 2 < size) {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+      if (in_nal) {
+        size_t end = i;
+        // 4 字节起始码的前导 0 不属于上一个 NAL
+        while (end > start && data[end - 1] == 0) {
+          --end;
+        }
+        if (end > start) {
+          NalUnit nal = {data + start, end - start, NalType(codec, data[start])};
+          out->push_back(nal);
+        }
+      }
+      i += 3;
+      start = i;
+      in_nal = true;
+      continue;
+    }
+    ++i;
+  }
+  if (in_nal && start < size) {
+    NalUnit nal = {data + start, size - start, NalType(codec, data[start])};
+    out->push_back(nal);
+  }
+  return true;
+}
+
+int NalType(VideoCodecType codec, uint8_t first_byte) {
+  return codec == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? (first_byte >> 1) & 0x3f
+                                                      : first_byte & 0x1f;
+}
+
+bool IsParameterSetNal(VideoCodecType codec, int type) {
+  if (codec == liteav::trtc::VIDEO_CODEC_TYPE_H265) {
+    return type == 32 || type == 33 || type == 34;
+  }
+  return type == 7 || type == 8;
+}
+
+bool IsKeyframeNal(VideoCodecType codec, int type) {
+  if (codec == liteav::trtc::VIDEO_CODEC_TYPE_H265) {
+    return type >= 16 && type <= 21;
+  }
+  return type == 5;
+}
+
+bool IsAccessUnitDelimiter(VideoCodecType codec, int type) {
+  return codec == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? type == 35 : type == 9;
+}
+
+bool VideoParameterSets::Complete(VideoCodecType codec) const {
+  if (sps.empty() || pps.empty() || width <= 0 || height <= 0) {
+    return false;
+  }
+  return codec != liteav::trtc::VIDEO_CODEC_TYPE_H265 || !vps.empty();
+}
+
+bool ParseSps(VideoCodecType codec, const uint8_t* sps, size_t size, VideoParameterSets* sets) {
+  if (sps == nullptr || size < 4) {
+    return false;
+  }
+  std::vector<uint8_t> rbsp = UnescapeRbsp(sps, size);
+  return codec == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? ParseH265Sps(rbsp, sets)
+                                                      : ParseH264Sps(rbsp, sets);
+}
+
+}  // namespace swing
@@ -0,0 +1,84 @@
+//
+// 功能说明：
+//   H.264 / H.265 Annex-B 码流解析：按起始码切分 NAL、识别参数集与关键帧、
+//   从 SPS 解析分辨率等封装所需的信息。只解析封装层需要的字段，不做解码。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_NAL_PARSER_H_
+#define GCHATGPT_TRTC_SWING_NAL_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+
+namespace swing {
+
+using liteav::trtc::VideoCodecType;
+
+// 一个 NAL 单元，不含起始码，指向输入缓冲
+struct NalUnit {
+  const uint8_t* data;
+  size_t size;
+  int type;
+};
+
+// 按 3 / 4 字节起始码切分，结果追加到 |out|
+// 返回 false 表示数据不以起始码开头。
+bool SplitAnnexB(VideoCodecType codec,
+                 const uint8_t* data,
+                 size_t size,
+                 std::vector<NalUnit>* out);
+
+// NAL 类型：H.264 取首字节低 5 位，H.265 取首字节的第 1~6 位
+int NalType(VideoCodecType codec, uint8_t first_byte);
+
+// H.264 的 SPS / PPS，H.265 的 VPS / SPS / PPS
+bool IsParameterSetNal(VideoCodecType codec, int type);
+
+// IDR / IRAP
+bool IsKeyframeNal(VideoCodecType codec, int type);
+
+// 访问单元分隔符、SEI 等封装时不需要单独保留的 NAL
+bool IsAccessUnitDelimiter(VideoCodecType codec, int type);
+
+// 从参数集中解析出的信息
+struct VideoParameterSets {
+  VideoParameterSets()
+      : width(0),
+        height(0),
+        chroma_format_idc(1),
+        bit_depth_luma(8),
+        bit_depth_chroma(8),
+        max_sub_layers(1),
+        temporal_id_nesting(false) {}
+
+  // 原始 NAL（不含起始码），H.264 时 |vps| 为空
+  std::string vps;
+  std::string sps;
+  std::string pps;
+
+  int width;
+  int height;
+
+  // 以下仅 H.265 使用
+  int chroma_format_idc;
+  int bit_depth_luma;
+  int bit_depth_chroma;
+  int max_sub_layers;
+  bool temporal_id_nesting;
+  // general_profile_space 到 general_level_idc 的 12 字节
+  uint8_t general_profile_tier_level[12];
+
+  bool Complete(VideoCodecType codec) const;
+};
+
+// 解析 SPS 填充 |sets| 的分辨率等字段，|sps| 不含起始码
+bool ParseSps(VideoCodecType codec, const uint8_t* sps, size_t size, VideoParameterSets* sets);
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_NAL_PARSER_H_
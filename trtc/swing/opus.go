@@ -0,0 +1,9 @@
+//go:build opus
+
+package swing
+
+// 以 go build -tags opus 构建时链接 libopus，AudioEncoderPool 可用 Opus 编码，见 audio_encoder_pool.h
+
+// #cgo pkg-config: opus
+// #cgo CXXFLAGS: -DSWING_HAVE_OPUS
+import "C"
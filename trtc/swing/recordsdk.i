@@ -11,6 +11,12 @@
 %feature("director") RoomDelegate;
 %feature("director") RecordDelegate;
 %feature("director") V2TXLivePlayerDelegate;
+%feature("director") swing::FrameSink;
+%feature("director") swing::AudioPullSink;
+%feature("director") swing::SeiMessageSink;
+%feature("director") swing::FanoutSink;
+%feature("director") swing::VadListener;
+%feature("director") swing::EncodedAudioSink;
 
 
 // "%{" 和 “}%” 的内容原样输出到转换后的 c++ 文件中
@@ -25,6 +31,28 @@
 #include "../include/live/liteav_live_player.h"
 #include "../include/live/liteav_live_premier.h"
 #include "../include/live/liteav_live_pusher.h"
+#include "frame_view.h"
+#include "frame_pool.h"
+#include "data_event.h"
+#include "user_interner.h"
+#include "frame_dispatcher.h"
+#include "audio_puller.h"
+#include "room_manager.h"
+#include "video_compositor.h"
+#include "audio_kernels.h"
+#include "audio_mixer.h"
+#include "audio_resampler.h"
+#include "media_crypto.h"
+#include "sei_mux.h"
+#include "stream_muxer.h"
+#include "video_jitter_buffer.h"
+#include "gop_cache.h"
+#include "fanout_hub.h"
+#include "subscription_manager.h"
+#include "watermark_renderer.h"
+#include "vad_gate.h"
+#include "audio_encoder_pool.h"
+#include "frame_pacer.h"
 
 %}
 
@@ -39,6 +67,100 @@
 #include "../include/live/liteav_live_premier.h"
 #include "../include/live/liteav_live_pusher.h"
 
+// 借用视图：ByteSpan 直接映射为指向 SDK 缓冲的 []byte，不复制
+// C 包装函数以 _goslice_ 返回，$result 才有 array / len / cap 字段
+%typemap(gotype) swing::ByteSpan "[]byte"
+%typemap(imtype) swing::ByteSpan "[]byte"
+%typemap(ctype) swing::ByteSpan "_goslice_"
+%typemap(out) swing::ByteSpan %{
+  $result.array = (void*)$1.data;
+  $result.len = (intgo)$1.size;
+  $result.cap = (intgo)$1.size;
+%}
+
+%insert(go_wrapper) %{
+
+// ViewBytes 返回借用视图的数据，不复制；视图过期时返回 nil。
+// 仅可在帧回调内使用，回调返回后需要保留数据请调用 RetainView()。
+func ViewBytes(v FrameView) []byte {
+	b := v.Bytes()
+	if len(b) == 0 {
+		return nil
+	}
+	return b[:len(b):len(b)]
+}
+
+// RetainView 复制视图数据，返回值在调用 Release() 前一直有效。
+// 视图已过期时返回 nil。
+func RetainView(v FrameView) RetainedFrame {
+	r := RetainedFrameRetain(v)
+	if r.Swigcptr() == 0 {
+		return nil
+	}
+	return r
+}
+
+%}
+
 // 重命名接口首字母大写
 %rename("%(firstuppercase)s", %$isfunction) "";
 
+// 媒体胶水层
+%include "frame_view.h"
+
+%ignore swing::PooledBuffer::PooledBuffer(PooledBuffer&&);
+%ignore swing::PooledBuffer::operator=;
+%include "frame_pool.h"
+
+%include "data_event.h"
+
+%include "user_interner.h"
+
+%ignore swing::RingFrame::payload;
+%include "frame_dispatcher.h"
+
+// Go 侧用 Drain() 批量取帧，数组形式的 GetAudioFrames() 供 C++ 调用
+%ignore swing::AudioPuller::GetAudioFrames;
+%include "audio_puller.h"
+
+// std::function 无法映射到 Go，Go 侧在 FrameSink 回调中处理即可
+%ignore swing::RoomManager::Post;
+%include "room_manager.h"
+
+%include "video_compositor.h"
+
+%include "audio_kernels.h"
+%include "audio_mixer.h"
+
+%ignore swing::AudioResampler::Process(const int16_t*, size_t, int, int, std::vector<int16_t>*);
+%include "audio_resampler.h"
+
+// 多重继承无法在 Go 侧向上转换，经 Encryption_delegate() / Decryption_delegate() 传给 RoomParams
+%ignore swing::MediaCipher::OnDataEncrypt;
+%ignore swing::MediaCipher::OnDataDecrypt;
+%include "media_crypto.h"
+
+// Go 侧使用 string 版本的 Enqueue() 与 Flush()
+%ignore swing::SeiMuxer::Enqueue(int, const uint8_t*, size_t);
+%ignore swing::SeiMuxer::Pack;
+%include "sei_mux.h"
+
+%include "stream_muxer.h"
+
+%include "video_jitter_buffer.h"
+
+%include "gop_cache.h"
+
+%include "fanout_hub.h"
+
+%include "subscription_manager.h"
+%include "watermark_renderer.h"
+%include "vad_gate.h"
+
+// 编码器与工厂只在 C++ 侧实现，Go 侧通过 EncodedAudioSink 取编码结果
+%ignore swing::AudioEncoder;
+%ignore swing::AudioEncoderFactory;
+%ignore swing::CreateOpusEncoder;
+%ignore swing::AudioEncoderPoolConfig::factory;
+%include "audio_encoder_pool.h"
+%include "frame_pacer.h"
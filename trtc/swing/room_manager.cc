@@ -0,0 +1,430 @@
+#include "room_manager.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "data_event.h"
+
+namespace swing {
+
+using liteav::trtc::TrtcString;
+
+namespace {
+
+// 没有帧和任务时的最长等待，用于按时刷新繁忙比例
+const int kIdleWaitMs = 100;
+
+const int64_t kLoadWindowNs = 1000000000;
+
+// 繁忙比例相差不超过该值时按实例个数分配
+const double kUtilizationTolerance = 0.05;
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 当前进程允许运行的 CPU
+std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+}  // namespace
+
+class RoomManager::Shard {
+ public:
+  Shard(int cpu, size_t max_frames_per_stream)
+      : max_frames_per_stream_(max_frames_per_stream),
+        cpu_(cpu),
+        instances_(0),
+        frames_(0),
+        tasks_run_(0),
+        busy_ns_(0),
+        utilization_(0),
+        running_(true) {
+    thread_ = std::thread(&Shard::Run, this);
+  }
+
+  ~Shard() {
+    running_.store(false, std::memory_order_release);
+    event_.Notify();
+    thread_.join();
+  }
+
+  DataEvent* event() { return &event_; }
+
+  void Post(const std::function<void()>& task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(task);
+    }
+    event_.Notify();
+  }
+
+  // 在分片线程上执行并等待完成，在分片线程上调用时直接执行
+  void RunSync(const std::function<void()>& task) {
+    if (std::this_thread::get_id() == thread_.get_id()) {
+      task();
+      return;
+    }
+    std::promise<void> done;
+    std::future<void> future = done.get_future();
+    Post([&task, &done]() {
+      task();
+      done.set_value();
+    });
+    future.wait();
+  }
+
+  // 以下两个函数仅在分片线程上调用
+  void AddCloud(FrameDispatcher* dispatcher, FrameSink* sink) {
+    clouds_.push_back(std::make_pair(dispatcher, sink));
+  }
+
+  void RemoveCloud(FrameDispatcher* dispatcher) {
+    for (size_t i = 0; i < clouds_.size(); ++i) {
+      if (clouds_[i].first == dispatcher) {
+        clouds_.erase(clouds_.begin() + i);
+        return;
+      }
+    }
+  }
+
+  void AddInstance() { instances_.fetch_add(1, std::memory_order_relaxed); }
+  void RemoveInstance() { instances_.fetch_sub(1, std::memory_order_relaxed); }
+
+  ShardLoad Load() const {
+    ShardLoad load;
+    load.cpu = cpu_.load(std::memory_order_relaxed);
+    load.instances = instances_.load(std::memory_order_relaxed);
+    load.frames = frames_.load(std::memory_order_relaxed);
+    load.tasks = tasks_run_.load(std::memory_order_relaxed);
+    load.busy_ns = busy_ns_.load(std::memory_order_relaxed);
+    load.utilization = utilization_.load(std::memory_order_relaxed);
+    return load;
+  }
+
+ private:
+  Shard(const Shard&);
+  Shard& operator=(const Shard&);
+
+  void Pin() {
+    int cpu = cpu_.load(std::memory_order_relaxed);
+    if (cpu < 0) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+      cpu_.store(-1, std::memory_order_relaxed);
+    }
+  }
+
+  size_t RunOnce() {
+    std::vector<std::function<void()> > tasks;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks.swap(tasks_);
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+      tasks[i]();
+    }
+    tasks_run_.fetch_add(tasks.size(), std::memory_order_relaxed);
+
+    size_t frames = 0;
+    bool backlog = false;
+    for (size_t i = 0; i < clouds_.size(); ++i) {
+      frames += clouds_[i].first->Drain(clouds_[i].second, max_frames_per_stream_);
+      if (max_frames_per_stream_ > 0 && !backlog) {
+        backlog = clouds_[i].first->TotalSize() > 0;
+      }
+    }
+    frames_.fetch_add(frames, std::memory_order_relaxed);
+    // 按 |max_frames_per_stream| 截断后仍有积压，重新置位事件，下一轮不等待
+    if (backlog) {
+      event_.Notify();
+    }
+    return tasks.size() + frames;
+  }
+
+  void Run() {
+    Pin();
+    int64_t window_start = MonotonicNs();
+    int64_t window_busy = 0;
+    while (running_.load(std::memory_order_acquire)) {
+      event_.Wait(kIdleWaitMs);
+      int64_t start = MonotonicNs();
+      RunOnce();
+      int64_t end = MonotonicNs();
+      window_busy += end - start;
+      busy_ns_.fetch_add(static_cast<uint64_t>(end - start), std::memory_order_relaxed);
+      if (end - window_start >= kLoadWindowNs) {
+        utilization_.store(static_cast<double>(window_busy) / (end - window_start),
+                           std::memory_order_relaxed);
+        window_start = end;
+        window_busy = 0;
+      }
+    }
+    // 退出前执行剩余任务，避免 RunSync() 的调用方一直等待
+    RunOnce();
+  }
+
+  const size_t max_frames_per_stream_;
+  DataEvent event_;
+
+  std::mutex mutex_;
+  std::vector<std::function<void()> > tasks_;
+
+  // 仅分片线程访问
+  std::vector<std::pair<FrameDispatcher*, FrameSink*> > clouds_;
+
+  std::atomic<int> cpu_;
+  std::atomic<size_t> instances_;
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> tasks_run_;
+  std::atomic<uint64_t> busy_ns_;
+  std::atomic<double> utilization_;
+
+  std::atomic<bool> running_;
+  std::thread thread_;
+};
+
+// 把 RoomDelegate 回调转到分片线程
+class RoomManager::ShardRoomDelegate : public RoomDelegate {
+ public:
+  ShardRoomDelegate(Shard* shard, RoomDelegate* target) : shard_(shard), target_(target) {}
+  ~ShardRoomDelegate() {}
+
+  void OnEnterRoom(Room* room) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room]() { target->OnEnterRoom(room); });
+  }
+
+  void OnExitRoom(Room* room) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room]() { target->OnExitRoom(room); });
+  }
+
+  void OnRemoteUserEnterRoom(Room* room, const TrtcString& remote_user_id) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room, remote_user_id]() {
+      target->OnRemoteUserEnterRoom(room, remote_user_id);
+    });
+  }
+
+  void OnRemoteUserLeaveRoom(Room* room, const TrtcString& remote_user_id) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room, remote_user_id]() {
+      target->OnRemoteUserLeaveRoom(room, remote_user_id);
+    });
+  }
+
+  void OnRemoteStreamAvailable(Room* room,
+                               const TrtcString& remote_user_id,
+                               StreamType type,
+                               bool available) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room, remote_user_id, type, available]() {
+      target->OnRemoteStreamAvailable(room, remote_user_id, type, available);
+    });
+  }
+
+  void OnRoomError(Room* room, liteav::trtc::Error error) override {
+    RoomDelegate* target = target_;
+    shard_->Post([target, room, error]() { target->OnRoomError(room, error); });
+  }
+
+ private:
+  ShardRoomDelegate(const ShardRoomDelegate&);
+  ShardRoomDelegate& operator=(const ShardRoomDelegate&);
+
+  Shard* const shard_;
+  RoomDelegate* const target_;
+};
+
+struct RoomManager::Instance {
+  Instance() : shard(0), cloud(nullptr), room(nullptr) {}
+
+  size_t shard;
+  TRTCCloud* cloud;
+  Room* room;
+  std::unique_ptr<FrameDispatcher> dispatcher;
+  std::unique_ptr<ShardRoomDelegate> room_delegate;
+};
+
+RoomManager::RoomManager(const RoomManagerConfig& config) : config_(config) {
+  std::vector<int> cpus = AllowedCpus();
+  size_t count = config.shard_count;
+  if (count == 0) {
+    count = std::max<size_t>(1, cpus.size());
+  }
+  for (size_t i = 0; i < count; ++i) {
+    int cpu = config.pin_threads && !cpus.empty() ? cpus[i % cpus.size()] : -1;
+    shards_.push_back(std::unique_ptr<Shard>(new Shard(cpu, config.max_frames_per_stream)));
+  }
+}
+
+RoomManager::~RoomManager() {
+  std::vector<std::pair<TRTCCloud*, Room*> > remaining;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::map<const void*, std::unique_ptr<Instance> >::iterator it = instances_.begin();
+         it != instances_.end(); ++it) {
+      remaining.push_back(std::make_pair(it->second->cloud, it->second->room));
+    }
+  }
+  for (size_t i = 0; i < remaining.size(); ++i) {
+    if (remaining[i].first != nullptr) {
+      DestroyCloud(remaining[i].first);
+    } else {
+      DestroyRoom(remaining[i].second);
+    }
+  }
+  shards_.clear();
+}
+
+size_t RoomManager::PickShard() const {
+  std::vector<ShardLoad> loads(shards_.size());
+  double min_utilization = 1.0;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    loads[i] = shards_[i]->Load();
+    min_utilization = std::min(min_utilization, loads[i].utilization);
+  }
+  size_t best = 0;
+  bool found = false;
+  for (size_t i = 0; i < loads.size(); ++i) {
+    if (loads[i].utilization > min_utilization + kUtilizationTolerance) {
+      continue;
+    }
+    if (!found || loads[i].instances < loads[best].instances) {
+      best = i;
+      found = true;
+    }
+  }
+  return best;
+}
+
+TRTCCloud* RoomManager::CreateCloud(TRTCCloudDelegate* delegate, FrameSink* sink) {
+  if (sink == nullptr) {
+    return nullptr;
+  }
+  std::unique_ptr<Instance> instance(new Instance());
+  instance->dispatcher.reset(new FrameDispatcher(delegate, config_.ring));
+  instance->cloud = TRTCCloud::Create(instance->dispatcher.get());
+  if (instance->cloud == nullptr) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  instance->shard = PickShard();
+  Shard* shard = shards_[instance->shard].get();
+  FrameDispatcher* dispatcher = instance->dispatcher.get();
+  dispatcher->SetDataEvent(shard->event());
+  shard->AddInstance();
+  shard->Post([shard, dispatcher, sink]() { shard->AddCloud(dispatcher, sink); });
+
+  TRTCCloud* cloud = instance->cloud;
+  instances_[cloud] = std::move(instance);
+  return cloud;
+}
+
+void RoomManager::DestroyCloud(TRTCCloud* cloud) {
+  std::unique_ptr<Instance> instance;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<const void*, std::unique_ptr<Instance> >::iterator it = instances_.find(cloud);
+    if (it == instances_.end() || it->second->cloud == nullptr) {
+      return;
+    }
+    instance = std::move(it->second);
+    instances_.erase(it);
+  }
+  // 先销毁 SDK 对象，不再有新帧进入队列，再从分片上摘除
+  TRTCCloud::Destroy(instance->cloud);
+  Shard* shard = shards_[instance->shard].get();
+  FrameDispatcher* dispatcher = instance->dispatcher.get();
+  shard->RunSync([shard, dispatcher]() { shard->RemoveCloud(dispatcher); });
+  shard->RemoveInstance();
+}
+
+Room* RoomManager::CreateRoom(const RoomParams& params, RoomDelegate* delegate) {
+  if (delegate == nullptr) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Instance> instance(new Instance());
+  instance->shard = PickShard();
+  Shard* shard = shards_[instance->shard].get();
+  instance->room_delegate.reset(new ShardRoomDelegate(shard, delegate));
+  instance->room = Room::Create(params, instance->room_delegate.get());
+  if (instance->room == nullptr) {
+    return nullptr;
+  }
+  shard->AddInstance();
+  Room* room = instance->room;
+  instances_[room] = std::move(instance);
+  return room;
+}
+
+void RoomManager::DestroyRoom(Room* room) {
+  std::unique_ptr<Instance> instance;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<const void*, std::unique_ptr<Instance> >::iterator it = instances_.find(room);
+    if (it == instances_.end() || it->second->room == nullptr) {
+      return;
+    }
+    instance = std::move(it->second);
+    instances_.erase(it);
+  }
+  Room::Destroy(instance->room);
+  // 等已转到分片上的回调执行完，再释放转发对象
+  Shard* shard = shards_[instance->shard].get();
+  shard->RunSync([]() {});
+  shard->RemoveInstance();
+}
+
+int RoomManager::Post(const void* instance, const std::function<void()>& task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<const void*, std::unique_ptr<Instance> >::iterator it = instances_.find(instance);
+  if (it == instances_.end() || !task) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  shards_[it->second->shard]->Post(task);
+  return liteav::trtc::ERR_OK;
+}
+
+int RoomManager::ShardOf(const void* instance) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<const void*, std::unique_ptr<Instance> >::const_iterator it = instances_.find(instance);
+  return it == instances_.end() ? -1 : static_cast<int>(it->second->shard);
+}
+
+ShardLoad RoomManager::GetShardLoad(size_t shard) const {
+  if (shard >= shards_.size()) {
+    return ShardLoad();
+  }
+  return shards_[shard]->Load();
+}
+
+}  // namespace swing
@@ -0,0 +1,134 @@
+//
+// 功能说明：
+//   多房间分片调度。
+//   单进程跑大量机器人房间时，每个 TRTCCloud::Create() 各自回调、互不协调。
+//   RoomManager 持有一组固定的分片线程（默认每个可用 CPU 一个，并绑定到该核），
+//   由它创建的 TRTCCloud / Room 按负载分配到某个分片，之后始终在该分片上处理：
+//   - TRTCCloud：SDK 回调线程经 FrameDispatcher 把帧放进 SPSC 队列，
+//     分片线程被 DataEvent 唤醒后批量取帧交给业务的 FrameSink，
+//     同一房间的帧处理固定在一个核上，数据留在该核的缓存里；
+//   - Room：RoomDelegate 回调转到分片线程执行；
+//   - Post()：把业务任务投递到实例所在的分片，与帧处理串行执行，无需额外加锁。
+//
+//   新实例分配到负载最低的分片：先比较最近一秒的繁忙比例，相差不超过 5% 时
+//   比较实例个数。负载可通过 GetShardLoad() 查询。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_ROOM_MANAGER_H_
+#define GCHATGPT_TRTC_SWING_ROOM_MANAGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "../include/trtc/liteav_trtc_recorder.h"
+#include "frame_dispatcher.h"
+
+namespace swing {
+
+using liteav::trtc::Room;
+using liteav::trtc::RoomDelegate;
+using liteav::trtc::RoomParams;
+using liteav::trtc::TRTCCloud;
+using liteav::trtc::TRTCCloudDelegate;
+
+struct RoomManagerConfig {
+  RoomManagerConfig() : shard_count(0), pin_threads(true), max_frames_per_stream(0) {}
+
+  // 分片线程数，0 表示取当前进程可用的 CPU 数
+  size_t shard_count;
+
+  // 是否把第 i 个分片线程绑定到第 i 个可用 CPU（超出时取模）
+  bool pin_threads;
+
+  // 每个 TRTCCloud 的帧队列配置
+  FrameRingConfig ring;
+
+  // 分片线程每轮每路流最多处理的帧数，0 表示不限
+  size_t max_frames_per_stream;
+};
+
+// 单个分片的负载
+struct ShardLoad {
+  ShardLoad() : cpu(-1), instances(0), frames(0), tasks(0), busy_ns(0), utilization(0) {}
+
+  // 绑定的 CPU，未绑定时为 -1
+  int cpu;
+
+  // 当前分配到该分片的 TRTCCloud / Room 个数
+  size_t instances;
+
+  // 累计处理的帧数、任务数
+  uint64_t frames;
+  uint64_t tasks;
+
+  // 累计处理耗时，单位纳秒，不含等待
+  uint64_t busy_ns;
+
+  // 最近一秒的繁忙比例，取值 [0, 1]
+  double utilization;
+};
+
+class RoomManager {
+ public:
+  explicit RoomManager(const RoomManagerConfig& config);
+
+  // 销毁尚未销毁的实例，然后停止分片线程
+  ~RoomManager();
+
+  // 创建 TRTCCloud 并分配到负载最低的分片
+  // |delegate| 接收帧以外的回调，在 SDK 线程上调用，可以为 nullptr；
+  // |sink| 在分片线程上接收远端帧，需在 DestroyCloud() 返回前保持有效。
+  // 失败返回 nullptr。
+  TRTCCloud* CreateCloud(TRTCCloudDelegate* delegate, FrameSink* sink);
+
+  // 销毁 TRTCCloud，返回后 |sink| 不会再被调用
+  // 不可在分片线程上调用。
+  void DestroyCloud(TRTCCloud* cloud);
+
+  // 创建 Room 并分配到负载最低的分片，|delegate| 的回调在分片线程上执行
+  Room* CreateRoom(const RoomParams& params, RoomDelegate* delegate);
+
+  // 销毁 Room，返回后 |delegate| 不会再被调用
+  // 不可在分片线程上调用。
+  void DestroyRoom(Room* room);
+
+  // 在 |instance|（TRTCCloud* 或 Room*）所在分片上异步执行 |task|
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：|instance| 不是由本对象创建
+  int Post(const void* instance, const std::function<void()>& task);
+
+  // |instance| 所在分片，不存在时返回 -1
+  int ShardOf(const void* instance) const;
+
+  size_t ShardCount() const { return shards_.size(); }
+  ShardLoad GetShardLoad(size_t shard) const;
+
+ private:
+  class Shard;
+  class ShardRoomDelegate;
+
+  struct Instance;
+
+  RoomManager(const RoomManager&);
+  RoomManager& operator=(const RoomManager&);
+
+  size_t PickShard() const;
+
+  const RoomManagerConfig config_;
+  std::vector<std::unique_ptr<Shard> > shards_;
+
+  mutable std::mutex mutex_;
+  std::map<const void*, std::unique_ptr<Instance> > instances_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_ROOM_MANAGER_H_
@@ -0,0 +1,10 @@
+//go:build !loopback
+
+package swing
+
+// 链接 libliteav，库文件按架构放在 trtc/trtclibs/<arch> 下
+
+// #cgo amd64 LDFLAGS: -L${SRCDIR}/../trtclibs/amd64 -Wl,-rpath,${SRCDIR}/../trtclibs/amd64
+// #cgo arm64 LDFLAGS: -L${SRCDIR}/../trtclibs/arm64 -Wl,-rpath,${SRCDIR}/../trtclibs/arm64
+// #cgo LDFLAGS: -lliteav -lz -ldl -lm
+import "C"
@@ -0,0 +1,367 @@
+#include "sei_mux.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace swing {
+
+namespace {
+
+const uint8_t kMagic = 0x53;
+const uint8_t kVersion = 0x01;
+const uint8_t kFlagMore = 0x40;
+const uint8_t kFlagContinue = 0x80;
+const uint8_t kChannelMask = 0x3f;
+
+const int64_t kWindowNs = 1000000000;
+
+// 分片小于该字节数时留到下一个封包，避免产生只有几个字节的碎片
+const size_t kMinFragmentBytes = 32;
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+size_t VarintSize(uint64_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+void AppendVarint(uint64_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// 解析失败返回 false
+bool ReadVarint(const uint8_t** cursor, const uint8_t* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *cursor < end; shift += 7) {
+    uint8_t byte = *(*cursor)++;
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+SeiMuxer::SeiMuxer(const SeiMuxConfig& config)
+    : config_(config),
+      queued_bytes_(0),
+      next_sequence_(0),
+      window_bytes_(0),
+      envelopes_(0),
+      messages_(0) {
+  envelope_.reserve(config_.max_envelope_bytes);
+}
+
+SeiMuxer::~SeiMuxer() {}
+
+int SeiMuxer::Enqueue(int channel, const uint8_t* data, size_t size) {
+  if (channel < 0 || channel > kSeiMaxChannel || data == nullptr || size == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (queued_bytes_ + size > config_.max_queued_bytes) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  queue_.push_back(Pending());
+  Pending& pending = queue_.back();
+  pending.channel = channel;
+  pending.data.assign(reinterpret_cast<const char*>(data), size);
+  pending.offset = 0;
+  queued_bytes_ += size;
+  return liteav::trtc::ERR_OK;
+}
+
+int SeiMuxer::Enqueue(int channel, const std::string& data) {
+  return Enqueue(channel, reinterpret_cast<const uint8_t*>(data.data()), data.size());
+}
+
+bool SeiMuxer::Build(int64_t now_ns, Plan* plan) {
+  while (!window_.empty() && now_ns - window_.front().first >= kWindowNs) {
+    window_bytes_ -= window_.front().second;
+    window_.pop_front();
+  }
+  if (queue_.empty() ||
+      static_cast<int>(window_.size()) >= config_.max_envelopes_per_second ||
+      window_bytes_ >= config_.max_bytes_per_second) {
+    return false;
+  }
+  const size_t budget =
+      std::min(config_.max_envelope_bytes, config_.max_bytes_per_second - window_bytes_);
+
+  envelope_.clear();
+  envelope_.push_back(static_cast<char>(kMagic));
+  envelope_.push_back(static_cast<char>(kVersion));
+  AppendVarint(next_sequence_, &envelope_);
+
+  plan->records = 0;
+  plan->completed = 0;
+  plan->offset = 0;
+  for (size_t i = 0; i < queue_.size(); ++i) {
+    const Pending& pending = queue_[i];
+    const size_t remaining = pending.data.size() - pending.offset;
+    if (envelope_.size() + 2 >= budget) {
+      break;
+    }
+    // 记录头：通道 1 字节 + 长度 varint
+    size_t space = budget - envelope_.size() - 1;
+    space -= VarintSize(std::min(remaining, space));
+    size_t take = std::min(remaining, space);
+    if (take < remaining && take < kMinFragmentBytes && plan->records > 0) {
+      break;
+    }
+    if (take == 0) {
+      break;
+    }
+    uint8_t header = static_cast<uint8_t>(pending.channel);
+    if (pending.offset > 0) {
+      header |= kFlagContinue;
+    }
+    if (take < remaining) {
+      header |= kFlagMore;
+    }
+    envelope_.push_back(static_cast<char>(header));
+    AppendVarint(take, &envelope_);
+    envelope_.append(pending.data, pending.offset, take);
+    ++plan->records;
+    if (take < remaining) {
+      plan->offset = pending.offset + take;
+      break;
+    }
+    ++plan->completed;
+  }
+  return plan->records > 0;
+}
+
+void SeiMuxer::Commit(int64_t now_ns, const Plan& plan) {
+  for (size_t i = 0; i < plan.completed; ++i) {
+    queued_bytes_ -= queue_.front().data.size() - queue_.front().offset;
+    queue_.pop_front();
+  }
+  if (plan.offset > 0) {
+    queued_bytes_ -= plan.offset - queue_.front().offset;
+    queue_.front().offset = plan.offset;
+  }
+  next_sequence_ += static_cast<uint32_t>(plan.records);
+  window_.push_back(std::make_pair(now_ns, envelope_.size()));
+  window_bytes_ += envelope_.size();
+  ++envelopes_;
+  messages_ += plan.completed;
+}
+
+template <typename Send>
+int SeiMuxer::FlushWith(Send send) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int64_t now = MonotonicNs();
+  Plan plan;
+  if (!Build(now, &plan)) {
+    return liteav::trtc::ERR_READ_TRY_AGAIN;
+  }
+  int result = send(reinterpret_cast<const uint8_t*>(envelope_.data()), envelope_.size());
+  if (result == liteav::trtc::ERR_OK) {
+    Commit(now, plan);
+  }
+  return result;
+}
+
+int SeiMuxer::Flush(TRTCCloud* cloud) {
+  if (cloud == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  const int message_type = config_.message_type;
+  return FlushWith([cloud, message_type](const uint8_t* data, size_t size) {
+    return cloud->SendSeiMessage(message_type, data, static_cast<int>(size));
+  });
+}
+
+int SeiMuxer::Flush(V2TXLivePusher* pusher) {
+  if (pusher == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  const int message_type = config_.message_type;
+  return FlushWith([pusher, message_type](const uint8_t* data, size_t size) {
+    return pusher->SendSeiMessage(message_type, data, size);
+  });
+}
+
+int SeiMuxer::Pack(std::string* envelope) {
+  if (envelope == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return FlushWith([envelope](const uint8_t* data, size_t size) {
+    envelope->assign(reinterpret_cast<const char*>(data), size);
+    return static_cast<int>(liteav::trtc::ERR_OK);
+  });
+}
+
+size_t SeiMuxer::QueuedBytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_bytes_;
+}
+
+uint64_t SeiMuxer::Envelopes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return envelopes_;
+}
+
+uint64_t SeiMuxer::Messages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return messages_;
+}
+
+SeiDemuxer::SeiDemuxer(SeiMessageSink* sink, size_t max_message_bytes)
+    : sink_(sink), max_message_bytes_(max_message_bytes), messages_(0), lost_(0), malformed_(0) {}
+
+SeiDemuxer::~SeiDemuxer() {}
+
+bool SeiDemuxer::Feed(const char* user_id, const uint8_t* data, size_t size) {
+  if (data == nullptr || size < 3 || data[0] != kMagic || data[1] != kVersion) {
+    return false;
+  }
+  if (user_id == nullptr) {
+    user_id = "";
+  }
+  const uint8_t* cursor = data + 2;
+  const uint8_t* end = data + size;
+  uint64_t first = 0;
+
+  // 解析时只收集完整的消息，解锁后再交给 |sink_|
+  // 未分片的消息指向 |data|，重组的消息取走分片缓冲。
+  struct Delivery {
+    int channel;
+    uint32_t sequence;
+    const uint8_t* data;
+    size_t size;
+    bool reassembled;
+    std::string buffer;
+  };
+  std::vector<Delivery> deliveries;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!ReadVarint(&cursor, end, &first) || first > 0xffffffffull) {
+    ++malformed_;
+    return true;
+  }
+
+  UserState& state = users_[user_id];
+  uint32_t sequence = static_cast<uint32_t>(first);
+  if (state.synced && sequence != state.next_sequence) {
+    // 序号回退视为发送端重启，不计丢失
+    uint32_t gap = sequence - state.next_sequence;
+    if (gap < 0x80000000u) {
+      lost_ += gap;
+    }
+    // 分片缺了中间部分，丢弃
+    state.partial_channel = -1;
+    state.partial.clear();
+  }
+  state.synced = true;
+
+  while (cursor < end) {
+    uint8_t header = *cursor++;
+    uint64_t length = 0;
+    if (!ReadVarint(&cursor, end, &length) || length > static_cast<uint64_t>(end - cursor)) {
+      ++malformed_;
+      state.partial_channel = -1;
+      state.partial.clear();
+      break;
+    }
+    const int channel = header & kChannelMask;
+    const uint8_t* payload = cursor;
+    cursor += length;
+    const uint32_t record_sequence = sequence++;
+
+    if ((header & kFlagContinue) != 0) {
+      if (state.partial_channel != channel) {
+        // 前面的分片已丢失
+        continue;
+      }
+      if (state.partial.size() + length > max_message_bytes_) {
+        // 超过上限的消息不再重组，后续续片因通道不匹配被跳过
+        ++malformed_;
+        state.partial_channel = -1;
+        std::string().swap(state.partial);
+        continue;
+      }
+      state.partial.append(reinterpret_cast<const char*>(payload), length);
+    } else {
+      state.partial_channel = -1;
+      state.partial.clear();
+      if ((header & kFlagMore) == 0) {
+        ++messages_;
+        Delivery delivery = {channel, record_sequence, payload, static_cast<size_t>(length), false,
+                             std::string()};
+        deliveries.push_back(std::move(delivery));
+        continue;
+      }
+      if (length > max_message_bytes_) {
+        ++malformed_;
+        continue;
+      }
+      state.partial_channel = channel;
+      state.partial_sequence = record_sequence;
+      state.partial.assign(reinterpret_cast<const char*>(payload), length);
+    }
+    if ((header & kFlagMore) == 0) {
+      ++messages_;
+      Delivery delivery = {channel, state.partial_sequence, nullptr, 0, true, std::string()};
+      delivery.buffer.swap(state.partial);
+      deliveries.push_back(std::move(delivery));
+      state.partial_channel = -1;
+    }
+  }
+  state.next_sequence = sequence;
+  lock.unlock();
+
+  for (size_t i = 0; i < deliveries.size(); ++i) {
+    const Delivery& delivery = deliveries[i];
+    if (delivery.reassembled) {
+      sink_->OnSeiMessage(user_id, delivery.channel, delivery.sequence,
+                          reinterpret_cast<const uint8_t*>(delivery.buffer.data()),
+                          delivery.buffer.size());
+    } else {
+      sink_->OnSeiMessage(user_id, delivery.channel, delivery.sequence, delivery.data,
+                          delivery.size);
+    }
+  }
+  return true;
+}
+
+void SeiDemuxer::RemoveUser(const char* user_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  users_.erase(user_id == nullptr ? "" : user_id);
+}
+
+uint64_t SeiDemuxer::Messages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return messages_;
+}
+
+uint64_t SeiDemuxer::LostRecords() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lost_;
+}
+
+uint64_t SeiDemuxer::Malformed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return malformed_;
+}
+
+}  // namespace swing
@@ -0,0 +1,199 @@
+//
+// 功能说明：
+//   SEI 消息复用，用于随视频帧带内传输流式聊天 token、字幕等小消息。
+//   SendSeiMessage() 每次只发一条消息，且受 SDK 限制：单条不超过 1000 字节、
+//   每秒不超过 30 条、每秒不超过 8000 字节。一个 token 单独占一条 SEI 时，
+//   30 条 / 秒很快就用完。
+//
+//   SeiMuxer 缓存业务消息，每发送一帧视频调用一次 Flush()，把排队的消息打包成
+//   一条 SEI（封包），不额外增加帧；封包大小与发送频率按 SDK 限制在 1 秒滑动窗口内
+//   控制。超过单个封包容量的消息分片发送。SeiDemuxer 在接收端拆包、重组分片，
+//   并根据序号统计丢失。
+//
+//   封包格式：
+//     [1 字节 magic 0x53][1 字节版本 0x01][varint 首条记录序号]
+//     若干条记录：[1 字节 通道 | 标志][varint 长度][数据]
+//   通道取值 [0, 63]，标志位 0x40 表示消息在下一条记录继续，0x80 表示本记录是
+//   上一条的续片。序号按记录递增，分片只出现在封包末尾，续片总在下一个封包开头。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_SEI_MUX_H_
+#define GCHATGPT_TRTC_SWING_SEI_MUX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "../include/live/liteav_live_pusher.h"
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::TRTCCloud;
+using liteav::live::V2TXLivePusher;
+
+const int kSeiMaxChannel = 63;
+
+struct SeiMuxConfig {
+  SeiMuxConfig()
+      : message_type(242),
+        max_envelope_bytes(1000),
+        max_envelopes_per_second(30),
+        max_bytes_per_second(8000),
+        max_queued_bytes(64 << 10) {}
+
+  // SEI 消息类型，5 或 242，收发两端需一致
+  int message_type;
+
+  // 以下默认值为 SDK 的限制
+  size_t max_envelope_bytes;
+  int max_envelopes_per_second;
+  size_t max_bytes_per_second;
+
+  // 排队数据上限，超过时 Enqueue() 失败
+  size_t max_queued_bytes;
+};
+
+class SeiMuxer {
+ public:
+  explicit SeiMuxer(const SeiMuxConfig& config);
+  ~SeiMuxer();
+
+  // 排队一条消息，可在任意线程调用
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：通道超出范围或消息为空
+  // - ERR_INVALID_OPERATION：排队数据超过 |max_queued_bytes|
+  int Enqueue(int channel, const uint8_t* data, size_t size);
+  int Enqueue(int channel, const std::string& data);
+
+  // 把排队的消息打包成一条 SEI 发送，通常在每次 SendVideoFrame() 之后调用
+  // 发送失败时消息保留在队列中，下次重试。
+  // 返回值：
+  // - ERR_OK：已发送
+  // - ERR_READ_TRY_AGAIN：队列为空，或当前窗口内的配额已用完
+  // - 其他：SendSeiMessage() 的错误码
+  int Flush(TRTCCloud* cloud);
+  int Flush(V2TXLivePusher* pusher);
+
+  // 只打包不发送，供自定义通道使用，返回值同 Flush()
+  int Pack(std::string* envelope);
+
+  // 排队中的字节数
+  size_t QueuedBytes() const;
+
+  // 已发送的封包数、完整消息数
+  uint64_t Envelopes() const;
+  uint64_t Messages() const;
+
+ private:
+  struct Pending {
+    int channel;
+    std::string data;
+    // 已发送的字节数，大于 0 表示后续记录为续片
+    size_t offset;
+  };
+
+  // Build() 生成的封包消耗的队列内容
+  struct Plan {
+    size_t records;
+    // 完整发出的消息数，之后的第一条消息发送到 |offset|
+    size_t completed;
+    size_t offset;
+  };
+
+  SeiMuxer(const SeiMuxer&);
+  SeiMuxer& operator=(const SeiMuxer&);
+
+  // 在 |envelope_| 中生成封包，没有可发送的内容时返回 false，需持有 |mutex_|
+  bool Build(int64_t now_ns, Plan* plan);
+  void Commit(int64_t now_ns, const Plan& plan);
+
+  template <typename Send>
+  int FlushWith(Send send);
+
+  const SeiMuxConfig config_;
+
+  mutable std::mutex mutex_;
+  std::deque<Pending> queue_;
+  size_t queued_bytes_;
+  uint32_t next_sequence_;
+  std::string envelope_;
+  // 最近 1 秒内发送的封包：(发送时间, 字节数)
+  std::deque<std::pair<int64_t, size_t> > window_;
+  size_t window_bytes_;
+  uint64_t envelopes_;
+  uint64_t messages_;
+};
+
+class SeiMessageSink {
+ public:
+  virtual ~SeiMessageSink() {}
+
+  // |sequence| 为消息首条记录的序号，|data| 仅在回调期间有效
+  virtual void OnSeiMessage(const char* user_id,
+                            int channel,
+                            uint32_t sequence,
+                            const uint8_t* data,
+                            size_t size) = 0;
+};
+
+class SeiDemuxer {
+ public:
+  // |sink| 需在本对象之后销毁
+  // 分片重组超过 |max_message_bytes| 的消息丢弃并计入 Malformed()，
+  // 默认与发送端的 SeiMuxConfig::max_queued_bytes 相同，单条消息不会超过该值。
+  explicit SeiDemuxer(SeiMessageSink* sink, size_t max_message_bytes = 64 << 10);
+  ~SeiDemuxer();
+
+  // 在 OnSeiMessageReceived 中调用，|user_id| 可以为 nullptr（直播播放器）
+  // 返回 false 表示不是 SeiMuxer 的封包，业务按原始 SEI 处理。
+  // |sink| 在调用线程上同步回调，回调时不持有内部锁，可以调用本对象的方法。
+  bool Feed(const char* user_id, const uint8_t* data, size_t size);
+
+  // 清除用户的序号与未完成的分片，远端退房时调用
+  void RemoveUser(const char* user_id);
+
+  // 已交付的消息数
+  uint64_t Messages() const;
+
+  // 按序号推算丢失的记录数，残缺的分片消息会被丢弃，不交给 |sink|
+  uint64_t LostRecords() const;
+
+  // 格式错误的封包数，含重组超过 |max_message_bytes| 的消息
+  uint64_t Malformed() const;
+
+ private:
+  struct UserState {
+    UserState() : synced(false), next_sequence(0), partial_channel(-1), partial_sequence(0) {}
+
+    // 是否收到过封包，第一个封包不计丢失
+    bool synced;
+    uint32_t next_sequence;
+    // 未完成的分片，|partial_channel| 为 -1 表示没有
+    int partial_channel;
+    uint32_t partial_sequence;
+    std::string partial;
+  };
+
+  SeiDemuxer(const SeiDemuxer&);
+  SeiDemuxer& operator=(const SeiDemuxer&);
+
+  SeiMessageSink* const sink_;
+  const size_t max_message_bytes_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, UserState> users_;
+  uint64_t messages_;
+  uint64_t lost_;
+  uint64_t malformed_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_SEI_MUX_H_
@@ -0,0 +1,109 @@
+//
+// 功能说明：
+//   单生产者 / 单消费者无锁环形队列。
+//   槽位在构造时一次性分配，生产者就地写入槽位，消费者批量读取后一次性归还，
+//   稳定运行时不产生内存分配。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_SPSC_RING_H_
+#define GCHATGPT_TRTC_SWING_SPSC_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+namespace swing {
+
+const size_t kCacheLineSize = 64;
+
+template <typename T>
+class SpscRing {
+ public:
+  // |capacity| 向上取整为 2 的幂
+  explicit SpscRing(size_t capacity)
+      : mask_(RoundUpPow2(capacity) - 1),
+        slots_(mask_ + 1),
+        head_(0),
+        cached_tail_(0),
+        tail_(0) {}
+
+  size_t Capacity() const { return mask_ + 1; }
+
+  // 当前队列中的元素个数，任意线程可调用，结果为近似值
+  size_t Size() const {
+    // 先读 |tail_| 再读 |head_|，保证差值非负
+    uint64_t tail = tail_.load(std::memory_order_acquire);
+    return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail);
+  }
+
+  ///////////////////////////////////////////////////////////////////////
+  //                           生产者接口                             //
+  /////////////////////////////////////////////////////////////////////
+
+  // 取得下一个可写槽位，队列已满返回 nullptr
+  // 写完后调用 CommitPush() 发布。
+  T* BeginPush() {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ > mask_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ > mask_) {
+        return nullptr;
+      }
+    }
+    return &slots_[head & mask_];
+  }
+
+  void CommitPush() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  ///////////////////////////////////////////////////////////////////////
+  //                           消费者接口                             //
+  /////////////////////////////////////////////////////////////////////
+
+  // 可读元素个数
+  size_t Readable() {
+    return static_cast<size_t>(head_.load(std::memory_order_acquire) -
+                               tail_.load(std::memory_order_relaxed));
+  }
+
+  // 第 |index| 个可读元素，|index| 需小于最近一次 Readable() 的返回值
+  T* Peek(size_t index) {
+    return &slots_[(tail_.load(std::memory_order_relaxed) + index) & mask_];
+  }
+
+  // 归还前 |count| 个元素的槽位
+  void Consume(size_t count) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+  }
+
+ private:
+  SpscRing(const SpscRing&);
+  SpscRing& operator=(const SpscRing&);
+
+  static size_t RoundUpPow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t mask_;
+  std::vector<T> slots_;
+
+  // 生产者写 |head_|，读 |tail_|；消费者相反。用填充分在不同缓存行避免伪共享，
+  // 不用 alignas 是因为 C++11 的 new 不保证超对齐。
+  char pad0_[kCacheLineSize];
+  std::atomic<uint64_t> head_;
+  uint64_t cached_tail_;
+  char pad1_[kCacheLineSize];
+  std::atomic<uint64_t> tail_;
+  char pad2_[kCacheLineSize];
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_SPSC_RING_H_
@@ -0,0 +1,1009 @@
+#include "stream_muxer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace swing {
+
+namespace {
+
+const uint32_t kVideoTrackId = 1;
+const uint32_t kAudioTrackId = 2;
+const uint32_t kVideoTimescale = 1000;
+const uint32_t kOpusTimescale = 48000;
+
+// 样本标志：关键帧，以及依赖其他帧的非同步样本
+const uint32_t kSyncSampleFlags = 0x02000000;
+const uint32_t kNonSyncSampleFlags = 0x01010000;
+
+const uint8_t kFlvTagAudio = 8;
+const uint8_t kFlvTagVideo = 9;
+const uint8_t kFlvCodecAvc = 7;
+// FLV 标准没有 HEVC，沿用国内 CDN 通行的扩展编号
+const uint8_t kFlvCodecHevc = 12;
+
+const int kAacSampleRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                               22050, 16000, 12000, 11025, 8000,  7350};
+
+const int32_t kIdentityMatrix[9] = {0x10000, 0, 0, 0, 0x10000, 0, 0, 0, 0x40000000};
+
+void PutU8(std::vector<uint8_t>* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutU16(std::vector<uint8_t>* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutU24(std::vector<uint8_t>* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 16));
+  PutU16(out, value);
+}
+
+void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  PutU16(out, value >> 16);
+  PutU16(out, value);
+}
+
+void PutU64(std::vector<uint8_t>* out, uint64_t value) {
+  PutU32(out, static_cast<uint32_t>(value >> 32));
+  PutU32(out, static_cast<uint32_t>(value));
+}
+
+void PutBytes(std::vector<uint8_t>* out, const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  out->insert(out->end(), bytes, bytes + size);
+}
+
+void PutZeros(std::vector<uint8_t>* out, size_t count) {
+  out->insert(out->end(), count, 0);
+}
+
+void PatchU32(std::vector<uint8_t>* out, size_t pos, uint32_t value) {
+  (*out)[pos] = static_cast<uint8_t>(value >> 24);
+  (*out)[pos + 1] = static_cast<uint8_t>(value >> 16);
+  (*out)[pos + 2] = static_cast<uint8_t>(value >> 8);
+  (*out)[pos + 3] = static_cast<uint8_t>(value);
+}
+
+// 开始一个 box，返回其起点，EndBox() 回填长度
+size_t BeginBox(std::vector<uint8_t>* out, const char* type) {
+  size_t pos = out->size();
+  PutU32(out, 0);
+  PutBytes(out, type, 4);
+  return pos;
+}
+
+size_t BeginFullBox(std::vector<uint8_t>* out, const char* type, uint8_t version, uint32_t flags) {
+  size_t pos = BeginBox(out, type);
+  PutU32(out, (static_cast<uint32_t>(version) << 24) | (flags & 0xffffff));
+  return pos;
+}
+
+void EndBox(std::vector<uint8_t>* out, size_t pos) {
+  PatchU32(out, pos, static_cast<uint32_t>(out->size() - pos));
+}
+
+// 单字节长度的 MPEG-4 描述符，esds 中的描述符都远小于 128 字节
+void PutDescriptorHeader(std::vector<uint8_t>* out, uint8_t tag, size_t size) {
+  PutU8(out, tag);
+  PutU8(out, static_cast<uint32_t>(size));
+}
+
+int64_t UnwrapMs(uint32_t raw, bool* seen, uint32_t* last_raw, int64_t* last_ms) {
+  if (!*seen) {
+    *seen = true;
+    *last_raw = raw;
+    *last_ms = raw;
+    return *last_ms;
+  }
+  *last_ms += static_cast<int32_t>(raw - *last_raw);
+  *last_raw = raw;
+  return *last_ms;
+}
+
+}  // namespace
+
+// 带缓冲的顺序写文件，缓冲在构造时一次分配
+class StreamMuxer::FileWriter {
+ public:
+  explicit FileWriter(size_t buffer_bytes)
+      : fd_(-1), buffer_(std::max<size_t>(buffer_bytes, 4096)), used_(0), offset_(0),
+        preallocated_(false) {}
+
+  ~FileWriter() { Close(); }
+
+  bool Open(const std::string& path, size_t preallocate_bytes) {
+    fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+      return false;
+    }
+    // 预留失败（文件系统不支持等）不影响写入
+    if (preallocate_bytes > 0 &&
+        posix_fallocate(fd_, 0, static_cast<off_t>(preallocate_bytes)) == 0) {
+      preallocated_ = true;
+    }
+    return true;
+  }
+
+  bool Append(const uint8_t* data, size_t size) {
+    if (used_ + size > buffer_.size()) {
+      if (!Flush()) {
+        return false;
+      }
+      // 大块数据不经过缓冲
+      if (size >= buffer_.size()) {
+        return WriteAll(data, size);
+      }
+    }
+    memcpy(buffer_.data() + used_, data, size);
+    used_ += size;
+    return true;
+  }
+
+  bool Append(const std::vector<uint8_t>& data) { return Append(data.data(), data.size()); }
+
+  bool Flush() {
+    if (used_ == 0) {
+      return true;
+    }
+    size_t used = used_;
+    used_ = 0;
+    return WriteAll(buffer_.data(), used);
+  }
+
+  bool Close() {
+    if (fd_ < 0) {
+      return true;
+    }
+    bool ok = Flush();
+    if (preallocated_ && ftruncate(fd_, static_cast<off_t>(offset_)) != 0) {
+      ok = false;
+    }
+    if (close(fd_) != 0) {
+      ok = false;
+    }
+    fd_ = -1;
+    return ok;
+  }
+
+  uint64_t offset() const { return offset_ + used_; }
+
+ private:
+  bool WriteAll(const uint8_t* data, size_t size) {
+    while (size > 0) {
+      ssize_t n = pwrite(fd_, data, size, static_cast<off_t>(offset_));
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += n;
+      size -= static_cast<size_t>(n);
+      offset_ += static_cast<uint64_t>(n);
+    }
+    return true;
+  }
+
+  int fd_;
+  std::vector<uint8_t> buffer_;
+  size_t used_;
+  uint64_t offset_;
+  bool preallocated_;
+};
+
+StreamMuxer::StreamMuxer(const StreamMuxerConfig& config)
+    : config_(config),
+      initialized_(false),
+      closed_(false),
+      failed_(false),
+      video_seen_(false),
+      video_last_raw_(0),
+      video_last_ms_(0),
+      audio_seen_(false),
+      audio_last_raw_(0),
+      audio_last_ms_(0),
+      video_codec_(liteav::trtc::VIDEO_CODEC_TYPE_H264),
+      video_ready_(false),
+      video_rotation_(0),
+      audio_codec_(liteav::trtc::AUDIO_CODEC_TYPE_AAC),
+      audio_sample_rate_(0),
+      audio_channels_(0),
+      audio_ready_(false),
+      audio_unsupported_(false),
+      writer_(nullptr),
+      segment_index_(0),
+      segment_start_ms_(0),
+      fragment_sequence_(1),
+      fragment_start_ms_(0),
+      video_last_dts_(-1),
+      audio_next_dts_(-1),
+      bytes_written_(0),
+      dropped_frames_(0) {}
+
+StreamMuxer::~StreamMuxer() {
+  Close();
+}
+
+int StreamMuxer::Init() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (initialized_) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  if ((config_.file_format != liteav::trtc::kFlv && config_.file_format != liteav::trtc::kMp4) ||
+      config_.path_prefix.empty() || config_.segment_duration_in_seconds < 0 ||
+      config_.fragment_duration_ms <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  if (IsMp4()) {
+    video_data_.reserve(config_.write_buffer_bytes);
+    audio_data_.reserve(config_.write_buffer_bytes / 8);
+  }
+  scratch_.reserve(64 << 10);
+  initialized_ = true;
+  return liteav::trtc::ERR_OK;
+}
+
+bool StreamMuxer::HasVideo() const {
+  return config_.record_type != liteav::trtc::kAudioOnly;
+}
+
+bool StreamMuxer::HasAudio() const {
+  return config_.record_type != liteav::trtc::kVideoOnly;
+}
+
+bool StreamMuxer::IsMp4() const {
+  return config_.file_format == liteav::trtc::kMp4;
+}
+
+int StreamMuxer::WriteVideo(const VideoFrame& frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!initialized_ || closed_ || !HasVideo()) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  if (failed_) {
+    return liteav::trtc::ERR_FAILED;
+  }
+  nals_.clear();
+  if (frame.data() == nullptr ||
+      !SplitAnnexB(frame.codec, frame.data(), frame.size(), &nals_)) {
+    ++dropped_frames_;
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+
+  const int64_t dts_ms = UnwrapMs(frame.dts, &video_seen_, &video_last_raw_, &video_last_ms_);
+  const int32_t cto_ms = static_cast<int32_t>(frame.pts - frame.dts);
+  bool keyframe = frame.is_key_frame;
+  bool params_changed = false;
+
+  // 关键帧携带的参数集与当前不同时更新，已开始写文件则切换到新文件
+  VideoParameterSets params;
+  for (size_t i = 0; i < nals_.size(); ++i) {
+    const NalUnit& nal = nals_[i];
+    keyframe = keyframe || IsKeyframeNal(frame.codec, nal.type);
+    if (!IsParameterSetNal(frame.codec, nal.type)) {
+      continue;
+    }
+    std::string value(reinterpret_cast<const char*>(nal.data), nal.size);
+    const bool is_vps = frame.codec == liteav::trtc::VIDEO_CODEC_TYPE_H265 && nal.type == 32;
+    const bool is_sps = frame.codec == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? nal.type == 33
+                                                                           : nal.type == 7;
+    if (is_vps) {
+      params.vps.swap(value);
+    } else if (is_sps) {
+      if (params.sps.empty() && ParseSps(frame.codec, nal.data, nal.size, &params)) {
+        params.sps.swap(value);
+      }
+    } else if (params.pps.empty()) {
+      params.pps.swap(value);
+    }
+  }
+  if (keyframe && params.Complete(frame.codec)) {
+    if (!video_ready_ || frame.codec != video_codec_ || params.sps != video_params_.sps ||
+        params.pps != video_params_.pps || params.vps != video_params_.vps) {
+      params_changed = video_ready_;
+      video_params_ = params;
+      video_codec_ = frame.codec;
+      video_ready_ = true;
+    }
+  }
+
+  int ret = liteav::trtc::ERR_OK;
+  if (writer_ == nullptr) {
+    const bool audio_pending = HasAudio() && !audio_ready_ && !audio_unsupported_;
+    if (!keyframe || !video_ready_ || audio_pending) {
+      ++dropped_frames_;
+      return liteav::trtc::ERR_OK;
+    }
+    video_rotation_ = frame.rotation;
+    ret = OpenSegment(dts_ms);
+  } else if (frame.codec != video_codec_) {
+    // 编码类型变化后等待新的参数集
+    ++dropped_frames_;
+    return liteav::trtc::ERR_OK;
+  } else if (keyframe) {
+    const bool segment_full =
+        config_.segment_duration_in_seconds > 0 &&
+        dts_ms - segment_start_ms_ >= config_.segment_duration_in_seconds * 1000LL;
+    if (params_changed || segment_full) {
+      if ((ret = FlushFragment(dts_ms)) == liteav::trtc::ERR_OK &&
+          (ret = CloseSegment()) == liteav::trtc::ERR_OK) {
+        video_rotation_ = frame.rotation;
+        ret = OpenSegment(dts_ms);
+      }
+    } else if (IsMp4() && dts_ms - fragment_start_ms_ >= config_.fragment_duration_ms) {
+      ret = FlushFragment(dts_ms);
+    }
+  } else if (IsMp4() && dts_ms - fragment_start_ms_ >= 4LL * config_.fragment_duration_ms) {
+    // 关键帧间隔过长时不再等关键帧，避免分片无限增长
+    ret = FlushFragment(dts_ms);
+  }
+  if (ret != liteav::trtc::ERR_OK) {
+    return ret;
+  }
+
+  // B 帧之外 DTS 应单调递增，异常时钳位到上一帧
+  int64_t dts = std::max<int64_t>(dts_ms - segment_start_ms_, video_last_dts_ + 1);
+  dts = std::max<int64_t>(dts, 0);
+  video_last_dts_ = dts;
+
+  if (IsMp4()) {
+    if (video_samples_.empty() && audio_samples_.empty()) {
+      fragment_start_ms_ = segment_start_ms_ + dts;
+    }
+    size_t size = AppendVideoPayload(&video_data_);
+    if (size == 0) {
+      ++dropped_frames_;
+      return liteav::trtc::ERR_OK;
+    }
+    Sample sample = {dts, cto_ms, static_cast<uint32_t>(size), keyframe};
+    video_samples_.push_back(sample);
+    return liteav::trtc::ERR_OK;
+  }
+
+  scratch_.clear();
+  if (AppendVideoPayload(&scratch_) == 0) {
+    ++dropped_frames_;
+    return liteav::trtc::ERR_OK;
+  }
+  const uint8_t codec_id =
+      video_codec_ == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? kFlvCodecHevc : kFlvCodecAvc;
+  const uint8_t head[5] = {static_cast<uint8_t>((keyframe ? 0x10 : 0x20) | codec_id), 1,
+                           static_cast<uint8_t>(cto_ms >> 16), static_cast<uint8_t>(cto_ms >> 8),
+                           static_cast<uint8_t>(cto_ms)};
+  return WriteFlvTag(kFlvTagVideo, dts, head, sizeof(head), scratch_.data(), scratch_.size());
+}
+
+int StreamMuxer::WriteAudio(const AudioFrame& frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!initialized_ || closed_ || !HasAudio()) {
+    return liteav::trtc::ERR_INVALID_OPERATION;
+  }
+  if (failed_) {
+    return liteav::trtc::ERR_FAILED;
+  }
+  if (frame.codec == liteav::trtc::AUDIO_CODEC_TYPE_PCM ||
+      (frame.codec == liteav::trtc::AUDIO_CODEC_TYPE_OPUS && !IsMp4())) {
+    audio_unsupported_ = true;
+    ++dropped_frames_;
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  size_t header_size = 0;
+  if (frame.data() == nullptr || !UpdateAudioConfig(frame, &header_size)) {
+    ++dropped_frames_;
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  const int64_t ms = UnwrapMs(frame.pts, &audio_seen_, &audio_last_raw_, &audio_last_ms_);
+
+  int ret = liteav::trtc::ERR_OK;
+  if (writer_ == nullptr) {
+    if (HasVideo()) {
+      ++dropped_frames_;
+      return liteav::trtc::ERR_OK;
+    }
+    ret = OpenSegment(ms);
+  } else if (!HasVideo()) {
+    const bool segment_full =
+        config_.segment_duration_in_seconds > 0 &&
+        ms - segment_start_ms_ >= config_.segment_duration_in_seconds * 1000LL;
+    if (segment_full) {
+      if ((ret = FlushFragment(-1)) == liteav::trtc::ERR_OK &&
+          (ret = CloseSegment()) == liteav::trtc::ERR_OK) {
+        ret = OpenSegment(ms);
+      }
+    } else if (IsMp4() && !audio_samples_.empty() &&
+               ms - fragment_start_ms_ >= config_.fragment_duration_ms) {
+      ret = FlushFragment(-1);
+    }
+  }
+  if (ret != liteav::trtc::ERR_OK) {
+    return ret;
+  }
+
+  // 早于文件起点（视频首个关键帧）的音频丢弃
+  const int64_t relative_ms = ms - segment_start_ms_;
+  const uint8_t* payload = frame.data() + header_size;
+  const size_t payload_size = frame.size() - header_size;
+  if (relative_ms < 0 || payload_size == 0) {
+    ++dropped_frames_;
+    return liteav::trtc::ERR_OK;
+  }
+
+  if (!IsMp4()) {
+    const uint8_t head[2] = {0xaf, 1};
+    return WriteFlvTag(kFlvTagAudio, relative_ms, head, sizeof(head), payload, payload_size);
+  }
+
+  // 毫秒时间戳换算为采样数会有取整抖动，与上一帧连续时按帧长递推
+  const int64_t timescale = AudioTimescale();
+  const int64_t frame_samples = AudioFrameSamples();
+  int64_t dts = relative_ms * timescale / 1000;
+  if (audio_next_dts_ >= 0 && dts >= audio_next_dts_ - frame_samples / 2 &&
+      dts <= audio_next_dts_ + frame_samples / 2) {
+    dts = audio_next_dts_;
+  } else if (audio_next_dts_ >= 0 && dts < audio_next_dts_) {
+    ++dropped_frames_;
+    return liteav::trtc::ERR_OK;
+  }
+  audio_next_dts_ = dts + frame_samples;
+
+  if (video_samples_.empty() && audio_samples_.empty()) {
+    fragment_start_ms_ = ms;
+  }
+  Sample sample = {dts, 0, static_cast<uint32_t>(payload_size), true};
+  audio_samples_.push_back(sample);
+  audio_data_.insert(audio_data_.end(), payload, payload + payload_size);
+  return liteav::trtc::ERR_OK;
+}
+
+int StreamMuxer::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) {
+    return liteav::trtc::ERR_OK;
+  }
+  closed_ = true;
+  if (writer_ == nullptr) {
+    return failed_ ? liteav::trtc::ERR_FAILED : liteav::trtc::ERR_OK;
+  }
+  int ret = FlushFragment(-1);
+  if (ret != liteav::trtc::ERR_OK) {
+    return ret;
+  }
+  return CloseSegment();
+}
+
+int StreamMuxer::SegmentCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segment_index_;
+}
+
+uint64_t StreamMuxer::BytesWritten() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_written_;
+}
+
+uint64_t StreamMuxer::DroppedFrames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_frames_;
+}
+
+std::string StreamMuxer::CurrentPath() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return writer_ != nullptr ? path_ : std::string();
+}
+
+int StreamMuxer::OpenSegment(int64_t start_ms) {
+  ++segment_index_;
+  path_ = config_.path_prefix;
+  if (config_.segment_duration_in_seconds > 0 || segment_index_ > 1) {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%05d", segment_index_);
+    path_ += suffix;
+  }
+  path_ += IsMp4() ? ".mp4" : ".flv";
+
+  writer_ = new FileWriter(config_.write_buffer_bytes);
+  if (!writer_->Open(path_, config_.preallocate_bytes)) {
+    return Fail();
+  }
+  segment_start_ms_ = start_ms;
+  fragment_start_ms_ = start_ms;
+  fragment_sequence_ = 1;
+  video_last_dts_ = -1;
+  audio_next_dts_ = -1;
+  return WriteHeader();
+}
+
+int StreamMuxer::CloseSegment() {
+  if (writer_ == nullptr) {
+    return liteav::trtc::ERR_OK;
+  }
+  bool ok = writer_->Close();
+  delete writer_;
+  writer_ = nullptr;
+  return ok ? liteav::trtc::ERR_OK : Fail();
+}
+
+int StreamMuxer::Fail() {
+  failed_ = true;
+  if (writer_ != nullptr) {
+    writer_->Close();
+    delete writer_;
+    writer_ = nullptr;
+  }
+  video_samples_.clear();
+  audio_samples_.clear();
+  video_data_.clear();
+  audio_data_.clear();
+  return liteav::trtc::ERR_FAILED;
+}
+
+int StreamMuxer::WriteHeader() {
+  const bool video = HasVideo() && video_ready_;
+  const bool aac = HasAudio() && audio_ready_ && audio_codec_ == liteav::trtc::AUDIO_CODEC_TYPE_AAC;
+  const bool audio = HasAudio() && audio_ready_ && (IsMp4() || aac);
+
+  scratch_.clear();
+  if (IsMp4()) {
+    size_t ftyp = BeginBox(&scratch_, "ftyp");
+    PutBytes(&scratch_, "isom", 4);
+    PutU32(&scratch_, 0x200);
+    PutBytes(&scratch_, "isomiso6mp41", 12);
+    EndBox(&scratch_, ftyp);
+    AppendMoov(&scratch_);
+    if (!writer_->Append(scratch_)) {
+      return Fail();
+    }
+    bytes_written_ += scratch_.size();
+    return liteav::trtc::ERR_OK;
+  }
+
+  const uint8_t header[13] = {'F', 'L', 'V', 1,
+                              static_cast<uint8_t>((audio ? 0x04 : 0) | (video ? 0x01 : 0)),
+                              0, 0, 0, 9, 0, 0, 0, 0};
+  if (!writer_->Append(header, sizeof(header))) {
+    return Fail();
+  }
+  bytes_written_ += sizeof(header);
+  int ret = liteav::trtc::ERR_OK;
+  if (video) {
+    AppendVideoConfig(&scratch_);
+    const uint8_t codec_id =
+        video_codec_ == liteav::trtc::VIDEO_CODEC_TYPE_H265 ? kFlvCodecHevc : kFlvCodecAvc;
+    const uint8_t head[5] = {static_cast<uint8_t>(0x10 | codec_id), 0, 0, 0, 0};
+    ret = WriteFlvTag(kFlvTagVideo, 0, head, sizeof(head), scratch_.data(), scratch_.size());
+  }
+  if (ret == liteav::trtc::ERR_OK && aac) {
+    const uint8_t head[2] = {0xaf, 0};
+    ret = WriteFlvTag(kFlvTagAudio, 0, head, sizeof(head), audio_config_.data(),
+                      audio_config_.size());
+  }
+  return ret;
+}
+
+int StreamMuxer::WriteFlvTag(uint8_t type,
+                             int64_t dts_ms,
+                             const uint8_t* head,
+                             size_t head_size,
+                             const uint8_t* body,
+                             size_t body_size) {
+  const uint32_t data_size = static_cast<uint32_t>(head_size + body_size);
+  const uint32_t ts = static_cast<uint32_t>(dts_ms);
+  const uint8_t tag[11] = {type,
+                           static_cast<uint8_t>(data_size >> 16),
+                           static_cast<uint8_t>(data_size >> 8),
+                           static_cast<uint8_t>(data_size),
+                           static_cast<uint8_t>(ts >> 16),
+                           static_cast<uint8_t>(ts >> 8),
+                           static_cast<uint8_t>(ts),
+                           static_cast<uint8_t>(ts >> 24),
+                           0,
+                           0,
+                           0};
+  const uint32_t tag_size = data_size + sizeof(tag);
+  const uint8_t trailer[4] = {static_cast<uint8_t>(tag_size >> 24),
+                              static_cast<uint8_t>(tag_size >> 16),
+                              static_cast<uint8_t>(tag_size >> 8),
+                              static_cast<uint8_t>(tag_size)};
+  if (!writer_->Append(tag, sizeof(tag)) || !writer_->Append(head, head_size) ||
+      !writer_->Append(body, body_size) || !writer_->Append(trailer, sizeof(trailer))) {
+    return Fail();
+  }
+  bytes_written_ += tag_size + sizeof(trailer);
+  return liteav::trtc::ERR_OK;
+}
+
+int StreamMuxer::FlushFragment(int64_t video_end_ms) {
+  if (!IsMp4() || writer_ == nullptr || (video_samples_.empty() && audio_samples_.empty())) {
+    return liteav::trtc::ERR_OK;
+  }
+  scratch_.clear();
+  AppendMoof(&scratch_, video_end_ms);
+  PutU32(&scratch_, static_cast<uint32_t>(8 + video_data_.size() + audio_data_.size()));
+  PutBytes(&scratch_, "mdat", 4);
+  if (!writer_->Append(scratch_) || !writer_->Append(video_data_) ||
+      !writer_->Append(audio_data_)) {
+    return Fail();
+  }
+  bytes_written_ += scratch_.size() + video_data_.size() + audio_data_.size();
+  ++fragment_sequence_;
+  video_samples_.clear();
+  audio_samples_.clear();
+  video_data_.clear();
+  audio_data_.clear();
+  return liteav::trtc::ERR_OK;
+}
+
+bool StreamMuxer::UpdateAudioConfig(const AudioFrame& frame, size_t* header_size) {
+  *header_size = 0;
+  if (frame.codec == liteav::trtc::AUDIO_CODEC_TYPE_OPUS) {
+    if (frame.sample_rate <= 0 || frame.channels <= 0 || frame.channels > 2) {
+      return false;
+    }
+    audio_codec_ = frame.codec;
+    audio_sample_rate_ = frame.sample_rate;
+    audio_channels_ = frame.channels;
+    audio_ready_ = true;
+    return true;
+  }
+
+  // AAC：带 ADTS 头时从头中取参数并去掉头，否则按帧上的采样率 / 声道数按 LC 处理
+  const uint8_t* data = frame.data();
+  const size_t size = frame.size();
+  int object_type = 2;
+  int rate_index = -1;
+  int channels = frame.channels;
+  if (size >= 7 && data[0] == 0xff && (data[1] & 0xf0) == 0xf0) {
+    object_type = (data[2] >> 6) + 1;
+    rate_index = (data[2] >> 2) & 0x0f;
+    channels = ((data[2] & 0x01) << 2) | (data[3] >> 6);
+    *header_size = (data[1] & 0x01) ? 7 : 9;
+    if (size < *header_size || rate_index >= 13) {
+      return false;
+    }
+  } else {
+    for (int i = 0; i < 13; ++i) {
+      if (kAacSampleRates[i] == frame.sample_rate) {
+        rate_index = i;
+        break;
+      }
+    }
+  }
+  if (rate_index < 0 || channels <= 0 || channels > 7) {
+    return false;
+  }
+  audio_codec_ = liteav::trtc::AUDIO_CODEC_TYPE_AAC;
+  audio_sample_rate_ = kAacSampleRates[rate_index];
+  audio_channels_ = channels;
+  if (!audio_ready_) {
+    audio_config_.resize(2);
+    audio_config_[0] = static_cast<uint8_t>((object_type << 3) | (rate_index >> 1));
+    audio_config_[1] = static_cast<uint8_t>(((rate_index & 1) << 7) | (channels << 3));
+    audio_ready_ = true;
+  }
+  return true;
+}
+
+uint32_t StreamMuxer::AudioTimescale() const {
+  return audio_codec_ == liteav::trtc::AUDIO_CODEC_TYPE_OPUS
+             ? kOpusTimescale
+             : static_cast<uint32_t>(audio_sample_rate_);
+}
+
+uint32_t StreamMuxer::AudioFrameSamples() const {
+  // Opus 按 20ms 帧
+  return audio_codec_ == liteav::trtc::AUDIO_CODEC_TYPE_OPUS ? 960 : 1024;
+}
+
+size_t StreamMuxer::AppendVideoPayload(std::vector<uint8_t>* out) const {
+  const size_t begin = out->size();
+  for (size_t i = 0; i < nals_.size(); ++i) {
+    const NalUnit& nal = nals_[i];
+    if (IsParameterSetNal(video_codec_, nal.type) ||
+        IsAccessUnitDelimiter(video_codec_, nal.type)) {
+      continue;
+    }
+    PutU32(out, static_cast<uint32_t>(nal.size));
+    PutBytes(out, nal.data, nal.size);
+  }
+  return out->size() - begin;
+}
+
+void StreamMuxer::AppendVideoConfig(std::vector<uint8_t>* out) const {
+  const VideoParameterSets& params = video_params_;
+  if (video_codec_ != liteav::trtc::VIDEO_CODEC_TYPE_H265) {
+    // AVCDecoderConfigurationRecord
+    PutU8(out, 1);
+    PutBytes(out, params.sps.data() + 1, 3);
+    PutU8(out, 0xff);  // lengthSizeMinusOne = 3
+    PutU8(out, 0xe1);  // 1 个 SPS
+    PutU16(out, static_cast<uint32_t>(params.sps.size()));
+    PutBytes(out, params.sps.data(), params.sps.size());
+    PutU8(out, 1);
+    PutU16(out, static_cast<uint32_t>(params.pps.size()));
+    PutBytes(out, params.pps.data(), params.pps.size());
+    return;
+  }
+
+  // HEVCDecoderConfigurationRecord
+  PutU8(out, 1);
+  PutBytes(out, params.general_profile_tier_level, 12);
+  PutU16(out, 0xf000);  // min_spatial_segmentation_idc
+  PutU8(out, 0xfc);     // parallelismType
+  PutU8(out, 0xfc | params.chroma_format_idc);
+  PutU8(out, 0xf8 | (params.bit_depth_luma - 8));
+  PutU8(out, 0xf8 | (params.bit_depth_chroma - 8));
+  PutU16(out, 0);  // avgFrameRate
+  PutU8(out, (params.max_sub_layers << 3) | (params.temporal_id_nesting ? 0x04 : 0) | 0x03);
+  PutU8(out, 3);
+  const std::string* sets[3] = {&params.vps, &params.sps, &params.pps};
+  const uint8_t types[3] = {32, 33, 34};
+  for (int i = 0; i < 3; ++i) {
+    PutU8(out, 0x80 | types[i]);
+    PutU16(out, 1);
+    PutU16(out, static_cast<uint32_t>(sets[i]->size()));
+    PutBytes(out, sets[i]->data(), sets[i]->size());
+  }
+}
+
+void StreamMuxer::AppendMoov(std::vector<uint8_t>* out) const {
+  const bool video = HasVideo() && video_ready_;
+  const bool audio = HasAudio() && audio_ready_;
+
+  size_t moov = BeginBox(out, "moov");
+  size_t mvhd = BeginFullBox(out, "mvhd", 0, 0);
+  PutZeros(out, 8);  // creation / modification time
+  PutU32(out, 1000);
+  PutU32(out, 0);  // duration 由分片决定
+  PutU32(out, 0x00010000);
+  PutU16(out, 0x0100);
+  PutZeros(out, 10);
+  for (int i = 0; i < 9; ++i) {
+    PutU32(out, static_cast<uint32_t>(kIdentityMatrix[i]));
+  }
+  PutZeros(out, 24);
+  PutU32(out, kAudioTrackId + 1);
+  EndBox(out, mvhd);
+
+  for (int track = 0; track < 2; ++track) {
+    const bool is_video = track == 0;
+    if ((is_video && !video) || (!is_video && !audio)) {
+      continue;
+    }
+    const uint32_t track_id = is_video ? kVideoTrackId : kAudioTrackId;
+
+    size_t trak = BeginBox(out, "trak");
+    size_t tkhd = BeginFullBox(out, "tkhd", 0, 0x03);
+    PutZeros(out, 8);
+    PutU32(out, track_id);
+    PutU32(out, 0);
+    PutU32(out, 0);  // duration
+    PutZeros(out, 8);
+    PutU16(out, 0);  // layer
+    PutU16(out, is_video ? 0 : 1);
+    PutU16(out, is_video ? 0 : 0x0100);
+    PutU16(out, 0);
+    // 旋转写入显示矩阵，与 VideoRotation 的顺时针方向一致
+    int32_t matrix[9];
+    memcpy(matrix, kIdentityMatrix, sizeof(matrix));
+    if (is_video) {
+      switch (video_rotation_) {
+        case liteav::trtc::VIDEO_ROTATION_90:
+          matrix[0] = 0, matrix[1] = 0x10000, matrix[3] = -0x10000, matrix[4] = 0;
+          break;
+        case liteav::trtc::VIDEO_ROTATION_180:
+          matrix[0] = -0x10000, matrix[4] = -0x10000;
+          break;
+        case liteav::trtc::VIDEO_ROTATION_270:
+          matrix[0] = 0, matrix[1] = -0x10000, matrix[3] = 0x10000, matrix[4] = 0;
+          break;
+        default:
+          break;
+      }
+    }
+    for (int i = 0; i < 9; ++i) {
+      PutU32(out, static_cast<uint32_t>(matrix[i]));
+    }
+    PutU32(out, is_video ? static_cast<uint32_t>(video_params_.width) << 16 : 0);
+    PutU32(out, is_video ? static_cast<uint32_t>(video_params_.height) << 16 : 0);
+    EndBox(out, tkhd);
+
+    size_t mdia = BeginBox(out, "mdia");
+    size_t mdhd = BeginFullBox(out, "mdhd", 0, 0);
+    PutZeros(out, 8);
+    PutU32(out, is_video ? kVideoTimescale : AudioTimescale());
+    PutU32(out, 0);
+    PutU16(out, 0x55c4);  // "und"
+    PutU16(out, 0);
+    EndBox(out, mdhd);
+
+    size_t hdlr = BeginFullBox(out, "hdlr", 0, 0);
+    PutU32(out, 0);
+    PutBytes(out, is_video ? "vide" : "soun", 4);
+    PutZeros(out, 12);
+    const char* name = is_video ? "VideoHandler" : "SoundHandler";
+    PutBytes(out, name, strlen(name) + 1);
+    EndBox(out, hdlr);
+
+    size_t minf = BeginBox(out, "minf");
+    if (is_video) {
+      size_t vmhd = BeginFullBox(out, "vmhd", 0, 1);
+      PutZeros(out, 8);
+      EndBox(out, vmhd);
+    } else {
+      size_t smhd = BeginFullBox(out, "smhd", 0, 0);
+      PutZeros(out, 4);
+      EndBox(out, smhd);
+    }
+    size_t dinf = BeginBox(out, "dinf");
+    size_t dref = BeginFullBox(out, "dref", 0, 0);
+    PutU32(out, 1);
+    EndBox(out, BeginFullBox(out, "url ", 0, 1));
+    EndBox(out, dref);
+    EndBox(out, dinf);
+
+    size_t stbl = BeginBox(out, "stbl");
+    size_t stsd = BeginFullBox(out, "stsd", 0, 0);
+    PutU32(out, 1);
+    if (is_video) {
+      const bool hevc = video_codec_ == liteav::trtc::VIDEO_CODEC_TYPE_H265;
+      size_t entry = BeginBox(out, hevc ? "hvc1" : "avc1");
+      PutZeros(out, 6);
+      PutU16(out, 1);  // data_reference_index
+      PutZeros(out, 16);
+      PutU16(out, static_cast<uint32_t>(video_params_.width));
+      PutU16(out, static_cast<uint32_t>(video_params_.height));
+      PutU32(out, 0x00480000);
+      PutU32(out, 0x00480000);
+      PutU32(out, 0);
+      PutU16(out, 1);  // frame_count
+      PutZeros(out, 32);
+      PutU16(out, 0x0018);
+      PutU16(out, 0xffff);
+      size_t config = BeginBox(out, hevc ? "hvcC" : "avcC");
+      AppendVideoConfig(out);
+      EndBox(out, config);
+      EndBox(out, entry);
+    } else {
+      const bool opus = audio_codec_ == liteav::trtc::AUDIO_CODEC_TYPE_OPUS;
+      size_t entry = BeginBox(out, opus ? "Opus" : "mp4a");
+      PutZeros(out, 6);
+      PutU16(out, 1);
+      PutZeros(out, 8);
+      PutU16(out, static_cast<uint32_t>(audio_channels_));
+      PutU16(out, 16);
+      PutU32(out, 0);
+      PutU32(out, AudioTimescale() << 16);
+      if (opus) {
+        size_t dops = BeginBox(out, "dOps");
+        PutU8(out, 0);
+        PutU8(out, static_cast<uint32_t>(audio_channels_));
+        PutU16(out, 0);  // PreSkip
+        PutU32(out, static_cast<uint32_t>(audio_sample_rate_));
+        PutU16(out, 0);  // OutputGain
+        PutU8(out, 0);   // ChannelMappingFamily
+        EndBox(out, dops);
+      } else {
+        size_t esds = BeginFullBox(out, "esds", 0, 0);
+        const size_t decoder_specific = 2 + audio_config_.size();
+        const size_t decoder_config = 2 + 13 + decoder_specific;
+        PutDescriptorHeader(out, 0x03, 3 + decoder_config + 3);
+        PutU16(out, kAudioTrackId);
+        PutU8(out, 0);
+        PutDescriptorHeader(out, 0x04, decoder_config - 2);
+        PutU8(out, 0x40);  // MPEG-4 Audio
+        PutU8(out, 0x15);  // AudioStream
+        PutU24(out, 0);
+        PutU32(out, 0);
+        PutU32(out, 0);
+        PutDescriptorHeader(out, 0x05, audio_config_.size());
+        PutBytes(out, audio_config_.data(), audio_config_.size());
+        PutDescriptorHeader(out, 0x06, 1);
+        PutU8(out, 0x02);
+        EndBox(out, esds);
+      }
+      EndBox(out, entry);
+    }
+    EndBox(out, stsd);
+    const char* empty_tables[] = {"stts", "stsc", "stco"};
+    for (int i = 0; i < 3; ++i) {
+      size_t box = BeginFullBox(out, empty_tables[i], 0, 0);
+      PutU32(out, 0);
+      EndBox(out, box);
+    }
+    size_t stsz = BeginFullBox(out, "stsz", 0, 0);
+    PutU32(out, 0);
+    PutU32(out, 0);
+    EndBox(out, stsz);
+    EndBox(out, stbl);
+    EndBox(out, minf);
+    EndBox(out, mdia);
+    EndBox(out, trak);
+  }
+
+  size_t mvex = BeginBox(out, "mvex");
+  for (int track = 0; track < 2; ++track) {
+    if ((track == 0 && !video) || (track == 1 && !audio)) {
+      continue;
+    }
+    size_t trex = BeginFullBox(out, "trex", 0, 0);
+    PutU32(out, track == 0 ? kVideoTrackId : kAudioTrackId);
+    PutU32(out, 1);
+    PutU32(out, 0);
+    PutU32(out, 0);
+    PutU32(out, 0);
+    EndBox(out, trex);
+  }
+  EndBox(out, mvex);
+  EndBox(out, moov);
+}
+
+void StreamMuxer::AppendMoof(std::vector<uint8_t>* out, int64_t video_end_ms) const {
+  const size_t moof = BeginBox(out, "moof");
+  size_t mfhd = BeginFullBox(out, "mfhd", 0, 0);
+  PutU32(out, fragment_sequence_);
+  EndBox(out, mfhd);
+
+  size_t data_offset_pos[2] = {0, 0};
+  for (int track = 0; track < 2; ++track) {
+    const bool is_video = track == 0;
+    const std::vector<Sample>& samples = is_video ? video_samples_ : audio_samples_;
+    if (samples.empty()) {
+      continue;
+    }
+    size_t traf = BeginBox(out, "traf");
+    size_t tfhd = BeginFullBox(out, "tfhd", 0, 0x020000);  // default-base-is-moof
+    PutU32(out, is_video ? kVideoTrackId : kAudioTrackId);
+    EndBox(out, tfhd);
+    size_t tfdt = BeginFullBox(out, "tfdt", 1, 0);
+    PutU64(out, static_cast<uint64_t>(samples[0].dts));
+    EndBox(out, tfdt);
+
+    // data-offset | duration | size，视频另带 flags 与 composition time offset
+    const uint32_t flags = is_video ? 0x000f01 : 0x000301;
+    size_t trun = BeginFullBox(out, "trun", 1, flags);
+    PutU32(out, static_cast<uint32_t>(samples.size()));
+    data_offset_pos[track] = out->size();
+    PutU32(out, 0);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      const Sample& sample = samples[i];
+      int64_t duration;
+      if (i + 1 < samples.size()) {
+        duration = samples[i + 1].dts - sample.dts;
+      } else if (is_video) {
+        duration = video_end_ms >= 0 ? video_end_ms - segment_start_ms_ - sample.dts
+                   : samples.size() > 1 ? sample.dts - samples[i - 1].dts
+                                        : 33;
+      } else {
+        duration = AudioFrameSamples();
+      }
+      PutU32(out, static_cast<uint32_t>(std::max<int64_t>(duration, 0)));
+      PutU32(out, sample.size);
+      if (is_video) {
+        PutU32(out, sample.sync ? kSyncSampleFlags : kNonSyncSampleFlags);
+        PutU32(out, static_cast<uint32_t>(sample.cto));
+      }
+    }
+    EndBox(out, trun);
+    EndBox(out, traf);
+  }
+  EndBox(out, moof);
+
+  // 数据偏移相对 moof 起点，mdat 中先视频后音频
+  const size_t mdat_payload = out->size() - moof + 8;
+  if (data_offset_pos[0] != 0) {
+    PatchU32(out, data_offset_pos[0], static_cast<uint32_t>(mdat_payload));
+  }
+  if (data_offset_pos[1] != 0) {
+    PatchU32(out, data_offset_pos[1], static_cast<uint32_t>(mdat_payload + video_data_.size()));
+  }
+}
+
+}  // namespace swing
@@ -0,0 +1,198 @@
+//
+// 功能说明：
+//   单流本地录制：把编码后的 VideoFrame（H.264 / H.265）与 AudioFrame（AAC / Opus）
+//   直接封装为分片 MP4（fMP4）或 FLV 文件，不解码、不转码。
+//   SDK 的录制器（liteav_trtc_recorder.h）需要单独进房并解码，单流录制用
+//   StreamMuxer 只需在 OnRemoteVideoReceived / OnRemoteAudioReceived 中转发帧。
+//
+//   - 视频输入为 Annex-B，参数集（SPS / PPS / VPS）从关键帧中提取，样本转为
+//     4 字节长度前缀格式；参数集变化时切换到新文件
+//   - 文件按关键帧切分：|segment_duration_in_seconds| > 0 时，时长达到后在下一个
+//     关键帧处切换文件（纯音频录制时在任意音频帧处切换）
+//   - fMP4 每个文件自带 ftyp + moov，可独立播放；每 |fragment_duration_ms| 在关键帧
+//     处输出一个 moof + mdat 分片
+//   - 写入先进入预先分配的缓冲，满后一次 write()；|preallocate_bytes| > 0 时
+//     新文件先用 fallocate 预留磁盘空间，关闭时截断到实际长度
+//
+//   录制 kAudioAndVideo 时两路参数都就绪后从下一个视频关键帧开始写文件，之前的帧
+//   丢弃。FLV 不支持 Opus，此时音频帧被丢弃。
+//
+//   线程安全：WriteVideo() / WriteAudio() 可在不同线程调用，内部串行化。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_STREAM_MUXER_H_
+#define GCHATGPT_TRTC_SWING_STREAM_MUXER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "../include/trtc/liteav_trtc_recorder.h"
+#include "nal_parser.h"
+
+namespace swing {
+
+using liteav::trtc::AudioCodecType;
+using liteav::trtc::AudioFrame;
+using liteav::trtc::FileFormat;
+using liteav::trtc::RecordType;
+using liteav::trtc::VideoFrame;
+
+struct StreamMuxerConfig {
+  StreamMuxerConfig()
+      : file_format(liteav::trtc::kMp4),
+        record_type(liteav::trtc::kAudioAndVideo),
+        segment_duration_in_seconds(0),
+        fragment_duration_ms(1000),
+        write_buffer_bytes(1 << 20),
+        preallocate_bytes(0) {}
+
+  // kFlv 或 kMp4
+  FileFormat file_format;
+  RecordType record_type;
+
+  // 文件名前缀，可带目录，目录需已存在
+  // 第一个文件为 "<path_prefix>.mp4"，分段时为 "<path_prefix>_00001.mp4"，
+  // 之后的文件依次为 "<path_prefix>_00002.mp4"，以此类推（FLV 扩展名为 .flv）。
+  std::string path_prefix;
+
+  // 0 表示不分段
+  int segment_duration_in_seconds;
+
+  // fMP4 分片时长，FLV 忽略
+  int fragment_duration_ms;
+
+  // 写缓冲大小
+  size_t write_buffer_bytes;
+
+  // 每个文件预留的磁盘空间，0 表示不预留
+  size_t preallocate_bytes;
+};
+
+class StreamMuxer {
+ public:
+  explicit StreamMuxer(const StreamMuxerConfig& config);
+  ~StreamMuxer();
+
+  // 检查配置，此时不创建文件
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：格式不是 kFlv / kMp4，或 |path_prefix| 为空
+  int Init();
+
+  // 写入一帧
+  // 返回值：
+  // - ERR_OK：已写入或在等待参数集 / 关键帧时按预期丢弃
+  // - ERR_INVALID_PARAMETER：帧数据格式错误或编码类型不支持
+  // - ERR_INVALID_OPERATION：未 Init()、已 Close()，或录制类型不包含该路
+  // - ERR_FAILED：文件写入失败，之后的写入都返回该值
+  int WriteVideo(const VideoFrame& frame);
+  int WriteAudio(const AudioFrame& frame);
+
+  // 写出缓存的分片并关闭当前文件
+  int Close();
+
+  // 已创建的文件数、已写入的字节数、丢弃的帧数
+  int SegmentCount() const;
+  uint64_t BytesWritten() const;
+  uint64_t DroppedFrames() const;
+
+  // 当前正在写入的文件路径，未开始时为空
+  std::string CurrentPath() const;
+
+ private:
+  class FileWriter;
+
+  // fMP4 分片中的一个样本，|dts| 为相对文件起点的轨道时间（视频毫秒，音频采样）
+  struct Sample {
+    int64_t dts;
+    int32_t cto;
+    uint32_t size;
+    bool sync;
+  };
+
+  StreamMuxer(const StreamMuxer&);
+  StreamMuxer& operator=(const StreamMuxer&);
+
+  bool HasVideo() const;
+  bool HasAudio() const;
+  bool IsMp4() const;
+
+  int OpenSegment(int64_t start_ms);
+  int CloseSegment();
+  int WriteHeader();
+  int FlushFragment(int64_t video_end_ms);
+  int Fail();
+
+  bool UpdateAudioConfig(const AudioFrame& frame, size_t* header_size);
+  uint32_t AudioTimescale() const;
+  uint32_t AudioFrameSamples() const;
+
+  // 样本数据转为长度前缀格式追加到 |out|，返回追加的字节数
+  size_t AppendVideoPayload(std::vector<uint8_t>* out) const;
+  void AppendVideoConfig(std::vector<uint8_t>* out) const;
+  void AppendMoov(std::vector<uint8_t>* out) const;
+  void AppendMoof(std::vector<uint8_t>* out, int64_t video_end_ms) const;
+  int WriteFlvTag(uint8_t type, int64_t dts_ms, const uint8_t* head, size_t head_size,
+                  const uint8_t* body, size_t body_size);
+
+  const StreamMuxerConfig config_;
+
+  mutable std::mutex mutex_;
+  bool initialized_;
+  bool closed_;
+  bool failed_;
+
+  // 时间戳展开为 int64 毫秒，处理 uint32 回绕
+  bool video_seen_;
+  uint32_t video_last_raw_;
+  int64_t video_last_ms_;
+  bool audio_seen_;
+  uint32_t audio_last_raw_;
+  int64_t audio_last_ms_;
+
+  // 视频参数
+  VideoCodecType video_codec_;
+  VideoParameterSets video_params_;
+  bool video_ready_;
+  int video_rotation_;
+
+  // 音频参数，|audio_config_| 为 AAC 的 AudioSpecificConfig
+  AudioCodecType audio_codec_;
+  int audio_sample_rate_;
+  int audio_channels_;
+  std::vector<uint8_t> audio_config_;
+  bool audio_ready_;
+  bool audio_unsupported_;
+
+  // 当前文件
+  FileWriter* writer_;
+  std::string path_;
+  int segment_index_;
+  int64_t segment_start_ms_;
+  uint32_t fragment_sequence_;
+
+  // 当前分片缓存的样本与数据（仅 fMP4），视频数据为长度前缀格式
+  std::vector<Sample> video_samples_;
+  std::vector<Sample> audio_samples_;
+  std::vector<uint8_t> video_data_;
+  std::vector<uint8_t> audio_data_;
+  int64_t fragment_start_ms_;
+  int64_t video_last_dts_;
+  int64_t audio_next_dts_;
+
+  // 复用的临时缓冲
+  std::vector<NalUnit> nals_;
+  std::vector<uint8_t> scratch_;
+
+  uint64_t bytes_written_;
+  uint64_t dropped_frames_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_STREAM_MUXER_H_
@@ -0,0 +1,362 @@
+#include "subscription_manager.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace swing {
+
+namespace {
+
+struct Rect {
+  Rect() : left(0), top(0), right(0), bottom(0) {}
+
+  bool Empty() const { return right <= left || bottom <= top; }
+
+  int64_t left;
+  int64_t top;
+  int64_t right;
+  int64_t bottom;
+};
+
+int64_t MonotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+Rect LayoutRect(const LayoutParams& layout, int canvas_width, int canvas_height) {
+  Rect rect;
+  rect.left = layout.x;
+  rect.top = layout.y;
+  rect.right = rect.left + layout.width;
+  rect.bottom = rect.top + layout.height;
+  if (canvas_width > 0 && canvas_height > 0) {
+    rect.right = std::min<int64_t>(rect.right, canvas_width);
+    rect.bottom = std::min<int64_t>(rect.bottom, canvas_height);
+  }
+  return rect;
+}
+
+Rect Intersect(const Rect& a, const Rect& b) {
+  Rect rect;
+  rect.left = std::max(a.left, b.left);
+  rect.top = std::max(a.top, b.top);
+  rect.right = std::min(a.right, b.right);
+  rect.bottom = std::min(a.bottom, b.bottom);
+  return rect;
+}
+
+// 矩形并集的面积：按 x 坐标切成竖条，每条内合并 y 区间
+int64_t UnionArea(const std::vector<Rect>& rects) {
+  std::vector<int64_t> xs;
+  xs.reserve(rects.size() * 2);
+  for (size_t i = 0; i < rects.size(); ++i) {
+    xs.push_back(rects[i].left);
+    xs.push_back(rects[i].right);
+  }
+  std::sort(xs.begin(), xs.end());
+  xs.erase(std::unique(xs.begin(), xs.end()), xs.end());
+
+  int64_t area = 0;
+  std::vector<std::pair<int64_t, int64_t> > spans;
+  for (size_t i = 0; i + 1 < xs.size(); ++i) {
+    spans.clear();
+    for (size_t j = 0; j < rects.size(); ++j) {
+      if (rects[j].left <= xs[i] && rects[j].right >= xs[i + 1]) {
+        spans.push_back(std::make_pair(rects[j].top, rects[j].bottom));
+      }
+    }
+    std::sort(spans.begin(), spans.end());
+    int64_t covered = 0;
+    int64_t end = 0;
+    for (size_t j = 0; j < spans.size(); ++j) {
+      const int64_t top = std::max(spans[j].first, end);
+      if (spans[j].second > top) {
+        covered += spans[j].second - top;
+        end = spans[j].second;
+      }
+    }
+    area += covered * (xs[i + 1] - xs[i]);
+  }
+  return area;
+}
+
+StreamType VideoStreamType(bool aux, SubscribeTier tier) {
+  if (aux) {
+    return liteav::trtc::STREAM_TYPE_VIDEO_AUX;
+  }
+  return tier == kSubscribeHigh ? liteav::trtc::STREAM_TYPE_VIDEO_HIGH
+                                : liteav::trtc::STREAM_TYPE_VIDEO_LOW;
+}
+
+int64_t PixelRate(const StreamCost& cost) {
+  return static_cast<int64_t>(cost.width) * cost.height * cost.fps;
+}
+
+}  // namespace
+
+int64_t VisiblePixels(const LayoutParams layouts[],
+                      size_t layouts_count,
+                      size_t index,
+                      int canvas_width,
+                      int canvas_height) {
+  if (index >= layouts_count) {
+    return 0;
+  }
+  const Rect rect = LayoutRect(layouts[index], canvas_width, canvas_height);
+  if (rect.Empty()) {
+    return 0;
+  }
+  std::vector<Rect> occluders;
+  for (size_t i = 0; i < layouts_count; ++i) {
+    const bool above = layouts[i].zorder > layouts[index].zorder ||
+                       (layouts[i].zorder == layouts[index].zorder && i > index);
+    if (!above) {
+      continue;
+    }
+    const Rect overlap = Intersect(rect, LayoutRect(layouts[i], canvas_width, canvas_height));
+    if (!overlap.Empty()) {
+      occluders.push_back(overlap);
+    }
+  }
+  return (rect.right - rect.left) * (rect.bottom - rect.top) - UnionArea(occluders);
+}
+
+SubscriptionManager::SubscriptionManager(TRTCCloud* cloud, const SubscriptionConfig& config)
+    : cloud_(cloud), config_(config), has_layout_(false), last_accumulate_ms_(-1) {}
+
+SubscriptionManager::~SubscriptionManager() {}
+
+void SubscriptionManager::UpdateLayout(const LayoutParams layouts[],
+                                       size_t layouts_count,
+                                       int64_t now_ms) {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Advance(now_ms);
+  for (std::map<std::string, User>::iterator it = users_.begin(); it != users_.end(); ++it) {
+    it->second.main.visible_pixels = 0;
+    it->second.aux.visible_pixels = 0;
+  }
+  // 同一路出现在多个格子时取可见像素最多的一格
+  for (size_t i = 0; i < layouts_count; ++i) {
+    const char* user_id = layouts[i].user_id.GetValue();
+    if (user_id == nullptr || user_id[0] == '\0') {
+      continue;
+    }
+    User& user = users_[user_id];
+    Stream& stream =
+        layouts[i].stream_type == liteav::trtc::STREAM_TYPE_VIDEO_AUX ? user.aux : user.main;
+    stream.visible_pixels = std::max(
+        stream.visible_pixels,
+        VisiblePixels(layouts, layouts_count, i, config_.canvas_width, config_.canvas_height));
+  }
+  has_layout_ = true;
+  EvaluateAll(now_ms);
+}
+
+void SubscriptionManager::OnRemoteVideoAvailable(const char* user_id,
+                                                 bool available,
+                                                 StreamType type,
+                                                 int64_t now_ms) {
+  if (user_id == nullptr) {
+    return;
+  }
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  const bool aux = type == liteav::trtc::STREAM_TYPE_VIDEO_AUX;
+  std::lock_guard<std::mutex> lock(mutex_);
+  Advance(now_ms);
+  User& user = users_[user_id];
+  Stream& stream = aux ? user.aux : user.main;
+  if (available && !stream.available && !stream.evaluated) {
+    stream.current = config_.auto_subscribed ? kSubscribeHigh : kSubscribeNone;
+    stream.target = stream.current;
+  }
+  stream.available = available;
+  if (has_layout_) {
+    Evaluate(user_id, aux, &stream, now_ms);
+  }
+}
+
+void SubscriptionManager::OnRemoteUserExitRoom(const char* user_id, int64_t now_ms) {
+  if (user_id == nullptr) {
+    return;
+  }
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Advance(now_ms);
+  users_.erase(user_id);
+}
+
+void SubscriptionManager::Tick(int64_t now_ms) {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Advance(now_ms);
+  if (has_layout_) {
+    EvaluateAll(now_ms);
+  }
+}
+
+SubscribeTier SubscriptionManager::CurrentTier(const char* user_id, bool aux) const {
+  if (user_id == nullptr) {
+    return kSubscribeNone;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, User>::const_iterator it = users_.find(user_id);
+  if (it == users_.end()) {
+    return kSubscribeNone;
+  }
+  return aux ? it->second.aux.current : it->second.main.current;
+}
+
+SubscriptionStats SubscriptionManager::GetStats(int64_t now_ms) const {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  SubscriptionStats stats = stats_;
+  Accumulate(now_ms, &stats);
+  return stats;
+}
+
+void SubscriptionManager::EvaluateAll(int64_t now_ms) {
+  for (std::map<std::string, User>::iterator it = users_.begin(); it != users_.end(); ++it) {
+    Evaluate(it->first, false, &it->second.main, now_ms);
+    Evaluate(it->first, true, &it->second.aux, now_ms);
+  }
+}
+
+SubscribeTier SubscriptionManager::Desired(const Stream& stream, bool aux) const {
+  if (stream.visible_pixels <= 0 || stream.visible_pixels < config_.min_visible_pixels) {
+    return kSubscribeNone;
+  }
+  if (aux) {
+    return kSubscribeHigh;
+  }
+  const double low_pixels = static_cast<double>(config_.low.width) * config_.low.height;
+  const double ratio =
+      stream.current == kSubscribeHigh ? config_.downgrade_ratio : config_.upgrade_ratio;
+  return stream.visible_pixels >= low_pixels * ratio ? kSubscribeHigh : kSubscribeLow;
+}
+
+void SubscriptionManager::Evaluate(const std::string& user_id,
+                                   bool aux,
+                                   Stream* stream,
+                                   int64_t now_ms) {
+  // 没有视频时服务器不下发，保持原档位，视频恢复后再判断
+  if (!stream->available) {
+    return;
+  }
+  const SubscribeTier desired = Desired(*stream, aux);
+  if (desired == stream->current) {
+    stream->target = desired;
+    stream->evaluated = true;
+    return;
+  }
+  if (desired > stream->current || !stream->evaluated) {
+    Switch(user_id, aux, stream, desired);
+    return;
+  }
+
+  if (desired != stream->target) {
+    stream->target = desired;
+    stream->target_since_ms = now_ms;
+  }
+  const int delay =
+      desired == kSubscribeNone ? config_.unsubscribe_delay_ms : config_.downgrade_delay_ms;
+  if (now_ms - stream->target_since_ms >= delay) {
+    Switch(user_id, aux, stream, desired);
+  }
+}
+
+void SubscriptionManager::Switch(const std::string& user_id,
+                                 bool aux,
+                                 Stream* stream,
+                                 SubscribeTier tier) {
+  // 先订阅新档位再取消旧档位；失败时保持原档位，下次 Tick() 重试
+  if (tier != kSubscribeNone &&
+      cloud_->Subscribe(user_id.c_str(), VideoStreamType(aux, tier)) != liteav::trtc::ERR_OK) {
+    ++stats_.failures;
+    return;
+  }
+  if (stream->current != kSubscribeNone &&
+      cloud_->Unsubscribe(user_id.c_str(), VideoStreamType(aux, stream->current)) !=
+          liteav::trtc::ERR_OK) {
+    ++stats_.failures;
+    if (tier == kSubscribeNone) {
+      return;
+    }
+  }
+  stream->current = tier;
+  stream->target = tier;
+  stream->evaluated = true;
+  ++stats_.switches;
+}
+
+void SubscriptionManager::Advance(int64_t now_ms) {
+  Accumulate(now_ms, &stats_);
+  last_accumulate_ms_ = now_ms;
+}
+
+void SubscriptionManager::Accumulate(int64_t now_ms, SubscriptionStats* stats) const {
+  Costs(stats);
+  if (last_accumulate_ms_ < 0 || now_ms <= last_accumulate_ms_) {
+    return;
+  }
+  const int64_t elapsed_ms = now_ms - last_accumulate_ms_;
+  // kbps * ms = bit
+  const int64_t saved_kbps = stats->baseline_bitrate_kbps - stats->bitrate_kbps;
+  if (saved_kbps > 0) {
+    stats->saved_bytes += static_cast<uint64_t>(saved_kbps * elapsed_ms / 8);
+  }
+  const int64_t saved_pixels =
+      stats->baseline_decode_pixels_per_second - stats->decode_pixels_per_second;
+  if (saved_pixels > 0) {
+    stats->saved_decode_pixels += static_cast<uint64_t>(saved_pixels * elapsed_ms / 1000);
+  }
+}
+
+void SubscriptionManager::Costs(SubscriptionStats* stats) const {
+  stats->high_streams = 0;
+  stats->low_streams = 0;
+  stats->unsubscribed_streams = 0;
+  stats->bitrate_kbps = 0;
+  stats->baseline_bitrate_kbps = 0;
+  stats->decode_pixels_per_second = 0;
+  stats->baseline_decode_pixels_per_second = 0;
+  for (std::map<std::string, User>::const_iterator it = users_.begin(); it != users_.end(); ++it) {
+    for (int aux = 0; aux < 2; ++aux) {
+      const Stream& stream = aux ? it->second.aux : it->second.main;
+      if (!stream.available) {
+        continue;
+      }
+      const StreamCost& full = aux ? config_.aux : config_.high;
+      stats->baseline_bitrate_kbps += full.bitrate_kbps;
+      stats->baseline_decode_pixels_per_second += PixelRate(full);
+      if (stream.current == kSubscribeNone) {
+        ++stats->unsubscribed_streams;
+        continue;
+      }
+      const StreamCost& cost = stream.current == kSubscribeLow ? config_.low : full;
+      if (stream.current == kSubscribeLow) {
+        ++stats->low_streams;
+      } else {
+        ++stats->high_streams;
+      }
+      stats->bitrate_kbps += cost.bitrate_kbps;
+      stats->decode_pixels_per_second += PixelRate(cost);
+    }
+  }
+}
+
+}  // namespace swing
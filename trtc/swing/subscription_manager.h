@@ -0,0 +1,222 @@
+//
+// 功能说明：
+//   按画布布局自动选择远端视频的订阅档位。
+//   SDK 默认为每个远端用户订阅大流，画面只占一个小格子时仍然拉取和解码大流。
+//   SubscriptionManager 根据 UpdateLayout() 传入的 LayoutParams 计算每路视频
+//   在画布上实际可见的像素数（裁掉画布外部分，扣除被更高层级格子遮挡的部分），
+//   在大流、小流、不订阅三档之间切换，通过 TRTCCloud::Subscribe() / Unsubscribe() 生效：
+//   - 可见像素不少于小流分辨率 * |upgrade_ratio| 时订阅大流，
+//     已是大流时降到小流分辨率 * |downgrade_ratio| 以下才降档；
+//   - 不在布局中、完全被遮挡或可见像素少于 |min_visible_pixels| 时取消订阅；
+//   - 升档立即生效，降档与取消订阅需持续 |downgrade_delay_ms| / |unsubscribe_delay_ms|，
+//     布局动画或短暂隐藏不会来回切换；
+//   - 切换时先订阅新档位再取消旧档位，避免中间出现无画面。
+//   辅流（屏幕分享）没有小流，只在订阅与不订阅之间切换。
+//
+//   节省的带宽与解码开销按配置中各档位的码率、分辨率和帧率估算，
+//   基准为 SDK 默认的全部订阅大流。
+//
+//   时间参数 |now_ms| 为 CLOCK_MONOTONIC 毫秒，传负值时取当前时间。
+//   延迟生效的降档在 UpdateLayout() / Tick() 中执行，需定时调用 Tick()。
+//   线程安全：各接口可在不同线程调用，内部串行化。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_SUBSCRIPTION_MANAGER_H_
+#define GCHATGPT_TRTC_SWING_SUBSCRIPTION_MANAGER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "../include/trtc/liteav_trtc_recorder.h"
+
+namespace swing {
+
+using liteav::trtc::LayoutParams;
+using liteav::trtc::StreamType;
+using liteav::trtc::TRTCCloud;
+
+// 订阅档位
+enum SubscribeTier {
+  kSubscribeNone = 0,
+  kSubscribeLow = 1,
+  kSubscribeHigh = 2,
+};
+
+// 一档视频流的估算参数
+struct StreamCost {
+  StreamCost() : width(0), height(0), fps(0), bitrate_kbps(0) {}
+  StreamCost(int width, int height, int fps, int bitrate_kbps)
+      : width(width), height(height), fps(fps), bitrate_kbps(bitrate_kbps) {}
+
+  int width;
+  int height;
+  int fps;
+  int bitrate_kbps;
+};
+
+struct SubscriptionConfig {
+  SubscriptionConfig()
+      : canvas_width(0),
+        canvas_height(0),
+        high(1280, 720, 15, 1200),
+        low(320, 180, 15, 150),
+        aux(1920, 1080, 10, 1500),
+        upgrade_ratio(1.5),
+        downgrade_ratio(1.0),
+        min_visible_pixels(64 * 36),
+        downgrade_delay_ms(2000),
+        unsubscribe_delay_ms(5000),
+        auto_subscribed(true) {}
+
+  // 画布尺寸，超出部分不可见；为 0 时不裁剪
+  int canvas_width;
+  int canvas_height;
+
+  // 大流、小流、辅流的分辨率、帧率与码率，用于档位判断和开销估算
+  StreamCost high;
+  StreamCost low;
+  StreamCost aux;
+
+  // 档位阈值，相对小流分辨率的像素数，|downgrade_ratio| 需不大于 |upgrade_ratio|
+  double upgrade_ratio;
+  double downgrade_ratio;
+
+  // 可见像素少于该值视为不可见
+  int min_visible_pixels;
+
+  // 降档 / 取消订阅需持续的时间
+  int downgrade_delay_ms;
+  int unsubscribe_delay_ms;
+
+  // SDK 是否默认订阅大流（TRTCCloud 的默认行为），决定新用户的初始档位
+  bool auto_subscribed;
+};
+
+struct SubscriptionStats {
+  SubscriptionStats()
+      : high_streams(0),
+        low_streams(0),
+        unsubscribed_streams(0),
+        switches(0),
+        failures(0),
+        bitrate_kbps(0),
+        baseline_bitrate_kbps(0),
+        decode_pixels_per_second(0),
+        baseline_decode_pixels_per_second(0),
+        saved_bytes(0),
+        saved_decode_pixels(0) {}
+
+  // 有视频的远端流按当前档位计数，辅流计入 |high_streams|
+  size_t high_streams;
+  size_t low_streams;
+  size_t unsubscribed_streams;
+
+  // 档位切换次数，以及 Subscribe() / Unsubscribe() 失败次数（下次 Tick() 重试）
+  uint64_t switches;
+  uint64_t failures;
+
+  // 当前估算的下行码率与解码像素率，以及全部订阅大流时的基准
+  int bitrate_kbps;
+  int baseline_bitrate_kbps;
+  int64_t decode_pixels_per_second;
+  int64_t baseline_decode_pixels_per_second;
+
+  // 创建以来累计节省的下行字节数与解码像素数
+  uint64_t saved_bytes;
+  uint64_t saved_decode_pixels;
+};
+
+// 按 |layouts| 计算 |index| 格在画布上未被遮挡的像素数
+// 绘制顺序与 VideoCompositor 相同：|zorder| 大的在上，相同时后传入的在上。
+// |canvas_width| / |canvas_height| 为 0 时不裁剪。
+int64_t VisiblePixels(const LayoutParams layouts[],
+                      size_t layouts_count,
+                      size_t index,
+                      int canvas_width,
+                      int canvas_height);
+
+class SubscriptionManager {
+ public:
+  // |cloud| 需已进房，且在本对象销毁前保持有效
+  SubscriptionManager(TRTCCloud* cloud, const SubscriptionConfig& config);
+  ~SubscriptionManager();
+
+  // 全量更新布局，立即执行升档，降档按延迟执行
+  void UpdateLayout(const LayoutParams layouts[], size_t layouts_count, int64_t now_ms = -1);
+
+  // 在 TRTCCloudDelegate::OnRemoteVideoAvailable() 中调用
+  // 没有视频的流不订阅，也不计入开销。
+  void OnRemoteVideoAvailable(const char* user_id,
+                              bool available,
+                              StreamType type,
+                              int64_t now_ms = -1);
+
+  // 在 TRTCCloudDelegate::OnRemoteUserExitRoom() 中调用
+  void OnRemoteUserExitRoom(const char* user_id, int64_t now_ms = -1);
+
+  // 执行到期的降档，重试失败的切换，建议每 200ms 到 1s 调用一次
+  void Tick(int64_t now_ms = -1);
+
+  // 用户主流 / 辅流的当前档位，|aux| 为 true 时返回辅流
+  SubscribeTier CurrentTier(const char* user_id, bool aux) const;
+
+  SubscriptionStats GetStats(int64_t now_ms = -1) const;
+
+ private:
+  // 一路视频：主流（大小流）或辅流
+  struct Stream {
+    Stream()
+        : available(false),
+          evaluated(false),
+          current(kSubscribeNone),
+          target(kSubscribeNone),
+          target_since_ms(0),
+          visible_pixels(0) {}
+
+    bool available;
+    // 是否已按布局切换过档位，首次判断的降档立即执行
+    bool evaluated;
+    SubscribeTier current;
+    SubscribeTier target;
+    int64_t target_since_ms;
+    int64_t visible_pixels;
+  };
+
+  struct User {
+    Stream main;
+    Stream aux;
+  };
+
+  SubscriptionManager(const SubscriptionManager&);
+  SubscriptionManager& operator=(const SubscriptionManager&);
+
+  // 调用方持有 mutex_
+  void Evaluate(const std::string& user_id, bool aux, Stream* stream, int64_t now_ms);
+  void Switch(const std::string& user_id, bool aux, Stream* stream, SubscribeTier tier);
+  SubscribeTier Desired(const Stream& stream, bool aux) const;
+  void EvaluateAll(int64_t now_ms);
+  // 档位变化前调用，按当前档位把节省量累计到 |now_ms|
+  void Advance(int64_t now_ms);
+  void Accumulate(int64_t now_ms, SubscriptionStats* stats) const;
+  // 按当前档位填写 |stats| 的流数与开销
+  void Costs(SubscriptionStats* stats) const;
+
+  TRTCCloud* const cloud_;
+  const SubscriptionConfig config_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, User> users_;
+  // 收到第一次布局前不切换档位
+  bool has_layout_;
+  SubscriptionStats stats_;
+  int64_t last_accumulate_ms_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_SUBSCRIPTION_MANAGER_H_
@@ -0,0 +1,117 @@
+package swing
+
+// 逐帧时延追踪，接口说明见 latency_tracer.h
+
+// #include "latency_tracer.h"
+import "C"
+
+type TraceStage int
+
+const (
+	TraceCallback TraceStage = C.kSwingTraceCallback
+	TraceQueue    TraceStage = C.kSwingTraceQueue
+	TraceHandoff  TraceStage = C.kSwingTraceHandoff
+	TraceProcess  TraceStage = C.kSwingTraceProcess
+	TraceOutput   TraceStage = C.kSwingTraceOutput
+)
+
+var traceStageNames = [...]string{"callback", "queue", "handoff", "process", "output"}
+
+func (s TraceStage) String() string {
+	if s >= 0 && int(s) < len(traceStageNames) {
+		return traceStageNames[s]
+	}
+	return "unknown"
+}
+
+// 一个直方图的摘要，时间单位微秒
+type LatencyRow struct {
+	StreamType string  `json:"stream_type"`
+	Stage      string  `json:"stage"`
+	Cumulative bool    `json:"cumulative"`
+	Count      uint64  `json:"count"`
+	MinUs      float64 `json:"min_us"`
+	MeanUs     float64 `json:"mean_us"`
+	P50Us      float64 `json:"p50_us"`
+	P90Us      float64 `json:"p90_us"`
+	P99Us      float64 `json:"p99_us"`
+	P999Us     float64 `json:"p999_us"`
+	MaxUs      float64 `json:"max_us"`
+}
+
+type LatencyReport struct {
+	Stamps    uint64       `json:"stamps"`
+	Dropped   uint64       `json:"dropped"`
+	Unmatched uint64       `json:"unmatched"`
+	Expired   uint64       `json:"expired"`
+	InFlight  uint64       `json:"in_flight"`
+	Rows      []LatencyRow `json:"rows"`
+}
+
+const traceMaxRows = 64
+
+// 开启追踪，每 2^sampleShift 帧追踪一帧，sampleShift 为负时关闭
+func EnableTracing(sampleShift int) {
+	C.SwingTraceEnable(C.int(sampleShift))
+}
+
+// 记录 key 为 key 的帧到达 stage，key 为 0（未被追踪）时不进入 C
+func TraceStamp(key uint64, stage TraceStage) {
+	if key == 0 {
+		return
+	}
+	C.SwingTraceStamp(C.uint64_t(key), C.int(stage))
+}
+
+// StreamType 定义在 C++ 命名空间中，cgo 不可见，取值见 liteav_trtc_defines.h
+func traceStreamTypeName(streamType int) string {
+	switch streamType {
+	case 1:
+		return "audio"
+	case 2:
+		return "video_high"
+	case 3:
+		return "video_low"
+	case 7:
+		return "video_aux"
+	}
+	return "unknown"
+}
+
+func LatencySnapshot() LatencyReport {
+	var rows [traceMaxRows]C.SwingTraceRow
+	n := int(C.SwingTraceSnapshot(&rows[0], traceMaxRows))
+	var stats C.SwingTraceStats
+	C.SwingTraceGetStats(&stats)
+	report := LatencyReport{
+		Stamps:    uint64(stats.stamps),
+		Dropped:   uint64(stats.dropped),
+		Unmatched: uint64(stats.unmatched),
+		Expired:   uint64(stats.expired),
+		InFlight:  uint64(stats.in_flight),
+		Rows:      make([]LatencyRow, 0, n),
+	}
+	us := func(ns C.int64_t) float64 { return float64(ns) / 1000 }
+	for i := 0; i < n; i++ {
+		row := &rows[i]
+		report.Rows = append(report.Rows, LatencyRow{
+			StreamType: traceStreamTypeName(int(row.stream_type)),
+			Stage:      TraceStage(row.stage).String(),
+			Cumulative: row.cumulative != 0,
+			Count:      uint64(row.count),
+			MinUs:      us(row.min_ns),
+			MeanUs:     us(row.mean_ns),
+			P50Us:      us(row.p50_ns),
+			P90Us:      us(row.p90_ns),
+			P99Us:      us(row.p99_ns),
+			P999Us:     us(row.p999_ns),
+			MaxUs:      us(row.max_ns),
+		})
+	}
+	return report
+}
+
+// 清空直方图与计数
+func ResetLatency() {
+	C.SwingTraceReset()
+}
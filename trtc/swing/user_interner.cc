@@ -0,0 +1,325 @@
+#include "user_interner.h"
+
+#include <string.h>
+
+namespace swing {
+
+namespace {
+
+size_t TableSize(size_t max_users) {
+  size_t size = 16;
+  while (size < max_users * 2) {
+    size <<= 1;
+  }
+  return size;
+}
+
+// FNV-1a
+uint32_t HashUserId(const char* user_id) {
+  uint32_t hash = 2166136261u;
+  for (const char* p = user_id; *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619u;
+  }
+  return hash;
+}
+
+// 已删除的槽位，查找时跳过、插入时复用
+char g_tombstone;
+
+template <typename T>
+T* Tombstone() {
+  return reinterpret_cast<T*>(&g_tombstone);
+}
+
+// 读线程登记的纪元，0 表示不在查找中，填充到独占缓存行
+struct ReaderSlot {
+  ReaderSlot() : epoch(0), used(true) {}
+
+  std::atomic<uint64_t> epoch;
+  std::atomic<bool> used;
+  char padding[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)];
+};
+
+// 进程内所有 UserInterner 共用的读者登记
+// 槽位在线程退出时归还给后来的线程，不释放。
+class ReaderRegistry {
+ public:
+  // 不析构，线程退出时仍可访问
+  static ReaderRegistry& Instance() {
+    static ReaderRegistry* registry = new ReaderRegistry();
+    return *registry;
+  }
+
+  ReaderSlot* Local() {
+    struct Holder {
+      Holder() : slot(nullptr) {}
+      ~Holder() {
+        if (slot != nullptr) {
+          slot->epoch.store(0, std::memory_order_release);
+          slot->used.store(false, std::memory_order_release);
+        }
+      }
+      ReaderSlot* slot;
+    };
+    thread_local Holder holder;
+    if (holder.slot == nullptr) {
+      holder.slot = Acquire();
+    }
+    return holder.slot;
+  }
+
+  uint64_t Epoch() const { return epoch_.load(std::memory_order_seq_cst); }
+
+  // 推进纪元，返回推进前的值
+  uint64_t Advance() { return epoch_.fetch_add(1, std::memory_order_seq_cst); }
+
+  // 正在查找的读者中最早的纪元，没有读者时返回 UINT64_MAX
+  uint64_t MinActive() {
+    uint64_t min = UINT64_MAX;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      const uint64_t epoch = slots_[i]->epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0 && epoch < min) {
+        min = epoch;
+      }
+    }
+    return min;
+  }
+
+ private:
+  ReaderRegistry() : epoch_(1) {}
+
+  ReaderSlot* Acquire() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < slots_.size(); ++i) {
+      if (!slots_[i]->used.load(std::memory_order_acquire)) {
+        slots_[i]->used.store(true, std::memory_order_relaxed);
+        return slots_[i];
+      }
+    }
+    slots_.push_back(new ReaderSlot());
+    return slots_.back();
+  }
+
+  std::atomic<uint64_t> epoch_;
+  std::mutex mutex_;
+  std::vector<ReaderSlot*> slots_;
+};
+
+// Find() 期间登记纪元
+// 登记与之后读哈希表都是顺序一致的，回收者摘除条目后若看到本线程未登记，
+// 本线程之后的查找一定看得到摘除后的哈希表。
+class ReadGuard {
+ public:
+  ReadGuard() : slot_(ReaderRegistry::Instance().Local()) {
+    slot_->epoch.store(ReaderRegistry::Instance().Epoch(), std::memory_order_seq_cst);
+  }
+  ~ReadGuard() { slot_->epoch.store(0, std::memory_order_release); }
+
+ private:
+  ReaderSlot* const slot_;
+};
+
+}  // namespace
+
+UserInterner::UserInterner(size_t max_users)
+    : table_(new Table(TableSize(max_users))),
+      entries_(max_users),
+      size_(0),
+      used_slots_(0),
+      next_handle_(0) {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    entries_[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+UserInterner::~UserInterner() {
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    delete entries_[i].load(std::memory_order_relaxed);
+  }
+  for (size_t i = 0; i < retired_entries_.size(); ++i) {
+    delete retired_entries_[i].second;
+  }
+  for (size_t i = 0; i < retired_tables_.size(); ++i) {
+    delete retired_tables_[i].second;
+  }
+  delete table_.load(std::memory_order_relaxed);
+}
+
+uint32_t UserInterner::Find(const char* user_id) const {
+  if (user_id == nullptr) {
+    user_id = "";
+  }
+  const uint32_t hash = HashUserId(user_id);
+  ReadGuard guard;
+  const Table* table = table_.load(std::memory_order_seq_cst);
+  const size_t mask = table->slots.size() - 1;
+  // 无锁查找：遇到空槽即说明不存在，墓碑继续向后探测
+  for (size_t probe = 0; probe <= mask; ++probe) {
+    const Entry* entry = table->slots[(hash + probe) & mask].load(std::memory_order_seq_cst);
+    if (entry == nullptr) {
+      break;
+    }
+    if (entry == Tombstone<Entry>()) {
+      continue;
+    }
+    if (entry->hash == hash && strcmp(entry->name.c_str(), user_id) == 0) {
+      return entry->handle;
+    }
+  }
+  return kInvalidUser;
+}
+
+uint32_t UserInterner::Intern(const char* user_id) {
+  if (user_id == nullptr) {
+    user_id = "";
+  }
+  uint32_t handle = Find(user_id);
+  if (handle != kInvalidUser) {
+    return handle;
+  }
+
+  const uint32_t hash = HashUserId(user_id);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Table* table = table_.load(std::memory_order_relaxed);
+  size_t mask = table->slots.size() - 1;
+  // 先确认不存在，同时记下第一个可用的槽位，墓碑优先
+  size_t target = mask + 1;
+  bool tombstone = false;
+  for (size_t probe = 0; probe <= mask; ++probe) {
+    const size_t index = (hash + probe) & mask;
+    Entry* entry = table->slots[index].load(std::memory_order_relaxed);
+    if (entry == nullptr) {
+      if (target > mask) {
+        target = index;
+      }
+      break;
+    }
+    if (entry == Tombstone<Entry>()) {
+      if (target > mask) {
+        target = index;
+        tombstone = true;
+      }
+      continue;
+    }
+    if (entry->hash == hash && strcmp(entry->name.c_str(), user_id) == 0) {
+      return entry->handle;
+    }
+  }
+
+  if (free_handles_.empty() && next_handle_ >= entries_.size()) {
+    return kInvalidUser;
+  }
+  if (!free_handles_.empty()) {
+    handle = free_handles_.front();
+    free_handles_.pop_front();
+  } else {
+    handle = next_handle_++;
+  }
+
+  // 占用空槽会使墓碑越积越多，超过 3/4 时重建，查找遇到空槽的距离保持较短
+  if (!tombstone && used_slots_ + 1 > table->slots.size() / 4 * 3) {
+    Rebuild();
+    table = table_.load(std::memory_order_relaxed);
+    mask = table->slots.size() - 1;
+    target = hash & mask;
+    while (table->slots[target].load(std::memory_order_relaxed) != nullptr) {
+      target = (target + 1) & mask;
+    }
+  }
+
+  Entry* entry = new Entry(user_id, hash, handle);
+  entries_[handle].store(entry, std::memory_order_release);
+  size_.fetch_add(1, std::memory_order_release);
+  if (!tombstone) {
+    ++used_slots_;
+  }
+  table->slots[target].store(entry, std::memory_order_seq_cst);
+  Reclaim();
+  return handle;
+}
+
+bool UserInterner::Release(uint32_t handle) {
+  if (handle >= entries_.size()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry* entry = entries_[handle].load(std::memory_order_relaxed);
+  if (entry == nullptr) {
+    return false;
+  }
+  Table* table = table_.load(std::memory_order_relaxed);
+  const size_t mask = table->slots.size() - 1;
+  for (size_t probe = 0; probe <= mask; ++probe) {
+    std::atomic<Entry*>& slot = table->slots[(entry->hash + probe) & mask];
+    if (slot.load(std::memory_order_relaxed) == entry) {
+      slot.store(Tombstone<Entry>(), std::memory_order_seq_cst);
+      break;
+    }
+  }
+  entries_[handle].store(nullptr, std::memory_order_release);
+  size_.fetch_sub(1, std::memory_order_release);
+  free_handles_.push_back(handle);
+
+  retired_entries_.push_back(std::make_pair(ReaderRegistry::Instance().Advance(), entry));
+  Reclaim();
+  return true;
+}
+
+const char* UserInterner::Name(uint32_t handle) const {
+  if (handle >= entries_.size()) {
+    return nullptr;
+  }
+  const Entry* entry = entries_[handle].load(std::memory_order_acquire);
+  return entry == nullptr ? nullptr : entry->name.c_str();
+}
+
+void UserInterner::Rebuild() {
+  Table* old_table = table_.load(std::memory_order_relaxed);
+  Table* table = new Table(old_table->slots.size());
+  const size_t mask = table->slots.size() - 1;
+  used_slots_ = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    Entry* entry = entries_[i].load(std::memory_order_relaxed);
+    if (entry == nullptr) {
+      continue;
+    }
+    size_t index = entry->hash & mask;
+    while (table->slots[index].load(std::memory_order_relaxed) != nullptr) {
+      index = (index + 1) & mask;
+    }
+    table->slots[index].store(entry, std::memory_order_relaxed);
+    ++used_slots_;
+  }
+  table_.store(table, std::memory_order_seq_cst);
+  retired_tables_.push_back(std::make_pair(ReaderRegistry::Instance().Advance(), old_table));
+  Reclaim();
+}
+
+void UserInterner::Reclaim() {
+  if (retired_entries_.empty() && retired_tables_.empty()) {
+    return;
+  }
+  // 纪元不晚于摘除时纪元的读者可能还持有指针，其余读者只能看到摘除之后的哈希表
+  const uint64_t min_active = ReaderRegistry::Instance().MinActive();
+  size_t kept = 0;
+  for (size_t i = 0; i < retired_entries_.size(); ++i) {
+    if (retired_entries_[i].first < min_active) {
+      delete retired_entries_[i].second;
+    } else {
+      retired_entries_[kept++] = retired_entries_[i];
+    }
+  }
+  retired_entries_.resize(kept);
+  kept = 0;
+  for (size_t i = 0; i < retired_tables_.size(); ++i) {
+    if (retired_tables_[i].first < min_active) {
+      delete retired_tables_[i].second;
+    } else {
+      retired_tables_[kept++] = retired_tables_[i];
+    }
+  }
+  retired_tables_.resize(kept);
+}
+
+}  // namespace swing
@@ -0,0 +1,107 @@
+//
+// 功能说明：
+//   用户 ID 驻留。
+//   TRTCCloudDelegate 的回调都以 const char* user_id 标识用户，每一层按字符串
+//   查表既要哈希又要比较，复制 TrtcString 还会分配内存。UserInterner 把用户 ID
+//   映射为 [0, max_users) 内的整数句柄：在 OnRemoteUserEnterRoom 中驻留一次，
+//   之后每帧只需一次无锁查找得到句柄，各层的用户状态放在按句柄下标访问的数组里。
+//
+//   用户退房时调用 Release() 归还句柄，句柄之后会分配给新用户；归还前需先清理
+//   各层按该句柄索引的状态。未归还的句柄在对象生命周期内不变。
+//   同时驻留的用户数达到 |max_users| 后不再接受新用户。
+//
+//   Find() 不加锁：读线程在查找期间登记当前纪元，Release() 摘下的条目与
+//   重建后替换下来的哈希表要等所有早于摘除的读者离开后才释放（纪元回收）。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_USER_INTERNER_H_
+#define GCHATGPT_TRTC_SWING_USER_INTERNER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace swing {
+
+const uint32_t kInvalidUser = 0xffffffffu;
+
+class UserInterner {
+ public:
+  explicit UserInterner(size_t max_users);
+  ~UserInterner();
+
+  // 返回 |user_id| 的句柄，不存在时分配新句柄
+  // |user_id| 为 nullptr 时按空字符串处理，超出 |max_users| 时返回 kInvalidUser。
+  uint32_t Intern(const char* user_id);
+
+  // 查找已驻留的句柄，不存在时返回 kInvalidUser，无锁
+  uint32_t Find(const char* user_id) const;
+
+  // 归还句柄，之后 Find() 查不到该用户，句柄可能分配给其他用户
+  // 句柄未被占用时返回 false。
+  bool Release(uint32_t handle);
+
+  // 句柄对应的用户 ID，句柄无效时返回 nullptr
+  // 返回的指针在句柄被 Release() 之前有效。
+  const char* Name(uint32_t handle) const;
+
+  // 当前驻留的用户数
+  size_t Size() const { return size_.load(std::memory_order_acquire); }
+
+  // 句柄取值 [0, Capacity())
+  size_t Capacity() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    Entry(const char* name, uint32_t hash, uint32_t handle)
+        : name(name), hash(hash), handle(handle) {}
+
+    const std::string name;
+    const uint32_t hash;
+    const uint32_t handle;
+  };
+
+  // 开放寻址哈希表，删除的槽位写入墓碑，查找遇到空槽即说明不存在
+  struct Table {
+    explicit Table(size_t size) : slots(size) {}
+
+    std::vector<std::atomic<Entry*> > slots;
+  };
+
+  UserInterner(const UserInterner&);
+  UserInterner& operator=(const UserInterner&);
+
+  // 以下调用时需持有 |mutex_|
+  // 只保留在用条目重建哈希表，清除墓碑
+  void Rebuild();
+  // 释放没有读者可能还在访问的条目与哈希表
+  void Reclaim();
+
+  std::atomic<Table*> table_;
+
+  // 按句柄排列，空闲句柄为 nullptr
+  std::vector<std::atomic<Entry*> > entries_;
+  std::atomic<size_t> size_;
+
+  std::mutex mutex_;
+  // 以下在 |mutex_| 下访问
+  // 非空槽位数，含墓碑
+  size_t used_slots_;
+  // 从未分配过的最小句柄
+  uint32_t next_handle_;
+  // 已归还的句柄，先归还的先复用
+  std::deque<uint32_t> free_handles_;
+  // 已摘下待释放的条目与哈希表，附摘除时的纪元
+  std::vector<std::pair<uint64_t, Entry*> > retired_entries_;
+  std::vector<std::pair<uint64_t, Table*> > retired_tables_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_USER_INTERNER_H_
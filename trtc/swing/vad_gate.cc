@@ -0,0 +1,465 @@
+#include "vad_gate.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "audio_kernels.h"
+#include "frame_pool.h"
+
+namespace swing {
+
+namespace {
+
+// 数字静音的能量下限
+const double kMinDbfs = -100.0;
+
+// 噪声底向更低能量靠拢的速度，每帧缩小差距的比例
+const double kNoiseFallRatio = 0.5;
+
+bool IsPcm16(const AudioFrame& frame) {
+  return frame.codec == liteav::trtc::AUDIO_CODEC_TYPE_PCM && frame.bits_per_sample == 16 &&
+         frame.sample_rate > 0 && (frame.channels == 1 || frame.channels == 2);
+}
+
+int64_t FrameDurationUs(const AudioFrame& frame) {
+  const size_t frames = frame.size() / (sizeof(int16_t) * frame.channels);
+  return static_cast<int64_t>(frames) * 1000000 / frame.sample_rate;
+}
+
+// 缓存的前导帧
+struct PrerollFrame {
+  PrerollFrame() : pts(0), sample_rate(0), channels(0), duration_us(0) {}
+
+  PooledBuffer data;
+  uint32_t pts;
+  int sample_rate;
+  int channels;
+  int64_t duration_us;
+};
+
+}  // namespace
+
+VoiceActivityDetector::VoiceActivityDetector(const VadConfig& config) : config_(config) {
+  Reset();
+}
+
+VoiceActivityDetector::~VoiceActivityDetector() {}
+
+void VoiceActivityDetector::Reset() {
+  state_ = kVadSilence;
+  noise_dbfs_ = NAN;
+  run_us_ = 0;
+}
+
+int VoiceActivityDetector::Process(const AudioFrame& frame, VadResult* result) {
+  if (!IsPcm16(frame)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return Process(reinterpret_cast<const int16_t*>(frame.data()),
+                 frame.size() / (sizeof(int16_t) * frame.channels), frame.channels,
+                 frame.sample_rate, result);
+}
+
+int VoiceActivityDetector::Process(const int16_t* samples,
+                                   size_t frames,
+                                   int channels,
+                                   int sample_rate,
+                                   VadResult* result) {
+  if (samples == nullptr || frames == 0 || result == nullptr || sample_rate <= 0 ||
+      (channels != 1 && channels != 2)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  const int16_t* mono = samples;
+  if (channels == 2) {
+    mono_.resize(frames);
+    DownmixStereoToMono(samples, mono_.data(), frames);
+    mono = mono_.data();
+  }
+
+  uint64_t energy = 0;
+  uint64_t diff_energy = 0;
+  SignalEnergyS16(mono, frames, &energy, &diff_energy);
+  const double mean =
+      static_cast<double>(energy) / static_cast<double>(frames) / (32768.0 * 32768.0);
+  const double energy_dbfs = std::max(kMinDbfs, 10.0 * log10(mean + 1e-10));
+  // 4 * diff / energy = 2 - 2cos(2πf / fs)，反解出等效频率
+  double ratio = energy > 0 ? 4.0 * static_cast<double>(diff_energy) / static_cast<double>(energy)
+                            : 0.0;
+  ratio = std::min(4.0, ratio);
+  const double centroid_hz = sample_rate / (2.0 * M_PI) * acos(1.0 - ratio / 2.0);
+
+  // 首帧按不高于绝对门限初始化噪声底，刚进房就在说话时也能识别
+  if (isnan(noise_dbfs_)) {
+    noise_dbfs_ = std::min(energy_dbfs, config_.min_energy_dbfs);
+  }
+
+  const int64_t frame_us = static_cast<int64_t>(frames) * 1000000 / sample_rate;
+  const bool in_band =
+      centroid_hz >= config_.min_centroid_hz && centroid_hz <= config_.max_centroid_hz;
+  const bool active = energy_dbfs >= config_.min_energy_dbfs &&
+                      energy_dbfs >= noise_dbfs_ + config_.snr_db &&
+                      (state_ == kVadSpeech || in_band);
+
+  if (energy_dbfs < noise_dbfs_) {
+    noise_dbfs_ += (energy_dbfs - noise_dbfs_) * kNoiseFallRatio;
+  } else {
+    noise_dbfs_ = std::min(energy_dbfs,
+                           noise_dbfs_ + config_.noise_rise_db_per_second * frame_us / 1e6);
+  }
+
+  bool speech_start = false;
+  bool speech_end = false;
+  if (state_ == kVadSilence) {
+    run_us_ = active ? run_us_ + frame_us : 0;
+    if (active && run_us_ >= static_cast<int64_t>(config_.start_ms) * 1000) {
+      state_ = kVadSpeech;
+      speech_start = true;
+      run_us_ = 0;
+    }
+  } else {
+    run_us_ = active ? 0 : run_us_ + frame_us;
+    if (run_us_ >= static_cast<int64_t>(config_.hangover_ms) * 1000) {
+      state_ = kVadSilence;
+      speech_end = true;
+      run_us_ = 0;
+    }
+  }
+
+  result->active = active;
+  result->state = state_;
+  result->speech_start = speech_start;
+  result->speech_end = speech_end;
+  result->energy_dbfs = energy_dbfs;
+  result->noise_dbfs = noise_dbfs_;
+  result->centroid_hz = centroid_hz;
+  return liteav::trtc::ERR_OK;
+}
+
+struct VadGate::User {
+  explicit User(const VadConfig& config)
+      : detector(config),
+        head(0),
+        count(0),
+        buffered_us(0),
+        segment_us(0),
+        pending_us(0),
+        last_pts(0) {}
+
+  // 追加一帧，只保留覆盖 |limit_us| 所需的最近几帧
+  void PushPreroll(const AudioFrame& frame, int64_t duration_us, int64_t limit_us) {
+    if (count == preroll.size()) {
+      // 环形缓存已满，展开为线性顺序后在末尾扩容
+      std::rotate(preroll.begin(), preroll.begin() + head, preroll.end());
+      head = 0;
+      preroll.push_back(PrerollFrame());
+    }
+    PrerollFrame& slot = preroll[(head + count) % preroll.size()];
+    slot.data.Assign(frame.data(), frame.size());
+    slot.pts = frame.pts;
+    slot.sample_rate = frame.sample_rate;
+    slot.channels = frame.channels;
+    slot.duration_us = duration_us;
+    ++count;
+    buffered_us += duration_us;
+    while (count > 1 && buffered_us - preroll[head].duration_us >= limit_us) {
+      buffered_us -= preroll[head].duration_us;
+      head = (head + 1) % preroll.size();
+      --count;
+    }
+  }
+
+  std::mutex mutex;
+  VoiceActivityDetector detector;
+
+  // 静音期间的前导帧，环形缓存，槽位复用
+  std::vector<PrerollFrame> preroll;
+  size_t head;
+  size_t count;
+  int64_t buffered_us;
+
+  // 当前语音段的有效时长，以及末尾尚未确认的无效帧时长
+  int64_t segment_us;
+  int64_t pending_us;
+  uint32_t last_pts;
+
+  // 转发前导帧时复用
+  AudioFrame output;
+};
+
+VadGate::VadGate(liteav::trtc::TRTCCloudDelegate* target, const VadConfig& config)
+    : target_(target),
+      config_(config),
+      listener_(nullptr),
+      frames_(0),
+      forwarded_frames_(0),
+      preroll_frames_(0),
+      dropped_frames_(0),
+      bypassed_frames_(0),
+      segments_(0),
+      speech_us_(0),
+      total_us_(0) {}
+
+VadGate::~VadGate() {}
+
+void VadGate::SetListener(VadListener* listener) {
+  listener_.store(listener, std::memory_order_release);
+}
+
+std::shared_ptr<VadGate::User> VadGate::FindOrCreate(const char* user_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<User>& user = users_[user_id];
+  if (!user) {
+    user = std::make_shared<User>(config_);
+  }
+  return user;
+}
+
+void VadGate::Forward(const char* user_id, const AudioFrame& frame, int64_t duration_us) {
+  forwarded_frames_.fetch_add(1, std::memory_order_relaxed);
+  speech_us_.fetch_add(static_cast<uint64_t>(duration_us), std::memory_order_relaxed);
+  if (target_ != nullptr) {
+    target_->OnRemoteAudioReceived(user_id, frame);
+  }
+}
+
+void VadGate::FlushPreroll(const char* user_id, User* user) {
+  for (size_t i = 0; i < user->count; ++i) {
+    const PrerollFrame& slot = user->preroll[(user->head + i) % user->preroll.size()];
+    user->output.SetData(slot.data.data(), slot.data.size());
+    user->output.pts = slot.pts;
+    user->output.sample_rate = slot.sample_rate;
+    user->output.channels = slot.channels;
+    user->output.bits_per_sample = 16;
+    user->output.codec = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+    preroll_frames_.fetch_add(1, std::memory_order_relaxed);
+    Forward(user_id, user->output, slot.duration_us);
+  }
+  user->head = 0;
+  user->count = 0;
+  user->buffered_us = 0;
+}
+
+void VadGate::ProcessAudio(const char* user_id, const AudioFrame& frame) {
+  if (user_id == nullptr) {
+    return;
+  }
+  std::shared_ptr<User> user = FindOrCreate(user_id);
+  std::lock_guard<std::mutex> lock(user->mutex);
+
+  VadResult result;
+  if (user->detector.Process(frame, &result) != liteav::trtc::ERR_OK) {
+    bypassed_frames_.fetch_add(1, std::memory_order_relaxed);
+    if (target_ != nullptr) {
+      target_->OnRemoteAudioReceived(user_id, frame);
+    }
+    return;
+  }
+  const int64_t duration_us = FrameDurationUs(frame);
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  total_us_.fetch_add(static_cast<uint64_t>(duration_us), std::memory_order_relaxed);
+  user->last_pts = frame.pts;
+  VadListener* listener = listener_.load(std::memory_order_acquire);
+
+  if (result.speech_start) {
+    segments_.fetch_add(1, std::memory_order_relaxed);
+    user->segment_us = static_cast<int64_t>(config_.start_ms) * 1000;
+    user->pending_us = 0;
+    if (listener != nullptr) {
+      listener->OnSpeechStart(user_id, frame.pts);
+    }
+    FlushPreroll(user_id, user.get());
+    Forward(user_id, frame, duration_us);
+    return;
+  }
+
+  if (result.state == kVadSpeech || result.speech_end) {
+    if (result.active) {
+      user->segment_us += user->pending_us + duration_us;
+      user->pending_us = 0;
+    } else {
+      user->pending_us += duration_us;
+    }
+    Forward(user_id, frame, duration_us);
+    if (result.speech_end && listener != nullptr) {
+      listener->OnSpeechEnd(user_id, frame.pts, static_cast<uint32_t>(user->segment_us / 1000));
+    }
+    return;
+  }
+
+  if (!config_.drop_silence) {
+    Forward(user_id, frame, duration_us);
+    return;
+  }
+  dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+  user->PushPreroll(frame, duration_us,
+                    static_cast<int64_t>(config_.preroll_ms + config_.start_ms) * 1000);
+}
+
+VadState VadGate::UserState(const char* user_id) const {
+  std::shared_ptr<User> user;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::shared_ptr<User> >::const_iterator it =
+        users_.find(user_id != nullptr ? user_id : "");
+    if (it == users_.end()) {
+      return kVadSilence;
+    }
+    user = it->second;
+  }
+  std::lock_guard<std::mutex> lock(user->mutex);
+  return user->detector.state();
+}
+
+void VadGate::RemoveUser(const char* user_id) {
+  if (user_id == nullptr) {
+    return;
+  }
+  std::shared_ptr<User> user;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, std::shared_ptr<User> >::iterator it = users_.find(user_id);
+    if (it == users_.end()) {
+      return;
+    }
+    user = it->second;
+    users_.erase(it);
+  }
+  std::lock_guard<std::mutex> lock(user->mutex);
+  VadListener* listener = listener_.load(std::memory_order_acquire);
+  if (user->detector.state() == kVadSpeech && listener != nullptr) {
+    listener->OnSpeechEnd(user_id, user->last_pts, static_cast<uint32_t>(user->segment_us / 1000));
+  }
+}
+
+VadGateStats VadGate::GetStats() const {
+  VadGateStats stats;
+  stats.frames = frames_.load(std::memory_order_relaxed);
+  stats.forwarded_frames = forwarded_frames_.load(std::memory_order_relaxed);
+  stats.preroll_frames = preroll_frames_.load(std::memory_order_relaxed);
+  stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+  stats.bypassed_frames = bypassed_frames_.load(std::memory_order_relaxed);
+  stats.segments = segments_.load(std::memory_order_relaxed);
+  stats.speech_ms = speech_us_.load(std::memory_order_relaxed) / 1000;
+  stats.total_ms = total_us_.load(std::memory_order_relaxed) / 1000;
+  return stats;
+}
+
+void VadGate::OnError(liteav::trtc::Error error) {
+  if (target_ != nullptr) {
+    target_->OnError(error);
+  }
+}
+
+void VadGate::OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                       liteav::trtc::ConnectionState new_state) {
+  if (target_ != nullptr) {
+    target_->OnConnectionStateChanged(old_state, new_state);
+  }
+}
+
+void VadGate::OnEnterRoom() {
+  if (target_ != nullptr) {
+    target_->OnEnterRoom();
+  }
+}
+
+void VadGate::OnExitRoom() {
+  if (target_ != nullptr) {
+    target_->OnExitRoom();
+  }
+}
+
+void VadGate::OnLocalAudioChannelCreated() {
+  if (target_ != nullptr) {
+    target_->OnLocalAudioChannelCreated();
+  }
+}
+
+void VadGate::OnLocalAudioChannelDestroyed() {
+  if (target_ != nullptr) {
+    target_->OnLocalAudioChannelDestroyed();
+  }
+}
+
+void VadGate::OnLocalVideoChannelCreated(StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnLocalVideoChannelCreated(type);
+  }
+}
+
+void VadGate::OnLocalVideoChannelDestroyed(StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnLocalVideoChannelDestroyed(type);
+  }
+}
+
+void VadGate::OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) {
+  if (target_ != nullptr) {
+    target_->OnRequestChangeVideoEncodeBitrate(type, bitrate_bps);
+  }
+}
+
+void VadGate::OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) {
+  if (target_ != nullptr) {
+    target_->OnRemoteUserEnterRoom(info);
+  }
+}
+
+void VadGate::OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) {
+  RemoveUser(info.user_id.GetValue());
+  if (target_ != nullptr) {
+    target_->OnRemoteUserExitRoom(info);
+  }
+}
+
+void VadGate::OnRemoteAudioAvailable(const char* user_id, bool available) {
+  if (target_ != nullptr) {
+    target_->OnRemoteAudioAvailable(user_id, available);
+  }
+}
+
+void VadGate::OnRemoteVideoAvailable(const char* user_id, bool available, StreamType type) {
+  if (target_ != nullptr) {
+    target_->OnRemoteVideoAvailable(user_id, available, type);
+  }
+}
+
+void VadGate::OnRemoteVideoReceived(const char* user_id,
+                                    StreamType type,
+                                    const liteav::trtc::VideoFrame& frame) {
+  if (target_ != nullptr) {
+    target_->OnRemoteVideoReceived(user_id, type, frame);
+  }
+}
+
+void VadGate::OnRemoteVideoReceived(const char* user_id,
+                                    StreamType type,
+                                    const liteav::trtc::PixelFrame& frame) {
+  if (target_ != nullptr) {
+    target_->OnRemoteVideoReceived(user_id, type, frame);
+  }
+}
+
+void VadGate::OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) {
+  ProcessAudio(user_id, frame);
+}
+
+void VadGate::OnRemoteMixedAudioReceived(const AudioFrame& frame) {
+  if (target_ != nullptr) {
+    target_->OnRemoteMixedAudioReceived(frame);
+  }
+}
+
+void VadGate::OnSeiMessageReceived(const char* user_id,
+                                   StreamType stream_type,
+                                   int message_type,
+                                   const uint8_t* message,
+                                   int length) {
+  if (target_ != nullptr) {
+    target_->OnSeiMessageReceived(user_id, stream_type, message_type, message, length);
+  }
+}
+
+}  // namespace swing
@@ -0,0 +1,267 @@
+//
+// 功能说明：
+//   远端音频的语音检测（VAD）与静音门限。
+//   OnRemoteAudioReceived / GetAudioFrame 对每个用户每 20ms 都给出一帧，包括静音，
+//   下游的语音识别、混音等按连接时长消耗 CPU。VadGate 在帧进入下游之前逐帧判断，
+//   只放行语音段，下游开销随说话时长而不是在线时长增长。
+//
+//   VoiceActivityDetector 对单路 16 位 PCM 流式判断，每帧一次 SignalEnergyS16：
+//   - 能量：帧能量（dBFS）需高于 |min_energy_dbfs|，并高出自适应噪声底 |snr_db|；
+//     噪声底随低能量帧快速下降，随时间缓慢上升，持续的稳态噪声最终被视为背景；
+//   - 频谱：由差分能量与能量之比估算频谱重心，静音段中重心不在
+//     [|min_centroid_hz|, |max_centroid_hz|] 内的帧（工频嗡声、白噪声）不触发语音开始，
+//     语音段中不再要求，清辅音不会提前结束语音段；
+//   - 连续 |start_ms| 的有效帧判定语音开始，连续 |hangover_ms| 的无效帧判定语音结束。
+//
+//   VadGate 作为 TRTCCloudDelegate 包在下游 delegate（如 FrameDispatcher）外面，
+//   帧以外的回调原样转发。每个用户的 PCM 帧：
+//   - 语音开始时先通知 VadListener::OnSpeechStart()，再依次转发缓存的
+//     |preroll_ms| 前导帧（含判定开始所用的帧）与当前帧，语音开头不被截断；
+//   - 语音段内的帧直接转发，结束帧转发后通知 VadListener::OnSpeechEnd()；
+//   - 静音帧只进入前导缓存，|drop_silence| 为 false 时照常转发，仅通过事件标注语音段。
+//   非 PCM 帧与混音流（OnRemoteMixedAudioReceived）不做判断，直接转发。
+//   非录制模式下把 GetAudioFrame() 读到的帧交给 ProcessAudio()，效果相同。
+//
+//   线程安全：不同用户的帧可在不同线程回调，同一用户的帧需串行。
+//   VadListener 与下游 delegate 的音频回调在该用户的处理过程中调用，
+//   回调内不可再对同一用户调用 ProcessAudio()。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_VAD_GATE_H_
+#define GCHATGPT_TRTC_SWING_VAD_GATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+
+namespace swing {
+
+using liteav::trtc::AudioFrame;
+using liteav::trtc::StreamType;
+
+struct VadConfig {
+  VadConfig()
+      : min_energy_dbfs(-55.0),
+        snr_db(9.0),
+        min_centroid_hz(120.0),
+        max_centroid_hz(3500.0),
+        noise_rise_db_per_second(1.0),
+        start_ms(40),
+        hangover_ms(300),
+        preroll_ms(200),
+        drop_silence(true) {}
+
+  // 能量门限：绝对下限与相对噪声底的信噪比
+  double min_energy_dbfs;
+  double snr_db;
+
+  // 语音开始所需的频谱重心范围
+  double min_centroid_hz;
+  double max_centroid_hz;
+
+  // 噪声底上升速度
+  double noise_rise_db_per_second;
+
+  // 判定语音开始 / 结束所需的持续时间
+  int start_ms;
+  int hangover_ms;
+
+  // 语音开始时补发的前导音频时长
+  int preroll_ms;
+
+  // 是否丢弃静音帧
+  bool drop_silence;
+};
+
+// 语音状态
+enum VadState {
+  kVadSilence = 0,
+  kVadSpeech = 1,
+};
+
+// 一帧的判断结果
+struct VadResult {
+  VadResult()
+      : active(false),
+        state(kVadSilence),
+        speech_start(false),
+        speech_end(false),
+        energy_dbfs(0),
+        noise_dbfs(0),
+        centroid_hz(0) {}
+
+  // 本帧满足门限
+  bool active;
+  // 处理本帧后的状态
+  VadState state;
+  // 本帧触发语音开始 / 结束
+  bool speech_start;
+  bool speech_end;
+
+  double energy_dbfs;
+  double noise_dbfs;
+  double centroid_hz;
+};
+
+// 单路流式语音检测，非线程安全
+class VoiceActivityDetector {
+ public:
+  explicit VoiceActivityDetector(const VadConfig& config);
+  ~VoiceActivityDetector();
+
+  // 判断一帧，立体声先下混为单声道
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_INVALID_PARAMETER：非 16 位 PCM、声道数不是 1 或 2，或采样率非法
+  int Process(const AudioFrame& frame, VadResult* result);
+  int Process(const int16_t* samples,
+              size_t frames,
+              int channels,
+              int sample_rate,
+              VadResult* result);
+
+  // 回到静音状态并重新估计噪声底
+  void Reset();
+
+  VadState state() const { return state_; }
+
+ private:
+  VoiceActivityDetector(const VoiceActivityDetector&);
+  VoiceActivityDetector& operator=(const VoiceActivityDetector&);
+
+  const VadConfig config_;
+
+  VadState state_;
+  // 噪声底，尚未初始化时为 NaN
+  double noise_dbfs_;
+  // 语音开始前连续有效帧 / 语音段中连续无效帧的时长，单位微秒
+  int64_t run_us_;
+
+  std::vector<int16_t> mono_;
+};
+
+// 语音段事件
+// |pts| 为触发帧的 AudioFrame::pts，|duration_ms| 为语音段时长（含 |start_ms|，
+// 不含前导与 |hangover_ms|）。
+class VadListener {
+ public:
+  virtual ~VadListener() {}
+  virtual void OnSpeechStart(const char* user_id, uint32_t pts) = 0;
+  virtual void OnSpeechEnd(const char* user_id, uint32_t pts, uint32_t duration_ms) = 0;
+};
+
+struct VadGateStats {
+  VadGateStats()
+      : frames(0),
+        forwarded_frames(0),
+        preroll_frames(0),
+        dropped_frames(0),
+        bypassed_frames(0),
+        segments(0),
+        speech_ms(0),
+        total_ms(0) {}
+
+  // 判断过的 PCM 帧数，其中转发（含前导）与丢弃的帧数
+  uint64_t frames;
+  uint64_t forwarded_frames;
+  uint64_t preroll_frames;
+  uint64_t dropped_frames;
+
+  // 不做判断直接转发的帧数（非 PCM 或格式不支持）
+  uint64_t bypassed_frames;
+
+  // 语音段个数，以及转发与判断的音频总时长
+  uint64_t segments;
+  uint64_t speech_ms;
+  uint64_t total_ms;
+};
+
+class VadGate : public liteav::trtc::TRTCCloudDelegate {
+ public:
+  // |target| 接收转发的回调，可以为 nullptr（只需要事件时）
+  VadGate(liteav::trtc::TRTCCloudDelegate* target, const VadConfig& config);
+  virtual ~VadGate();
+
+  // 设置事件回调，传 nullptr 取消
+  void SetListener(VadListener* listener);
+
+  // 判断一帧并按需转发给 |target| 的 OnRemoteAudioReceived()
+  void ProcessAudio(const char* user_id, const AudioFrame& frame);
+
+  // 用户当前状态，未出现过的用户返回 kVadSilence
+  VadState UserState(const char* user_id) const;
+
+  // 清除用户状态，OnRemoteUserExitRoom 时自动调用
+  // 用户处于语音段时先通知 VadListener::OnSpeechEnd()。
+  void RemoveUser(const char* user_id);
+
+  VadGateStats GetStats() const;
+
+  // TRTCCloudDelegate
+  void OnError(liteav::trtc::Error error) override;
+  void OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                liteav::trtc::ConnectionState new_state) override;
+  void OnEnterRoom() override;
+  void OnExitRoom() override;
+  void OnLocalAudioChannelCreated() override;
+  void OnLocalAudioChannelDestroyed() override;
+  void OnLocalVideoChannelCreated(StreamType type) override;
+  void OnLocalVideoChannelDestroyed(StreamType type) override;
+  void OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) override;
+  void OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteAudioAvailable(const char* user_id, bool available) override;
+  void OnRemoteVideoAvailable(const char* user_id, bool available, StreamType type) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const liteav::trtc::VideoFrame& frame) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const liteav::trtc::PixelFrame& frame) override;
+  void OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) override;
+  void OnRemoteMixedAudioReceived(const AudioFrame& frame) override;
+  void OnSeiMessageReceived(const char* user_id,
+                            StreamType stream_type,
+                            int message_type,
+                            const uint8_t* message,
+                            int length) override;
+
+ private:
+  struct User;
+
+  VadGate(const VadGate&);
+  VadGate& operator=(const VadGate&);
+
+  std::shared_ptr<User> FindOrCreate(const char* user_id);
+  // 调用方持有 |user| 的锁
+  void Forward(const char* user_id, const AudioFrame& frame, int64_t duration_us);
+  void FlushPreroll(const char* user_id, User* user);
+
+  liteav::trtc::TRTCCloudDelegate* const target_;
+  const VadConfig config_;
+  std::atomic<VadListener*> listener_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<User> > users_;
+
+  std::atomic<uint64_t> frames_;
+  std::atomic<uint64_t> forwarded_frames_;
+  std::atomic<uint64_t> preroll_frames_;
+  std::atomic<uint64_t> dropped_frames_;
+  std::atomic<uint64_t> bypassed_frames_;
+  std::atomic<uint64_t> segments_;
+  std::atomic<uint64_t> speech_us_;
+  std::atomic<uint64_t> total_us_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_VAD_GATE_H_
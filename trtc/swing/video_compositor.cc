@@ -0,0 +1,491 @@
+#include "video_compositor.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "watermark_renderer.h"
+
+namespace swing {
+
+namespace {
+
+int AlignEven(int value) {
+  return value & ~1;
+}
+
+size_t I420Size(int width, int height) {
+  return static_cast<size_t>(width) * height +
+         2 * static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+}
+
+CanvasRect Intersect(const CanvasRect& a, const CanvasRect& b) {
+  int x = std::max(a.x, b.x);
+  int y = std::max(a.y, b.y);
+  int right = std::min(a.x + a.width, b.x + b.width);
+  int bottom = std::min(a.y + a.height, b.y + b.height);
+  if (right <= x || bottom <= y) {
+    return CanvasRect();
+  }
+  return CanvasRect(x, y, right - x, bottom - y);
+}
+
+CanvasRect Union(const CanvasRect& a, const CanvasRect& b) {
+  int x = std::min(a.x, b.x);
+  int y = std::min(a.y, b.y);
+  int right = std::max(a.x + a.width, b.x + b.width);
+  int bottom = std::max(a.y + a.height, b.y + b.height);
+  return CanvasRect(x, y, right - x, bottom - y);
+}
+
+int64_t UnixMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int64_t Area(const CanvasRect& rect) {
+  return static_cast<int64_t>(rect.width) * rect.height;
+}
+
+// 把 [0, total) 均分为 |count| 段，返回第 |index| 段的起点（偶数）
+int SplitOffset(int total, int count, int index) {
+  return AlignEven(static_cast<int>(static_cast<int64_t>(total) * index / count));
+}
+
+}  // namespace
+
+void ComputeAutoLayout(liteav::trtc::LayoutMode mode,
+                       int canvas_width,
+                       int canvas_height,
+                       int count,
+                       std::vector<CanvasRect>* cells) {
+  cells->clear();
+  if (count <= 0 || mode == liteav::trtc::KManual) {
+    return;
+  }
+
+  int cols = 1;
+  int rows = 1;
+  switch (mode) {
+    case liteav::trtc::kSpeedDial:
+      cols = static_cast<int>(ceil(sqrt(static_cast<double>(count))));
+      rows = (count + cols - 1) / cols;
+      break;
+    case liteav::trtc::kLinearHorizontal:
+      cols = count;
+      break;
+    case liteav::trtc::kLinearVertical:
+      rows = count;
+      break;
+    default:
+      return;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    int col = i % cols;
+    int row = i / cols;
+    int x0 = SplitOffset(canvas_width, cols, col);
+    int x1 = col + 1 == cols ? canvas_width : SplitOffset(canvas_width, cols, col + 1);
+    int y0 = SplitOffset(canvas_height, rows, row);
+    int y1 = row + 1 == rows ? canvas_height : SplitOffset(canvas_height, rows, row + 1);
+    cells->push_back(CanvasRect(x0, y0, x1 - x0, y1 - y0));
+  }
+}
+
+void ComputeFillRects(liteav::trtc::FillMode mode,
+                      int src_width,
+                      int src_height,
+                      const CanvasRect& cell,
+                      CanvasRect* src,
+                      CanvasRect* dst) {
+  *src = CanvasRect(0, 0, src_width, src_height);
+  *dst = cell;
+  if (src_width <= 0 || src_height <= 0 || cell.Empty()) {
+    *dst = CanvasRect();
+    return;
+  }
+
+  // 比较 src_w / src_h 与 cell_w / cell_h
+  int64_t src_cross = static_cast<int64_t>(src_width) * cell.height;
+  int64_t cell_cross = static_cast<int64_t>(cell.width) * src_height;
+  if (src_cross == cell_cross) {
+    return;
+  }
+
+  if (mode == liteav::trtc::kFill) {
+    // 裁掉源画面多出的一边，居中
+    if (src_cross > cell_cross) {
+      int width = AlignEven(static_cast<int>(cell_cross / cell.height));
+      width = std::max(2, std::min(width, src_width));
+      src->x = AlignEven((src_width - width) / 2);
+      src->width = width;
+    } else {
+      int height = AlignEven(static_cast<int>(src_cross / cell.width));
+      height = std::max(2, std::min(height, src_height));
+      src->y = AlignEven((src_height - height) / 2);
+      src->height = height;
+    }
+    return;
+  }
+
+  // kFit：缩小目标区域，居中
+  if (src_cross > cell_cross) {
+    int height = AlignEven(static_cast<int>(
+        static_cast<int64_t>(cell.width) * src_height / src_width));
+    height = std::max(2, std::min(height, cell.height));
+    dst->y = cell.y + AlignEven((cell.height - height) / 2);
+    dst->height = height;
+  } else {
+    int width = AlignEven(static_cast<int>(src_cross / src_height));
+    width = std::max(2, std::min(width, cell.width));
+    dst->x = cell.x + AlignEven((cell.width - width) / 2);
+    dst->width = width;
+  }
+}
+
+struct VideoCompositor::Input {
+  Input(const char* user_id, StreamType type, uint64_t order)
+      : user_id(user_id), type(type), order(order), width(0), height(0), pts(0), updated(false) {}
+
+  const std::string user_id;
+  const StreamType type;
+  // 加入顺序，自动布局按此排列
+  const uint64_t order;
+  int width;
+  int height;
+  uint32_t pts;
+  // 上次 Compose() 之后有新画面
+  bool updated;
+  PooledBuffer data;
+  PlaneScaler scalers[3];
+};
+
+VideoCompositor::VideoCompositor(const MultiRecordParams& params)
+    : params_(params),
+      width_(AlignEven(static_cast<int>(std::max(16u, std::min(params.width, 4096u))))),
+      height_(AlignEven(static_cast<int>(std::max(16u, std::min(params.height, 4096u))))),
+      full_redraw_(true),
+      dirty_pixels_(0) {
+  RgbToYuv(params.background_color, &background_[0], &background_[1], &background_[2]);
+  canvas_.Resize(I420Size(width_, height_));
+  planes_[0] = canvas_.data();
+  planes_[1] = planes_[0] + static_cast<size_t>(width_) * height_;
+  planes_[2] = planes_[1] + static_cast<size_t>(width_ / 2) * (height_ / 2);
+  strides_[0] = width_;
+  strides_[1] = width_ / 2;
+  strides_[2] = width_ / 2;
+  FillRect(CanvasRect(0, 0, width_, height_), background_);
+}
+
+VideoCompositor::~VideoCompositor() {}
+
+bool VideoCompositor::Cell::operator==(const Cell& other) const {
+  return rect.x == other.rect.x && rect.y == other.rect.y && rect.width == other.rect.width &&
+         rect.height == other.rect.height && mode == other.mode && zorder == other.zorder &&
+         input == other.input && memcmp(color, other.color, sizeof(color)) == 0;
+}
+
+void VideoCompositor::UpdateLayout(const LayoutParams layouts[], size_t layouts_count) {
+  layouts_.assign(layouts, layouts + layouts_count);
+}
+
+int VideoCompositor::SetLayout(const LayoutParams& layout) {
+  const char* user_id = layout.user_id.GetValue();
+  if (user_id == nullptr || user_id[0] == '\0') {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  for (size_t i = 0; i < layouts_.size(); ++i) {
+    const char* existing = layouts_[i].user_id.GetValue();
+    if (layouts_[i].stream_type == layout.stream_type && existing != nullptr &&
+        strcmp(existing, user_id) == 0) {
+      layouts_[i] = layout;
+      return liteav::trtc::ERR_OK;
+    }
+  }
+  layouts_.push_back(layout);
+  return liteav::trtc::ERR_OK;
+}
+
+int VideoCompositor::RemoveLayout(const char* user_id, StreamType type) {
+  if (user_id == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  for (size_t i = 0; i < layouts_.size(); ++i) {
+    const char* existing = layouts_[i].user_id.GetValue();
+    if (layouts_[i].stream_type == type && existing != nullptr && strcmp(existing, user_id) == 0) {
+      layouts_.erase(layouts_.begin() + i);
+      return liteav::trtc::ERR_OK;
+    }
+  }
+  return liteav::trtc::ERR_INVALID_PARAMETER;
+}
+
+VideoCompositor::Input* VideoCompositor::Find(const char* user_id, StreamType type) const {
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    Input* input = inputs_[i].get();
+    if (input->type == type && input->user_id == user_id) {
+      return input;
+    }
+  }
+  return nullptr;
+}
+
+int VideoCompositor::SetInput(const char* user_id, StreamType type, const PixelFrame& frame) {
+  int width = static_cast<int>(frame.width);
+  int height = static_cast<int>(frame.height);
+  if (user_id == nullptr || width <= 0 || height <= 0 ||
+      frame.format != liteav::trtc::VIDEO_PIXEL_FORMAT_YUV420p ||
+      frame.size() < I420Size(width, height)) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Input* input = Find(user_id, type);
+  if (input == nullptr) {
+    uint64_t order = inputs_.empty() ? 0 : inputs_.back()->order + 1;
+    input = new Input(user_id, type, order);
+    inputs_.push_back(std::unique_ptr<Input>(input));
+  }
+  input->width = width;
+  input->height = height;
+  input->pts = frame.pts;
+  input->updated = true;
+  input->data.Assign(frame.data(), I420Size(width, height));
+  return liteav::trtc::ERR_OK;
+}
+
+void VideoCompositor::RemoveInput(const char* user_id, StreamType type) {
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    if (inputs_[i]->type == type && inputs_[i]->user_id == user_id) {
+      inputs_.erase(inputs_.begin() + i);
+      return;
+    }
+  }
+}
+
+void VideoCompositor::BuildCells() {
+  cells_.clear();
+
+  if (params_.layout_mode == liteav::trtc::KManual) {
+    for (size_t i = 0; i < layouts_.size(); ++i) {
+      const LayoutParams& layout = layouts_[i];
+      Cell cell;
+      int x = AlignEven(static_cast<int>(std::min<uint32_t>(layout.x, width_)));
+      int y = AlignEven(static_cast<int>(std::min<uint32_t>(layout.y, height_)));
+      int right = AlignEven(static_cast<int>(
+          std::min<uint64_t>(static_cast<uint64_t>(layout.x) + layout.width, width_)));
+      int bottom = AlignEven(static_cast<int>(
+          std::min<uint64_t>(static_cast<uint64_t>(layout.y) + layout.height, height_)));
+      cell.rect = CanvasRect(x, y, right - x, bottom - y);
+      if (cell.rect.Empty()) {
+        continue;
+      }
+      cell.mode = layout.mode;
+      RgbToYuv(layout.color, &cell.color[0], &cell.color[1], &cell.color[2]);
+      cell.zorder = layout.zorder;
+      cell.input = Find(layout.user_id.GetValue(), layout.stream_type);
+      cells_.push_back(cell);
+    }
+    // zorder 小的先画，相同 zorder 保持传入顺序
+    std::stable_sort(cells_.begin(), cells_.end(),
+                     [](const Cell& a, const Cell& b) { return a.zorder < b.zorder; });
+    return;
+  }
+
+  int count = static_cast<int>(params_.max_layout_count);
+  if (count == 0) {
+    count = static_cast<int>(inputs_.size());
+  }
+  ComputeAutoLayout(params_.layout_mode, width_, height_, count, &auto_cells_);
+  for (size_t i = 0; i < auto_cells_.size() && i < inputs_.size(); ++i) {
+    Cell cell;
+    cell.rect = auto_cells_[i];
+    cell.mode = liteav::trtc::kFit;
+    memcpy(cell.color, background_, sizeof(cell.color));
+    cell.zorder = 1;
+    cell.input = inputs_[i].get();
+    cells_.push_back(cell);
+  }
+}
+
+void VideoCompositor::FillRect(const CanvasRect& rect, const uint8_t color[3]) {
+  FillPlane(planes_[0] + static_cast<ptrdiff_t>(rect.y) * strides_[0] + rect.x, strides_[0],
+            rect.width, rect.height, color[0]);
+  for (int p = 1; p < 3; ++p) {
+    FillPlane(planes_[p] + static_cast<ptrdiff_t>(rect.y / 2) * strides_[p] + rect.x / 2,
+              strides_[p], rect.width / 2, rect.height / 2, color[p]);
+  }
+}
+
+void VideoCompositor::DrawCell(const Cell& cell, const CanvasRect& clip) {
+  const CanvasRect area = Intersect(cell.rect, clip);
+  if (area.Empty()) {
+    return;
+  }
+  if (params_.layout_mode == liteav::trtc::KManual ||
+      memcmp(cell.color, background_, sizeof(background_)) != 0) {
+    FillRect(area, cell.color);
+  }
+  Input* input = cell.input;
+  if (input == nullptr || input->data.empty()) {
+    return;
+  }
+
+  CanvasRect src;
+  CanvasRect dst;
+  ComputeFillRects(cell.mode, input->width, input->height, cell.rect, &src, &dst);
+  // 坐标均为偶数，色度平面按一半裁剪
+  const CanvasRect visible = Intersect(dst, clip);
+  if (visible.Empty()) {
+    return;
+  }
+  const int clip_x = visible.x - dst.x;
+  const int clip_y = visible.y - dst.y;
+
+  const uint8_t* y_plane = input->data.data();
+  const int src_chroma_stride = (input->width + 1) / 2;
+  const uint8_t* u_plane = y_plane + static_cast<size_t>(input->width) * input->height;
+  const uint8_t* v_plane =
+      u_plane + static_cast<size_t>(src_chroma_stride) * ((input->height + 1) / 2);
+
+  input->scalers[0].ScaleClipped(
+      y_plane + static_cast<ptrdiff_t>(src.y) * input->width + src.x, input->width, src.width,
+      src.height, planes_[0] + static_cast<ptrdiff_t>(dst.y) * strides_[0] + dst.x, strides_[0],
+      dst.width, dst.height, clip_x, clip_y, visible.width, visible.height);
+
+  const uint8_t* chroma[2] = {u_plane, v_plane};
+  for (int p = 1; p < 3; ++p) {
+    input->scalers[p].ScaleClipped(
+        chroma[p - 1] + static_cast<ptrdiff_t>(src.y / 2) * src_chroma_stride + src.x / 2,
+        src_chroma_stride, (src.width + 1) / 2, (src.height + 1) / 2,
+        planes_[p] + static_cast<ptrdiff_t>(dst.y / 2) * strides_[p] + dst.x / 2, strides_[p],
+        dst.width / 2, dst.height / 2, clip_x / 2, clip_y / 2, visible.width / 2,
+        visible.height / 2);
+  }
+}
+
+void VideoCompositor::AddDirty(const CanvasRect& rect) {
+  if (rect.Empty()) {
+    return;
+  }
+  // 与已有区域重叠时合并为外接矩形，保证各区域互不重叠，每个像素只画一次
+  CanvasRect merged = rect;
+  for (size_t i = 0; i < dirty_.size();) {
+    if (Intersect(merged, dirty_[i]).Empty()) {
+      ++i;
+      continue;
+    }
+    merged = Union(merged, dirty_[i]);
+    dirty_.erase(dirty_.begin() + i);
+    i = 0;
+  }
+  dirty_.push_back(merged);
+}
+
+void VideoCompositor::CollectDirty() {
+  dirty_.clear();
+  const CanvasRect canvas(0, 0, width_, height_);
+  if (full_redraw_) {
+    dirty_.push_back(canvas);
+    return;
+  }
+
+  // 按内容匹配上一帧的格子：没有对应的格子（新增、移动、改变层级等）画新旧两处，
+  // 绘制先后顺序变化或有新画面的格子画当前位置
+  std::vector<bool> matched(previous_cells_.size(), false);
+  size_t last_match = 0;
+  for (size_t i = 0; i < cells_.size(); ++i) {
+    const Cell& cell = cells_[i];
+    size_t j = 0;
+    while (j < previous_cells_.size() && (matched[j] || !(previous_cells_[j] == cell))) {
+      ++j;
+    }
+    if (j == previous_cells_.size()) {
+      AddDirty(cell.rect);
+      continue;
+    }
+    matched[j] = true;
+    if (j < last_match || (cell.input != nullptr && cell.input->updated)) {
+      AddDirty(cell.rect);
+    }
+    last_match = std::max(last_match, j);
+  }
+  for (size_t j = 0; j < previous_cells_.size(); ++j) {
+    if (!matched[j]) {
+      AddDirty(previous_cells_[j].rect);
+    }
+  }
+  for (size_t i = 0; i < watermark_changed_.size(); ++i) {
+    AddDirty(watermark_changed_[i]);
+  }
+
+  int64_t area = 0;
+  for (size_t i = 0; i < dirty_.size(); ++i) {
+    area += Area(dirty_[i]);
+  }
+  // 大部分画布都要重画时直接整幅重画
+  if (area * 4 >= Area(canvas) * 3) {
+    dirty_.assign(1, canvas);
+  }
+}
+
+void VideoCompositor::Compose() {
+  BuildCells();
+  watermark_changed_.clear();
+  if (watermarks_) {
+    watermarks_->Prepare(UnixMs(), &watermark_changed_);
+  }
+  CollectDirty();
+  dirty_pixels_ = 0;
+  for (size_t d = 0; d < dirty_.size(); ++d) {
+    const CanvasRect& clip = dirty_[d];
+    FillRect(clip, background_);
+    for (size_t i = 0; i < cells_.size(); ++i) {
+      DrawCell(cells_[i], clip);
+    }
+    if (watermarks_) {
+      watermarks_->Blend(planes_, strides_, width_, height_, clip);
+    }
+    dirty_pixels_ += Area(clip);
+  }
+
+  previous_cells_ = cells_;
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    inputs_[i]->updated = false;
+  }
+  full_redraw_ = false;
+}
+
+int VideoCompositor::UpdateWatermark(const liteav::trtc::WatermarkConfig watermarks[],
+                                     size_t watermark_count) {
+  if (!watermarks_) {
+    watermarks_.reset(new WatermarkRenderer());
+  }
+  Invalidate();
+  return watermarks_->UpdateWatermark(watermarks, watermark_count);
+}
+
+void VideoCompositor::Invalidate() {
+  full_redraw_ = true;
+}
+
+int VideoCompositor::Compose(uint32_t pts, PixelFrame* output) {
+  if (output == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Compose();
+  output->SetData(canvas_.data(), canvas_.size());
+  output->width = static_cast<uint32_t>(width_);
+  output->height = static_cast<uint32_t>(height_);
+  output->format = liteav::trtc::VIDEO_PIXEL_FORMAT_YUV420p;
+  output->rotation = liteav::trtc::VIDEO_ROTATION_0;
+  output->pts = pts;
+  return liteav::trtc::ERR_OK;
+}
+
+ByteSpan VideoCompositor::Canvas() const {
+  return canvas_.Bytes();
+}
+
+}  // namespace swing
@@ -0,0 +1,179 @@
+//
+// 功能说明：
+//   本地多路 YUV420p 合流。
+//   按 liteav_trtc_recorder.h 中 MultiRecordParams / LayoutMode / FillMode /
+//   LayoutParams 的语义把多路 PixelFrame 合成到一张画布上，
+//   不依赖 SDK 内部的 Recorder，便于自行合流输出和做性能评估。
+//
+//   - kSpeedDial：宫格数 N 取列数 ceil(sqrt(N))，按行从左到右排布；
+//   - kLinearHorizontal / kLinearVertical：均分 N 格，从左往右 / 从上往下；
+//   - |max_layout_count| 为 0 时 N 取当前有画面的用户数；
+//   - KManual：按 UpdateLayout() 传入的 LayoutParams 布局，|zorder| 小的先画，
+//     可能被大的遮挡；
+//   - kFill 居中裁剪铺满，kFit 完整显示，空白处填背景色。自动布局时格子使用
+//     kFit，背景色取画布背景色；手动布局取 LayoutParams::color。
+//
+//   局部重绘：画布在两次 Compose() 之间保留，只重绘变化的区域——
+//   位置、层级、填充方式或输入发生变化的格子的新旧位置，以及有新画面的格子，
+//   其余格子和背景沿用上一帧。布局基本不变时每帧的开销只与变化区域的面积有关。
+//   手动布局可用 SetLayout() / RemoveLayout() 增量修改单个格子，
+//   UpdateLayout() 全量替换时同样只重绘前后不同的格子。
+//
+//   UpdateWatermark() 设置的水印（见 watermark_renderer.h）叠加在全部格子之上，
+//   随重绘区域一起混合；时间戳水印在显示的秒数变化时把自身区域计入重绘。
+//
+//   不做旋转处理，PixelFrame::rotation 需为 VIDEO_ROTATION_0。
+//   非线程安全，SetInput() 与 Compose() 需在同一线程调用，
+//   通常在 FrameDispatcher::Drain() 的消费线程中驱动。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_VIDEO_COMPOSITOR_H_
+#define GCHATGPT_TRTC_SWING_VIDEO_COMPOSITOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_recorder.h"
+#include "frame_pool.h"
+#include "frame_view.h"
+#include "yuv_kernels.h"
+
+namespace swing {
+
+using liteav::trtc::LayoutParams;
+using liteav::trtc::MultiRecordParams;
+using liteav::trtc::StreamType;
+
+class WatermarkRenderer;
+
+// 画布上的矩形，单位像素，坐标和尺寸均为偶数
+struct CanvasRect {
+  CanvasRect() : x(0), y(0), width(0), height(0) {}
+  CanvasRect(int x, int y, int width, int height) : x(x), y(y), width(width), height(height) {}
+
+  bool Empty() const { return width <= 0 || height <= 0; }
+
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+// 按自动布局模式计算 |count| 个格子的位置，|mode| 为 KManual 时不输出
+void ComputeAutoLayout(liteav::trtc::LayoutMode mode,
+                       int canvas_width,
+                       int canvas_height,
+                       int count,
+                       std::vector<CanvasRect>* cells);
+
+// 格子内画面的位置
+// |src| 为源画面参与缩放的区域，|dst| 为画布上的目标区域。
+void ComputeFillRects(liteav::trtc::FillMode mode,
+                      int src_width,
+                      int src_height,
+                      const CanvasRect& cell,
+                      CanvasRect* src,
+                      CanvasRect* dst);
+
+class VideoCompositor {
+ public:
+  explicit VideoCompositor(const MultiRecordParams& params);
+  ~VideoCompositor();
+
+  // 手动布局，全量替换，仅 |layout_mode| 为 KManual 时生效
+  void UpdateLayout(const LayoutParams layouts[], size_t layouts_count);
+
+  // 手动布局的增量修改：按 (user_id, stream_type) 新增一格，已存在时修改其位置、
+  // 尺寸、层级、填充方式与背景色，在相同层级中的绘制顺序不变
+  // |layout.user_id| 为空时返回 ERR_INVALID_PARAMETER。
+  int SetLayout(const LayoutParams& layout);
+
+  // 删除手动布局中的一格，不存在时返回 ERR_INVALID_PARAMETER
+  int RemoveLayout(const char* user_id, StreamType type);
+
+  // 更新某路的最新画面，复制数据
+  // 返回 ERR_INVALID_PARAMETER 表示画面格式或尺寸不合法。
+  int SetInput(const char* user_id, StreamType type, const PixelFrame& frame);
+
+  // 移除某路，自动布局时其余画面重新排布
+  void RemoveInput(const char* user_id, StreamType type);
+
+  // 合成一帧，结果保留在内部画布中
+  void Compose();
+
+  // 合成一帧并写入 |output|，|pts| 为输出帧时间戳
+  int Compose(uint32_t pts, PixelFrame* output);
+
+  // 内部画布数据（YUV420p），下次 Compose() 前有效
+  ByteSpan Canvas() const;
+
+  // 全量替换水印，|watermark_count| 为 0 时清除，返回值同 WatermarkRenderer::UpdateWatermark()
+  int UpdateWatermark(const liteav::trtc::WatermarkConfig watermarks[], size_t watermark_count);
+
+  // 下次 Compose() 全量重绘
+  void Invalidate();
+
+  // 最近一次 Compose() 重绘的像素数（亮度平面）
+  int64_t DirtyPixels() const { return dirty_pixels_; }
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+
+ private:
+  struct Input;
+
+  // 一次合成中需要绘制的格子
+  struct Cell {
+    CanvasRect rect;
+    liteav::trtc::FillMode mode;
+    uint8_t color[3];
+    uint32_t zorder;
+    Input* input;
+
+    bool operator==(const Cell& other) const;
+  };
+
+  VideoCompositor(const VideoCompositor&);
+  VideoCompositor& operator=(const VideoCompositor&);
+
+  Input* Find(const char* user_id, StreamType type) const;
+  void BuildCells();
+  // 对比上一帧的格子，得到需要重绘的区域
+  void CollectDirty();
+  void AddDirty(const CanvasRect& rect);
+  // 只绘制 |cell| 落在 |clip| 内的部分
+  void DrawCell(const Cell& cell, const CanvasRect& clip);
+  void FillRect(const CanvasRect& rect, const uint8_t color[3]);
+
+  const MultiRecordParams params_;
+  const int width_;
+  const int height_;
+  uint8_t background_[3];
+
+  PooledBuffer canvas_;
+  uint8_t* planes_[3];
+  int strides_[3];
+
+  std::vector<std::unique_ptr<Input> > inputs_;
+  std::vector<LayoutParams> layouts_;
+  std::vector<Cell> cells_;
+  std::vector<CanvasRect> auto_cells_;
+
+  // 上一帧绘制的格子与本帧的重绘区域
+  std::vector<Cell> previous_cells_;
+  std::vector<CanvasRect> dirty_;
+  bool full_redraw_;
+  int64_t dirty_pixels_;
+
+  // 首次 UpdateWatermark() 时创建，以及本帧内容变化的水印区域
+  std::unique_ptr<WatermarkRenderer> watermarks_;
+  std::vector<CanvasRect> watermark_changed_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_VIDEO_COMPOSITOR_H_
@@ -0,0 +1,313 @@
+#include "video_jitter_buffer.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace swing {
+
+namespace {
+
+const int64_t kNoTransit = std::numeric_limits<int64_t>::max();
+
+// 传输偏移的滑动最小值按两段窗口维护，取值覆盖最近 2~4 秒
+const int64_t kTransitWindowMs = 2000;
+
+// 目标延迟回落速度，约 64 帧回落到新值的 63%
+const double kDelayDecay = 1.0 / 64;
+
+// 放出延迟的指数平均系数
+const double kAverageWeight = 1.0 / 32;
+
+int64_t MonotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+}  // namespace
+
+VideoJitterBuffer::VideoJitterBuffer(const VideoJitterBufferConfig& config)
+    : config_(config),
+      bytes_(0),
+      dts_seen_(false),
+      last_raw_dts_(0),
+      last_dts_(0),
+      popped_any_(false),
+      last_popped_dts_(0),
+      need_keyframe_(true),
+      release_through_dts_(std::numeric_limits<int64_t>::min()),
+      has_previous_(false),
+      previous_dts_(0),
+      previous_arrival_ms_(0),
+      jitter_ms_(0),
+      target_delay_ms_(config.min_delay_ms),
+      window_start_ms_(0),
+      window_min_(kNoTransit),
+      previous_window_min_(kNoTransit),
+      average_delay_ms_(0) {}
+
+VideoJitterBuffer::~VideoJitterBuffer() {}
+
+int VideoJitterBuffer::Insert(const VideoFrame& frame, int64_t now_ms) {
+  if (frame.data() == nullptr || frame.size() == 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Entry entry;
+  entry.frame.kind = kFrameKindVideo;
+  entry.frame.pts = frame.pts;
+  entry.frame.dts = frame.dts;
+  entry.frame.is_key_frame = frame.is_key_frame;
+  entry.frame.codec = frame.codec;
+  entry.frame.rotation = frame.rotation;
+  entry.frame.payload.Assign(frame.data(), frame.size());
+  std::lock_guard<std::mutex> lock(mutex_);
+  return InsertLocked(&entry, now_ms);
+}
+
+int VideoJitterBuffer::Insert(RingFrame* frame, int64_t now_ms) {
+  if (frame == nullptr || frame->kind != kFrameKindVideo || frame->payload.empty()) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  Entry entry;
+  entry.frame.kind = kFrameKindVideo;
+  entry.frame.pts = frame->pts;
+  entry.frame.dts = frame->dts;
+  entry.frame.is_key_frame = frame->is_key_frame;
+  entry.frame.codec = frame->codec;
+  entry.frame.width = frame->width;
+  entry.frame.height = frame->height;
+  entry.frame.rotation = frame->rotation;
+  std::swap(entry.frame.payload, frame->payload);
+  std::lock_guard<std::mutex> lock(mutex_);
+  return InsertLocked(&entry, now_ms);
+}
+
+int VideoJitterBuffer::InsertLocked(Entry* entry, int64_t now_ms) {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  ++stats_.inserted;
+
+  // 乱序帧与上一帧的差值在 int32 范围内，按差值展开即可跨越回绕
+  const uint32_t raw = entry->frame.dts;
+  if (!dts_seen_) {
+    dts_seen_ = true;
+    last_dts_ = raw;
+  } else {
+    last_dts_ += static_cast<int32_t>(raw - last_raw_dts_);
+  }
+  last_raw_dts_ = raw;
+  entry->dts = last_dts_;
+  entry->arrival_ms = now_ms;
+
+  if (popped_any_ && entry->dts <= last_popped_dts_) {
+    ++stats_.dropped_late;
+    return liteav::trtc::ERR_OK;
+  }
+
+  // 多数帧按序到达，从尾部向前找插入位置
+  std::deque<Entry>::iterator pos = frames_.end();
+  while (pos != frames_.begin() && (pos - 1)->dts >= entry->dts) {
+    --pos;
+  }
+  if (pos != frames_.end() && pos->dts == entry->dts) {
+    ++stats_.dropped_duplicate;
+    return liteav::trtc::ERR_OK;
+  }
+
+  UpdateDelay(entry->dts, now_ms);
+  const bool keyframe = entry->frame.is_key_frame;
+  const int64_t dts = entry->dts;
+  bytes_ += entry->frame.payload.size();
+  frames_.insert(pos, std::move(*entry));
+  if (keyframe) {
+    keyframes_.insert(dts);
+  }
+
+  while (frames_.size() > config_.max_frames || bytes_ > config_.max_bytes) {
+    DropOldestGop();
+  }
+  return liteav::trtc::ERR_OK;
+}
+
+void VideoJitterBuffer::UpdateDelay(int64_t dts, int64_t now_ms) {
+  // 只用按序到达的帧估计抖动，乱序帧的到达间隔没有意义
+  if (has_previous_ && dts > previous_dts_) {
+    const int64_t d = (now_ms - previous_arrival_ms_) - (dts - previous_dts_);
+    jitter_ms_ += (static_cast<double>(llabs(d)) - jitter_ms_) / 16;
+  }
+  if (!has_previous_ || dts > previous_dts_) {
+    has_previous_ = true;
+    previous_dts_ = dts;
+    previous_arrival_ms_ = now_ms;
+  }
+
+  const double desired = std::min<double>(
+      config_.max_delay_ms,
+      std::max<double>(config_.min_delay_ms, jitter_ms_ * config_.jitter_multiplier));
+  if (desired > target_delay_ms_) {
+    target_delay_ms_ = desired;
+  } else {
+    target_delay_ms_ += (desired - target_delay_ms_) * kDelayDecay;
+  }
+
+  if (window_min_ == kNoTransit || now_ms - window_start_ms_ >= kTransitWindowMs) {
+    previous_window_min_ = window_min_;
+    window_min_ = kNoTransit;
+    window_start_ms_ = now_ms;
+  }
+  window_min_ = std::min(window_min_, now_ms - dts);
+}
+
+int64_t VideoJitterBuffer::ReleaseMs(const Entry& entry) const {
+  if (entry.dts <= release_through_dts_) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  const int64_t transit = std::min(window_min_, previous_window_min_);
+  const int64_t scheduled =
+      entry.dts + transit + static_cast<int64_t>(target_delay_ms_ + 0.5);
+  // 停留时间不超过 |max_delay_ms|
+  return std::min(scheduled, entry.arrival_ms + config_.max_delay_ms);
+}
+
+int VideoJitterBuffer::Pop(RingFrame* out, int64_t now_ms) {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!frames_.empty()) {
+    Entry& head = frames_.front();
+    if (need_keyframe_ && !head.frame.is_key_frame) {
+      ++stats_.dropped_undecodable;
+      popped_any_ = true;
+      last_popped_dts_ = head.dts;
+      PopFront();
+      continue;
+    }
+    if (now_ms < ReleaseMs(head)) {
+      return liteav::trtc::ERR_READ_TRY_AGAIN;
+    }
+
+    const int delay = static_cast<int>(std::max<int64_t>(now_ms - head.arrival_ms, 0));
+    stats_.last_delay_ms = delay;
+    average_delay_ms_ = stats_.popped == 0
+                            ? delay
+                            : average_delay_ms_ + (delay - average_delay_ms_) * kAverageWeight;
+    ++stats_.popped;
+
+    out->kind = head.frame.kind;
+    out->pts = head.frame.pts;
+    out->dts = head.frame.dts;
+    out->is_key_frame = head.frame.is_key_frame;
+    out->codec = head.frame.codec;
+    out->width = head.frame.width;
+    out->height = head.frame.height;
+    out->rotation = head.frame.rotation;
+    std::swap(out->payload, head.frame.payload);
+
+    need_keyframe_ = false;
+    popped_any_ = true;
+    last_popped_dts_ = head.dts;
+    PopFront();
+    return liteav::trtc::ERR_OK;
+  }
+  return liteav::trtc::ERR_READ_TRY_AGAIN;
+}
+
+int VideoJitterBuffer::TimeUntilNextMs(int64_t now_ms) {
+  if (now_ms < 0) {
+    now_ms = MonotonicMs();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (frames_.empty()) {
+    return -1;
+  }
+  // 等待关键帧时之前的帧会在 Pop() 中直接丢弃
+  std::deque<Entry>::const_iterator head = frames_.begin();
+  if (need_keyframe_) {
+    while (head != frames_.end() && !head->frame.is_key_frame) {
+      ++head;
+    }
+    if (head == frames_.end()) {
+      return 0;
+    }
+  }
+  const int64_t wait = ReleaseMs(*head) - now_ms;
+  return wait <= 0 ? 0 : static_cast<int>(std::min<int64_t>(wait, config_.max_delay_ms));
+}
+
+size_t VideoJitterBuffer::SkipToLatestKeyframe() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (keyframes_.empty()) {
+    return 0;
+  }
+  const int64_t latest = *keyframes_.rbegin();
+  size_t skipped = 0;
+  while (frames_.front().dts < latest) {
+    PopFront();
+    ++skipped;
+  }
+  stats_.skipped += skipped;
+  release_through_dts_ = latest;
+  if (skipped > 0) {
+    popped_any_ = true;
+    last_popped_dts_ = std::max(last_popped_dts_, latest - 1);
+  }
+  return skipped;
+}
+
+size_t VideoJitterBuffer::KeyframeCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return keyframes_.size();
+}
+
+void VideoJitterBuffer::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  frames_.clear();
+  keyframes_.clear();
+  bytes_ = 0;
+  need_keyframe_ = true;
+}
+
+VideoJitterBufferStats VideoJitterBuffer::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  VideoJitterBufferStats stats = stats_;
+  stats.frames = frames_.size();
+  stats.bytes = bytes_;
+  stats.keyframes = keyframes_.size();
+  stats.buffered_ms =
+      frames_.empty() ? 0 : static_cast<int>(frames_.back().dts - frames_.front().dts);
+  stats.jitter_ms = static_cast<int>(jitter_ms_ + 0.5);
+  stats.target_delay_ms = static_cast<int>(target_delay_ms_ + 0.5);
+  stats.average_delay_ms = static_cast<int>(average_delay_ms_ + 0.5);
+  return stats;
+}
+
+void VideoJitterBuffer::PopFront() {
+  const Entry& head = frames_.front();
+  if (head.frame.is_key_frame) {
+    keyframes_.erase(head.dts);
+  }
+  bytes_ -= head.frame.payload.size();
+  frames_.pop_front();
+}
+
+void VideoJitterBuffer::DropOldestGop() {
+  // 丢到下一个关键帧为止，缓冲中没有后续关键帧时只丢最早一帧并等待关键帧
+  std::set<int64_t>::const_iterator next = keyframes_.upper_bound(frames_.front().dts);
+  do {
+    popped_any_ = true;
+    last_popped_dts_ = std::max(last_popped_dts_, frames_.front().dts);
+    PopFront();
+    ++stats_.dropped_overflow;
+  } while (next != keyframes_.end() && frames_.front().dts < *next);
+  if (next == keyframes_.end()) {
+    need_keyframe_ = true;
+  }
+}
+
+}  // namespace swing
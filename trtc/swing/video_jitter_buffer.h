@@ -0,0 +1,199 @@
+//
+// 功能说明：
+//   编码视频帧的抖动缓冲。
+//   单路流的 VideoFrame 按 dts 排序缓存，每帧在 "dts + 传输偏移 + 目标延迟" 时刻
+//   放出：传输偏移取最近约 4 秒内 (到达时间 - dts) 的最小值，目标延迟按 RFC 3550
+//   的到达抖动估计乘以 |jitter_multiplier|，并限制在 [min_delay_ms, max_delay_ms]。
+//   抖动变大时目标延迟立即跟上，变小时缓慢回落。
+//
+//   缓冲维护关键帧索引：
+//   - 超出帧数 / 字节上限时整组丢弃最早的 GOP，剩余数据仍从关键帧开始
+//   - SkipToLatestKeyframe() 丢弃最新关键帧之前的帧并立即放出该关键帧，
+//     消费者落后太多或刚开始解码时可直接跳到最新的可解码位置
+//   - 因丢帧导致解码链断开后，到下一个关键帧之前的帧在 Pop() 时丢弃
+//   晚于已放出帧到达的帧、dts 重复的帧直接丢弃。
+//
+//   时间参数 |now_ms| 为 CLOCK_MONOTONIC 毫秒，传负值时取当前时间。
+//   线程安全：Insert() 与 Pop() 可在不同线程调用。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_VIDEO_JITTER_BUFFER_H_
+#define GCHATGPT_TRTC_SWING_VIDEO_JITTER_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <mutex>
+#include <set>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "frame_dispatcher.h"
+
+namespace swing {
+
+using liteav::trtc::VideoFrame;
+
+struct VideoJitterBufferConfig {
+  VideoJitterBufferConfig()
+      : min_delay_ms(0),
+        max_delay_ms(400),
+        jitter_multiplier(3),
+        max_frames(300),
+        max_bytes(16 << 20) {}
+
+  // 目标延迟范围，帧在缓冲中停留的时间不会超过 |max_delay_ms|
+  int min_delay_ms;
+  int max_delay_ms;
+
+  // 目标延迟 = 抖动估计 * |jitter_multiplier|
+  int jitter_multiplier;
+
+  // 缓存上限
+  size_t max_frames;
+  size_t max_bytes;
+};
+
+struct VideoJitterBufferStats {
+  VideoJitterBufferStats()
+      : frames(0),
+        bytes(0),
+        keyframes(0),
+        buffered_ms(0),
+        jitter_ms(0),
+        target_delay_ms(0),
+        last_delay_ms(0),
+        average_delay_ms(0),
+        inserted(0),
+        popped(0),
+        dropped_late(0),
+        dropped_duplicate(0),
+        dropped_overflow(0),
+        dropped_undecodable(0),
+        skipped(0) {}
+
+  // 当前缓存
+  size_t frames;
+  size_t bytes;
+  size_t keyframes;
+  // 缓存帧的 dts 跨度
+  int buffered_ms;
+
+  // 到达抖动估计与当前目标延迟
+  int jitter_ms;
+  int target_delay_ms;
+
+  // 缓冲引入的延迟：最近一帧与指数平均（从 Insert() 到 Pop() 的时间）
+  int last_delay_ms;
+  int average_delay_ms;
+
+  uint64_t inserted;
+  uint64_t popped;
+  uint64_t dropped_late;
+  uint64_t dropped_duplicate;
+  uint64_t dropped_overflow;
+  uint64_t dropped_undecodable;
+  // SkipToLatestKeyframe() 丢弃的帧数
+  uint64_t skipped;
+};
+
+class VideoJitterBuffer {
+ public:
+  explicit VideoJitterBuffer(const VideoJitterBufferConfig& config);
+  ~VideoJitterBuffer();
+
+  // 缓存一帧，复制 |frame| 的数据
+  // 返回值：
+  // - ERR_OK：已缓存，或因过期 / 重复按预期丢弃（计入统计）
+  // - ERR_INVALID_PARAMETER：帧数据为空
+  int Insert(const VideoFrame& frame, int64_t now_ms = -1);
+
+  // 缓存 FrameDispatcher 队列中的一帧，取走 |frame| 的数据而不复制
+  // 除上述返回值外，|frame| 不是编码视频帧时返回 ERR_INVALID_PARAMETER。
+  int Insert(RingFrame* frame, int64_t now_ms = -1);
+
+  // 取出最早一帧到 |out|，|out| 原有的数据块与缓冲交换复用
+  // 返回值：
+  // - ERR_OK：成功
+  // - ERR_READ_TRY_AGAIN：缓冲为空或最早一帧未到放出时间
+  int Pop(RingFrame* out, int64_t now_ms = -1);
+
+  // 距最早一帧可以放出的毫秒数，已可放出返回 0，缓冲为空返回 -1
+  int TimeUntilNextMs(int64_t now_ms = -1);
+
+  // 丢弃最新关键帧之前的所有帧，该关键帧下次 Pop() 时立即放出
+  // 返回丢弃的帧数，缓冲中没有关键帧时不做处理并返回 0。
+  size_t SkipToLatestKeyframe();
+
+  // 缓冲中的关键帧数
+  size_t KeyframeCount() const;
+
+  // 清空缓冲，抖动估计保留
+  void Clear();
+
+  VideoJitterBufferStats GetStats() const;
+
+ private:
+  struct Entry {
+    Entry() : dts(0), arrival_ms(0) {}
+
+    // 展开为 int64 的 dts
+    int64_t dts;
+    int64_t arrival_ms;
+    RingFrame frame;
+  };
+
+  VideoJitterBuffer(const VideoJitterBuffer&);
+  VideoJitterBuffer& operator=(const VideoJitterBuffer&);
+
+  int InsertLocked(Entry* entry, int64_t now_ms);
+  void UpdateDelay(int64_t dts, int64_t now_ms);
+  int64_t ReleaseMs(const Entry& entry) const;
+  void PopFront();
+  void DropOldestGop();
+
+  const VideoJitterBufferConfig config_;
+
+  mutable std::mutex mutex_;
+
+  // 按 dts 升序
+  std::deque<Entry> frames_;
+  size_t bytes_;
+
+  // 缓冲中关键帧的 dts
+  std::set<int64_t> keyframes_;
+
+  // dts 回绕展开
+  bool dts_seen_;
+  uint32_t last_raw_dts_;
+  int64_t last_dts_;
+
+  // 已放出的最大 dts，之后到达的更早的帧丢弃
+  bool popped_any_;
+  int64_t last_popped_dts_;
+
+  // 解码链断开，等待关键帧
+  bool need_keyframe_;
+
+  // 不早于该 dts 的帧立即放出（SkipToLatestKeyframe）
+  int64_t release_through_dts_;
+
+  // 抖动估计，RFC 3550：J += (|D| - J) / 16
+  bool has_previous_;
+  int64_t previous_dts_;
+  int64_t previous_arrival_ms_;
+  double jitter_ms_;
+  double target_delay_ms_;
+
+  // 传输偏移的两段滑动最小值
+  int64_t window_start_ms_;
+  int64_t window_min_;
+  int64_t previous_window_min_;
+
+  VideoJitterBufferStats stats_;
+  double average_delay_ms_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_VIDEO_JITTER_BUFFER_H_
@@ -0,0 +1,146 @@
+package swing
+
+// 语音对话的音频入口，接口说明见 voice_source.h
+
+// #include <stdlib.h>
+// #include "voice_source.h"
+import "C"
+
+import (
+	"errors"
+	"sync"
+	"time"
+	"unsafe"
+)
+
+type VoiceEventType int
+
+const (
+	VoiceAudio       VoiceEventType = C.kSwingVoiceAudio
+	VoiceSpeechStart VoiceEventType = C.kSwingVoiceSpeechStart
+	VoiceSpeechEnd   VoiceEventType = C.kSwingVoiceSpeechEnd
+	VoiceUserExit    VoiceEventType = C.kSwingVoiceUserExit
+)
+
+// 语音事件，Samples 为单声道 PCM，仅 VoiceAudio 有效
+type VoiceEvent struct {
+	Type       VoiceEventType
+	UserID     string
+	Samples    []int16
+	SampleRate int
+	Pts        uint32
+	DurationMs uint32
+	// 时延追踪的 key，未追踪时为 0，见 trace.go
+	TraceKey uint64
+}
+
+type VoiceSourceConfig struct {
+	// 以下参数为 0 时取 voice_source.h 中的默认值，PrerollMs 为负时取默认值
+	SampleRate      int
+	HangoverMs      int
+	PrerollMs       int
+	MaxQueuedFrames int
+}
+
+type VoiceSourceStats struct {
+	AudioFrames    uint64
+	DroppedFrames  uint64
+	SpeechSegments uint64
+	TotalMs        uint64
+	SpeechMs       uint64
+}
+
+var ErrVoiceSourceClosed = errors.New("swing: voice source closed")
+
+const voiceReadBatch = 32
+
+type VoiceSource struct {
+	closeOnce sync.Once
+	// mu 保护 handle 的生命周期，readMu 串行化 Read() 对 events 的使用
+	mu     sync.RWMutex
+	readMu sync.Mutex
+	handle unsafe.Pointer
+	events *[voiceReadBatch]C.SwingVoiceEvent
+}
+
+func NewVoiceSource(config VoiceSourceConfig) *VoiceSource {
+	handle := C.SwingVoiceSourceCreate(C.int(config.SampleRate), C.int(config.HangoverMs),
+		C.int(config.PrerollMs), C.size_t(config.MaxQueuedFrames))
+	events := (*[voiceReadBatch]C.SwingVoiceEvent)(C.malloc(C.size_t(unsafe.Sizeof(C.SwingVoiceEvent{})) * voiceReadBatch))
+	return &VoiceSource{handle: handle, events: events}
+}
+
+// 以录制模式进房，roomID 为字符串房间号，返回值同 TRTCCloud::EnterRoom()
+func (s *VoiceSource) EnterRoom(sdkAppID uint32, roomID, userID, userSig string) int {
+	cRoomID := C.CString(roomID)
+	defer C.free(unsafe.Pointer(cRoomID))
+	cUserID := C.CString(userID)
+	defer C.free(unsafe.Pointer(cUserID))
+	cUserSig := C.CString(userSig)
+	defer C.free(unsafe.Pointer(cUserSig))
+	return int(C.SwingVoiceSourceEnterRoom(s.handle, C.uint32_t(sdkAppID), cRoomID, cUserID, cUserSig))
+}
+
+// 等待事件并追加到 dst，timeout 为负时一直等待，超时返回 dst 本身
+// 关闭后且事件读完时返回 ErrVoiceSourceClosed，同一时刻只允许一个 goroutine 调用。
+func (s *VoiceSource) Read(dst []VoiceEvent, timeout time.Duration) ([]VoiceEvent, error) {
+	timeoutMs := -1
+	if timeout >= 0 {
+		timeoutMs = int(timeout / time.Millisecond)
+	}
+	s.readMu.Lock()
+	defer s.readMu.Unlock()
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	if s.handle == nil {
+		return dst, ErrVoiceSourceClosed
+	}
+	n := int(C.SwingVoiceSourceRead(s.handle, &s.events[0], voiceReadBatch, C.int(timeoutMs)))
+	if n < 0 {
+		return dst, ErrVoiceSourceClosed
+	}
+	for i := 0; i < n; i++ {
+		e := &s.events[i]
+		event := VoiceEvent{
+			Type:       VoiceEventType(e._type),
+			UserID:     C.GoString(e.user_id),
+			SampleRate: int(e.sample_rate),
+			Pts:        uint32(e.pts),
+			DurationMs: uint32(e.duration_ms),
+			TraceKey:   uint64(e.trace_key),
+		}
+		if e.sample_count > 0 {
+			event.Samples = make([]int16, int(e.sample_count))
+			copy(event.Samples, unsafe.Slice((*int16)(unsafe.Pointer(e.samples)), int(e.sample_count)))
+		}
+		dst = append(dst, event)
+	}
+	return dst, nil
+}
+
+func (s *VoiceSource) Stats() VoiceSourceStats {
+	var stats C.SwingVoiceStats
+	s.mu.RLock()
+	C.SwingVoiceSourceGetStats(s.handle, &stats)
+	s.mu.RUnlock()
+	return VoiceSourceStats{
+		AudioFrames:    uint64(stats.audio_frames),
+		DroppedFrames:  uint64(stats.dropped_frames),
+		SpeechSegments: uint64(stats.speech_segments),
+		TotalMs:        uint64(stats.total_ms),
+		SpeechMs:       uint64(stats.speech_ms),
+	}
+}
+
+// 退房并释放，阻塞中的 Read() 先返回 ErrVoiceSourceClosed
+func (s *VoiceSource) Close() {
+	s.closeOnce.Do(func() {
+		C.SwingVoiceSourceClose(s.handle)
+		s.mu.Lock()
+		defer s.mu.Unlock()
+		C.SwingVoiceSourceDestroy(s.handle)
+		C.free(unsafe.Pointer(s.events))
+		s.handle = nil
+		s.events = nil
+	})
+}
@@ -0,0 +1,366 @@
+#include "voice_source.h"
+
+#include <string.h>
+
+#include <chrono>
+#include <utility>
+
+#include "latency_tracer.h"
+
+namespace swing {
+
+namespace {
+
+VadConfig GateConfig(const VoiceSourceConfig& config) {
+  VadConfig vad = config.vad;
+  vad.drop_silence = true;
+  return vad;
+}
+
+// 用户 ID 的 16 位 FNV-1a 摘要，作为 trace key 中的用户部分
+uint32_t TraceUser(const char* user_id) {
+  uint32_t hash = 2166136261u;
+  for (const char* p = user_id; *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<uint8_t>(*p)) * 16777619u;
+  }
+  return (hash >> 16) ^ (hash & 0xFFFF);
+}
+
+}  // namespace
+
+VoiceSource::VoiceSource(const VoiceSourceConfig& config)
+    : config_(config),
+      trace_source_(NewTraceSource()),
+      gate_(this, GateConfig(config)),
+      cloud_(nullptr),
+      queued_frames_(0),
+      entered_(false),
+      closed_(false),
+      audio_frames_(0),
+      dropped_frames_(0) {
+  gate_.SetListener(this);
+  cloud_ = liteav::trtc::TRTCCloud::Create(&gate_);
+}
+
+VoiceSource::~VoiceSource() {
+  Close();
+  // 不调用 ExitRoom()：其 OnExitRoom 回调异步送达，此时本对象可能已释放，
+  // 销毁实例即同步退房
+  if (cloud_ != nullptr) {
+    liteav::trtc::TRTCCloud::Destroy(cloud_);
+    cloud_ = nullptr;
+  }
+}
+
+int VoiceSource::EnterRoom(uint32_t sdk_app_id,
+                           const char* room_id,
+                           const char* user_id,
+                           const char* user_sig) {
+  if (room_id == nullptr || room_id[0] == '\0' || user_id == nullptr || user_id[0] == '\0' ||
+      user_sig == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cloud_ == nullptr || entered_ || closed_) {
+      return liteav::trtc::ERR_INVALID_OPERATION;
+    }
+    entered_ = true;
+  }
+
+  liteav::trtc::EnterRoomParams params;
+  params.room.sdk_app_id = sdk_app_id;
+  params.room.str_room_id = room_id;
+  params.room.user_id = user_id;
+  params.room.user_sig = user_sig;
+  params.scene = liteav::trtc::TRTC_SCENE_RECORD;
+  params.record_config.enable_remote_audio_mix = false;
+  params.record_config.output_sample_rate = config_.sample_rate;
+  params.record_config.output_channels = 1;
+  // 帧长取最小值，语音结束的判定不被帧长拖慢
+  params.record_config.output_frame_length_ms = 20;
+  params.record_config.output_audio_codec_type = liteav::trtc::AUDIO_CODEC_TYPE_PCM;
+  int result = cloud_->EnterRoom(params);
+  if (result != liteav::trtc::ERR_OK) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entered_ = false;
+  }
+  return result;
+}
+
+int VoiceSource::Read(SwingVoiceEvent* events, int max_events, int timeout_ms) {
+  if (events == nullptr || max_events <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < reading_.size(); ++i) {
+    free_.push_back(std::move(reading_[i]));
+  }
+  reading_.clear();
+
+  if (queue_.empty() && !closed_ && timeout_ms != 0) {
+    if (timeout_ms < 0) {
+      cond_.wait(lock, [this] { return !queue_.empty() || closed_; });
+    } else {
+      cond_.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                     [this] { return !queue_.empty() || closed_; });
+    }
+  }
+  if (queue_.empty()) {
+    return closed_ ? liteav::trtc::ERR_INVALID_OPERATION : 0;
+  }
+
+  const int64_t trace_ns = TraceClock();
+  int count = 0;
+  while (count < max_events && !queue_.empty()) {
+    std::unique_ptr<Event> event = std::move(queue_.front());
+    queue_.pop_front();
+    if (event->type == kSwingVoiceAudio) {
+      --queued_frames_;
+    }
+    SwingVoiceEvent& out = events[count++];
+    out.type = event->type;
+    out.user_id = event->user_id.c_str();
+    out.samples = reinterpret_cast<const int16_t*>(event->samples.data());
+    out.sample_count = event->samples.size() / sizeof(int16_t);
+    out.sample_rate = event->sample_rate;
+    out.pts = event->pts;
+    out.duration_ms = event->duration_ms;
+    out.trace_key = event->trace_key;
+    TraceStampAt(event->trace_key, kSwingTraceHandoff, trace_ns);
+    reading_.push_back(std::move(event));
+  }
+  return count;
+}
+
+void VoiceSource::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+  }
+  cond_.notify_all();
+}
+
+SwingVoiceStats VoiceSource::GetStats() const {
+  VadGateStats gate = gate_.GetStats();
+  SwingVoiceStats stats;
+  stats.audio_frames = audio_frames_.load(std::memory_order_relaxed);
+  stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+  stats.speech_segments = gate.segments;
+  stats.total_ms = gate.total_ms;
+  stats.speech_ms = gate.speech_ms;
+  return stats;
+}
+
+std::unique_ptr<VoiceSource::Event> VoiceSource::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_.empty()) {
+      std::unique_ptr<Event> event = std::move(free_.back());
+      free_.pop_back();
+      return event;
+    }
+  }
+  return std::unique_ptr<Event>(new Event());
+}
+
+void VoiceSource::Push(std::unique_ptr<Event> event) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) {
+      free_.push_back(std::move(event));
+      return;
+    }
+    if (event->type == kSwingVoiceAudio) {
+      if (queued_frames_ >= config_.max_queued_frames) {
+        // 丢弃最旧的音频帧，语音事件保留，下游仍能看到完整的语音段边界
+        for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+          if ((*it)->type == kSwingVoiceAudio) {
+            free_.push_back(std::move(*it));
+            queue_.erase(it);
+            --queued_frames_;
+            dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+            break;
+          }
+        }
+      }
+      ++queued_frames_;
+    }
+    queue_.push_back(std::move(event));
+  }
+  cond_.notify_one();
+}
+
+void VoiceSource::OnError(liteav::trtc::Error error) {}
+
+void VoiceSource::OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                           liteav::trtc::ConnectionState new_state) {}
+
+void VoiceSource::OnEnterRoom() {}
+
+void VoiceSource::OnExitRoom() {}
+
+void VoiceSource::OnLocalAudioChannelCreated() {}
+
+void VoiceSource::OnLocalAudioChannelDestroyed() {}
+
+void VoiceSource::OnLocalVideoChannelCreated(StreamType type) {}
+
+void VoiceSource::OnLocalVideoChannelDestroyed(StreamType type) {}
+
+void VoiceSource::OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) {}
+
+void VoiceSource::OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) {}
+
+void VoiceSource::OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) {
+  // VadGate 已在转发前清除该用户，说话中退房时的语音结束事件先于此入队
+  const char* user_id = info.user_id.GetValue();
+  if (user_id == nullptr) {
+    return;
+  }
+  std::unique_ptr<Event> event = Acquire();
+  event->type = kSwingVoiceUserExit;
+  event->user_id = user_id;
+  event->samples.Clear();
+  event->sample_rate = config_.sample_rate;
+  event->pts = 0;
+  event->duration_ms = 0;
+  event->trace_key = 0;
+  Push(std::move(event));
+}
+
+void VoiceSource::OnRemoteAudioAvailable(const char* user_id, bool available) {}
+
+void VoiceSource::OnRemoteVideoAvailable(const char* user_id, bool available, StreamType type) {}
+
+void VoiceSource::OnRemoteVideoReceived(const char* user_id,
+                                        StreamType type,
+                                        const liteav::trtc::VideoFrame& frame) {}
+
+void VoiceSource::OnRemoteVideoReceived(const char* user_id,
+                                        StreamType type,
+                                        const liteav::trtc::PixelFrame& frame) {}
+
+void VoiceSource::OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) {
+  const int64_t trace_ns = TraceClock();
+  // VadGate 只放行能判断的 16 位 PCM，其余格式在这里忽略
+  if (user_id == nullptr || frame.codec != liteav::trtc::AUDIO_CODEC_TYPE_PCM ||
+      frame.bits_per_sample != 16 || frame.sample_rate <= 0 ||
+      (frame.channels != 1 && frame.channels != 2)) {
+    return;
+  }
+  const int16_t* src = reinterpret_cast<const int16_t*>(frame.data());
+  const size_t frames = frame.size() / (sizeof(int16_t) * frame.channels);
+  if (frames == 0) {
+    return;
+  }
+
+  std::unique_ptr<Event> event = Acquire();
+  event->type = kSwingVoiceAudio;
+  event->user_id = user_id;
+  event->sample_rate = frame.sample_rate;
+  event->pts = frame.pts;
+  event->duration_ms = 0;
+  event->trace_key = trace_ns != 0 ? TraceKey(trace_source_, TraceUser(user_id),
+                                              liteav::trtc::STREAM_TYPE_AUDIO, frame.pts)
+                                   : 0;
+  event->samples.Resize(frames * sizeof(int16_t));
+  int16_t* dst = reinterpret_cast<int16_t*>(event->samples.data());
+  if (frame.channels == 1) {
+    memcpy(dst, src, frames * sizeof(int16_t));
+  } else {
+    for (size_t i = 0; i < frames; ++i) {
+      dst[i] = static_cast<int16_t>((static_cast<int32_t>(src[2 * i]) + src[2 * i + 1]) >> 1);
+    }
+  }
+  audio_frames_.fetch_add(1, std::memory_order_relaxed);
+  // 入队时间在发布前取，保证早于 Read() 的交付时间
+  TraceStampAt(event->trace_key, kSwingTraceCallback, trace_ns);
+  TraceStamp(event->trace_key, kSwingTraceQueue);
+  Push(std::move(event));
+}
+
+void VoiceSource::OnRemoteMixedAudioReceived(const AudioFrame& frame) {}
+
+void VoiceSource::OnSpeechStart(const char* user_id, uint32_t pts) {
+  std::unique_ptr<Event> event = Acquire();
+  event->type = kSwingVoiceSpeechStart;
+  event->user_id = user_id;
+  event->samples.Clear();
+  event->sample_rate = config_.sample_rate;
+  event->pts = pts;
+  event->duration_ms = 0;
+  event->trace_key = 0;
+  Push(std::move(event));
+}
+
+void VoiceSource::OnSpeechEnd(const char* user_id, uint32_t pts, uint32_t duration_ms) {
+  std::unique_ptr<Event> event = Acquire();
+  event->type = kSwingVoiceSpeechEnd;
+  event->user_id = user_id;
+  event->samples.Clear();
+  event->sample_rate = config_.sample_rate;
+  event->pts = pts;
+  event->duration_ms = duration_ms;
+  event->trace_key = 0;
+  Push(std::move(event));
+}
+
+}  // namespace swing
+
+void* SwingVoiceSourceCreate(int sample_rate,
+                             int hangover_ms,
+                             int preroll_ms,
+                             size_t max_queued_frames) {
+  swing::VoiceSourceConfig config;
+  if (sample_rate > 0) {
+    config.sample_rate = sample_rate;
+  }
+  if (hangover_ms > 0) {
+    config.vad.hangover_ms = hangover_ms;
+  }
+  if (preroll_ms >= 0) {
+    config.vad.preroll_ms = preroll_ms;
+  }
+  if (max_queued_frames > 0) {
+    config.max_queued_frames = max_queued_frames;
+  }
+  return new swing::VoiceSource(config);
+}
+
+int SwingVoiceSourceEnterRoom(void* source,
+                              uint32_t sdk_app_id,
+                              const char* room_id,
+                              const char* user_id,
+                              const char* user_sig) {
+  if (source == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return static_cast<swing::VoiceSource*>(source)->EnterRoom(sdk_app_id, room_id, user_id,
+                                                              user_sig);
+}
+
+int SwingVoiceSourceRead(void* source, SwingVoiceEvent* events, int max_events, int timeout_ms) {
+  if (source == nullptr) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  return static_cast<swing::VoiceSource*>(source)->Read(events, max_events, timeout_ms);
+}
+
+void SwingVoiceSourceGetStats(void* source, SwingVoiceStats* stats) {
+  if (source == nullptr || stats == nullptr) {
+    return;
+  }
+  *stats = static_cast<swing::VoiceSource*>(source)->GetStats();
+}
+
+void SwingVoiceSourceClose(void* source) {
+  if (source == nullptr) {
+    return;
+  }
+  static_cast<swing::VoiceSource*>(source)->Close();
+}
+
+void SwingVoiceSourceDestroy(void* source) {
+  delete static_cast<swing::VoiceSource*>(source);
+}
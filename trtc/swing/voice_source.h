@@ -0,0 +1,205 @@
+//
+// 功能说明：
+//   语音对话的音频入口。
+//   VoiceSource 以录制模式（TRTC_SCENE_RECORD，单声道 PCM）进房，
+//   OnRemoteAudioReceived 的每路远端音频先经过 VadGate，只有语音段的帧
+//   （含前导）与语音开始 / 结束事件进入同一个有界事件队列，
+//   同一用户的帧与事件严格保持先后顺序。Go 侧通过下方 C 接口批量读取，
+//   交给语音识别与对话流水线（见 gchatgpt/voice）。
+//   时延追踪开启时，音频帧记录进入本对象（VadGate 放行之后）、入队与被读取的时间。
+//
+//   远端用户退房时入队用户退出事件（说话中退房时先有语音结束事件），下游据此释放该用户的状态。
+//
+//   队列满时丢弃最旧的音频帧并计数，语音开始 / 结束与用户退出事件不丢弃，
+//   下游处理变慢时 SDK 回调线程不会被阻塞。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_VOICE_SOURCE_H_
+#define GCHATGPT_TRTC_SWING_VOICE_SOURCE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 事件类型
+enum {
+  kSwingVoiceAudio = 0,
+  kSwingVoiceSpeechStart = 1,
+  kSwingVoiceSpeechEnd = 2,
+  // 远端用户退房，之后不再有该用户的事件，直到其再次进房
+  kSwingVoiceUserExit = 3,
+};
+
+// 读取到的一个事件，指针在下次 SwingVoiceSourceRead() 之前有效
+typedef struct SwingVoiceEvent {
+  int type;
+  const char* user_id;
+  // 单声道 16 位 PCM，仅音频事件有效
+  const int16_t* samples;
+  size_t sample_count;
+  int sample_rate;
+  uint32_t pts;
+  // 语音段时长，仅语音结束事件有效
+  uint32_t duration_ms;
+  // 时延追踪的 key，未开启追踪或非音频事件时为 0，见 latency_tracer.h
+  uint64_t trace_key;
+} SwingVoiceEvent;
+
+typedef struct SwingVoiceStats {
+  uint64_t audio_frames;
+  uint64_t dropped_frames;
+  uint64_t speech_segments;
+  // VadGate 判断过与放行的音频时长
+  uint64_t total_ms;
+  uint64_t speech_ms;
+} SwingVoiceStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C 接口，供 cgo 调用，含义与下方 swing::VoiceSource 的同名方法相同
+// 参数为 0 时取默认值：|sample_rate| 16000，|hangover_ms| 300，|max_queued_frames| 500
+// （20ms 一帧约 10 秒）；|preroll_ms| 为负时取默认值 200。
+void* SwingVoiceSourceCreate(int sample_rate,
+                             int hangover_ms,
+                             int preroll_ms,
+                             size_t max_queued_frames);
+int SwingVoiceSourceEnterRoom(void* source,
+                              uint32_t sdk_app_id,
+                              const char* room_id,
+                              const char* user_id,
+                              const char* user_sig);
+int SwingVoiceSourceRead(void* source, SwingVoiceEvent* events, int max_events, int timeout_ms);
+void SwingVoiceSourceGetStats(void* source, SwingVoiceStats* stats);
+void SwingVoiceSourceClose(void* source);
+void SwingVoiceSourceDestroy(void* source);
+
+#ifdef __cplusplus
+}  // extern "C"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_cloud.h"
+#include "frame_pool.h"
+#include "vad_gate.h"
+
+namespace swing {
+
+struct VoiceSourceConfig {
+  VoiceSourceConfig() : sample_rate(16000), max_queued_frames(500) {}
+
+  // 录制模式输出的采样率，单声道
+  int sample_rate;
+
+  // 语音检测参数，|drop_silence| 固定为 true
+  VadConfig vad;
+
+  // 队列中最多缓存的音频帧数
+  size_t max_queued_frames;
+};
+
+class VoiceSource : public liteav::trtc::TRTCCloudDelegate, public VadListener {
+ public:
+  explicit VoiceSource(const VoiceSourceConfig& config);
+  virtual ~VoiceSource();
+
+  // 进房，|room_id| 为字符串房间号
+  // 返回值：
+  // - ERR_OK：成功发起进房
+  // - ERR_INVALID_PARAMETER：参数为空
+  // - ERR_INVALID_OPERATION：已经进房或已关闭
+  // - 其他：TRTCCloud::EnterRoom() 的返回值
+  int EnterRoom(uint32_t sdk_app_id,
+                const char* room_id,
+                const char* user_id,
+                const char* user_sig);
+
+  // 等待并取出最多 |max_events| 个事件，|timeout_ms| 为负时一直等待
+  // 返回事件数，超时返回 0，Close() 后且队列为空时返回 ERR_INVALID_OPERATION。
+  // 事件中的指针在下次 Read() 之前有效，同一时刻只允许一个线程调用。
+  int Read(SwingVoiceEvent* events, int max_events, int timeout_ms);
+
+  // 停止入队并唤醒 Read()，已入队的事件仍可读完，析构时退房
+  void Close();
+
+  SwingVoiceStats GetStats() const;
+
+  // TRTCCloudDelegate
+  void OnError(liteav::trtc::Error error) override;
+  void OnConnectionStateChanged(liteav::trtc::ConnectionState old_state,
+                                liteav::trtc::ConnectionState new_state) override;
+  void OnEnterRoom() override;
+  void OnExitRoom() override;
+  void OnLocalAudioChannelCreated() override;
+  void OnLocalAudioChannelDestroyed() override;
+  void OnLocalVideoChannelCreated(StreamType type) override;
+  void OnLocalVideoChannelDestroyed(StreamType type) override;
+  void OnRequestChangeVideoEncodeBitrate(StreamType type, int bitrate_bps) override;
+  void OnRemoteUserEnterRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteUserExitRoom(const liteav::trtc::UserInfo& info) override;
+  void OnRemoteAudioAvailable(const char* user_id, bool available) override;
+  void OnRemoteVideoAvailable(const char* user_id, bool available, StreamType type) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const liteav::trtc::VideoFrame& frame) override;
+  void OnRemoteVideoReceived(const char* user_id,
+                             StreamType type,
+                             const liteav::trtc::PixelFrame& frame) override;
+  void OnRemoteAudioReceived(const char* user_id, const AudioFrame& frame) override;
+  void OnRemoteMixedAudioReceived(const AudioFrame& frame) override;
+
+  // VadListener
+  void OnSpeechStart(const char* user_id, uint32_t pts) override;
+  void OnSpeechEnd(const char* user_id, uint32_t pts, uint32_t duration_ms) override;
+
+ private:
+  struct Event {
+    Event() : type(kSwingVoiceAudio), sample_rate(0), pts(0), duration_ms(0), trace_key(0) {}
+
+    int type;
+    std::string user_id;
+    PooledBuffer samples;
+    int sample_rate;
+    uint32_t pts;
+    uint32_t duration_ms;
+    uint64_t trace_key;
+  };
+
+  VoiceSource(const VoiceSource&);
+  VoiceSource& operator=(const VoiceSource&);
+
+  // 取一个空闲事件对象，复用其缓冲
+  std::unique_ptr<Event> Acquire();
+  void Push(std::unique_ptr<Event> event);
+
+  const VoiceSourceConfig config_;
+  const uint32_t trace_source_;
+  VadGate gate_;
+  liteav::trtc::TRTCCloud* cloud_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::unique_ptr<Event> > queue_;
+  std::vector<std::unique_ptr<Event> > free_;
+  size_t queued_frames_;
+  bool entered_;
+  bool closed_;
+
+  // 上次 Read() 交出的事件，下次 Read() 时回收
+  std::vector<std::unique_ptr<Event> > reading_;
+
+  std::atomic<uint64_t> audio_frames_;
+  std::atomic<uint64_t> dropped_frames_;
+};
+
+}  // namespace swing
+
+#endif  // __cplusplus
+
+#endif  // GCHATGPT_TRTC_SWING_VOICE_SOURCE_H_
@@ -0,0 +1,9 @@
+//go:build watermark
+
+package swing
+
+// 以 go build -tags watermark 构建时链接 FreeType 与 libpng，VideoCompositor 可叠加水印，见 watermark_renderer.h
+
+// #cgo pkg-config: freetype2 libpng
+// #cgo CXXFLAGS: -DSWING_HAVE_WATERMARK
+import "C"
@@ -0,0 +1,599 @@
+#include "watermark_renderer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+#ifdef SWING_HAVE_WATERMARK
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include <png.h>
+#endif  // SWING_HAVE_WATERMARK
+
+#include "yuv_kernels.h"
+
+namespace swing {
+
+namespace {
+
+// 字形图集宽度，高度按需翻倍
+const int kAtlasWidth = 1024;
+
+// 白色文字，BT.601 limited range
+const uint8_t kTextLuma = 235;
+const uint8_t kTextChroma = 128;
+
+int AlignEven(int value) {
+  return value & ~1;
+}
+
+int AlignEvenUp(int value) {
+  return (value + 1) & ~1;
+}
+
+int64_t UnixMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+CanvasRect Intersect(const CanvasRect& a, const CanvasRect& b) {
+  int x = std::max(a.x, b.x);
+  int y = std::max(a.y, b.y);
+  int right = std::min(a.x + a.width, b.x + b.width);
+  int bottom = std::min(a.y + a.height, b.y + b.height);
+  if (right <= x || bottom <= y) {
+    return CanvasRect();
+  }
+  return CanvasRect(x, y, right - x, bottom - y);
+}
+
+// UTF-8 解码，非法字节按 U+FFFD 处理
+void DecodeUtf8(const std::string& text, std::vector<uint32_t>* codepoints) {
+  codepoints->clear();
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(text.data());
+  const uint8_t* end = p + text.size();
+  while (p < end) {
+    uint32_t c = *p++;
+    int extra = 0;
+    if (c >= 0xF0 && c < 0xF8) {
+      c &= 0x07;
+      extra = 3;
+    } else if (c >= 0xE0) {
+      c &= 0x0F;
+      extra = 2;
+    } else if (c >= 0xC0) {
+      c &= 0x1F;
+      extra = 1;
+    } else if (c >= 0x80) {
+      c = 0xFFFD;
+    }
+    for (; extra > 0; --extra) {
+      if (p == end || (*p & 0xC0) != 0x80) {
+        c = 0xFFFD;
+        break;
+      }
+      c = (c << 6) | (*p++ & 0x3F);
+    }
+    codepoints->push_back(c);
+  }
+}
+
+void FormatTimestamp(int64_t unix_seconds, std::string* text) {
+  time_t seconds = static_cast<time_t>(unix_seconds);
+  struct tm local;
+  localtime_r(&seconds, &local);
+  // 按 6 个 int 的最大宽度预留，字段超出格式宽度时也不会截断
+  char buffer[80];
+  const int length =
+      snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d", local.tm_year + 1900,
+               local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+  if (length < 0) {
+    text->clear();
+    return;
+  }
+  text->assign(buffer, static_cast<size_t>(length));
+}
+
+}  // namespace
+
+// 字形在图集中的位置与排版参数，单位像素
+struct Glyph {
+  Glyph() : x(0), y(0), width(0), height(0), left(0), top(0), advance(0) {}
+
+  int x;
+  int y;
+  int width;
+  int height;
+  int left;
+  int top;
+  int advance;
+};
+
+#ifdef SWING_HAVE_WATERMARK
+
+// 一个字体文件的一个字号，字形首次使用时光栅化进图集
+class WatermarkRenderer::Font {
+ public:
+  static Font* Load(void* library, const std::string& path, size_t size) {
+    FT_Face face = nullptr;
+    if (library == nullptr ||
+        FT_New_Face(static_cast<FT_Library>(library), path.c_str(), 0, &face) != 0) {
+      return nullptr;
+    }
+    if (FT_Set_Pixel_Sizes(face, 0, static_cast<FT_UInt>(size)) != 0) {
+      FT_Done_Face(face);
+      return nullptr;
+    }
+    return new Font(face);
+  }
+
+  ~Font() { FT_Done_Face(face_); }
+
+  const Glyph& GetGlyph(uint32_t codepoint) {
+    std::unordered_map<uint32_t, Glyph>::const_iterator it = glyphs_.find(codepoint);
+    if (it != glyphs_.end()) {
+      return it->second;
+    }
+    // 加载失败的字形也记录下来，避免每次排版重试
+    Glyph& glyph = glyphs_[codepoint];
+    if (FT_Load_Char(face_, codepoint, FT_LOAD_RENDER) != 0) {
+      return glyph;
+    }
+    const FT_GlyphSlot slot = face_->glyph;
+    const FT_Bitmap& bitmap = slot->bitmap;
+    glyph.left = slot->bitmap_left;
+    glyph.top = slot->bitmap_top;
+    glyph.advance = static_cast<int>((slot->advance.x + 32) >> 6);
+    if (bitmap.pixel_mode != FT_PIXEL_MODE_GRAY || bitmap.width == 0 || bitmap.rows == 0) {
+      return glyph;
+    }
+    glyph.width = std::min(static_cast<int>(bitmap.width), kAtlasWidth);
+    glyph.height = static_cast<int>(bitmap.rows);
+    Place(&glyph);
+    for (int row = 0; row < glyph.height; ++row) {
+      const int source_row = bitmap.pitch >= 0 ? row : glyph.height - 1 - row;
+      memcpy(&atlas_[static_cast<size_t>(glyph.y + row) * kAtlasWidth + glyph.x],
+             bitmap.buffer + static_cast<ptrdiff_t>(source_row) * abs(bitmap.pitch),
+             glyph.width);
+    }
+    return glyph;
+  }
+
+  const uint8_t* AtlasRow(int y) const { return &atlas_[static_cast<size_t>(y) * kAtlasWidth]; }
+
+  int ascender() const { return ascender_; }
+  int line_height() const { return line_height_; }
+
+ private:
+  explicit Font(FT_Face face)
+      : face_(face),
+        ascender_(static_cast<int>((face->size->metrics.ascender + 63) >> 6)),
+        line_height_(ascender_ - static_cast<int>(face->size->metrics.descender >> 6)),
+        atlas_height_(0),
+        shelf_x_(0),
+        shelf_y_(0),
+        shelf_height_(0) {}
+
+  Font(const Font&);
+  Font& operator=(const Font&);
+
+  // 按行（shelf）排放，行满换行，图集高度不够时翻倍
+  void Place(Glyph* glyph) {
+    if (shelf_x_ + glyph->width > kAtlasWidth) {
+      shelf_y_ += shelf_height_ + 1;
+      shelf_x_ = 0;
+      shelf_height_ = 0;
+    }
+    if (shelf_y_ + glyph->height > atlas_height_) {
+      atlas_height_ = std::max(atlas_height_ * 2, shelf_y_ + glyph->height);
+      atlas_.resize(static_cast<size_t>(atlas_height_) * kAtlasWidth);
+    }
+    glyph->x = shelf_x_;
+    glyph->y = shelf_y_;
+    shelf_x_ += glyph->width + 1;
+    shelf_height_ = std::max(shelf_height_, glyph->height);
+  }
+
+  FT_Face face_;
+  const int ascender_;
+  const int line_height_;
+
+  std::unordered_map<uint32_t, Glyph> glyphs_;
+  std::vector<uint8_t> atlas_;
+  int atlas_height_;
+  int shelf_x_;
+  int shelf_y_;
+  int shelf_height_;
+};
+
+#else  // SWING_HAVE_WATERMARK
+
+// 未链接 FreeType，字体一律加载失败
+class WatermarkRenderer::Font {
+ public:
+  static Font* Load(void* /* library */, const std::string& /* path */, size_t /* size */) {
+    return nullptr;
+  }
+
+  const Glyph& GetGlyph(uint32_t /* codepoint */) { return glyph_; }
+  const uint8_t* AtlasRow(int /* y */) const { return nullptr; }
+  int ascender() const { return 0; }
+  int line_height() const { return 0; }
+
+ private:
+  Glyph glyph_;
+};
+
+#endif  // SWING_HAVE_WATERMARK
+
+// 解码后的图片，全分辨率的 Y / U / V / A 平面
+struct WatermarkRenderer::Image {
+  Image() : width(0), height(0) {}
+
+  int width;
+  int height;
+  std::vector<uint8_t> planes[4];
+};
+
+// 一个水印的 YUVA 图层
+struct WatermarkRenderer::Layer {
+  Layer() : type(liteav::trtc::kWatermarkImage), font(nullptr), second(-1) {}
+
+  void Resize(int width, int height) {
+    rect.width = width;
+    rect.height = height;
+    const size_t luma = static_cast<size_t>(width) * height;
+    const size_t chroma = luma / 4;
+    y.assign(luma, kTextLuma);
+    a.assign(luma, 0);
+    u.assign(chroma, kTextChroma);
+    v.assign(chroma, kTextChroma);
+    chroma_a.assign(chroma, 0);
+    spans.resize(height);
+    chroma_spans.resize(height / 2);
+  }
+
+  // 由 |a| 计算色度 alpha（2x2 平均）与每行的非透明区间
+  void Finish() {
+    const int width = rect.width;
+    const int chroma_width = width / 2;
+    for (int row = 0; row < rect.height / 2; ++row) {
+      const uint8_t* top = &a[static_cast<size_t>(row * 2) * width];
+      const uint8_t* bottom = top + width;
+      uint8_t* out = &chroma_a[static_cast<size_t>(row) * chroma_width];
+      for (int x = 0; x < chroma_width; ++x) {
+        out[x] = static_cast<uint8_t>(
+            (top[2 * x] + top[2 * x + 1] + bottom[2 * x] + bottom[2 * x + 1] + 2) >> 2);
+      }
+    }
+    ComputeSpans(a, width, rect.height, &spans);
+    ComputeSpans(chroma_a, chroma_width, rect.height / 2, &chroma_spans);
+  }
+
+  static void ComputeSpans(const std::vector<uint8_t>& alpha,
+                           int width,
+                           int height,
+                           std::vector<std::pair<int, int> >* spans) {
+    for (int row = 0; row < height; ++row) {
+      const uint8_t* line = &alpha[static_cast<size_t>(row) * width];
+      int begin = 0;
+      while (begin < width && line[begin] == 0) {
+        ++begin;
+      }
+      int end = width;
+      while (end > begin && line[end - 1] == 0) {
+        --end;
+      }
+      (*spans)[row] = std::make_pair(begin, end);
+    }
+  }
+
+  liteav::trtc::WatermarkType type;
+  CanvasRect rect;
+  Font* font;
+
+  // 时间戳水印当前显示的秒数与文本
+  int64_t second;
+  std::string text;
+
+  std::vector<uint8_t> y;
+  std::vector<uint8_t> u;
+  std::vector<uint8_t> v;
+  std::vector<uint8_t> a;
+  std::vector<uint8_t> chroma_a;
+
+  // 每行 alpha 非 0 的区间 [first, second)
+  std::vector<std::pair<int, int> > spans;
+  std::vector<std::pair<int, int> > chroma_spans;
+};
+
+WatermarkRenderer::WatermarkRenderer() : library_(nullptr) {
+#ifdef SWING_HAVE_WATERMARK
+  FT_Library library = nullptr;
+  if (FT_Init_FreeType(&library) == 0) {
+    library_ = library;
+  }
+#endif  // SWING_HAVE_WATERMARK
+}
+
+WatermarkRenderer::~WatermarkRenderer() {
+  layers_.clear();
+  fonts_.clear();
+#ifdef SWING_HAVE_WATERMARK
+  if (library_ != nullptr) {
+    FT_Done_FreeType(static_cast<FT_Library>(library_));
+  }
+#endif  // SWING_HAVE_WATERMARK
+}
+
+WatermarkRenderer::Font* WatermarkRenderer::GetFont(const std::string& path, size_t size) {
+  std::pair<std::string, size_t> key(path, size);
+  std::map<std::pair<std::string, size_t>, std::unique_ptr<Font> >::iterator it =
+      fonts_.find(key);
+  if (it != fonts_.end()) {
+    return it->second.get();
+  }
+  Font* font = Font::Load(library_, path, size);
+  if (font != nullptr) {
+    fonts_[key].reset(font);
+  }
+  return font;
+}
+
+const WatermarkRenderer::Image* WatermarkRenderer::GetImage(const std::string& path) {
+  std::map<std::string, std::unique_ptr<Image> >::iterator it = images_.find(path);
+  if (it != images_.end()) {
+    return it->second.get();
+  }
+
+#ifdef SWING_HAVE_WATERMARK
+  png_image png;
+  memset(&png, 0, sizeof(png));
+  png.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_file(&png, path.c_str())) {
+    return nullptr;
+  }
+  png.format = PNG_FORMAT_RGBA;
+  std::vector<uint8_t> rgba(PNG_IMAGE_SIZE(png));
+  if (!png_image_finish_read(&png, nullptr, rgba.data(), 0, nullptr)) {
+    png_image_free(&png);
+    return nullptr;
+  }
+
+  std::unique_ptr<Image> image(new Image());
+  image->width = static_cast<int>(png.width);
+  image->height = static_cast<int>(png.height);
+  const size_t pixels = static_cast<size_t>(image->width) * image->height;
+  for (int p = 0; p < 4; ++p) {
+    image->planes[p].resize(pixels);
+  }
+  for (size_t i = 0; i < pixels; ++i) {
+    const uint8_t* px = &rgba[i * 4];
+    RgbToYuv((px[0] << 16) | (px[1] << 8) | px[2], &image->planes[0][i], &image->planes[1][i],
+             &image->planes[2][i]);
+    image->planes[3][i] = px[3];
+  }
+  const Image* result = image.get();
+  images_[path] = std::move(image);
+  return result;
+#else
+  return nullptr;
+#endif  // SWING_HAVE_WATERMARK
+}
+
+bool WatermarkRenderer::BuildImageLayer(const WatermarkConfig& config, Layer* layer) {
+  const char* path = config.content.GetValue();
+  const Image* image = path != nullptr ? GetImage(path) : nullptr;
+  if (image == nullptr || image->width <= 0 || image->height <= 0) {
+    return false;
+  }
+  const int width = std::max(2, AlignEven(config.width > 0 ? config.width : image->width));
+  const int height = std::max(2, AlignEven(config.height > 0 ? config.height : image->height));
+  layer->Resize(width, height);
+
+  PlaneScaler scaler;
+  scaler.Scale(image->planes[0].data(), image->width, image->width, image->height,
+               layer->y.data(), width, width, height);
+  scaler.Scale(image->planes[3].data(), image->width, image->width, image->height,
+               layer->a.data(), width, width, height);
+  scaler.Scale(image->planes[1].data(), image->width, image->width, image->height,
+               layer->u.data(), width / 2, width / 2, height / 2);
+  scaler.Scale(image->planes[2].data(), image->width, image->width, image->height,
+               layer->v.data(), width / 2, width / 2, height / 2);
+  layer->Finish();
+  return true;
+}
+
+bool WatermarkRenderer::BuildTextLayer(const std::string& text, Layer* layer) {
+  Font* font = layer->font;
+  std::vector<uint32_t> codepoints;
+  DecodeUtf8(text, &codepoints);
+
+  // 字形从图集复制到 alpha 平面，重叠处取最大值；超出图层的部分裁掉
+  std::fill(layer->a.begin(), layer->a.end(), 0);
+  const int width = layer->rect.width;
+  const int height = layer->rect.height;
+  const int baseline = (height - font->line_height()) / 2 + font->ascender();
+  int pen = 0;
+  for (size_t i = 0; i < codepoints.size() && pen < width; ++i) {
+    const Glyph& glyph = font->GetGlyph(codepoints[i]);
+    const int left = pen + glyph.left;
+    const int top = baseline - glyph.top;
+    const int col_begin = std::max(0, -left);
+    const int col_end = std::min(glyph.width, width - left);
+    for (int row = std::max(0, -top); row < glyph.height && top + row < height; ++row) {
+      const uint8_t* src = font->AtlasRow(glyph.y + row) + glyph.x;
+      uint8_t* dst = &layer->a[static_cast<size_t>(top + row) * width + left];
+      for (int x = col_begin; x < col_end; ++x) {
+        dst[x] = std::max(dst[x], src[x]);
+      }
+    }
+    pen += glyph.advance;
+  }
+  layer->text = text;
+  layer->Finish();
+  return true;
+}
+
+int WatermarkRenderer::UpdateWatermark(const WatermarkConfig watermarks[],
+                                       size_t watermark_count) {
+  layers_.clear();
+#ifndef SWING_HAVE_WATERMARK
+  if (watermark_count > 0) {
+    return liteav::trtc::ERR_NOT_SUPPORTED;
+  }
+#endif  // SWING_HAVE_WATERMARK
+  int ret = liteav::trtc::ERR_OK;
+  for (size_t i = 0; i < watermark_count; ++i) {
+    const WatermarkConfig& config = watermarks[i];
+    std::unique_ptr<Layer> layer(new Layer());
+    layer->type = config.type;
+    layer->rect.x = AlignEven(std::max(0, config.offset_x));
+    layer->rect.y = AlignEven(std::max(0, config.offset_y));
+
+    bool ok = false;
+    if (config.type == liteav::trtc::kWatermarkImage) {
+      ok = BuildImageLayer(config, layer.get());
+    } else {
+      const char* font_path = config.path_to_font.GetValue();
+      const char* content = config.content.GetValue();
+      std::string text = content != nullptr ? content : "";
+      layer->font = font_path != nullptr && config.font_size > 0
+                        ? GetFont(font_path, config.font_size)
+                        : nullptr;
+      if (layer->font != nullptr && config.type == liteav::trtc::kWatermarkTimestamp) {
+        // 时间戳宽度按最宽的数字预留，秒数变化时图层尺寸不变
+        uint32_t widest = '0';
+        for (uint32_t c = '0'; c <= '9'; ++c) {
+          if (layer->font->GetGlyph(c).advance > layer->font->GetGlyph(widest).advance) {
+            widest = c;
+          }
+        }
+        text = "0000-00-00 00:00:00";
+        std::replace(text.begin(), text.end(), '0', static_cast<char>(widest));
+      }
+      if (layer->font != nullptr && !text.empty()) {
+        std::vector<uint32_t> codepoints;
+        DecodeUtf8(text, &codepoints);
+        int text_width = 0;
+        for (size_t c = 0; c < codepoints.size(); ++c) {
+          text_width += layer->font->GetGlyph(codepoints[c]).advance;
+        }
+        layer->Resize(std::max(2, config.width > 0 ? AlignEven(config.width)
+                                                   : AlignEvenUp(text_width)),
+                      std::max(2, config.height > 0 ? AlignEven(config.height)
+                                                    : AlignEvenUp(layer->font->line_height())));
+        ok = config.type == liteav::trtc::kWatermarkTimestamp || BuildTextLayer(text, layer.get());
+      }
+    }
+    if (!ok) {
+      ret = liteav::trtc::ERR_INVALID_PARAMETER;
+      continue;
+    }
+    layers_.push_back(std::move(layer));
+  }
+  return ret;
+}
+
+void WatermarkRenderer::Prepare(int64_t unix_ms, std::vector<CanvasRect>* changed) {
+  const int64_t second = unix_ms / 1000;
+  std::string text;
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    Layer* layer = layers_[i].get();
+    if (layer->type != liteav::trtc::kWatermarkTimestamp || layer->second == second) {
+      continue;
+    }
+    layer->second = second;
+    FormatTimestamp(second, &text);
+    if (text == layer->text) {
+      continue;
+    }
+    BuildTextLayer(text, layer);
+    if (changed != nullptr) {
+      changed->push_back(layer->rect);
+    }
+  }
+}
+
+void WatermarkRenderer::Blend(uint8_t* const planes[3],
+                              const int strides[3],
+                              int width,
+                              int height,
+                              const CanvasRect& clip) const {
+  const CanvasRect bounds = Intersect(clip, CanvasRect(0, 0, AlignEven(width), AlignEven(height)));
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    const Layer& layer = *layers_[i];
+    const CanvasRect visible = Intersect(layer.rect, bounds);
+    if (visible.Empty()) {
+      continue;
+    }
+    // 图层内坐标
+    const int x0 = visible.x - layer.rect.x;
+    const int x1 = x0 + visible.width;
+    for (int row = visible.y - layer.rect.y; row < visible.y + visible.height - layer.rect.y;
+         ++row) {
+      const int begin = std::max(x0, layer.spans[row].first);
+      const int end = std::min(x1, layer.spans[row].second);
+      if (begin >= end) {
+        continue;
+      }
+      const size_t offset = static_cast<size_t>(row) * layer.rect.width + begin;
+      BlendRow(&layer.y[offset], &layer.a[offset],
+               planes[0] + static_cast<ptrdiff_t>(layer.rect.y + row) * strides[0] +
+                   layer.rect.x + begin,
+               end - begin);
+    }
+
+    const int chroma_width = layer.rect.width / 2;
+    for (int row = (visible.y - layer.rect.y) / 2;
+         row < (visible.y + visible.height - layer.rect.y) / 2; ++row) {
+      const int begin = std::max(x0 / 2, layer.chroma_spans[row].first);
+      const int end = std::min(x1 / 2, layer.chroma_spans[row].second);
+      if (begin >= end) {
+        continue;
+      }
+      const size_t offset = static_cast<size_t>(row) * chroma_width + begin;
+      const ptrdiff_t dst_row = layer.rect.y / 2 + row;
+      const ptrdiff_t dst_col = layer.rect.x / 2 + begin;
+      BlendRow(&layer.u[offset], &layer.chroma_a[offset],
+               planes[1] + dst_row * strides[1] + dst_col, end - begin);
+      BlendRow(&layer.v[offset], &layer.chroma_a[offset],
+               planes[2] + dst_row * strides[2] + dst_col, end - begin);
+    }
+  }
+}
+
+int WatermarkRenderer::Render(uint8_t* data,
+                              size_t size,
+                              int width,
+                              int height,
+                              int64_t unix_ms) {
+  if (data == nullptr || width <= 0 || height <= 0) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  const int chroma_width = (width + 1) / 2;
+  const size_t luma = static_cast<size_t>(width) * height;
+  const size_t chroma = static_cast<size_t>(chroma_width) * ((height + 1) / 2);
+  if (size < luma + 2 * chroma) {
+    return liteav::trtc::ERR_INVALID_PARAMETER;
+  }
+  uint8_t* const planes[3] = {data, data + luma, data + luma + chroma};
+  const int strides[3] = {width, chroma_width, chroma_width};
+  Prepare(unix_ms < 0 ? UnixMs() : unix_ms, nullptr);
+  Blend(planes, strides, width, height, CanvasRect(0, 0, width, height));
+  return liteav::trtc::ERR_OK;
+}
+
+void WatermarkRenderer::GetRects(std::vector<CanvasRect>* rects) const {
+  rects->clear();
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    rects->push_back(layers_[i]->rect);
+  }
+}
+
+}  // namespace swing
@@ -0,0 +1,99 @@
+//
+// 功能说明：
+//   按 WatermarkConfig 在 YUV420p 画面上叠加水印，语义与 Recorder::UpdateWatermark() 一致，
+//   用于 VideoCompositor 的本地合流，也可单独叠加到任意 YUV420p 缓冲。
+//
+//   UpdateWatermark() 时把每个水印预先生成为目标尺寸的 YUVA 图层，每帧只做 alpha 混合：
+//   - kWatermarkImage：PNG 按路径解码一次并缓存，缩放到 |width| x |height|
+//     （为 0 时取图片原尺寸）；
+//   - kWatermarkText：白色文字，字形按 (字体文件, |font_size|) 光栅化一次放进字形图集，
+//     之后排版只从图集复制；
+//   - kWatermarkTimestamp：本地时间 "YYYY-MM-DD HH:MM:SS"，显示的秒数变化时才重新排版，
+//     字体同样取 |path_to_font| / |font_size|。
+//   图层按行记录非透明区间，混合只处理这些像素，文字水印的空白处不产生开销。
+//
+//   水印位置与尺寸按偶数对齐，超出画面的部分裁掉。
+//   图片与文字需以 go build -tags watermark 构建（链接 FreeType、libpng 并定义
+//   SWING_HAVE_WATERMARK），否则 UpdateWatermark() 返回 ERR_NOT_SUPPORTED。
+//   非线程安全，与所属的 VideoCompositor 在同一线程使用。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_WATERMARK_RENDERER_H_
+#define GCHATGPT_TRTC_SWING_WATERMARK_RENDERER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/trtc/liteav_trtc_defines.h"
+#include "video_compositor.h"
+
+namespace swing {
+
+using liteav::trtc::WatermarkConfig;
+
+class WatermarkRenderer {
+ public:
+  WatermarkRenderer();
+  ~WatermarkRenderer();
+
+  // 全量替换水印，图片解码、字体加载与图层生成在此完成
+  // 返回值：
+  // - ERR_OK：全部水印可用
+  // - ERR_INVALID_PARAMETER：部分水印的图片或字体无法加载，或文本为空，这些水印被忽略
+  // - ERR_NOT_SUPPORTED：构建时未启用水印，见文件头
+  int UpdateWatermark(const WatermarkConfig watermarks[], size_t watermark_count);
+
+  // 更新时间戳水印，|unix_ms| 为 Unix 时间毫秒
+  // 显示内容变化的水印区域追加到 |changed|，可以为 nullptr。
+  void Prepare(int64_t unix_ms, std::vector<CanvasRect>* changed);
+
+  // 把水印落在 |clip| 内的部分混合到画面上
+  // |planes| / |strides| 为 YUV420p 三个平面，|clip| 坐标为偶数。
+  void Blend(uint8_t* const planes[3],
+             const int strides[3],
+             int width,
+             int height,
+             const CanvasRect& clip) const;
+
+  // 在连续的 YUV420p 缓冲上叠加全部水印，时间戳取 |unix_ms|，为负值时取当前时间
+  // 返回 ERR_INVALID_PARAMETER 表示缓冲或尺寸不合法。
+  int Render(uint8_t* data, size_t size, int width, int height, int64_t unix_ms = -1);
+
+  // 当前水印的区域
+  void GetRects(std::vector<CanvasRect>* rects) const;
+
+  size_t WatermarkCount() const { return layers_.size(); }
+
+ private:
+  class Font;
+  struct Image;
+  struct Layer;
+
+  WatermarkRenderer(const WatermarkRenderer&);
+  WatermarkRenderer& operator=(const WatermarkRenderer&);
+
+  Font* GetFont(const std::string& path, size_t size);
+  const Image* GetImage(const std::string& path);
+
+  bool BuildImageLayer(const WatermarkConfig& config, Layer* layer);
+  bool BuildTextLayer(const std::string& text, Layer* layer);
+
+  // FT_Library，FreeType 头文件只在实现中引入，未启用水印时为 nullptr
+  void* library_;
+
+  // 按 (字体文件, 字号) 缓存，字形图集随之保留
+  std::map<std::pair<std::string, size_t>, std::unique_ptr<Font> > fonts_;
+  // 按路径缓存的解码结果，UpdateWatermark() 重复使用同一图片时不再解码
+  std::map<std::string, std::unique_ptr<Image> > images_;
+
+  std::vector<std::unique_ptr<Layer> > layers_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_WATERMARK_RENDERER_H_
@@ -0,0 +1,443 @@
+#include "yuv_kernels.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SWING_YUV_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SWING_YUV_NEON 1
+#endif
+
+namespace swing {
+
+namespace {
+
+std::atomic<bool> g_force_scalar(false);
+
+///////////////////////////////////////////////////////////////////////
+//                             标量实现                             //
+/////////////////////////////////////////////////////////////////////
+
+void InterpolateRowC(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, int f) {
+  const int f0 = 128 - f;
+  for (int i = 0; i < width; ++i) {
+    dst[i] = static_cast<uint8_t>((a[i] * f0 + b[i] * f + 64) >> 7);
+  }
+}
+
+void ScaleRowHC(const uint8_t* src,
+                int src_width,
+                const int32_t* x_index,
+                const uint16_t* x_weight,
+                uint8_t* dst,
+                int begin,
+                int end) {
+  for (int x = begin; x < end; ++x) {
+    int x0 = x_index[x];
+    int x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+    int w0 = x_weight[x] & 0xFF;
+    int w1 = x_weight[x] >> 8;
+    dst[x] = static_cast<uint8_t>((src[x0] * w0 + src[x1] * w1 + 32) >> 6);
+  }
+}
+
+void BlendRowC(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int width) {
+  for (int i = 0; i < width; ++i) {
+    int w = alpha[i] + (alpha[i] >> 7);
+    dst[i] = static_cast<uint8_t>((dst[i] * (256 - w) + src[i] * w + 128) >> 8);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////
+//                              AVX2                                //
+/////////////////////////////////////////////////////////////////////
+
+#if defined(SWING_YUV_X86)
+
+__attribute__((target("avx2"))) void InterpolateRowAVX2(const uint8_t* a,
+                                                        const uint8_t* b,
+                                                        uint8_t* dst,
+                                                        int width,
+                                                        int f) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i w0 = _mm256_set1_epi16(static_cast<int16_t>(128 - f));
+  const __m256i w1 = _mm256_set1_epi16(static_cast<int16_t>(f));
+  const __m256i round = _mm256_set1_epi16(64);
+  int i = 0;
+  for (; i + 32 <= width; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+    __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), w0),
+                                  _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), w1));
+    __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), w0),
+                                  _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), w1));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 7);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 7);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  InterpolateRowC(a + i, b + i, dst + i, width - i, f);
+}
+
+// 每次处理 8 个目标像素：gather 读取 src[x0..x0+3]，maddubs 完成两点加权
+__attribute__((target("avx2"))) void ScaleRowHAVX2(const uint8_t* src,
+                                                   int src_width,
+                                                   const int32_t* x_index,
+                                                   const uint16_t* x_weight,
+                                                   uint8_t* dst,
+                                                   int simd_count,
+                                                   int width) {
+  const __m256i round = _mm256_set1_epi32(32);
+  const __m256i gather_lanes = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  int x = 0;
+  for (; x + 8 <= simd_count; x += 8) {
+    __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x_index + x));
+    __m256i pixels = _mm256_i32gather_epi32(reinterpret_cast<const int*>(src), index, 1);
+    __m256i weights = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(x_weight + x)));
+    // 每个 32 位通道：低 16 位为 s0 * w0 + s1 * w1，高 16 位权重为 0
+    __m256i sum = _mm256_maddubs_epi16(pixels, weights);
+    sum = _mm256_srli_epi32(_mm256_add_epi32(sum, round), 6);
+    __m256i packed = _mm256_packus_epi32(sum, sum);
+    packed = _mm256_packus_epi16(packed, packed);
+    packed = _mm256_permutevar8x32_epi32(packed, gather_lanes);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm256_castsi256_si128(packed));
+  }
+  ScaleRowHC(src, src_width, x_index, x_weight, dst, x, width);
+}
+
+__attribute__((target("avx2"))) void BlendRowAVX2(const uint8_t* src,
+                                                  const uint8_t* alpha,
+                                                  uint8_t* dst,
+                                                  int width) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i full = _mm256_set1_epi16(256);
+  const __m256i round = _mm256_set1_epi16(128);
+  int i = 0;
+  for (; i + 32 <= width; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(alpha + i));
+    __m256i vs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m256i vd = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i));
+    // 各 16 位通道的值不超过 255 * 256 + 128，按无符号处理不会溢出
+    __m256i a_lo = _mm256_unpacklo_epi8(va, zero);
+    __m256i a_hi = _mm256_unpackhi_epi8(va, zero);
+    a_lo = _mm256_add_epi16(a_lo, _mm256_srli_epi16(a_lo, 7));
+    a_hi = _mm256_add_epi16(a_hi, _mm256_srli_epi16(a_hi, 7));
+    __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(vs, zero), a_lo),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(vd, zero), _mm256_sub_epi16(full, a_lo)));
+    __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(vs, zero), a_hi),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(vd, zero), _mm256_sub_epi16(full, a_hi)));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(lo, hi));
+  }
+  BlendRowC(src + i, alpha + i, dst + i, width - i);
+}
+
+bool HasAVX2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+#endif  // defined(SWING_YUV_X86)
+
+///////////////////////////////////////////////////////////////////////
+//                              NEON                                //
+/////////////////////////////////////////////////////////////////////
+
+#if defined(SWING_YUV_NEON)
+
+void InterpolateRowNEON(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, int f) {
+  const uint8x8_t w0 = vdup_n_u8(static_cast<uint8_t>(128 - f));
+  const uint8x8_t w1 = vdup_n_u8(static_cast<uint8_t>(f));
+  int i = 0;
+  for (; i + 16 <= width; i += 16) {
+    uint8x16_t va = vld1q_u8(a + i);
+    uint8x16_t vb = vld1q_u8(b + i);
+    uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), w0), vget_low_u8(vb), w1);
+    uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(va), w0), vget_high_u8(vb), w1);
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 7), vrshrn_n_u16(hi, 7)));
+  }
+  InterpolateRowC(a + i, b + i, dst + i, width - i, f);
+}
+
+void BlendRowNEON(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int width) {
+  const uint16x8_t full = vdupq_n_u16(256);
+  int i = 0;
+  for (; i + 16 <= width; i += 16) {
+    uint8x16_t va = vld1q_u8(alpha + i);
+    uint8x16_t vs = vld1q_u8(src + i);
+    uint8x16_t vd = vld1q_u8(dst + i);
+    uint16x8_t a_lo = vmovl_u8(vget_low_u8(va));
+    uint16x8_t a_hi = vmovl_u8(vget_high_u8(va));
+    a_lo = vaddq_u16(a_lo, vshrq_n_u16(a_lo, 7));
+    a_hi = vaddq_u16(a_hi, vshrq_n_u16(a_hi, 7));
+    uint16x8_t lo = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(vs)), a_lo),
+                              vmovl_u8(vget_low_u8(vd)), vsubq_u16(full, a_lo));
+    uint16x8_t hi = vmlaq_u16(vmulq_u16(vmovl_u8(vget_high_u8(vs)), a_hi),
+                              vmovl_u8(vget_high_u8(vd)), vsubq_u16(full, a_hi));
+    vst1q_u8(dst + i, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+  }
+  BlendRowC(src + i, alpha + i, dst + i, width - i);
+}
+
+#endif  // defined(SWING_YUV_NEON)
+
+void BlendRowImpl(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int width) {
+  if (!g_force_scalar.load(std::memory_order_relaxed)) {
+#if defined(SWING_YUV_X86)
+    if (HasAVX2()) {
+      BlendRowAVX2(src, alpha, dst, width);
+      return;
+    }
+#elif defined(SWING_YUV_NEON)
+    BlendRowNEON(src, alpha, dst, width);
+    return;
+#endif
+  }
+  BlendRowC(src, alpha, dst, width);
+}
+
+void InterpolateRowImpl(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, int f) {
+  if (!g_force_scalar.load(std::memory_order_relaxed)) {
+#if defined(SWING_YUV_X86)
+    if (HasAVX2()) {
+      InterpolateRowAVX2(a, b, dst, width, f);
+      return;
+    }
+#elif defined(SWING_YUV_NEON)
+    InterpolateRowNEON(a, b, dst, width, f);
+    return;
+#endif
+  }
+  InterpolateRowC(a, b, dst, width, f);
+}
+
+// NEON 没有 gather，横向缩放在 ARM 上走标量查表
+void ScaleRowH(const uint8_t* src,
+               int src_width,
+               const int32_t* x_index,
+               const uint16_t* x_weight,
+               uint8_t* dst,
+               int simd_count,
+               int width) {
+#if defined(SWING_YUV_X86)
+  if (!g_force_scalar.load(std::memory_order_relaxed) && HasAVX2()) {
+    ScaleRowHAVX2(src, src_width, x_index, x_weight, dst, simd_count, width);
+    return;
+  }
+#endif
+  (void)simd_count;
+  ScaleRowHC(src, src_width, x_index, x_weight, dst, 0, width);
+}
+
+}  // namespace
+
+const char* YuvKernelName() {
+  if (g_force_scalar.load(std::memory_order_relaxed)) {
+    return "c";
+  }
+#if defined(SWING_YUV_X86)
+  return HasAVX2() ? "avx2" : "c";
+#elif defined(SWING_YUV_NEON)
+  return "neon";
+#else
+  return "c";
+#endif
+}
+
+void ForceScalarYuvKernels(bool force) {
+  g_force_scalar.store(force, std::memory_order_relaxed);
+}
+
+void RgbToYuv(int rgb, uint8_t* y, uint8_t* u, uint8_t* v) {
+  int r = (rgb >> 16) & 0xFF;
+  int g = (rgb >> 8) & 0xFF;
+  int b = rgb & 0xFF;
+  *y = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+  *u = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+  *v = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+void FillPlane(uint8_t* dst, int stride, int width, int height, uint8_t value) {
+  if (width <= 0) {
+    return;
+  }
+  for (int y = 0; y < height; ++y) {
+    memset(dst + static_cast<ptrdiff_t>(y) * stride, value, width);
+  }
+}
+
+void CopyPlane(const uint8_t* src,
+               int src_stride,
+               uint8_t* dst,
+               int dst_stride,
+               int width,
+               int height) {
+  if (width <= 0) {
+    return;
+  }
+  for (int y = 0; y < height; ++y) {
+    memcpy(dst + static_cast<ptrdiff_t>(y) * dst_stride,
+           src + static_cast<ptrdiff_t>(y) * src_stride, width);
+  }
+}
+
+void InterpolateRow(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, int f) {
+  InterpolateRowImpl(a, b, dst, width, f);
+}
+
+void BlendRow(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int width) {
+  BlendRowImpl(src, alpha, dst, width);
+}
+
+PlaneScaler::PlaneScaler()
+    : src_width_(0),
+      src_height_(0),
+      dst_width_(0),
+      dst_height_(0),
+      x_simd_count_(0),
+      last_used_(0) {
+  row_y_[0] = -1;
+  row_y_[1] = -1;
+}
+
+void PlaneScaler::Configure(int src_width, int src_height, int dst_width, int dst_height) {
+  if (src_width == src_width_ && dst_width == dst_width_ && src_height == src_height_ &&
+      dst_height == dst_height_) {
+    return;
+  }
+  src_width_ = src_width;
+  src_height_ = src_height;
+  dst_width_ = dst_width;
+  dst_height_ = dst_height;
+
+  // 像素中心对齐的 16.16 定点映射
+  x_index_.resize(dst_width);
+  x_weight_.resize(dst_width);
+  x_simd_count_ = 0;
+  int64_t step = (static_cast<int64_t>(src_width) << 16) / dst_width;
+  int64_t pos = step / 2 - 32768;
+  for (int x = 0; x < dst_width; ++x, pos += step) {
+    int64_t p = pos < 0 ? 0 : pos;
+    int index = static_cast<int>(p >> 16);
+    int f = static_cast<int>((p & 0xFFFF) >> 10);
+    if (index >= src_width - 1) {
+      index = src_width - 1;
+      f = 0;
+    }
+    x_index_[x] = index;
+    x_weight_[x] = static_cast<uint16_t>((64 - f) | (f << 8));
+    if (index + 3 < src_width) {
+      x_simd_count_ = x + 1;
+    }
+  }
+
+  y_index_.resize(dst_height);
+  y_fraction_.resize(dst_height);
+  step = (static_cast<int64_t>(src_height) << 16) / dst_height;
+  pos = step / 2 - 32768;
+  for (int y = 0; y < dst_height; ++y, pos += step) {
+    int64_t p = pos < 0 ? 0 : pos;
+    int index = static_cast<int>(p >> 16);
+    int f = static_cast<int>((p & 0xFFFF) >> 9);
+    if (index >= src_height - 1) {
+      index = src_height - 1;
+      f = 0;
+    }
+    y_index_[y] = index;
+    y_fraction_[y] = static_cast<uint8_t>(f);
+  }
+
+  rows_[0].resize(dst_width);
+  rows_[1].resize(dst_width);
+}
+
+const uint8_t* PlaneScaler::ScaledRow(const uint8_t* src,
+                                      int src_stride,
+                                      int src_y,
+                                      int clip_x,
+                                      int clip_width) {
+  const uint8_t* src_row = src + static_cast<ptrdiff_t>(src_y) * src_stride;
+  if (src_width_ == dst_width_) {
+    return src_row + clip_x;
+  }
+  for (int i = 0; i < 2; ++i) {
+    if (row_y_[i] == src_y) {
+      last_used_ = i;
+      return rows_[i].data();
+    }
+  }
+  int slot = 1 - last_used_;
+  // 采样表按目标像素存放源下标，截取一段即可只算裁剪区域
+  const int simd_count = std::max(0, std::min(x_simd_count_ - clip_x, clip_width));
+  ScaleRowH(src_row, src_width_, x_index_.data() + clip_x, x_weight_.data() + clip_x,
+            rows_[slot].data(), simd_count, clip_width);
+  row_y_[slot] = src_y;
+  last_used_ = slot;
+  return rows_[slot].data();
+}
+
+void PlaneScaler::Scale(const uint8_t* src,
+                        int src_stride,
+                        int src_width,
+                        int src_height,
+                        uint8_t* dst,
+                        int dst_stride,
+                        int dst_width,
+                        int dst_height) {
+  ScaleClipped(src, src_stride, src_width, src_height, dst, dst_stride, dst_width, dst_height, 0,
+               0, dst_width, dst_height);
+}
+
+void PlaneScaler::ScaleClipped(const uint8_t* src,
+                               int src_stride,
+                               int src_width,
+                               int src_height,
+                               uint8_t* dst,
+                               int dst_stride,
+                               int dst_width,
+                               int dst_height,
+                               int clip_x,
+                               int clip_y,
+                               int clip_width,
+                               int clip_height) {
+  if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+    return;
+  }
+  clip_width = std::min(clip_width, dst_width - clip_x);
+  clip_height = std::min(clip_height, dst_height - clip_y);
+  if (clip_x < 0 || clip_y < 0 || clip_width <= 0 || clip_height <= 0) {
+    return;
+  }
+  uint8_t* dst_origin = dst + static_cast<ptrdiff_t>(clip_y) * dst_stride + clip_x;
+  if (src_width == dst_width && src_height == dst_height) {
+    CopyPlane(src + static_cast<ptrdiff_t>(clip_y) * src_stride + clip_x, src_stride, dst_origin,
+              dst_stride, clip_width, clip_height);
+    return;
+  }
+  Configure(src_width, src_height, dst_width, dst_height);
+  row_y_[0] = -1;
+  row_y_[1] = -1;
+
+  for (int y = 0; y < clip_height; ++y) {
+    uint8_t* dst_row = dst_origin + static_cast<ptrdiff_t>(y) * dst_stride;
+    int src_y = y_index_[clip_y + y];
+    int f = y_fraction_[clip_y + y];
+    const uint8_t* row0 = ScaledRow(src, src_stride, src_y, clip_x, clip_width);
+    if (f == 0) {
+      memcpy(dst_row, row0, clip_width);
+      continue;
+    }
+    const uint8_t* row1 = ScaledRow(src, src_stride, src_y + 1, clip_x, clip_width);
+    InterpolateRowImpl(row0, row1, dst_row, clip_width, f);
+  }
+}
+
+}  // namespace swing
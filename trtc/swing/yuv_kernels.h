@@ -0,0 +1,108 @@
+//
+// 功能说明：
+//   YUV420p 画面处理的基础算子：平面填充、双线性缩放、行插值和 alpha 混合。
+//   x86 上运行时检测 AVX2，ARM64 上使用 NEON，其余情况走标量实现，
+//   三种实现的输出逐字节一致。
+//
+
+#ifndef GCHATGPT_TRTC_SWING_YUV_KERNELS_H_
+#define GCHATGPT_TRTC_SWING_YUV_KERNELS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace swing {
+
+// 当前使用的实现："avx2"、"neon" 或 "c"
+const char* YuvKernelName();
+
+// 强制使用标量实现，用于基准测试对比
+void ForceScalarYuvKernels(bool force);
+
+// RGB（0x00RRGGBB）转 BT.601 limited range YUV
+void RgbToYuv(int rgb, uint8_t* y, uint8_t* u, uint8_t* v);
+
+void FillPlane(uint8_t* dst, int stride, int width, int height, uint8_t value);
+
+void CopyPlane(const uint8_t* src,
+               int src_stride,
+               uint8_t* dst,
+               int dst_stride,
+               int width,
+               int height);
+
+// 两行按权重插值
+// dst[i] = (a[i] * (128 - f) + b[i] * f + 64) >> 7，|f| 取值 [0, 128]
+void InterpolateRow(const uint8_t* a, const uint8_t* b, uint8_t* dst, int width, int f);
+
+// 按 alpha 把 |src| 叠加到 |dst|
+// dst[i] = (dst[i] * (256 - w) + src[i] * w + 128) >> 8，w = alpha[i] + (alpha[i] >> 7)，
+// alpha 为 0 时保持 dst，为 255 时取 src。
+void BlendRow(const uint8_t* src, const uint8_t* alpha, uint8_t* dst, int width);
+
+// 单平面双线性缩放
+// 横向、纵向的采样表按 (源尺寸, 目标尺寸) 缓存，尺寸不变时重复使用；
+// 横向插值结果按源行缓存，放大时相邻目标行共用。
+class PlaneScaler {
+ public:
+  PlaneScaler();
+
+  void Scale(const uint8_t* src,
+             int src_stride,
+             int src_width,
+             int src_height,
+             uint8_t* dst,
+             int dst_stride,
+             int dst_width,
+             int dst_height);
+
+  // 只输出目标画面中的一块区域，|dst| 仍指向目标画面左上角
+  // 区域为 [clip_x, clip_x + clip_width) x [clip_y, clip_y + clip_height)，
+  // 结果与整幅缩放后的对应位置逐字节一致，用于局部重绘。
+  void ScaleClipped(const uint8_t* src,
+                    int src_stride,
+                    int src_width,
+                    int src_height,
+                    uint8_t* dst,
+                    int dst_stride,
+                    int dst_width,
+                    int dst_height,
+                    int clip_x,
+                    int clip_y,
+                    int clip_width,
+                    int clip_height);
+
+ private:
+  void Configure(int src_width, int src_height, int dst_width, int dst_height);
+  const uint8_t* ScaledRow(const uint8_t* src,
+                           int src_stride,
+                           int src_y,
+                           int clip_x,
+                           int clip_width);
+
+  int src_width_;
+  int src_height_;
+  int dst_width_;
+  int dst_height_;
+
+  // 横向：目标像素对应的源下标和 6 位权重 (64 - f) | f << 8
+  std::vector<int32_t> x_index_;
+  std::vector<uint16_t> x_weight_;
+  // 源下标 + 3 仍在行内的目标像素个数，SIMD 一次读取 4 字节
+  int x_simd_count_;
+
+  // 纵向：目标行对应的源行和 7 位权重 f
+  std::vector<int32_t> y_index_;
+  std::vector<uint8_t> y_fraction_;
+
+  // 两行横向缩放结果及其对应的源行号，每次 Scale() 开始时清空
+  std::vector<uint8_t> rows_[2];
+  int row_y_[2];
+  int last_used_;
+};
+
+}  // namespace swing
+
+#endif  // GCHATGPT_TRTC_SWING_YUV_KERNELS_H_
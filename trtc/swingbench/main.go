@@ -0,0 +1,98 @@
+// swingbench 运行 trtc/swing 的微基准
+//
+// 参数沿用 Google Benchmark 的命名，JSON 输出可直接交给其 tools/compare.py 对比：
+//
+//	go run ./trtc/swingbench -benchmark_filter 'Mix|Resampler' -benchmark_out new.json
+//	compare.py benchmarks old.json new.json
+//
+// 不链接 libliteav 时加 -tags loopback。
+package main
+
+import (
+	"encoding/json"
+	"flag"
+	"fmt"
+	"gchatgpt/trtc/swing"
+	"os"
+	"text/tabwriter"
+	"time"
+)
+
+type benchmarkRun struct {
+	Name           string  `json:"name"`
+	Iterations     int64   `json:"iterations"`
+	RealTime       float64 `json:"real_time"`
+	CPUTime        float64 `json:"cpu_time"`
+	BytesPerSecond float64 `json:"bytes_per_second"`
+	ItemsPerSecond float64 `json:"items_per_second"`
+	Label          string  `json:"label"`
+	ErrorOccurred  bool    `json:"error_occurred"`
+	ErrorMessage   string  `json:"error_message"`
+}
+
+type benchmarkReport struct {
+	Context    map[string]interface{} `json:"context"`
+	Benchmarks []benchmarkRun         `json:"benchmarks"`
+}
+
+func main() {
+	filter := flag.String("benchmark_filter", "", "只运行名称匹配该正则的基准")
+	minTime := flag.Float64("benchmark_min_time", 0.5, "每个基准最短运行时间，单位秒")
+	format := flag.String("benchmark_format", "console", "标准输出格式：console 或 json")
+	out := flag.String("benchmark_out", "", "另外把 JSON 结果写入该文件")
+	flag.Parse()
+
+	results, err := swing.RunBenchmarks(*filter, time.Duration(*minTime*float64(time.Second)))
+	if err != nil {
+		fmt.Fprintln(os.Stderr, "Error:", err)
+		os.Exit(1)
+	}
+	if *out != "" {
+		if err := os.WriteFile(*out, []byte(results), 0644); err != nil {
+			fmt.Fprintln(os.Stderr, "Error:", err)
+			os.Exit(1)
+		}
+	}
+
+	switch *format {
+	case "json":
+		fmt.Print(results)
+	case "console":
+		var report benchmarkReport
+		if err := json.Unmarshal([]byte(results), &report); err != nil {
+			fmt.Fprintln(os.Stderr, "Error:", err)
+			os.Exit(1)
+		}
+		printConsole(report)
+	default:
+		fmt.Fprintln(os.Stderr, "Error: unknown -benchmark_format", *format)
+		os.Exit(1)
+	}
+}
+
+func printConsole(report benchmarkReport) {
+	fmt.Printf("audio kernels: %v, yuv kernels: %v, aes kernels: %v, cpus: %v\n",
+		report.Context["audio_kernels"], report.Context["yuv_kernels"],
+		report.Context["aes_kernels"], report.Context["num_cpus"])
+	w := tabwriter.NewWriter(os.Stdout, 0, 0, 2, ' ', tabwriter.AlignRight)
+	fmt.Fprintln(w, "Benchmark\tTime\tCPU\tIterations\tThroughput\t")
+	for _, run := range report.Benchmarks {
+		if run.ErrorOccurred {
+			fmt.Fprintf(w, "%s\t\t\t\tERROR: %s\t\n", run.Name, run.ErrorMessage)
+			continue
+		}
+		throughput := ""
+		switch {
+		case run.BytesPerSecond > 0:
+			throughput = fmt.Sprintf("%.1f MiB/s", run.BytesPerSecond/(1<<20))
+		case run.ItemsPerSecond > 0:
+			throughput = fmt.Sprintf("%.1f k/s", run.ItemsPerSecond/1000)
+		}
+		if run.Label != "" {
+			throughput += " " + run.Label
+		}
+		fmt.Fprintf(w, "%s\t%.0f ns\t%.0f ns\t%d\t%s\t\n",
+			run.Name, run.RealTime, run.CPUTime, run.Iterations, throughput)
+	}
+	w.Flush()
+}
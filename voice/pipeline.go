@@ -0,0 +1,481 @@
+// Package voice 把房间里的语音接到对话：语音识别 -> 对话生成 -> 逐 token 回复
+//
+// 每个用户两个 goroutine，RemoveUser() 后退出，各阶段之间都是有界队列：
+//   - 输入队列（PipelineConfig.AudioQueue）：满时丢弃音频帧并计数，语句开始 / 结束不丢弃；
+//   - 识别 goroutine 把音频送给 TranscriberStream，每句话交给回复 goroutine（TurnQueue）；
+//   - 回复 goroutine 读识别结果，生成回复，token 先进入 TokenQueue，再送到 Replies()。
+//
+// 提前开始：中间结果保持 StableFor 不变，或以句末标点结尾时，不等最终结果就开始生成回复，
+// token 先缓存不送出。最终结果与之相同（忽略标点、空白与大小写）时直接采用，
+// 省掉识别尾部与生成首 token 的时间；不同时作废并按最终结果重新生成。
+// 只有采用的回复才调用 Responder.Commit()，对话历史里不会出现作废的回复。
+package voice
+
+import (
+	"context"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unicode"
+)
+
+type PipelineConfig struct {
+	// 每个用户的输入队列长度，单位帧
+	AudioQueue int
+	// 每个用户等待回复的语句数
+	TurnQueue int
+	// 每个回复缓存的 token 数
+	TokenQueue int
+	// Replies() 的长度
+	ReplyQueue int
+	// 中间结果保持不变多久后提前开始生成回复，0 表示不提前
+	StableFor time.Duration
+	// 计算延迟分位数所用的样本数
+	LatencyWindow int
+}
+
+func DefaultPipelineConfig() PipelineConfig {
+	return PipelineConfig{
+		AudioQueue:    100,
+		TurnQueue:     4,
+		TokenQueue:    256,
+		ReplyQueue:    256,
+		StableFor:     200 * time.Millisecond,
+		LatencyWindow: 256,
+	}
+}
+
+// 回复，同一用户的回复按语句顺序送出
+// 每个 token 一条，Token 非空；一句回复结束时再送一条 Done 为 true 的，
+// 带完整回复 Answer 或错误 Err。
+type Reply struct {
+	UserID string
+	// 识别出的文字
+	Text   string
+	Token  string
+	Done   bool
+	Answer string
+	Err    error
+}
+
+type Pipeline struct {
+	transcriber Transcriber
+	responder   Responder
+	config      PipelineConfig
+
+	ctx     context.Context
+	cancel  context.CancelFunc
+	replies chan Reply
+	wg      sync.WaitGroup
+
+	mu     sync.RWMutex
+	closed bool
+	users  map[string]*userPipe
+
+	utterances      atomic.Uint64
+	emptyUtterances atomic.Uint64
+	earlyStarts     atomic.Uint64
+	earlyHits       atomic.Uint64
+	earlyMisses     atomic.Uint64
+	droppedFrames   atomic.Uint64
+	errors          atomic.Uint64
+	firstToken      *latencyWindow
+}
+
+const (
+	inputStart = iota
+	inputAudio
+	inputEnd
+)
+
+type inputEvent struct {
+	kind       int
+	samples    []int16
+	sampleRate int
+	at         time.Time
+}
+
+type userPipe struct {
+	id    string
+	input chan inputEvent
+	turns chan *turn
+}
+
+// 一句话
+type turn struct {
+	userID string
+	stream TranscriberStream
+	// 关闭前写入 endAt
+	ended chan struct{}
+	endAt time.Time
+}
+
+// 一次回复生成
+type response struct {
+	text   string
+	cancel context.CancelFunc
+	tokens chan string
+	// tokens 关闭前写入
+	answer string
+	err    error
+}
+
+func NewPipeline(transcriber Transcriber, responder Responder, config PipelineConfig) *Pipeline {
+	defaults := DefaultPipelineConfig()
+	if config.AudioQueue <= 0 {
+		config.AudioQueue = defaults.AudioQueue
+	}
+	if config.TurnQueue <= 0 {
+		config.TurnQueue = defaults.TurnQueue
+	}
+	if config.TokenQueue <= 0 {
+		config.TokenQueue = defaults.TokenQueue
+	}
+	if config.ReplyQueue <= 0 {
+		config.ReplyQueue = defaults.ReplyQueue
+	}
+	if config.LatencyWindow <= 0 {
+		config.LatencyWindow = defaults.LatencyWindow
+	}
+	ctx, cancel := context.WithCancel(context.Background())
+	return &Pipeline{
+		transcriber: transcriber,
+		responder:   responder,
+		config:      config,
+		ctx:         ctx,
+		cancel:      cancel,
+		replies:     make(chan Reply, config.ReplyQueue),
+		users:       make(map[string]*userPipe),
+		firstToken:  newLatencyWindow(config.LatencyWindow),
+	}
+}
+
+// 以下三个输入方法需按事件顺序调用，samples 交给流水线后调用方不再修改
+
+func (p *Pipeline) StartUtterance(userID string, sampleRate int) {
+	p.send(userID, inputEvent{kind: inputStart, sampleRate: sampleRate, at: time.Now()}, true)
+}
+
+// 返回 false 表示队列满，帧被丢弃
+func (p *Pipeline) Audio(userID string, samples []int16) bool {
+	return p.send(userID, inputEvent{kind: inputAudio, samples: samples}, false)
+}
+
+func (p *Pipeline) EndUtterance(userID string) {
+	p.send(userID, inputEvent{kind: inputEnd, at: time.Now()}, true)
+}
+
+// 用户离开，结束进行中的语句并释放该用户的 goroutine
+// 已排队的语句仍会回复完，之后同一用户的输入按新用户处理。
+func (p *Pipeline) RemoveUser(userID string) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	u := p.users[userID]
+	if p.closed || u == nil {
+		return
+	}
+	delete(p.users, userID)
+	close(u.input)
+}
+
+// 回复通道，Close() 后关闭，调用方需持续读取
+func (p *Pipeline) Replies() <-chan Reply {
+	return p.replies
+}
+
+func (p *Pipeline) Stats() Stats {
+	return Stats{
+		Utterances:      p.utterances.Load(),
+		EmptyUtterances: p.emptyUtterances.Load(),
+		EarlyStarts:     p.earlyStarts.Load(),
+		EarlyHits:       p.earlyHits.Load(),
+		EarlyMisses:     p.earlyMisses.Load(),
+		DroppedFrames:   p.droppedFrames.Load(),
+		Errors:          p.errors.Load(),
+		FirstToken:      p.firstToken.Stats(),
+	}
+}
+
+// 取消进行中的识别与回复，等待各 goroutine 退出后关闭 Replies()
+func (p *Pipeline) Close() {
+	p.cancel()
+	p.mu.Lock()
+	if p.closed {
+		p.mu.Unlock()
+		return
+	}
+	p.closed = true
+	for _, u := range p.users {
+		close(u.input)
+	}
+	p.mu.Unlock()
+	p.wg.Wait()
+	close(p.replies)
+}
+
+// 在读锁下写入，RemoveUser() 与 Close() 关闭输入队列前等待写入完成
+func (p *Pipeline) send(userID string, event inputEvent, wait bool) bool {
+	p.mu.RLock()
+	defer p.mu.RUnlock()
+	u := p.users[userID]
+	for u == nil && !p.closed {
+		p.mu.RUnlock()
+		p.addUser(userID)
+		p.mu.RLock()
+		u = p.users[userID]
+	}
+	if p.closed {
+		return false
+	}
+	if !wait {
+		select {
+		case u.input <- event:
+			return true
+		default:
+			p.droppedFrames.Add(1)
+			return false
+		}
+	}
+	select {
+	case u.input <- event:
+		return true
+	case <-p.ctx.Done():
+		return false
+	}
+}
+
+func (p *Pipeline) addUser(userID string) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	if p.closed || p.users[userID] != nil {
+		return
+	}
+	u := &userPipe{
+		id:    userID,
+		input: make(chan inputEvent, p.config.AudioQueue),
+		turns: make(chan *turn, p.config.TurnQueue),
+	}
+	p.users[userID] = u
+	p.wg.Add(2)
+	go p.transcribe(u)
+	go p.respond(u)
+}
+
+// 识别 goroutine
+func (p *Pipeline) transcribe(u *userPipe) {
+	defer p.wg.Done()
+	defer close(u.turns)
+	var current *turn
+	finish := func(at time.Time) {
+		current.endAt = at
+		close(current.ended)
+		current.stream.Close()
+		current = nil
+	}
+	for event := range u.input {
+		switch event.kind {
+		case inputStart:
+			if current != nil {
+				finish(event.at)
+			}
+			stream, err := p.transcriber.Start(p.ctx, u.id, event.sampleRate)
+			if err != nil {
+				p.errors.Add(1)
+				p.emit(Reply{UserID: u.id, Done: true, Err: err})
+				continue
+			}
+			t := &turn{userID: u.id, stream: stream, ended: make(chan struct{})}
+			select {
+			case u.turns <- t:
+				current = t
+			case <-p.ctx.Done():
+				stream.Close()
+			}
+		case inputAudio:
+			if current != nil {
+				if err := current.stream.Write(event.samples); err != nil {
+					p.errors.Add(1)
+				}
+			}
+		case inputEnd:
+			if current != nil {
+				finish(event.at)
+			}
+		}
+	}
+	if current != nil {
+		finish(time.Now())
+	}
+}
+
+// 回复 goroutine
+func (p *Pipeline) respond(u *userPipe) {
+	defer p.wg.Done()
+	for t := range u.turns {
+		p.runTurn(t)
+	}
+}
+
+func (p *Pipeline) runTurn(t *turn) {
+	var early *response
+	defer func() {
+		if early != nil {
+			early.cancel()
+		}
+	}()
+
+	partial := ""
+	var stable *time.Timer
+	var stableC <-chan time.Time
+	defer func() {
+		if stable != nil {
+			stable.Stop()
+		}
+	}()
+
+	final, gotFinal := "", false
+	results := t.stream.Results()
+	for !gotFinal {
+		select {
+		case result, ok := <-results:
+			if !ok {
+				// 没有最终结果时按最后的中间结果处理
+				final, gotFinal = partial, true
+				break
+			}
+			if result.Final {
+				final, gotFinal = result.Text, true
+				break
+			}
+			if result.Text == partial {
+				break
+			}
+			partial = result.Text
+			if p.config.StableFor <= 0 {
+				break
+			}
+			if endsSentence(partial) {
+				early = p.startEarly(t, early, partial)
+				break
+			}
+			if stable == nil {
+				stable = time.NewTimer(p.config.StableFor)
+			} else {
+				if !stable.Stop() {
+					select {
+					case <-stable.C:
+					default:
+					}
+				}
+				stable.Reset(p.config.StableFor)
+			}
+			stableC = stable.C
+		case <-stableC:
+			stableC = nil
+			early = p.startEarly(t, early, partial)
+		case <-p.ctx.Done():
+			return
+		}
+	}
+
+	if normalize(final) == "" {
+		p.emptyUtterances.Add(1)
+		return
+	}
+	p.utterances.Add(1)
+	r := early
+	early = nil
+	if r != nil && normalize(r.text) == normalize(final) {
+		p.earlyHits.Add(1)
+	} else {
+		if r != nil {
+			r.cancel()
+			p.earlyMisses.Add(1)
+		}
+		r = p.generate(t.userID, final)
+	}
+	defer r.cancel()
+
+	first := true
+	for token := range r.tokens {
+		if first {
+			first = false
+			select {
+			case <-t.ended:
+				p.firstToken.Add(time.Since(t.endAt))
+			default:
+				// 识别服务自己断句，最终结果先于语音结束到达
+				p.firstToken.Add(0)
+			}
+		}
+		if !p.emit(Reply{UserID: t.userID, Text: final, Token: token}) {
+			return
+		}
+	}
+	if r.err != nil {
+		p.errors.Add(1)
+	} else {
+		p.responder.Commit(t.userID, final, r.answer)
+	}
+	p.emit(Reply{UserID: t.userID, Text: final, Done: true, Answer: r.answer, Err: r.err})
+}
+
+// 按中间结果提前开始，与进行中的相同时沿用
+func (p *Pipeline) startEarly(t *turn, early *response, text string) *response {
+	if normalize(text) == "" {
+		return early
+	}
+	if early != nil {
+		if normalize(early.text) == normalize(text) {
+			return early
+		}
+		early.cancel()
+		p.earlyMisses.Add(1)
+	}
+	p.earlyStarts.Add(1)
+	return p.generate(t.userID, text)
+}
+
+func (p *Pipeline) generate(userID, text string) *response {
+	ctx, cancel := context.WithCancel(p.ctx)
+	r := &response{text: text, cancel: cancel, tokens: make(chan string, p.config.TokenQueue)}
+	go func() {
+		defer close(r.tokens)
+		r.answer, r.err = p.responder.Respond(ctx, userID, text, r.tokens)
+	}()
+	return r
+}
+
+func (p *Pipeline) emit(reply Reply) bool {
+	select {
+	case p.replies <- reply:
+		return true
+	case <-p.ctx.Done():
+		return false
+	}
+}
+
+// 去掉标点与空白并转小写，比较中间结果与最终结果
+func normalize(text string) string {
+	var b strings.Builder
+	for _, r := range text {
+		if unicode.IsPunct(r) || unicode.IsSpace(r) || unicode.IsSymbol(r) {
+			continue
+		}
+		b.WriteRune(unicode.ToLower(r))
+	}
+	return b.String()
+}
+
+func endsSentence(text string) bool {
+	text = strings.TrimRightFunc(text, unicode.IsSpace)
+	if text == "" {
+		return false
+	}
+	switch text[len(text)-1] {
+	case '.', '?', '!':
+		return true
+	}
+	return strings.HasSuffix(text, "。") || strings.HasSuffix(text, "？") || strings.HasSuffix(text, "！")
+}
@@ -0,0 +1,244 @@
+package voice
+
+import (
+	"context"
+	"strings"
+	"testing"
+	"time"
+)
+
+const testSampleRate = 16000
+
+// 10ms 有声帧
+func voicedFrame() []int16 {
+	samples := make([]int16, testSampleRate/100)
+	for i := range samples {
+		samples[i] = 1000
+	}
+	return samples
+}
+
+func newTestPipeline(transcriber Transcriber, config PipelineConfig) *Pipeline {
+	responder := &LocalResponder{FirstTokenDelay: time.Millisecond, TokenDelay: time.Millisecond}
+	return NewPipeline(transcriber, responder, config)
+}
+
+func sendAudio(p *Pipeline, userID string, frames int) {
+	for i := 0; i < frames; i++ {
+		p.Audio(userID, voicedFrame())
+	}
+}
+
+// 读取 userID 的一句回复，检查 token 在 Done 之前且拼起来等于 Answer
+func readAnswer(t *testing.T, p *Pipeline, userID string) Reply {
+	t.Helper()
+	var tokens strings.Builder
+	timeout := time.After(5 * time.Second)
+	for {
+		select {
+		case reply, ok := <-p.Replies():
+			if !ok {
+				t.Fatal("replies closed before the answer")
+			}
+			if reply.UserID != userID {
+				t.Fatalf("reply for %q, want %q", reply.UserID, userID)
+			}
+			if !reply.Done {
+				tokens.WriteString(reply.Token)
+				continue
+			}
+			if reply.Err != nil {
+				t.Fatalf("reply error: %v", reply.Err)
+			}
+			if tokens.String() != reply.Answer {
+				t.Fatalf("tokens %q, answer %q", tokens.String(), reply.Answer)
+			}
+			return reply
+		case <-timeout:
+			t.Fatal("timed out waiting for the answer")
+		}
+	}
+}
+
+func TestEarlyStartHit(t *testing.T) {
+	transcriber := &LocalTranscriber{
+		Script:          []string{"a b c"},
+		WordDuration:    10 * time.Millisecond,
+		PartialInterval: 10 * time.Millisecond,
+		FinalDelay:      10 * time.Millisecond,
+	}
+	config := DefaultPipelineConfig()
+	config.StableFor = 20 * time.Millisecond
+	p := newTestPipeline(transcriber, config)
+	defer p.Close()
+
+	p.StartUtterance("u1", testSampleRate)
+	sendAudio(p, "u1", 5)
+	// 中间结果 "a b c" 保持不变超过 StableFor，提前开始
+	time.Sleep(150 * time.Millisecond)
+	p.EndUtterance("u1")
+
+	reply := readAnswer(t, p, "u1")
+	if reply.Text != "a b c" || reply.Answer != "收到：abc" {
+		t.Fatalf("reply %q -> %q", reply.Text, reply.Answer)
+	}
+	stats := p.Stats()
+	if stats.EarlyStarts != 1 || stats.EarlyHits != 1 || stats.EarlyMisses != 0 {
+		t.Fatalf("early starts %d hits %d misses %d", stats.EarlyStarts, stats.EarlyHits, stats.EarlyMisses)
+	}
+}
+
+func TestEarlyStartMiss(t *testing.T) {
+	transcriber := &LocalTranscriber{
+		Script:          []string{"a b c"},
+		WordDuration:    100 * time.Millisecond,
+		PartialInterval: 10 * time.Millisecond,
+		FinalDelay:      5 * time.Millisecond,
+	}
+	config := DefaultPipelineConfig()
+	config.StableFor = 50 * time.Millisecond
+	p := newTestPipeline(transcriber, config)
+	defer p.Close()
+
+	p.StartUtterance("u1", testSampleRate)
+	sendAudio(p, "u1", 20)
+	// 按 "a b" 提前开始
+	time.Sleep(200 * time.Millisecond)
+	// 最终结果 "a b c" 在 StableFor 之前到达，作废提前开始的回复
+	sendAudio(p, "u1", 10)
+	p.EndUtterance("u1")
+
+	reply := readAnswer(t, p, "u1")
+	if reply.Text != "a b c" || reply.Answer != "收到：abc" {
+		t.Fatalf("reply %q -> %q", reply.Text, reply.Answer)
+	}
+	stats := p.Stats()
+	if stats.EarlyStarts != 1 || stats.EarlyHits != 0 || stats.EarlyMisses != 1 {
+		t.Fatalf("early starts %d hits %d misses %d", stats.EarlyStarts, stats.EarlyHits, stats.EarlyMisses)
+	}
+}
+
+// Start() 阻塞到 release 关闭，期间识别 goroutine 不读输入队列
+type blockingTranscriber struct {
+	Transcriber
+	started chan struct{}
+	release chan struct{}
+}
+
+func (b *blockingTranscriber) Start(ctx context.Context, userID string, sampleRate int) (TranscriberStream, error) {
+	close(b.started)
+	<-b.release
+	return b.Transcriber.Start(ctx, userID, sampleRate)
+}
+
+func TestAudioQueueFullDrops(t *testing.T) {
+	transcriber := &blockingTranscriber{
+		Transcriber: &LocalTranscriber{
+			Script:          []string{"a"},
+			WordDuration:    10 * time.Millisecond,
+			PartialInterval: 10 * time.Millisecond,
+		},
+		started: make(chan struct{}),
+		release: make(chan struct{}),
+	}
+	config := DefaultPipelineConfig()
+	config.AudioQueue = 4
+	config.StableFor = 0
+	p := newTestPipeline(transcriber, config)
+	defer p.Close()
+
+	p.StartUtterance("u1", testSampleRate)
+	<-transcriber.started
+	accepted := 0
+	for i := 0; i < 10; i++ {
+		if p.Audio("u1", voicedFrame()) {
+			accepted++
+		}
+	}
+	if accepted != 4 {
+		t.Fatalf("accepted %d frames, want 4", accepted)
+	}
+	if dropped := p.Stats().DroppedFrames; dropped != 6 {
+		t.Fatalf("dropped %d frames, want 6", dropped)
+	}
+
+	// 语句结束不丢弃，队列腾出后送达
+	close(transcriber.release)
+	p.EndUtterance("u1")
+	if reply := readAnswer(t, p, "u1"); reply.Text != "a" {
+		t.Fatalf("text %q, want %q", reply.Text, "a")
+	}
+}
+
+func TestCloseOrdering(t *testing.T) {
+	transcriber := &LocalTranscriber{
+		Script:          []string{"a"},
+		WordDuration:    10 * time.Millisecond,
+		PartialInterval: 10 * time.Millisecond,
+	}
+	config := DefaultPipelineConfig()
+	config.StableFor = 0
+	// 回复迟迟不出 token，Close() 需取消生成才能返回
+	p := NewPipeline(transcriber, &LocalResponder{FirstTokenDelay: time.Hour}, config)
+	p.StartUtterance("u1", testSampleRate)
+	sendAudio(p, "u1", 5)
+	p.EndUtterance("u1")
+	time.Sleep(50 * time.Millisecond)
+
+	closed := make(chan struct{})
+	go func() {
+		p.Close()
+		close(closed)
+	}()
+	select {
+	case <-closed:
+	case <-time.After(5 * time.Second):
+		t.Fatal("Close() did not return")
+	}
+	// Close() 返回时所有 goroutine 已退出，Replies() 已关闭
+	for reply := range p.Replies() {
+		if reply.Done && reply.Err == nil {
+			t.Fatalf("unexpected answer after Close(): %+v", reply)
+		}
+	}
+	if p.Audio("u1", voicedFrame()) {
+		t.Fatal("Audio() accepted a frame after Close()")
+	}
+	p.StartUtterance("u2", testSampleRate)
+	p.RemoveUser("u1")
+	p.Close()
+}
+
+func TestRemoveUser(t *testing.T) {
+	transcriber := &LocalTranscriber{
+		Script:          []string{"a", "b"},
+		WordDuration:    10 * time.Millisecond,
+		PartialInterval: 10 * time.Millisecond,
+	}
+	config := DefaultPipelineConfig()
+	config.StableFor = 0
+	p := newTestPipeline(transcriber, config)
+	defer p.Close()
+
+	// 说话中离开：语句随输入关闭结束，仍会回复
+	p.StartUtterance("u1", testSampleRate)
+	sendAudio(p, "u1", 5)
+	p.RemoveUser("u1")
+	if reply := readAnswer(t, p, "u1"); reply.Text != "a" {
+		t.Fatalf("text %q, want %q", reply.Text, "a")
+	}
+	p.mu.RLock()
+	users := len(p.users)
+	p.mu.RUnlock()
+	if users != 0 {
+		t.Fatalf("%d users after RemoveUser(), want 0", users)
+	}
+
+	// 再次说话时按新用户处理
+	p.StartUtterance("u1", testSampleRate)
+	sendAudio(p, "u1", 5)
+	p.EndUtterance("u1")
+	if reply := readAnswer(t, p, "u1"); reply.Text != "b" {
+		t.Fatalf("text %q, want %q", reply.Text, "b")
+	}
+}
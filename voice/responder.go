@@ -0,0 +1,55 @@
+package voice
+
+import (
+	"context"
+	"strings"
+	"time"
+)
+
+// 可替换的对话生成
+type Responder interface {
+	// 生成回复，逐个 token 写入 tokens，返回完整回复
+	// 写 tokens 时需同时等待 ctx.Done()，ctx 取消后尽快返回 ctx.Err()。
+	// 提前开始的回复可能被取消，Respond() 不应修改对话历史。
+	Respond(ctx context.Context, userID, text string, tokens chan<- string) (string, error)
+	// 采用一轮回复后调用，由实现记录对话历史
+	Commit(userID, text, answer string)
+}
+
+// 本地替身，逐词复述问题，用于在没有对话服务时跑通和压测整条链路
+type LocalResponder struct {
+	FirstTokenDelay time.Duration
+	TokenDelay      time.Duration
+}
+
+func NewLocalResponder() *LocalResponder {
+	return &LocalResponder{
+		FirstTokenDelay: 300 * time.Millisecond,
+		TokenDelay:      30 * time.Millisecond,
+	}
+}
+
+func (r *LocalResponder) Respond(ctx context.Context, userID, text string, tokens chan<- string) (string, error) {
+	words := append([]string{"收到："}, strings.Fields(text)...)
+	delay := r.FirstTokenDelay
+	var answer strings.Builder
+	for _, word := range words {
+		timer := time.NewTimer(delay)
+		select {
+		case <-timer.C:
+		case <-ctx.Done():
+			timer.Stop()
+			return answer.String(), ctx.Err()
+		}
+		select {
+		case tokens <- word:
+		case <-ctx.Done():
+			return answer.String(), ctx.Err()
+		}
+		answer.WriteString(word)
+		delay = r.TokenDelay
+	}
+	return answer.String(), nil
+}
+
+func (r *LocalResponder) Commit(userID, text, answer string) {}
@@ -0,0 +1,82 @@
+package voice
+
+import (
+	"sort"
+	"sync"
+	"time"
+)
+
+type LatencyStats struct {
+	Count uint64
+	Last  time.Duration
+	Max   time.Duration
+	// 以下按最近的样本计算
+	Mean time.Duration
+	P50  time.Duration
+	P95  time.Duration
+}
+
+type Stats struct {
+	// 有文字的语句数与识别结果为空的语句数
+	Utterances      uint64
+	EmptyUtterances uint64
+	// 按中间结果提前开始的回复数，其中被最终结果采用与作废的次数
+	EarlyStarts uint64
+	EarlyHits   uint64
+	EarlyMisses uint64
+	// 队列满时丢弃的音频帧数
+	DroppedFrames uint64
+	// 识别或回复出错的次数
+	Errors uint64
+	// 从 EndUtterance() 到第一个回复 token 送出的时间
+	FirstToken LatencyStats
+}
+
+// 最近若干个延迟样本
+type latencyWindow struct {
+	mu      sync.Mutex
+	samples []time.Duration
+	next    int
+	count   uint64
+	last    time.Duration
+	max     time.Duration
+}
+
+func newLatencyWindow(size int) *latencyWindow {
+	return &latencyWindow{samples: make([]time.Duration, 0, size)}
+}
+
+func (w *latencyWindow) Add(d time.Duration) {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	if len(w.samples) < cap(w.samples) {
+		w.samples = append(w.samples, d)
+	} else {
+		w.samples[w.next] = d
+		w.next = (w.next + 1) % len(w.samples)
+	}
+	w.count++
+	w.last = d
+	if d > w.max {
+		w.max = d
+	}
+}
+
+func (w *latencyWindow) Stats() LatencyStats {
+	w.mu.Lock()
+	sorted := append([]time.Duration(nil), w.samples...)
+	stats := LatencyStats{Count: w.count, Last: w.last, Max: w.max}
+	w.mu.Unlock()
+	if len(sorted) == 0 {
+		return stats
+	}
+	sort.Slice(sorted, func(i, j int) bool { return sorted[i] < sorted[j] })
+	var total time.Duration
+	for _, d := range sorted {
+		total += d
+	}
+	stats.Mean = total / time.Duration(len(sorted))
+	stats.P50 = sorted[len(sorted)*50/100]
+	stats.P95 = sorted[len(sorted)*95/100]
+	return stats
+}
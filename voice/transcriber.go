@@ -0,0 +1,176 @@
+package voice
+
+import (
+	"context"
+	"errors"
+	"strings"
+	"sync"
+	"time"
+)
+
+// 识别结果，Final 为 true 时是这句话的最终结果，之后结果通道关闭
+type Transcript struct {
+	Text  string
+	Final bool
+}
+
+// 一句话的流式识别
+type TranscriberStream interface {
+	// 送入单声道 PCM，调用方在 Close() 之后不再调用
+	Write(samples []int16) error
+	// 输入结束，最终结果随后送出
+	Close() error
+	// 中间结果与最终结果，最终结果送出后关闭
+	// 中间结果可以丢弃（通道满时），最终结果不丢弃。
+	Results() <-chan Transcript
+}
+
+// 可替换的语音识别
+// 每句话调用一次 Start()，ctx 取消时流应尽快关闭结果通道。
+type Transcriber interface {
+	Start(ctx context.Context, userID string, sampleRate int) (TranscriberStream, error)
+}
+
+var ErrStreamClosed = errors.New("voice: transcriber stream closed")
+
+// 本地替身，不做真正的识别，用于在没有识别服务时跑通和压测整条链路
+// 按有声音频的时长从 Script 中依次取词：每 WordDuration 一个词，静音帧不计入；
+// 每 PartialInterval 送出一次中间结果，Close() 后等待 FinalDelay 送出最终结果，
+// 模拟识别服务的尾部延迟。
+type LocalTranscriber struct {
+	Script          []string
+	WordDuration    time.Duration
+	PartialInterval time.Duration
+	FinalDelay      time.Duration
+
+	mu   sync.Mutex
+	next int
+}
+
+func NewLocalTranscriber() *LocalTranscriber {
+	return &LocalTranscriber{
+		Script: []string{
+			"今天 天气 怎么样",
+			"帮我 写 一首 关于 春天 的 诗",
+			"解释 一下 什么 是 量子 计算",
+			"推荐 几本 适合 入门 的 编程 书",
+		},
+		WordDuration:    300 * time.Millisecond,
+		PartialInterval: 200 * time.Millisecond,
+		FinalDelay:      80 * time.Millisecond,
+	}
+}
+
+func (t *LocalTranscriber) Start(ctx context.Context, userID string, sampleRate int) (TranscriberStream, error) {
+	if sampleRate <= 0 {
+		return nil, errors.New("voice: invalid sample rate")
+	}
+	t.mu.Lock()
+	var words []string
+	if len(t.Script) > 0 {
+		words = strings.Fields(t.Script[t.next%len(t.Script)])
+		t.next++
+	}
+	t.mu.Unlock()
+	return &localStream{
+		ctx:            ctx,
+		words:          words,
+		sampleRate:     sampleRate,
+		wordSamples:    samplesOf(t.WordDuration, sampleRate),
+		partialSamples: samplesOf(t.PartialInterval, sampleRate),
+		finalDelay:     t.FinalDelay,
+		results:        make(chan Transcript, 4),
+	}, nil
+}
+
+func samplesOf(d time.Duration, sampleRate int) int {
+	n := int(d * time.Duration(sampleRate) / time.Second)
+	if n <= 0 {
+		n = 1
+	}
+	return n
+}
+
+type localStream struct {
+	ctx            context.Context
+	words          []string
+	sampleRate     int
+	wordSamples    int
+	partialSamples int
+	finalDelay     time.Duration
+	results        chan Transcript
+
+	samples         int
+	sincePartial    int
+	lastPartialText string
+	closed          bool
+}
+
+func (s *localStream) text() string {
+	n := s.samples / s.wordSamples
+	if n > len(s.words) {
+		n = len(s.words)
+	}
+	return strings.Join(s.words[:n], " ")
+}
+
+func (s *localStream) Write(samples []int16) error {
+	if s.closed {
+		return ErrStreamClosed
+	}
+	if voiced(samples) {
+		s.samples += len(samples)
+	}
+	s.sincePartial += len(samples)
+	if s.sincePartial < s.partialSamples {
+		return nil
+	}
+	s.sincePartial = 0
+	text := s.text()
+	if text == "" || text == s.lastPartialText {
+		return nil
+	}
+	s.lastPartialText = text
+	select {
+	case s.results <- Transcript{Text: text}:
+	default:
+	}
+	return nil
+}
+
+// 峰值超过 -36dBFS 视为有声
+func voiced(samples []int16) bool {
+	for _, v := range samples {
+		if v > 512 || v < -512 {
+			return true
+		}
+	}
+	return false
+}
+
+func (s *localStream) Close() error {
+	if s.closed {
+		return ErrStreamClosed
+	}
+	s.closed = true
+	text := s.text()
+	go func() {
+		defer close(s.results)
+		timer := time.NewTimer(s.finalDelay)
+		defer timer.Stop()
+		select {
+		case <-timer.C:
+		case <-s.ctx.Done():
+			return
+		}
+		select {
+		case s.results <- Transcript{Text: text, Final: true}:
+		case <-s.ctx.Done():
+		}
+	}()
+	return nil
+}
+
+func (s *localStream) Results() <-chan Transcript {
+	return s.results
+}